@@ -96,6 +96,8 @@ CefRefPtr<CefPrintHandler> CClientAppBrowser::GetPrintHandler()
 
 void CClientAppBrowser::OnScheduleMessagePumpWork(int64 delay_ms)
 {
+  // Called from any thread, the work itself is done on Kodi's main thread
+  m_addonMain.GetMessagePump().ScheduleWork(delay_ms);
 }
 
 //@}
@@ -0,0 +1,116 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "BrowserCloseTracker.h"
+
+#include <algorithm>
+
+void CBrowserCloseTracker::CloseRequested(int uniqueClientId)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries[uniqueClientId] = {false, -1, CTimeStatistics::Now()};
+}
+
+void CBrowserCloseTracker::CloseSent(int uniqueClientId, int browserId)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const auto it = m_entries.find(uniqueClientId);
+  if (it != m_entries.end())
+    it->second.browserId = browserId;
+}
+
+void CBrowserCloseTracker::Closed(int uniqueClientId)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const auto it = m_entries.find(uniqueClientId);
+  if (it == m_entries.end() || it->second.closed)
+    return;
+
+  it->second.closed = true;
+  m_closeStats.AddSample(it->second.requested);
+}
+
+void CBrowserCloseTracker::Destroyed(int uniqueClientId)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto it = m_entries.find(uniqueClientId);
+    if (it == m_entries.end())
+      return;
+
+    m_destroyStats.AddSample(it->second.requested);
+    m_entries.erase(it);
+  }
+
+  m_condition.notify_all();
+}
+
+size_t CBrowserCloseTracker::Pending()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+bool CBrowserCloseTracker::WaitAll(std::chrono::milliseconds timeout,
+                                   const std::function<void()>& work,
+                                   std::chrono::microseconds interval)
+{
+  const auto deadline = CTimeStatistics::Now() + timeout;
+  while (true)
+  {
+    // Done without lock, the work can destroy clients on this thread
+    work();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const auto now = CTimeStatistics::Now();
+    if (m_entries.empty() || now >= deadline)
+      return m_entries.empty();
+
+    const auto next = std::min(deadline, now + interval);
+    if (m_condition.wait_until(lock, next, [this]() { return m_entries.empty(); }))
+      return true;
+  }
+}
+
+size_t CBrowserCloseTracker::LogPending()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const auto now = CTimeStatistics::Now();
+  size_t alive = 0;
+  for (const auto& entry : m_entries)
+  {
+    const double age =
+        std::chrono::duration<double, std::milli>(now - entry.second.requested).count();
+    if (entry.second.closed)
+    {
+      kodi::Log(ADDON_LOG_ERROR, "CBrowserCloseTracker::%s: Client %i closed, but not destroyed since %.1f ms",
+                __func__, entry.first, age);
+      continue;
+    }
+
+    alive++;
+    if (entry.second.browserId >= 0)
+      kodi::Log(ADDON_LOG_ERROR, "CBrowserCloseTracker::%s: Client %i browser %i still alive %.1f ms after close",
+                __func__, entry.first, entry.second.browserId, age);
+    else
+      kodi::Log(ADDON_LOG_ERROR, "CBrowserCloseTracker::%s: Client %i browser not created since %.1f ms, no close sent",
+                __func__, entry.first, age);
+  }
+  return alive;
+}
+
+void CBrowserCloseTracker::LogStatistics()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_closeStats.Log();
+  m_destroyStats.Log();
+}
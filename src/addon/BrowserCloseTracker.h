@@ -0,0 +1,84 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "utils/TimeStatistics.h"
+
+#include <condition_variable>
+#include <functional>
+#include <kodi/General.h>
+#include <map>
+#include <mutex>
+
+/*!
+ * @brief State of the browser clients on the way from the close request to
+ * their destruction.
+ *
+ * A client goes from CloseRequested() (DestroyControl() or shutdown) over
+ * CloseSent() (CloseBrowser(true) given to its browser) and Closed() (CEF's
+ * OnBeforeClose()) to Destroyed() (last reference gone). A browser still in
+ * creation gets the close after OnAfterCreated().
+ * Closed() and Destroyed() can come from CEF's UI thread, WaitAll() wakes up
+ * on them without polling.
+ */
+class ATTRIBUTE_HIDDEN CBrowserCloseTracker
+{
+public:
+  CBrowserCloseTracker() = default;
+
+  void CloseRequested(int uniqueClientId);
+  void CloseSent(int uniqueClientId, int browserId);
+  void Closed(int uniqueClientId);
+  void Destroyed(int uniqueClientId);
+
+  size_t Pending();
+
+  /*!
+   * @brief Wait until all clients are destroyed, only from Kodi's main
+   * thread.
+   *
+   * @param[in] timeout Longest time to wait
+   * @param[in] work Called before every wait, e.g. for CEF's message loop work
+   *                 which closes the browsers if they run on this thread
+   * @param[in] interval Longest wait between two work calls
+   * @return true if all are destroyed
+   */
+  bool WaitAll(std::chrono::milliseconds timeout,
+               const std::function<void()>& work,
+               std::chrono::microseconds interval);
+
+  /*!
+   * @brief Log the clients not destroyed with their state and age.
+   *
+   * @return Amount of browsers not closed yet, CefShutdown() fails on them
+   */
+  size_t LogPending();
+
+  /*!
+   * @brief Log the collected close times, samples are also logged in blocks
+   * of 20.
+   */
+  void LogStatistics();
+
+private:
+  struct Entry
+  {
+    bool closed = false;
+    int browserId = -1; // Set once the close is sent
+    CTimeStatistics::Clock::time_point requested;
+  };
+
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::map<int, Entry> m_entries;
+
+  // Used under m_mutex, as the calls come from different threads
+  CTimeStatistics m_closeStats{"CBrowserCloseTracker: Close request to OnBeforeClose", 20};
+  CTimeStatistics m_destroyStats{"CBrowserCloseTracker: Close request to destroyed", 20};
+};
@@ -0,0 +1,378 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "BrowserPool.h"
+
+#include "RequestContextHandler.h"
+#include "WebBrowserClient.h"
+#include "addon.h"
+
+#include "include/cef_request_context.h"
+#include "include/wrapper/cef_helpers.h"
+
+#include <algorithm>
+
+namespace
+{
+
+// Wait after start before the pool is filled, to leave Kodi's startup alone
+constexpr auto FILL_DELAY = std::chrono::seconds(2);
+
+// Wait after a browser was taken, to not slow down the load of its site
+constexpr auto REFILL_DELAY = std::chrono::seconds(3);
+
+// Wait after a failed browser creation
+constexpr auto RETRY_DELAY = std::chrono::seconds(30);
+
+// View size of pooled browsers, they are hidden and only need a valid size
+constexpr int POOLED_VIEW_SIZE = 64;
+
+void Remove(std::vector<CefRefPtr<CWarmBrowserClient>>& clients,
+            const CefRefPtr<CWarmBrowserClient>& client)
+{
+  clients.erase(std::remove(clients.begin(), clients.end(), client), clients.end());
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+CWarmBrowserClient::CWarmBrowserClient(CBrowserPool& pool,
+                                       int uniqueClientId,
+                                       int webAddonAccess,
+                                       bool externalBeginFrame,
+                                       CefRefPtr<CRequestContextHandler> contextHandler)
+  : m_pool(pool),
+    m_uniqueClientId(uniqueClientId),
+    m_webAddonAccess(webAddonAccess),
+    m_externalBeginFrame(externalBeginFrame),
+    m_contextHandler(contextHandler)
+{
+}
+
+CefRefPtr<CefBrowser> CWarmBrowserClient::GetBrowser()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_browser;
+}
+
+void CWarmBrowserClient::SetTarget(CefRefPtr<CWebBrowserClient> target)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_target = target;
+}
+
+CefRefPtr<CWebBrowserClient> CWarmBrowserClient::Target()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_target;
+}
+
+CefRefPtr<CefAudioHandler> CWarmBrowserClient::GetAudioHandler()
+{
+  CefRefPtr<CWebBrowserClient> target = Target();
+  return target ? target->GetAudioHandler() : nullptr;
+}
+
+CefRefPtr<CefContextMenuHandler> CWarmBrowserClient::GetContextMenuHandler()
+{
+  CefRefPtr<CWebBrowserClient> target = Target();
+  return target ? target->GetContextMenuHandler() : nullptr;
+}
+
+CefRefPtr<CefDialogHandler> CWarmBrowserClient::GetDialogHandler()
+{
+  CefRefPtr<CWebBrowserClient> target = Target();
+  return target ? target->GetDialogHandler() : nullptr;
+}
+
+CefRefPtr<CefDisplayHandler> CWarmBrowserClient::GetDisplayHandler()
+{
+  CefRefPtr<CWebBrowserClient> target = Target();
+  return target ? target->GetDisplayHandler() : nullptr;
+}
+
+CefRefPtr<CefDownloadHandler> CWarmBrowserClient::GetDownloadHandler()
+{
+  CefRefPtr<CWebBrowserClient> target = Target();
+  return target ? target->GetDownloadHandler() : nullptr;
+}
+
+CefRefPtr<CefDragHandler> CWarmBrowserClient::GetDragHandler()
+{
+  CefRefPtr<CWebBrowserClient> target = Target();
+  return target ? target->GetDragHandler() : nullptr;
+}
+
+CefRefPtr<CefFindHandler> CWarmBrowserClient::GetFindHandler()
+{
+  CefRefPtr<CWebBrowserClient> target = Target();
+  return target ? target->GetFindHandler() : nullptr;
+}
+
+CefRefPtr<CefJSDialogHandler> CWarmBrowserClient::GetJSDialogHandler()
+{
+  CefRefPtr<CWebBrowserClient> target = Target();
+  return target ? target->GetJSDialogHandler() : nullptr;
+}
+
+CefRefPtr<CefLifeSpanHandler> CWarmBrowserClient::GetLifeSpanHandler()
+{
+  CefRefPtr<CWebBrowserClient> target = Target();
+  return target ? target->GetLifeSpanHandler() : this;
+}
+
+CefRefPtr<CefLoadHandler> CWarmBrowserClient::GetLoadHandler()
+{
+  CefRefPtr<CWebBrowserClient> target = Target();
+  return target ? target->GetLoadHandler() : nullptr;
+}
+
+CefRefPtr<CefRenderHandler> CWarmBrowserClient::GetRenderHandler()
+{
+  CefRefPtr<CWebBrowserClient> target = Target();
+  return target ? target->GetRenderHandler() : this;
+}
+
+CefRefPtr<CefRequestHandler> CWarmBrowserClient::GetRequestHandler()
+{
+  CefRefPtr<CWebBrowserClient> target = Target();
+  return target ? target->GetRequestHandler() : nullptr;
+}
+
+bool CWarmBrowserClient::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
+                                                  CefRefPtr<CefFrame> frame,
+                                                  CefProcessId source_process,
+                                                  CefRefPtr<CefProcessMessage> message)
+{
+  CefRefPtr<CWebBrowserClient> target = Target();
+  return target ? target->OnProcessMessageReceived(browser, frame, source_process, message)
+                : false;
+}
+
+bool CWarmBrowserClient::OnBeforePopup(CefRefPtr<CefBrowser> browser,
+                                       CefRefPtr<CefFrame> frame,
+                                       const CefString& target_url,
+                                       const CefString& target_frame_name,
+                                       CefRequestHandler::WindowOpenDisposition target_disposition,
+                                       bool user_gesture,
+                                       const CefPopupFeatures& popupFeatures,
+                                       CefWindowInfo& windowInfo,
+                                       CefRefPtr<CefClient>& client,
+                                       CefBrowserSettings& settings,
+                                       CefRefPtr<CefDictionaryValue>& extra_info,
+                                       bool* no_javascript_access)
+{
+  return true; /* Nothing to open from about:blank */
+}
+
+void CWarmBrowserClient::OnAfterCreated(CefRefPtr<CefBrowser> browser)
+{
+  CEF_REQUIRE_UI_THREAD();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_browser = browser;
+  }
+
+  browser->GetHost()->WasHidden(true);
+  m_pool.BrowserCreated(this);
+}
+
+void CWarmBrowserClient::OnBeforeClose(CefRefPtr<CefBrowser> browser)
+{
+  CEF_REQUIRE_UI_THREAD();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_browser = nullptr;
+  }
+
+  m_contextHandler->Clear();
+  m_pool.BrowserClosed(this);
+}
+
+void CWarmBrowserClient::GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect)
+{
+  rect.x = 0;
+  rect.y = 0;
+  rect.width = POOLED_VIEW_SIZE;
+  rect.height = POOLED_VIEW_SIZE;
+}
+
+//------------------------------------------------------------------------------
+
+void CBrowserPool::Initialize(int size)
+{
+  m_size = std::max(size, 0);
+  m_nextFill = CTimeStatistics::Now() + FILL_DELAY;
+
+  kodi::Log(ADDON_LOG_DEBUG, "CBrowserPool::%s: Keeping %i browsers ready", __func__, m_size);
+}
+
+void CBrowserPool::Process()
+{
+  if (m_size == 0 || m_shutdown || CTimeStatistics::Now() < m_nextFill)
+    return;
+
+  {
+    // Only one creation at once, the next comes with a later idle pass
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_creating.empty() || m_ready.size() >= static_cast<size_t>(m_size))
+      return;
+  }
+
+  Create();
+}
+
+void CBrowserPool::Create()
+{
+  const int webAddonAccess = kodi::GetSettingInt("security.webaddon.access");
+#ifndef WIN32
+  const bool externalBeginFrame = kodi::GetSettingBoolean("performance.external_begin_frame", false);
+#else
+  const bool externalBeginFrame = false;
+#endif
+
+  CefRefPtr<CRequestContextHandler> contextHandler = new CRequestContextHandler;
+  CefRefPtr<CWarmBrowserClient> client = new CWarmBrowserClient(
+      *this, CWebBrowser::NewUniqueClientId(), webAddonAccess, externalBeginFrame, contextHandler);
+
+  CefWindowInfo info;
+  CefBrowserSettings settings;
+  CWebBrowser::GetBrowserCreateInfo(info, settings, externalBeginFrame, 1);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_creating.push_back(client);
+  }
+
+  const auto start = CTimeStatistics::Now();
+  CefRefPtr<CefRequestContext> requestContext =
+      CefRequestContext::CreateContext(CefRequestContext::GetGlobalContext(), contextHandler);
+  if (!CefBrowserHost::CreateBrowser(info, client, "about:blank", settings,
+                                     CWebBrowser::GetBrowserExtraInfo(webAddonAccess),
+                                     requestContext))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CBrowserPool::%s: Browser creation failed", __func__);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Remove(m_creating, client);
+    m_nextFill = CTimeStatistics::Now() + RETRY_DELAY;
+    return;
+  }
+
+  kodi::Log(ADDON_LOG_DEBUG, "CBrowserPool::%s: Browser %i requested in %.1f ms", __func__,
+            client->GetUniqueId(),
+            std::chrono::duration<double, std::milli>(CTimeStatistics::Now() - start).count());
+}
+
+CefRefPtr<CWarmBrowserClient> CBrowserPool::Take(int webAddonAccess, bool externalBeginFrame)
+{
+  std::vector<CefRefPtr<CWarmBrowserClient>> outdated;
+  CefRefPtr<CWarmBrowserClient> client;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (!m_ready.empty() && !client)
+    {
+      CefRefPtr<CWarmBrowserClient> entry = m_ready.front();
+      m_ready.erase(m_ready.begin());
+
+      // Browsers created before a change of the settings given on creation
+      if (entry->WebAddonAccess() != webAddonAccess ||
+          entry->ExternalBeginFrame() != externalBeginFrame)
+        outdated.push_back(entry);
+      else if (entry->GetBrowser())
+        client = entry;
+    }
+  }
+
+  for (const auto& entry : outdated)
+    Close(entry);
+
+  m_nextFill = CTimeStatistics::Now() + REFILL_DELAY;
+  return client;
+}
+
+void CBrowserPool::Shutdown()
+{
+  std::vector<CefRefPtr<CWarmBrowserClient>> ready;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_shutdown = true;
+    ready.swap(m_ready);
+
+    // Closed as soon as they are created
+    for (const auto& client : m_creating)
+      m_main.GetCloseTracker().CloseRequested(client->GetUniqueId());
+  }
+
+  for (const auto& client : ready)
+    Close(client);
+}
+
+void CBrowserPool::ReportFirstPaint(int uniqueClientId,
+                                    bool pooled,
+                                    CTimeStatistics::Clock::duration time)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  kodi::Log(ADDON_LOG_DEBUG, "CBrowserPool::%s: First paint of client %i after %.1f ms (%s browser)",
+            __func__, uniqueClientId, std::chrono::duration<double, std::milli>(time).count(),
+            pooled ? "pooled" : "new");
+
+  CTimeStatistics& stats = pooled ? m_firstPaintPooled : m_firstPaintNew;
+  stats.AddSample(time);
+  stats.Log();
+}
+
+void CBrowserPool::BrowserCreated(CefRefPtr<CWarmBrowserClient> client)
+{
+  bool close = false;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Remove(m_creating, client);
+    if (m_shutdown)
+      close = true;
+    else
+      m_ready.push_back(client);
+  }
+
+  if (close)
+  {
+    CefRefPtr<CefBrowser> browser = client->GetBrowser();
+    browser->GetHost()->CloseBrowser(true);
+    m_main.GetCloseTracker().CloseSent(client->GetUniqueId(), browser->GetIdentifier());
+  }
+  else
+    kodi::Log(ADDON_LOG_DEBUG, "CBrowserPool::%s: Browser %i ready", __func__,
+              client->GetUniqueId());
+}
+
+void CBrowserPool::BrowserClosed(CefRefPtr<CWarmBrowserClient> client)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Remove(m_creating, client);
+    Remove(m_ready, client);
+  }
+
+  // The client itself is released by CEF after this
+  m_main.GetCloseTracker().Closed(client->GetUniqueId());
+  m_main.GetCloseTracker().Destroyed(client->GetUniqueId());
+}
+
+void CBrowserPool::Close(CefRefPtr<CWarmBrowserClient> client)
+{
+  CefRefPtr<CefBrowser> browser = client->GetBrowser();
+  if (!browser)
+    return;
+
+  m_main.GetCloseTracker().CloseRequested(client->GetUniqueId());
+  browser->GetHost()->CloseBrowser(true);
+  m_main.GetCloseTracker().CloseSent(client->GetUniqueId(), browser->GetIdentifier());
+}
@@ -0,0 +1,190 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "utils/TimeStatistics.h"
+
+#include "include/cef_client.h"
+#include "include/cef_life_span_handler.h"
+#include "include/cef_render_handler.h"
+
+#include <kodi/General.h>
+#include <mutex>
+#include <vector>
+
+class CBrowserPool;
+class CRequestContextHandler;
+class CWebBrowser;
+class CWebBrowserClient;
+
+/*!
+ * @brief Client of a pre-created about:blank browser.
+ *
+ * CEF binds a browser to its client on creation, so this forwards all
+ * handlers to the web browser client that takes the browser over. Until then
+ * it only keeps the browser hidden and without paints.
+ */
+class ATTRIBUTE_HIDDEN CWarmBrowserClient : public CefClient,
+                                            public CefLifeSpanHandler,
+                                            public CefRenderHandler
+{
+public:
+  CWarmBrowserClient(CBrowserPool& pool,
+                     int uniqueClientId,
+                     int webAddonAccess,
+                     bool externalBeginFrame,
+                     CefRefPtr<CRequestContextHandler> contextHandler);
+
+  int GetUniqueId() const { return m_uniqueClientId; }
+  int WebAddonAccess() const { return m_webAddonAccess; }
+  bool ExternalBeginFrame() const { return m_externalBeginFrame; }
+  CefRefPtr<CRequestContextHandler> GetContextHandler() { return m_contextHandler; }
+  CefRefPtr<CefBrowser> GetBrowser();
+
+  /*!
+   * @brief Give all further calls of CEF to the client, from Kodi's main
+   * thread.
+   */
+  void SetTarget(CefRefPtr<CWebBrowserClient> target);
+
+  /// CefClient methods
+  //@{
+  CefRefPtr<CefAudioHandler> GetAudioHandler() override;
+  CefRefPtr<CefContextMenuHandler> GetContextMenuHandler() override;
+  CefRefPtr<CefDialogHandler> GetDialogHandler() override;
+  CefRefPtr<CefDisplayHandler> GetDisplayHandler() override;
+  CefRefPtr<CefDownloadHandler> GetDownloadHandler() override;
+  CefRefPtr<CefDragHandler> GetDragHandler() override;
+  CefRefPtr<CefFindHandler> GetFindHandler() override;
+  CefRefPtr<CefJSDialogHandler> GetJSDialogHandler() override;
+  CefRefPtr<CefLifeSpanHandler> GetLifeSpanHandler() override;
+  CefRefPtr<CefLoadHandler> GetLoadHandler() override;
+  CefRefPtr<CefRenderHandler> GetRenderHandler() override;
+  CefRefPtr<CefRequestHandler> GetRequestHandler() override;
+  bool OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
+                                CefRefPtr<CefFrame> frame,
+                                CefProcessId source_process,
+                                CefRefPtr<CefProcessMessage> message) override;
+  //@}
+
+  /// CefLifeSpanHandler methods, only used while in pool
+  //@{
+  bool OnBeforePopup(CefRefPtr<CefBrowser> browser,
+                     CefRefPtr<CefFrame> frame,
+                     const CefString& target_url,
+                     const CefString& target_frame_name,
+                     CefRequestHandler::WindowOpenDisposition target_disposition,
+                     bool user_gesture,
+                     const CefPopupFeatures& popupFeatures,
+                     CefWindowInfo& windowInfo,
+                     CefRefPtr<CefClient>& client,
+                     CefBrowserSettings& settings,
+                     CefRefPtr<CefDictionaryValue>& extra_info,
+                     bool* no_javascript_access) override;
+  void OnAfterCreated(CefRefPtr<CefBrowser> browser) override;
+  void OnBeforeClose(CefRefPtr<CefBrowser> browser) override;
+  //@}
+
+  /// CefRenderHandler methods, only used while in pool
+  //@{
+  void GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect) override;
+  void OnPaint(CefRefPtr<CefBrowser> browser,
+               PaintElementType type,
+               const RectList& dirtyRects,
+               const void* buffer,
+               int width,
+               int height) override {}
+  //@}
+
+private:
+  IMPLEMENT_REFCOUNTING(CWarmBrowserClient);
+  DISALLOW_COPY_AND_ASSIGN(CWarmBrowserClient);
+
+  CefRefPtr<CWebBrowserClient> Target();
+
+  CBrowserPool& m_pool;
+  const int m_uniqueClientId;
+  const int m_webAddonAccess;
+  const bool m_externalBeginFrame;
+  CefRefPtr<CRequestContextHandler> m_contextHandler;
+
+  std::mutex m_mutex;
+  CefRefPtr<CefBrowser> m_browser;
+  CefRefPtr<CWebBrowserClient> m_target;
+};
+
+/*!
+ * @brief Pool of pre-created about:blank browsers for a fast control creation.
+ *
+ * Creating a browser starts a new render process, which takes on the first
+ * open up to seconds. The pool creates them beforehand in idle time of Kodi's
+ * main thread, CWebBrowser::CreateControl() takes them from here and the pool
+ * is refilled later in the background.
+ *
+ * The time from the control creation until the first paint of the loaded
+ * site is collected for controls with and without a pooled browser.
+ */
+class ATTRIBUTE_HIDDEN CBrowserPool
+{
+public:
+  CBrowserPool(CWebBrowser& main) : m_main(main) {}
+
+  /*!
+   * @param[in] size Amount of browsers to keep ready, 0 to disable the pool
+   */
+  void Initialize(int size);
+
+  /*!
+   * @brief Create a missing browser if the main thread is idle, from Kodi's
+   * main loop.
+   */
+  void Process();
+
+  /*!
+   * @brief Take a ready browser for a new control, from Kodi's main thread.
+   *
+   * Browsers created with other values as given are dropped, these can not
+   * be changed later.
+   *
+   * @param[in] webAddonAccess Value of the security setting for the browser
+   * @param[in] externalBeginFrame If the browser uses external begin frames
+   * @return Client of the browser or nullptr if none is ready
+   */
+  CefRefPtr<CWarmBrowserClient> Take(int webAddonAccess, bool externalBeginFrame);
+
+  /*!
+   * @brief Close all pooled browsers, tracked by the close tracker of main.
+   */
+  void Shutdown();
+
+  void ReportFirstPaint(int uniqueClientId, bool pooled, CTimeStatistics::Clock::duration time);
+
+  /// Called by the pooled browser clients
+  //@{
+  void BrowserCreated(CefRefPtr<CWarmBrowserClient> client);
+  void BrowserClosed(CefRefPtr<CWarmBrowserClient> client);
+  //@}
+
+private:
+  void Create();
+  void Close(CefRefPtr<CWarmBrowserClient> client);
+
+  CWebBrowser& m_main;
+  int m_size = 0;
+  bool m_shutdown = false;
+  CTimeStatistics::Clock::time_point m_nextFill;
+
+  std::mutex m_mutex;
+  std::vector<CefRefPtr<CWarmBrowserClient>> m_creating;
+  std::vector<CefRefPtr<CWarmBrowserClient>> m_ready;
+
+  // Used under m_mutex, reported from CEF's UI thread
+  CTimeStatistics m_firstPaintPooled{"CBrowserPool: Control creation to first paint, pooled browser"};
+  CTimeStatistics m_firstPaintNew{"CBrowserPool: Control creation to first paint, new browser"};
+};
@@ -0,0 +1,80 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "FrameRateGovernor.h"
+
+#include <algorithm>
+
+void CFrameRateGovernor::Initialize(int fullRate)
+{
+  m_enabled = kodi::GetSettingBoolean("performance.frame_rate_governor", true);
+  m_fullRate = std::max(fullRate, 1);
+  m_idleRate = std::min(std::max(kodi::GetSettingInt("performance.idle_frame_rate", 5), 1), m_fullRate);
+  m_currentRate = m_fullRate;
+  m_lastActivity = Clock::now();
+}
+
+void CFrameRateGovernor::SetVisible(CefRefPtr<CefBrowser> browser, bool visible)
+{
+  if (!m_enabled || m_visible == visible)
+    return;
+
+  m_visible = visible;
+  m_lastActivity = Clock::now();
+
+  if (!browser)
+    return;
+
+  // Hiding itself is done by the renderer suspend of the control
+  if (visible)
+    SetRate(browser, m_fullRate);
+}
+
+void CFrameRateGovernor::InputActivity()
+{
+  m_lastActivity = Clock::now();
+}
+
+void CFrameRateGovernor::Update(CefRefPtr<CefBrowser> browser,
+                                bool fullscreen,
+                                bool loading,
+                                bool playing)
+{
+  if (!m_enabled || !m_visible || !browser)
+    return;
+
+  const Clock::time_point now = Clock::now();
+  if (fullscreen || loading || playing)
+    m_lastActivity = now;
+
+  SetRate(browser, now - m_lastActivity < m_idleTimeout ? m_fullRate : m_idleRate);
+}
+
+bool CFrameRateGovernor::BeginFrameDue()
+{
+  if (!m_enabled || m_currentRate >= m_fullRate)
+    return true;
+
+  const Clock::time_point now = Clock::now();
+  if (now - m_lastBeginFrame < std::chrono::microseconds(1000000 / m_currentRate))
+    return false;
+
+  m_lastBeginFrame = now;
+  return true;
+}
+
+void CFrameRateGovernor::SetRate(CefRefPtr<CefBrowser> browser, int rate)
+{
+  if (rate == m_currentRate)
+    return;
+
+  kodi::Log(ADDON_LOG_DEBUG, "CFrameRateGovernor::%s: Browser %i frame rate changed from %i to %i",
+            __func__, browser->GetIdentifier(), m_currentRate, rate);
+  m_currentRate = rate;
+  browser->GetHost()->SetWindowlessFrameRate(rate);
+}
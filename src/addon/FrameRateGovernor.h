@@ -0,0 +1,78 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "include/cef_browser.h"
+
+#include <chrono>
+#include <kodi/General.h>
+
+/*!
+ * @brief Adjust the windowless frame rate of a browser to his usage.
+ *
+ * - Inactive (parked) controls are not updated, they are hidden by the
+ *   renderer suspend where CEF stops rendering and throttles page timers.
+ * - Fullscreen content, loading pages, pages playing media and pages with
+ *   recent input use the full rate of the control.
+ * - Other pages drop after some seconds to the idle rate, also if they paint.
+ *   The own paints of a page are no activity, else an animation running at
+ *   the idle rate would bring itself back to the full rate.
+ */
+class ATTRIBUTE_HIDDEN CFrameRateGovernor
+{
+public:
+  CFrameRateGovernor() = default;
+
+  /*!
+   * @brief Set the maximum rate used by the control, reads also the settings.
+   */
+  void Initialize(int fullRate);
+
+  /*!
+   * @brief Inform about activation change of the control.
+   */
+  void SetVisible(CefRefPtr<CefBrowser> browser, bool visible);
+
+  /*!
+   * @brief Inform about user input to the control.
+   */
+  void InputActivity();
+
+  /*!
+   * @brief Check and change the frame rate, called on every dirty poll.
+   *
+   * @param[in] browser The browser to control
+   * @param[in] fullscreen true if the browser shows content in fullscreen
+   * @param[in] loading true if the browser loads a page
+   * @param[in] playing true if the browser plays media (has an audio stream)
+   */
+  void Update(CefRefPtr<CefBrowser> browser, bool fullscreen, bool loading, bool playing);
+
+  /*!
+   * @brief Check a external begin frame should be send now.
+   *
+   * With external begin frames is the windowless frame rate ignored by CEF,
+   * the idle rate becomes then done by skipping begin frames.
+   */
+  bool BeginFrameDue();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  void SetRate(CefRefPtr<CefBrowser> browser, int rate);
+
+  bool m_enabled = false;
+  bool m_visible = true;
+  int m_fullRate = 30;
+  int m_idleRate = 5;
+  int m_currentRate = 0;
+  std::chrono::seconds m_idleTimeout{3};
+  Clock::time_point m_lastActivity = Clock::now();
+  Clock::time_point m_lastBeginFrame;
+};
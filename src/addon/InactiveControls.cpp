@@ -0,0 +1,270 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "InactiveControls.h"
+
+#include "WebBrowserClient.h"
+#include "addon.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(TARGET_LINUX)
+#include <climits>
+#include <dirent.h>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+// Time between two checks of the memory use, reading it is not for free
+constexpr auto MEMORY_CHECK_INTERVAL = std::chrono::seconds(10);
+
+// Wait after a discard before the next check, the render process needs some
+// time to end and give its memory back
+constexpr auto DISCARD_SETTLE_TIME = std::chrono::seconds(5);
+
+} // namespace
+
+CInactiveControls::~CInactiveControls()
+{
+  JoinMemoryScan();
+}
+
+void CInactiveControls::Initialize(int memoryBudget, int maxInactiveTime)
+{
+  m_memoryBudget = static_cast<size_t>(std::max(memoryBudget, 0));
+  m_maxInactiveTime = std::chrono::minutes(std::max(maxInactiveTime, 0));
+  m_nextMemoryCheck = CTimeStatistics::Now() + MEMORY_CHECK_INTERVAL;
+
+  kodi::Log(ADDON_LOG_DEBUG, "CInactiveControls::%s: Memory budget %zu MB, max inactive time %i min",
+            __func__, m_memoryBudget, static_cast<int>(m_maxInactiveTime.count()));
+}
+
+void CInactiveControls::Add(const std::string& sourceName, CefRefPtr<CWebBrowserClient> client)
+{
+  Remove(sourceName);
+  m_entries.push_back({sourceName, client, CTimeStatistics::Now()});
+}
+
+CefRefPtr<CWebBrowserClient> CInactiveControls::Take(const std::string& sourceName)
+{
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+  {
+    if (it->sourceName == sourceName)
+    {
+      CefRefPtr<CWebBrowserClient> client = it->client;
+      m_entries.erase(it);
+      return client;
+    }
+  }
+
+  return nullptr;
+}
+
+bool CInactiveControls::TakeDiscarded(const std::string& sourceName, ControlState& state)
+{
+  const auto it = m_discarded.find(sourceName);
+  if (it == m_discarded.end())
+    return false;
+
+  state = std::move(it->second);
+  m_discarded.erase(it);
+  m_restores++;
+
+  kodi::Log(ADDON_LOG_INFO, "CInactiveControls::%s: Restoring discarded control '%s' with '%s'",
+            __func__, sourceName.c_str(), state.url.c_str());
+  LogStatistics();
+  return true;
+}
+
+void CInactiveControls::Remove(const std::string& sourceName)
+{
+  m_entries.remove_if([&sourceName](const Entry& entry) { return entry.sourceName == sourceName; });
+  m_discarded.erase(sourceName);
+}
+
+std::vector<CefRefPtr<CWebBrowserClient>> CInactiveControls::Clear()
+{
+  std::vector<CefRefPtr<CWebBrowserClient>> clients;
+  for (const auto& entry : m_entries)
+    clients.push_back(entry.client);
+
+  m_entries.clear();
+  m_discarded.clear();
+  JoinMemoryScan();
+  LogStatistics();
+  return clients;
+}
+
+void CInactiveControls::Process()
+{
+  if (m_entries.empty())
+    return;
+
+  const auto now = CTimeStatistics::Now();
+
+  if (m_maxInactiveTime.count() > 0)
+  {
+    while (!m_entries.empty() && now - m_entries.front().inactiveSince > m_maxInactiveTime)
+      Discard("inactive time");
+  }
+
+  if (m_memoryBudget == 0 || m_entries.empty())
+    return;
+
+  // Only one discard per check, the freed memory is seen with the next one
+  if (m_memoryScanDone)
+  {
+    JoinMemoryScan();
+    const size_t memory = m_scannedMemory;
+    if (memory > m_memoryBudget)
+    {
+      kodi::Log(ADDON_LOG_DEBUG, "CInactiveControls::%s: Browser processes use %zu MB, budget %zu MB",
+                __func__, memory, m_memoryBudget);
+      Discard("memory budget");
+      m_nextMemoryCheck = now + DISCARD_SETTLE_TIME;
+    }
+    return;
+  }
+
+  if (m_memoryScan.joinable() || now < m_nextMemoryCheck)
+    return;
+
+  m_nextMemoryCheck = now + MEMORY_CHECK_INTERVAL;
+  StartMemoryScan();
+}
+
+void CInactiveControls::StartMemoryScan()
+{
+  const std::string helperPath = m_main.GetBrowserSubprocessPath();
+  m_memoryScanDone = false;
+  m_memoryScan = std::thread([this, helperPath]() {
+    m_scannedMemory = BrowserProcessesMemory(helperPath);
+    m_memoryScanDone = true;
+  });
+}
+
+void CInactiveControls::JoinMemoryScan()
+{
+  if (m_memoryScan.joinable())
+    m_memoryScan.join();
+  m_memoryScanDone = false;
+}
+
+void CInactiveControls::LogStatistics()
+{
+  kodi::Log(ADDON_LOG_DEBUG, "CInactiveControls::%s: %llu discarded, %llu restored, %zu inactive, %zu saved",
+            __func__, static_cast<unsigned long long>(m_discards),
+            static_cast<unsigned long long>(m_restores), m_entries.size(), m_discarded.size());
+}
+
+void CInactiveControls::Discard(const char* reason)
+{
+  Entry entry = std::move(m_entries.front());
+  m_entries.pop_front();
+
+  m_discarded[entry.sourceName] = entry.client->GetState();
+  m_discards++;
+  m_inactiveTimeStats.AddSample(entry.inactiveSince);
+
+  kodi::Log(ADDON_LOG_INFO, "CInactiveControls::%s: Discarding control '%s' (client %i) by %s",
+            __func__, entry.sourceName.c_str(), entry.client->GetUniqueId(), reason);
+
+  m_main.GetCloseTracker().CloseRequested(entry.client->GetUniqueId());
+  entry.client->CloseComplete();
+}
+
+size_t CInactiveControls::BrowserProcessesMemory(const std::string& helperPath)
+{
+#if defined(TARGET_LINUX)
+  // The sub processes of CEF are started by Kodi's process, where this addon
+  // runs in, and start themselves further ones (zygote). Their resident
+  // memory is summed over the descendants running the helper executable,
+  // other addons can start own processes from Kodi too.
+  char resolved[PATH_MAX];
+  if (!realpath(helperPath.c_str(), resolved))
+    return 0;
+  const std::string helper = resolved;
+
+  const auto isHelper = [&helper](pid_t pid) {
+    char exe[PATH_MAX];
+    const ssize_t length =
+        readlink(("/proc/" + std::to_string(pid) + "/exe").c_str(), exe, sizeof(exe) - 1);
+    return length > 0 && std::string(exe, static_cast<size_t>(length)) == helper;
+  };
+
+  std::multimap<pid_t, pid_t> children;
+  std::map<pid_t, size_t> residentPages;
+
+  DIR* dir = opendir("/proc");
+  if (!dir)
+    return 0;
+
+  while (struct dirent* dirEntry = readdir(dir))
+  {
+    const pid_t pid = static_cast<pid_t>(atoi(dirEntry->d_name));
+    if (pid <= 0)
+      continue;
+
+    std::ifstream stat("/proc/" + std::string(dirEntry->d_name) + "/stat");
+    std::string line;
+    if (!std::getline(stat, line))
+      continue;
+
+    // The name in brackets can contain spaces, the fields start after it
+    const size_t nameEnd = line.rfind(')');
+    if (nameEnd == std::string::npos)
+      continue;
+
+    std::istringstream fields(line.substr(nameEnd + 2));
+    std::string field;
+    pid_t ppid = 0;
+    size_t rss = 0;
+    for (int i = 3; i <= 24 && fields >> field; ++i)
+    {
+      if (i == 4)
+        ppid = static_cast<pid_t>(atoi(field.c_str()));
+      else if (i == 24)
+        rss = static_cast<size_t>(strtoull(field.c_str(), nullptr, 10));
+    }
+
+    children.emplace(ppid, pid);
+    residentPages[pid] = rss;
+  }
+  closedir(dir);
+
+  size_t pages = 0;
+  std::set<pid_t> visited;
+  std::vector<pid_t> open{getpid()};
+  while (!open.empty())
+  {
+    const pid_t parent = open.back();
+    open.pop_back();
+
+    const auto range = children.equal_range(parent);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+      if (!visited.insert(it->second).second || !isHelper(it->second))
+        continue;
+
+      pages += residentPages[it->second];
+      open.push_back(it->second);
+    }
+  }
+
+  return pages * static_cast<size_t>(sysconf(_SC_PAGESIZE)) / (1024 * 1024);
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,151 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "utils/TimeStatistics.h"
+
+#include "include/cef_base.h"
+
+#include <atomic>
+#include <kodi/General.h>
+#include <list>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class CWebBrowser;
+class CWebBrowserClient;
+
+/*!
+ * @brief State of a website kept after its browser was discarded, to open it
+ * again like before.
+ */
+struct ControlState
+{
+  struct HistoryEntry
+  {
+    std::string url;
+    std::string title;
+  };
+
+  std::string url;
+  std::vector<HistoryEntry> history;
+  size_t historyCurrent = 0;
+  double scrollOffsetX = 0.0;
+  double scrollOffsetY = 0.0;
+  double zoomLevel = 0.0;
+};
+
+/*!
+ * @brief Controls set inactive by Kodi, ordered from least to most recently
+ * used.
+ *
+ * Every inactive control keeps its render process alive. If the browser
+ * processes use more memory as the budget or a control is inactive for too
+ * long, the least recently used one is discarded: its state is saved and the
+ * browser closed. The next CWebBrowser::CreateControl() for the same source
+ * name creates a new browser with this state.
+ *
+ * Not thread safe, used under the mutex of CWebBrowser from Kodi's main
+ * thread. Only the memory scan runs on its own thread, so that neither the
+ * main thread nor the mutex wait for it.
+ */
+class ATTRIBUTE_HIDDEN CInactiveControls
+{
+public:
+  CInactiveControls(CWebBrowser& main) : m_main(main) {}
+  ~CInactiveControls();
+
+  /*!
+   * @param[in] memoryBudget Memory in MB the browser processes can use before
+   *                         controls are discarded, 0 for no limit
+   * @param[in] maxInactiveTime Time in minutes a control can be inactive
+   *                            before discarded, 0 for no limit
+   */
+  void Initialize(int memoryBudget, int maxInactiveTime);
+
+  void Add(const std::string& sourceName, CefRefPtr<CWebBrowserClient> client);
+
+  /*!
+   * @brief Take the inactive control of the source name.
+   *
+   * @return The client or nullptr if none inactive
+   */
+  CefRefPtr<CWebBrowserClient> Take(const std::string& sourceName);
+
+  /*!
+   * @brief Take the saved state of a discarded control of the source name.
+   *
+   * @return true if present
+   */
+  bool TakeDiscarded(const std::string& sourceName, ControlState& state);
+
+  /*!
+   * @brief Forget the control and a saved state of the source name, if the
+   * control is destroyed complete.
+   */
+  void Remove(const std::string& sourceName);
+
+  /*!
+   * @brief Take all inactive controls and forget the saved states, on
+   * shutdown.
+   */
+  std::vector<CefRefPtr<CWebBrowserClient>> Clear();
+
+  size_t Size() const { return m_entries.size(); }
+
+  /*!
+   * @brief Discard controls over the limits, from Kodi's main loop.
+   */
+  void Process();
+
+  /*!
+   * @brief Log the discard and restore counters.
+   */
+  void LogStatistics();
+
+private:
+  struct Entry
+  {
+    std::string sourceName;
+    CefRefPtr<CWebBrowserClient> client;
+    CTimeStatistics::Clock::time_point inactiveSince;
+  };
+
+  void Discard(const char* reason);
+
+  void StartMemoryScan();
+  void JoinMemoryScan();
+
+  /*!
+   * @brief Memory in MB used by CEF's sub processes, 0 if unknown.
+   *
+   * @param[in] helperPath Executable of the sub processes, other children of
+   *                       Kodi (e.g. helpers of other addons) are not counted
+   */
+  static size_t BrowserProcessesMemory(const std::string& helperPath);
+
+  CWebBrowser& m_main;
+  size_t m_memoryBudget = 0;
+  std::chrono::minutes m_maxInactiveTime{0};
+  CTimeStatistics::Clock::time_point m_nextMemoryCheck;
+
+  // Result of the scan thread, taken by the next Process() once done
+  std::thread m_memoryScan;
+  std::atomic_bool m_memoryScanDone{false};
+  std::atomic<size_t> m_scannedMemory{0};
+
+  std::list<Entry> m_entries;
+  std::unordered_map<std::string, ControlState> m_discarded;
+
+  uint64_t m_discards = 0;
+  uint64_t m_restores = 0;
+  CTimeStatistics m_inactiveTimeStats{"CInactiveControls: Inactive time before discard", 10};
+};
@@ -0,0 +1,59 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "MainThreadTasks.h"
+
+void CMainThreadTasks::Initialize(bool multiThreaded)
+{
+  m_mainThread = std::this_thread::get_id();
+  m_multiThreaded = multiThreaded;
+}
+
+void CMainThreadTasks::Run(std::function<void()> task)
+{
+  if (!m_multiThreaded || IsMainThread())
+  {
+    task();
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_tasks.push_back({std::move(task), CTimeStatistics::Now()});
+}
+
+bool CMainThreadTasks::Process()
+{
+  std::vector<Task> tasks;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_tasks.empty())
+      return false;
+    tasks.swap(m_tasks);
+  }
+
+  // Done outside the lock, the tasks can queue further ones
+  for (auto& task : tasks)
+  {
+    m_waitStats.AddSample(task.queued);
+    task.function();
+  }
+  return true;
+}
+
+void CMainThreadTasks::Clear()
+{
+  std::vector<Task> tasks;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    tasks.swap(m_tasks);
+  }
+
+  // The tasks can hold the last reference of a browser client, released here
+  // outside the lock
+  tasks.clear();
+}
@@ -0,0 +1,83 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "utils/TimeStatistics.h"
+
+#include <atomic>
+#include <functional>
+#include <kodi/General.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * @brief Tasks handed from CEF's UI thread to Kodi's main thread.
+ *
+ * With CEF's multi threaded message loop runs CEF its UI thread itself and
+ * calls the handlers there, no more inside Kodi's main thread. Calls into
+ * Kodi's web control interface and all texture uploads must still be done on
+ * Kodi's main thread, they are given to Run() and done by Process() on the
+ * next loop or render pass.
+ *
+ * Without the multi threaded message loop is Run() the same as a direct call.
+ */
+class ATTRIBUTE_HIDDEN CMainThreadTasks
+{
+public:
+  CMainThreadTasks() = default;
+
+  /*!
+   * @brief Set the calling thread as main thread, only from Kodi's main
+   * thread.
+   *
+   * @param[in] multiThreaded true if CEF runs its own UI thread
+   */
+  void Initialize(bool multiThreaded);
+
+  bool MultiThreaded() const { return m_multiThreaded; }
+  bool IsMainThread() const { return std::this_thread::get_id() == m_mainThread; }
+
+  /*!
+   * @brief Do the task on Kodi's main thread, thread safe.
+   *
+   * Called on main thread or without multi threaded message loop is the task
+   * done directly, otherwise with the next Process().
+   */
+  void Run(std::function<void()> task);
+
+  /*!
+   * @brief Do all queued tasks, only from main thread.
+   *
+   * Tasks queued while this runs are done on the next call.
+   *
+   * @return true if tasks were done
+   */
+  bool Process();
+
+  /*!
+   * @brief Drop all queued tasks without doing them.
+   */
+  void Clear();
+
+private:
+  struct Task
+  {
+    std::function<void()> function;
+    CTimeStatistics::Clock::time_point queued;
+  };
+
+  std::atomic_bool m_multiThreaded{false};
+  std::thread::id m_mainThread;
+
+  std::mutex m_mutex;
+  std::vector<Task> m_tasks;
+
+  CTimeStatistics m_waitStats{"CMainThreadTasks: Queued to done", 300};
+};
@@ -0,0 +1,121 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "MessagePump.h"
+
+#include "include/cef_app.h"
+
+#include <algorithm>
+#include <chrono>
+
+void CMessagePump::ScheduleWork(int64_t delayMs)
+{
+  m_requests++;
+  // Copied, std::min would bind the static member by reference
+  const int64_t maxDelay = MAX_WORK_DELAY_US;
+  if (!ScheduleAt(NowUs() + std::min(std::max<int64_t>(delayMs, 0) * 1000, maxDelay)))
+    m_coalescedRequests++;
+}
+
+bool CMessagePump::Process()
+{
+  // CEF can call back into Kodi which comes then again here
+  if (m_inWork)
+    return false;
+
+  const int64_t now = NowUs();
+  if (m_dueTime.load() > now && now - m_lastWorkTime < MAX_WORK_DELAY_US)
+  {
+    m_skippedPolls++;
+    LogStatistics(now);
+    return false;
+  }
+
+  m_inWork = true;
+
+  int64_t current = now;
+  do
+  {
+    // Take the request, new ones given during work set it again
+    const int64_t taken = m_dueTime.exchange(NO_WORK);
+    if (taken != NO_WORK && taken > current)
+      ScheduleAt(taken); // Not due, work done by time limit
+
+    DoWork();
+    current = NowUs();
+  } while (m_dueTime.load() <= current && current - now < MAX_WORK_TIME_US);
+
+  m_lastWorkTime = current;
+  m_inWork = false;
+
+  LogStatistics(current);
+  return true;
+}
+
+void CMessagePump::ProcessNow()
+{
+  if (m_inWork)
+    return;
+
+  m_inWork = true;
+  m_dueTime.store(NO_WORK);
+  DoWork();
+  m_lastWorkTime = NowUs();
+  m_inWork = false;
+}
+
+int64_t CMessagePump::NowUs()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool CMessagePump::ScheduleAt(int64_t dueTime)
+{
+  int64_t current = m_dueTime.load();
+  while (dueTime < current)
+  {
+    if (m_dueTime.compare_exchange_weak(current, dueTime))
+      return true;
+  }
+
+  // An earlier request is already present
+  return false;
+}
+
+void CMessagePump::DoWork()
+{
+  const auto start = CTimeStatistics::Now();
+  CefDoMessageLoopWork();
+  m_workStats.AddSample(start);
+}
+
+void CMessagePump::LogStatistics(int64_t now)
+{
+  if (m_statisticsStart == 0)
+  {
+    m_statisticsStart = now;
+    return;
+  }
+
+  const int64_t elapsed = now - m_statisticsStart;
+  if (elapsed < STATISTICS_INTERVAL_US)
+    return;
+
+  const double seconds = elapsed / 1000000.0;
+  kodi::Log(ADDON_LOG_DEBUG,
+            "CMessagePump: %.1f work calls/s, %.1f requests/s (%llu coalesced), %.1f idle polls/s",
+            m_workStats.Samples() / seconds, m_requests.exchange(0) / seconds,
+            static_cast<unsigned long long>(m_coalescedRequests.exchange(0)),
+            m_skippedPolls / seconds);
+  m_workStats.Log();
+  m_workStats.Reset();
+  m_skippedPolls = 0;
+  m_statisticsStart = now;
+}
@@ -0,0 +1,83 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "utils/TimeStatistics.h"
+
+#include <atomic>
+#include <kodi/General.h>
+#include <limits>
+#include <stdint.h>
+
+/*!
+ * @brief Scheduler for CEF's external message pump.
+ *
+ * CEF informs with CefBrowserProcessHandler::OnScheduleMessagePumpWork() from
+ * any thread when CefDoMessageLoopWork() should be called next. The requests
+ * are stored here as a due time where a new one is only taken if it is earlier
+ * as the already stored (coalescing).
+ *
+ * Kodi's main thread calls Process() on every loop and render pass, the work
+ * itself is then only done if it is due. To stay safe against missed requests
+ * becomes the work also done if nothing was called for a longer time.
+ */
+class ATTRIBUTE_HIDDEN CMessagePump
+{
+public:
+  CMessagePump() = default;
+
+  /*!
+   * @brief Store a work request, thread safe.
+   *
+   * @param[in] delayMs Time in milliseconds after them the work should be done,
+   *                    0 or lower for as soon as possible
+   */
+  void ScheduleWork(int64_t delayMs);
+
+  /*!
+   * @brief Do CEF's message loop work if due, only from main thread.
+   *
+   * If CEF requests further immediate work while this runs, is it repeated
+   * until the per call time budget is used.
+   *
+   * @return true if work was done
+   */
+  bool Process();
+
+  /*!
+   * @brief Do CEF's message loop work now independent of any request.
+   */
+  void ProcessNow();
+
+private:
+  static constexpr int64_t NO_WORK = std::numeric_limits<int64_t>::max();
+
+  // Maximum time without work, same as used by cefclient
+  static constexpr int64_t MAX_WORK_DELAY_US = 1000000 / 30;
+  // Time budget per Process() call for repeated work
+  static constexpr int64_t MAX_WORK_TIME_US = 8000;
+  // Interval to log the pump statistics
+  static constexpr int64_t STATISTICS_INTERVAL_US = 10000000;
+
+  static int64_t NowUs();
+
+  bool ScheduleAt(int64_t dueTime);
+  void DoWork();
+  void LogStatistics(int64_t now);
+
+  std::atomic<int64_t> m_dueTime{NO_WORK};
+  int64_t m_lastWorkTime = 0;
+  bool m_inWork = false;
+
+  std::atomic<uint64_t> m_requests{0};
+  std::atomic<uint64_t> m_coalescedRequests{0};
+  uint64_t m_skippedPolls = 0;
+  int64_t m_statisticsStart = 0;
+  CTimeStatistics m_workStats{"CMessagePump: CefDoMessageLoopWork"};
+};
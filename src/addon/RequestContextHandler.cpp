@@ -73,7 +73,9 @@ void CRequestContextHandler::OnExtensionLoaded(CefRefPtr<CefExtension> extension
 {
   CEF_REQUIRE_UI_THREAD();
 
-  m_browserClient->AddExtension(extension);
+  // Not set for browsers waiting in the pool
+  if (m_browserClient)
+    m_browserClient->AddExtension(extension);
 }
 
 void CRequestContextHandler::OnExtensionUnloaded(CefRefPtr<CefExtension> extension)
@@ -109,7 +111,7 @@ CefRefPtr<CefBrowser> CRequestContextHandler::GetActiveBrowser(CefRefPtr<CefExte
 {
   CEF_REQUIRE_UI_THREAD();
 
-  CefRefPtr<CefBrowser> active_browser = m_browserClient->GetBrowser();
+  CefRefPtr<CefBrowser> active_browser = m_browserClient ? m_browserClient->GetBrowser() : nullptr;
   if (!active_browser)
   {
     kodi::Log(ADDON_LOG_WARNING, "No active browser available for extension %s",
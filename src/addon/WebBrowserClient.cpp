@@ -51,6 +51,20 @@
 namespace
 {
 static std::atomic_int m_ctorcount{0}; // For debug purposes and to see destructs done
+
+std::string ToJavaScriptString(const std::string& text)
+{
+  std::string result = "'";
+  for (const char c : text)
+  {
+    if (c == '\\' || c == '\'')
+      result += '\\';
+    else if (c == '\n' || c == '\r')
+      continue;
+    result += c;
+  }
+  return result + "'";
+}
 }
 
 CWebBrowserClient::CWebBrowserClient(KODI_HANDLE handle,
@@ -89,6 +103,11 @@ CWebBrowserClient::CWebBrowserClient(KODI_HANDLE handle,
   m_dialogContextMenu = new CBrowerDialogContextMenu(this);
   m_v8Kodi = new CV8Kodi(this);
 
+  m_frameRateGovernor.Initialize(static_cast<int>(GetFPS()));
+#ifndef WIN32
+  m_externalBeginFrame = kodi::GetSettingBoolean("performance.external_begin_frame", false);
+#endif
+
   LOG_MESSAGE(ADDON_LOG_DEBUG, "CWebBrowserClient START (%p) count open %i\n", this, ++m_ctorcount);
 }
 
@@ -104,10 +123,14 @@ CWebBrowserClient::~CWebBrowserClient()
 
 bool CWebBrowserClient::SetActive()
 {
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+
   m_renderViewReady = true;
-  if (m_browser.get())
+  m_renderer->Resume(browser);
+  m_frameRateGovernor.SetVisible(browser, true);
+  if (browser)
   {
-    m_browser->GetHost()->SetFocus(true);
+    browser->GetHost()->SetFocus(true);
     SetOpenedAddress(m_currentURL);
     SetOpenedTitle(m_currentTitle);
     SetIconURL(m_currentIcon);
@@ -119,11 +142,15 @@ bool CWebBrowserClient::SetActive()
 
 bool CWebBrowserClient::SetInactive()
 {
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+
   m_renderViewReady = false;
+  m_frameRateGovernor.SetVisible(browser, false);
+  m_renderer->Suspend(browser);
 
-  if (m_browser.get())
+  if (browser)
   {
-    m_browser->GetHost()->SetFocus(false);
+    browser->GetHost()->SetFocus(false);
     return true;
   }
 
@@ -132,15 +159,23 @@ bool CWebBrowserClient::SetInactive()
 
 void CWebBrowserClient::CloseComplete()
 {
-  CEF_REQUIRE_UI_THREAD();
-
   SetInactive();
 
-  if (m_browser.get())
+  // Set together with the browser look up, a browser created after it is
+  // closed by OnAfterCreated()
+  CefRefPtr<CefBrowser> browser;
+  {
+    std::lock_guard<std::mutex> lock(m_browserMutex);
+    m_closed = true;
+    browser = m_browser;
+  }
+
+  if (browser)
   {
     m_contextHandler->Clear();
     m_contextHandler = nullptr;
-    m_browser->GetHost()->CloseBrowser(true);
+    browser->GetHost()->CloseBrowser(true);
+    GetMain().GetCloseTracker().CloseSent(m_uniqueClientId, browser->GetIdentifier());
   }
 
   m_renderer->ClearClient();
@@ -151,9 +186,69 @@ void CWebBrowserClient::CloseComplete()
   m_v8Kodi = nullptr;
 }
 
+void CWebBrowserClient::AdoptBrowser(CefRefPtr<CefBrowser> browser)
+{
+  if (!CefCurrentlyOn(TID_UI))
+  {
+    CefPostTask(TID_UI, base::Bind(&CWebBrowserClient::AdoptBrowser, this, browser));
+    return;
+  }
+
+  // The render view of the pooled browser exists already
+  OnAfterCreated(browser);
+  {
+    std::lock_guard<std::mutex> lock(m_browserMutex);
+    if (m_closed)
+      return;
+  }
+  m_renderViewReady = true;
+
+  CefRefPtr<CefBrowserHost> host = browser->GetHost();
+  host->SetWindowlessFrameRate(static_cast<int>(GetFPS()));
+  host->WasHidden(false);
+  host->WasResized();
+  host->Invalidate(PET_VIEW);
+}
+
+void CWebBrowserClient::SetCreationStart(CTimeStatistics::Clock::time_point start, bool pooled)
+{
+  m_creationStart = start;
+  m_pooledBrowser = pooled;
+}
+
+void CWebBrowserClient::ViewPainted()
+{
+  if (!m_firstPaintArmed || m_firstPaintReported)
+    return;
+
+  m_firstPaintReported = true;
+  GetMain().GetBrowserPool().ReportFirstPaint(m_uniqueClientId, m_pooledBrowser,
+                                              CTimeStatistics::Now() - m_creationStart);
+}
+
+void CWebBrowserClient::RunOnMainThread(std::function<void()> task)
+{
+  CefRefPtr<CWebBrowserClient> self(this);
+  m_mainBrowserHandler->GetMainThreadTasks().Run([self, task]() {
+    // Kodi's control can be gone while the task was queued
+    if (!self->m_closed)
+      task();
+  });
+}
+
+CefRefPtr<CefBrowser> CWebBrowserClient::GetBrowser() const
+{
+  std::lock_guard<std::mutex> lock(m_browserMutex);
+  return m_browser;
+}
+
 void CWebBrowserClient::SendKey(int key)
 {
-  CefRefPtr<CefBrowserHost> host = m_browser->GetHost();
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+  if (!browser)
+    return;
+
+  CefRefPtr<CefBrowserHost> host = browser->GetHost();
   CefKeyEvent key_event;
   key_event.windows_key_code = key;
   key_event.type = KEYEVENT_RAWKEYDOWN;
@@ -203,12 +298,15 @@ bool CWebBrowserClient::HandleScrollEvent(int actionId)
 
 bool CWebBrowserClient::OnAction(const kodi::gui::input::CAction& action, int& nextItem)
 {
-  if (!m_browser.get())
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+  if (!browser)
     return false;
 
   fprintf(stderr, "--> %s %i %i %i %i\n", __func__, action.GetID(), action.GetButtonCode(), action.GetUnicode(), nextItem);
 
-  CefRefPtr<CefBrowserHost> host = m_browser->GetHost();
+  m_frameRateGovernor.InputActivity();
+
+  CefRefPtr<CefBrowserHost> host = browser->GetHost();
   ADDON_ACTION actionId = action.GetID();
   if (!m_focusOnEditableField)
   {
@@ -262,7 +360,7 @@ bool CWebBrowserClient::OnAction(const kodi::gui::input::CAction& action, int& n
           break;
 
         LOG_MESSAGE(ADDON_LOG_DEBUG, "%s - Zoom out to %i %%", __func__, zoomTo);
-        m_browser->GetHost()->SetZoomLevel(PercentageToZoomLevel(zoomTo));
+        SetZoomLevel(PercentageToZoomLevel(zoomTo));
         kodi::SetSettingInt("main.zoomlevel", zoomTo);
         break;
       }
@@ -276,7 +374,7 @@ bool CWebBrowserClient::OnAction(const kodi::gui::input::CAction& action, int& n
         LOG_MESSAGE(ADDON_LOG_DEBUG, "%s - Zoom in to %i %% - %i %i", __func__, zoomTo,
                     kodi::GetSettingInt("main.zoomlevel"),
                     kodi::GetSettingInt("main.zoom_step_size"));
-        m_browser->GetHost()->SetZoomLevel(PercentageToZoomLevel(zoomTo));
+        SetZoomLevel(PercentageToZoomLevel(zoomTo));
         kodi::SetSettingInt("main.zoomlevel", zoomTo);
         break;
       }
@@ -315,11 +413,14 @@ bool CWebBrowserClient::OnAction(const kodi::gui::input::CAction& action, int& n
 bool CWebBrowserClient::OnMouseEvent(
     int id, double x, double y, double offsetX, double offsetY, int state)
 {
-  if (!m_browser.get())
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+  if (!browser)
     return true;
 
+  m_frameRateGovernor.InputActivity();
+
   static const int scrollbarPixelsPerTick = 40;
-  CefRefPtr<CefBrowserHost> host = m_browser->GetHost();
+  CefRefPtr<CefBrowserHost> host = browser->GetHost();
 
   CefMouseEvent mouse_event;
   mouse_event.x = static_cast<int>((x - GetSkinXPos()) * m_fMouseXScaleFactor);
@@ -410,14 +511,27 @@ bool CWebBrowserClient::OnMouseEvent(
 
 bool CWebBrowserClient::Initialize()
 {
-  if (!m_browser.get())
+  if (!GetBrowser())
   {
     LOG_MESSAGE(ADDON_LOG_ERROR, "%s - Called without present browser", __func__);
     return false;
   }
 
   if (m_renderViewReady)
-    m_browser->GetHost()->SetZoomLevel(PercentageToZoomLevel(kodi::GetSettingInt("main.zoomlevel")));
+  {
+    std::unique_lock<std::mutex> lock(m_stateMutex);
+    if (m_restoreView)
+    {
+      const double zoomLevel = m_restoreZoomLevel;
+      lock.unlock();
+      SetZoomLevel(zoomLevel);
+    }
+    else
+    {
+      lock.unlock();
+      SetZoomLevel(PercentageToZoomLevel(kodi::GetSettingInt("main.zoomlevel")));
+    }
+  }
 
   return true;
 }
@@ -433,19 +547,30 @@ bool CWebBrowserClient::Dirty()
   if (!m_renderViewReady)
     return false;
 
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+
+  // Kodi asks this once per frame for a visible control, request the page
+  // frame here to have it with the next render pass.
+  if (m_externalBeginFrame && browser && m_frameRateGovernor.BeginFrameDue())
+    m_renderer->SendExternalBeginFrame(browser);
+
+  const bool playing = browser && GetMain().GetAudioHandler() &&
+                       GetMain().GetAudioHandler()->IsPlaying(browser->GetIdentifier());
+  m_frameRateGovernor.Update(browser, m_controlFullScreen, m_isLoading, playing);
   return m_renderer->Dirty();
 }
 
 bool CWebBrowserClient::OpenWebsite(const std::string& url)
 {
   LOG_MESSAGE(ADDON_LOG_DEBUG, "Open website '%s'", url.c_str());
-  if (!m_browser.get())
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+  if (!browser)
   {
     LOG_MESSAGE(ADDON_LOG_ERROR, "CWebBrowserClient::%s: Called without present browser", __func__);
     return false;
   }
 
-  CefRefPtr<CefFrame> frame = m_browser->GetMainFrame();
+  CefRefPtr<CefFrame> frame = browser->GetMainFrame();
   if (!frame.get())
   {
     LOG_MESSAGE(ADDON_LOG_ERROR, "CWebBrowserClient::%s: Called without present frame", __func__);
@@ -458,11 +583,38 @@ bool CWebBrowserClient::OpenWebsite(const std::string& url)
   else
     usedURL = url;
 
+  {
+    // The first website of a restored control is the one before its discard
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    if (!m_restoreURL.empty())
+    {
+      LOG_MESSAGE(ADDON_LOG_DEBUG, "Open restored website '%s' instead", m_restoreURL.c_str());
+      usedURL = m_restoreURL;
+      m_restoreURL.clear();
+    }
+  }
+
   if (m_strStartupURL.empty())
     m_strStartupURL = usedURL;
 
-  m_currentIcon = "DefaultFile.png"; // Use default image from Kodi itself
-  SetIconURL(m_currentIcon);
+  // Use default image from Kodi itself, called also from OnBeforePopup()
+  RunOnMainThread([this]() {
+    m_currentIcon = "DefaultFile.png";
+    SetIconURL(m_currentIcon);
+  });
+
+  // Wait with the load until Widevine is registered, the website could ask
+  // for it already during its load
+  CefRefPtr<CWebBrowserClient> self(this);
+  if (GetMain().GetWidevineControl().DeferUntilRegistered([self, usedURL]() {
+        CefRefPtr<CefBrowser> browser = self->GetBrowser();
+        if (!self->m_closed && browser)
+          browser->GetMainFrame()->LoadURL(usedURL);
+      }))
+  {
+    LOG_MESSAGE(ADDON_LOG_DEBUG, "Load of '%s' deferred until Widevine is registered", usedURL.c_str());
+    return true;
+  }
 
   frame->LoadURL(usedURL);
 
@@ -509,12 +661,129 @@ void CWebBrowserClient::OpenOwnContextMenu()
   }
 }
 
+void CWebBrowserClient::Reload()
+{
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+  if (browser)
+    browser->Reload();
+}
+
+void CWebBrowserClient::StopLoad()
+{
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+  if (browser)
+    browser->StopLoad();
+}
+
+void CWebBrowserClient::GoBack()
+{
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+  if (!browser || (!browser->CanGoBack() && GoToRestoredHistory(-1)))
+    return;
+
+  browser->GoBack();
+}
+
+void CWebBrowserClient::GoForward()
+{
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+  if (!browser || (!browser->CanGoForward() && GoToRestoredHistory(1)))
+    return;
+
+  browser->GoForward();
+}
+
+bool CWebBrowserClient::GoToRestoredHistory(int offset)
+{
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+  if (!browser)
+    return false;
+
+  std::string url;
+  {
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+
+    // Only usable from the first own entry, forward only without own ones
+    if (m_restoredHistory.empty() || m_historyCurrent != 0 ||
+        (offset > 0 && m_historyEntries.size() > 1))
+      return false;
+
+    const int index = static_cast<int>(m_restoredCurrent) + offset;
+    if (index < 0 || index >= static_cast<int>(m_restoredHistory.size()))
+      return false;
+
+    m_restoredCurrent = static_cast<size_t>(index);
+    url = m_restoredHistory[m_restoredCurrent].url;
+  }
+
+  // Replaced instead of loaded, so the browser stays on its first entry
+  CefRefPtr<CefFrame> frame = browser->GetMainFrame();
+  frame->ExecuteJavaScript("location.replace(" + ToJavaScriptString(url) + ");", frame->GetURL(), 0);
+  return true;
+}
+
+ControlState CWebBrowserClient::GetState()
+{
+  ControlState state;
+  state.url = m_currentURL;
+  state.scrollOffsetX = m_renderer->ScrollOffsetX();
+  state.scrollOffsetY = m_renderer->ScrollOffsetY();
+  state.zoomLevel = m_zoomLevel;
+
+  std::lock_guard<std::mutex> lock(m_stateMutex);
+
+  // The own entries start at the current one of a restored history
+  const size_t restoredCurrent = std::min(m_restoredCurrent, m_restoredHistory.size());
+  if (m_historyEntries.empty())
+  {
+    state.history = m_restoredHistory;
+    state.historyCurrent = restoredCurrent;
+  }
+  else
+  {
+    state.history.assign(m_restoredHistory.begin(), m_restoredHistory.begin() + restoredCurrent);
+    state.history.insert(state.history.end(), m_historyEntries.begin(), m_historyEntries.end());
+    state.historyCurrent = restoredCurrent + m_historyCurrent;
+    if (m_historyEntries.size() == 1 && restoredCurrent + 1 < m_restoredHistory.size())
+      state.history.insert(state.history.end(), m_restoredHistory.begin() + restoredCurrent + 1,
+                           m_restoredHistory.end());
+  }
+
+  if (state.url.empty() && state.historyCurrent < state.history.size())
+    state.url = state.history[state.historyCurrent].url;
+
+  return state;
+}
+
+void CWebBrowserClient::RestoreState(const ControlState& state)
+{
+  std::lock_guard<std::mutex> lock(m_stateMutex);
+
+  m_restoredHistory = state.history;
+  m_restoredCurrent = std::min(state.historyCurrent, state.history.size());
+  m_restoreURL = state.url;
+  m_restoreView = true;
+  m_restoreZoomLevel = state.zoomLevel;
+  m_restoreScrollX = state.scrollOffsetX;
+  m_restoreScrollY = state.scrollOffsetY;
+}
+
 bool CWebBrowserClient::GetHistory(std::vector<std::string>& historyWebsiteNames,
                                    bool behindCurrent)
 {
-  if (!m_browser)
+  if (!GetBrowser())
     return false;
 
+  std::lock_guard<std::mutex> lock(m_stateMutex);
+
+  // Entries before a discard, see GoToRestoredHistory()
+  const size_t restoredCurrent = std::min(m_restoredCurrent, m_restoredHistory.size());
+  if (!behindCurrent && m_historyCurrent == 0)
+  {
+    for (size_t i = 0; i < restoredCurrent; ++i)
+      historyWebsiteNames.push_back(m_restoredHistory[i].title);
+  }
+
   bool currentFound = false;
   for (const auto& entry : m_historyWebsiteNames)
   {
@@ -532,6 +801,12 @@ bool CWebBrowserClient::GetHistory(std::vector<std::string>& historyWebsiteNames
     historyWebsiteNames.push_back(entry.first);
   }
 
+  if (behindCurrent && m_historyEntries.size() <= 1)
+  {
+    for (size_t i = restoredCurrent + 1; i < m_restoredHistory.size(); ++i)
+      historyWebsiteNames.push_back(m_restoredHistory[i].title);
+  }
+
   return true;
 }
 
@@ -540,19 +815,21 @@ void CWebBrowserClient::SearchText(const std::string& text,
                                    bool matchCase,
                                    bool findNext)
 {
-  if (m_browser)
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+  if (browser)
   {
     if (m_currentSearchText != text)
-      m_browser->GetHost()->StopFinding(true);
-    m_browser->GetHost()->Find(0, text, forward, matchCase, findNext);
+      browser->GetHost()->StopFinding(true);
+    browser->GetHost()->Find(0, text, forward, matchCase, findNext);
     m_currentSearchText = text;
   }
 }
 
 void CWebBrowserClient::StopSearch(bool clearSelection)
 {
-  if (m_browser)
-    m_browser->GetHost()->StopFinding(clearSelection);
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+  if (browser)
+    browser->GetHost()->StopFinding(clearSelection);
   m_currentSearchText.clear();
 }
 
@@ -560,9 +837,11 @@ void CWebBrowserClient::ScreenSizeChange(
     float x, float y, float width, float height, bool fullscreen)
 {
   m_isFullScreen = true;
+  m_controlFullScreen = fullscreen;
   m_renderer->ScreenSizeChange(x, y, width, height);
-  if (m_browser.get())
-    m_browser->GetHost()->WasResized();
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+  if (browser)
+    browser->GetHost()->WasResized();
 }
 
 float CWebBrowserClient::GetWidth() const
@@ -657,8 +936,11 @@ void CWebBrowserClient::OnAddressChange(CefRefPtr<CefBrowser> browser,
 
   if (frame->IsMain())
   {
-    m_currentURL = url.ToString();
-    SetOpenedAddress(m_currentURL);
+    const std::string currentURL = url.ToString();
+    RunOnMainThread([this, currentURL]() {
+      m_currentURL = currentURL;
+      SetOpenedAddress(m_currentURL);
+    });
   }
 }
 
@@ -666,11 +948,14 @@ void CWebBrowserClient::OnTitleChange(CefRefPtr<CefBrowser> browser, const CefSt
 {
   CEF_REQUIRE_UI_THREAD();
 
-  if (m_currentTitle != title.ToString())
-  {
-    m_currentTitle = title.ToString();
-    SetOpenedTitle(m_currentTitle);
-  }
+  const std::string currentTitle = title.ToString();
+  RunOnMainThread([this, currentTitle]() {
+    if (m_currentTitle != currentTitle)
+    {
+      m_currentTitle = currentTitle;
+      SetOpenedTitle(m_currentTitle);
+    }
+  });
 }
 
 void CWebBrowserClient::OnFaviconURLChange(CefRefPtr<CefBrowser> browser,
@@ -685,12 +970,11 @@ void CWebBrowserClient::OnFaviconURLChange(CefRefPtr<CefBrowser> browser,
     kodi::Log(ADDON_LOG_DEBUG, " - Icon %i - %s", i + 1, icon_urls[i].ToString().c_str());
 #endif
 
-  if (listSize > 0)
-    m_currentIcon = icon_urls[0].ToString();
-  else
-    m_currentIcon = "";
-
-  SetIconURL(m_currentIcon);
+  const std::string currentIcon = listSize > 0 ? icon_urls[0].ToString() : "";
+  RunOnMainThread([this, currentIcon]() {
+    m_currentIcon = currentIcon;
+    SetIconURL(m_currentIcon);
+  });
 }
 
 void CWebBrowserClient::OnFullscreenModeChange(CefRefPtr<CefBrowser> browser, bool fullscreen)
@@ -702,8 +986,8 @@ void CWebBrowserClient::OnFullscreenModeChange(CefRefPtr<CefBrowser> browser, bo
     m_isFullScreen = fullscreen;
 
     kodi::Log(ADDON_LOG_DEBUG, "From currently opened web site becomes fullsreen requested as '%s'",
-              m_isFullScreen ? "yes" : "no");
-    SetFullscreen(m_isFullScreen);
+              fullscreen ? "yes" : "no");
+    RunOnMainThread([this, fullscreen]() { SetFullscreen(fullscreen); });
   }
 }
 
@@ -714,7 +998,8 @@ bool CWebBrowserClient::OnTooltip(CefRefPtr<CefBrowser> browser, CefString& text
   if (m_currentTooltip != text.ToString().c_str())
   {
     m_currentTooltip = text.ToString().c_str();
-    SetTooltip(m_currentTooltip);
+    const std::string currentTooltip = m_currentTooltip;
+    RunOnMainThread([this, currentTooltip]() { SetTooltip(currentTooltip); });
   }
 
   return true;
@@ -727,7 +1012,8 @@ void CWebBrowserClient::OnStatusMessage(CefRefPtr<CefBrowser> browser, const Cef
   if (m_currentStatusMsg != value.ToString().c_str())
   {
     m_currentStatusMsg = value.ToString().c_str();
-    SetStatusMessage(m_currentStatusMsg);
+    const std::string currentStatusMsg = m_currentStatusMsg;
+    RunOnMainThread([this, currentStatusMsg]() { SetStatusMessage(currentStatusMsg); });
   }
 }
 
@@ -795,7 +1081,12 @@ bool CWebBrowserClient::OnBeforePopup(CefRefPtr<CefBrowser> browser,
 
   if (!m_isFullScreen && kodi::GetSettingBoolean("main.allow_open_to_tabs") &&
       target_disposition != WOD_CURRENT_TAB)
-    RequestOpenSiteInNewTab(target_url); /* Request to do on kodi itself */
+  {
+    const std::string targetURL = target_url.ToString();
+    RunOnMainThread([this, targetURL]() {
+      RequestOpenSiteInNewTab(targetURL); /* Request to do on kodi itself */
+    });
+  }
   else
     OpenWebsite(std::string(target_url));
   return false; /* Cancel popups in off-screen rendering mode */
@@ -838,13 +1129,30 @@ void CWebBrowserClient::OnAfterCreated(CefRefPtr<CefBrowser> browser)
     }
   }
 
+  std::unique_lock<std::mutex> lock(m_browserMutex);
   if (!m_browser.get())
   {
     m_browser = browser;
     m_browserId = browser->GetIdentifier();
+    const bool closed = m_closed;
+    lock.unlock();
+
+    // The control was destroyed while the browser was created, without the
+    // close here it would stay alive until CefShutdown()
+    if (closed)
+    {
+      if (m_contextHandler)
+      {
+        m_contextHandler->Clear();
+        m_contextHandler = nullptr;
+      }
+      browser->GetHost()->CloseBrowser(true);
+      GetMain().GetCloseTracker().CloseSent(m_uniqueClientId, browser->GetIdentifier());
+      return;
+    }
 
     /* Inform Kodi the control is ready */
-    SetControlReady(true);
+    RunOnMainThread([this]() { SetControlReady(true); });
   }
 }
 
@@ -859,6 +1167,8 @@ void CWebBrowserClient::OnBeforeClose(CefRefPtr<CefBrowser> browser)
   CEF_REQUIRE_UI_THREAD();
 
   m_messageRouter->OnBeforeClose(browser);
+  if (GetMain().GetAudioHandler())
+    GetMain().GetAudioHandler()->ClearBrowserVolume(browser->GetIdentifier());
   if (--m_browserCount == 0)
   {
     for (const auto& entry : m_messageHandlers)
@@ -868,8 +1178,11 @@ void CWebBrowserClient::OnBeforeClose(CefRefPtr<CefBrowser> browser)
     }
     m_messageHandlers.clear();
     m_messageRouter = nullptr;
+
+    GetMain().GetCloseTracker().Closed(m_uniqueClientId);
   }
 
+  std::lock_guard<std::mutex> lock(m_browserMutex);
   m_browser = nullptr;
 }
 //@}
@@ -1056,7 +1369,9 @@ void CWebBrowserClient::OnLoadingStateChange(CefRefPtr<CefBrowser> browser,
 {
   CEF_REQUIRE_UI_THREAD();
 
-  SetLoadingState(isLoading, canGoBack, canGoForward);
+  RunOnMainThread([this, isLoading, canGoBack, canGoForward]() {
+    SetLoadingState(isLoading, canGoBack, canGoForward);
+  });
 }
 
 void CWebBrowserClient::OnLoadStart(CefRefPtr<CefBrowser> browser,
@@ -1069,6 +1384,10 @@ void CWebBrowserClient::OnLoadStart(CefRefPtr<CefBrowser> browser,
 
   m_isLoading = true;
   Initialize();
+
+  // OnLoadStart() comes after the commit, the next paint shows the site
+  if (frame->IsMain() && !m_firstPaintReported)
+    m_firstPaintArmed = true;
 }
 
 void CWebBrowserClient::OnLoadEnd(CefRefPtr<CefBrowser> browser,
@@ -1082,10 +1401,14 @@ void CWebBrowserClient::OnLoadEnd(CefRefPtr<CefBrowser> browser,
   class CHistoryReporter : public CefNavigationEntryVisitor
   {
   public:
-    CHistoryReporter(std::vector<std::pair<std::string, bool>>& historyWebsiteNames)
-      : m_historyWebsiteNames(historyWebsiteNames)
+    CHistoryReporter(CefRefPtr<CWebBrowserClient> client) : m_client(client) {}
+    ~CHistoryReporter() override
     {
-      m_historyWebsiteNames.clear();
+      // Taken for a later discard of the control
+      std::lock_guard<std::mutex> lock(m_client->m_stateMutex);
+      m_client->m_historyWebsiteNames.swap(m_historyWebsiteNames);
+      m_client->m_historyEntries.swap(m_entries);
+      m_client->m_historyCurrent = m_current;
     }
     virtual bool Visit(CefRefPtr<CefNavigationEntry> entry,
                        bool current,
@@ -1093,14 +1416,35 @@ void CWebBrowserClient::OnLoadEnd(CefRefPtr<CefBrowser> browser,
                        int total) override
     {
       m_historyWebsiteNames.push_back(std::pair<std::string, bool>(entry->GetTitle(), current));
+      m_entries.push_back({entry->GetURL(), entry->GetTitle()});
+      if (current)
+        m_current = static_cast<size_t>(index);
       return true;
     }
 
   private:
-    std::vector<std::pair<std::string, bool>>& m_historyWebsiteNames;
+    CefRefPtr<CWebBrowserClient> m_client;
+    std::vector<std::pair<std::string, bool>> m_historyWebsiteNames;
+    std::vector<ControlState::HistoryEntry> m_entries;
+    size_t m_current{0};
     IMPLEMENT_REFCOUNTING(CHistoryReporter);
   };
-  browser->GetHost()->GetNavigationEntries(new CHistoryReporter(m_historyWebsiteNames), false);
+  browser->GetHost()->GetNavigationEntries(new CHistoryReporter(this), false);
+
+  if (frame->IsMain())
+  {
+    std::unique_lock<std::mutex> lock(m_stateMutex);
+    if (m_restoreView)
+    {
+      // The scroll offset of the page before its discard, given after the
+      // load as the page has then its size
+      m_restoreView = false;
+      const std::string script = StringUtils::Format("window.scrollTo(%f, %f);", m_restoreScrollX,
+                                                     m_restoreScrollY);
+      lock.unlock();
+      frame->ExecuteJavaScript(script, frame->GetURL(), 0);
+    }
+  }
 }
 
 void CWebBrowserClient::OnLoadError(CefRefPtr<CefBrowser> browser,
@@ -1141,6 +1485,14 @@ double CWebBrowserClient::PercentageToZoomLevel(int percent)
   return (static_cast<double>(percent - 100)) / ZOOM_MULTIPLY;
 }
 
+void CWebBrowserClient::SetZoomLevel(double zoomLevel)
+{
+  m_zoomLevel = zoomLevel;
+  CefRefPtr<CefBrowser> browser = GetBrowser();
+  if (browser)
+    browser->GetHost()->SetZoomLevel(zoomLevel);
+}
+
 void CWebBrowserClient::CreateMessageHandlers(MessageHandlerSet& handlers)
 {
   handlers.insert(new CJSHandler(this));
@@ -10,6 +10,8 @@
 
 #define NDEBUG 1
 
+#include "FrameRateGovernor.h"
+#include "InactiveControls.h"
 #include "include/cef_app.h"
 #include "include/cef_audio_handler.h"
 #include "include/cef_client.h"
@@ -18,11 +20,14 @@
 #include "include/wrapper/cef_resource_manager.h"
 #include "interface/v8/v8-kodi.h"
 #include "renderer/Renderer.h"
+#include "utils/TimeStatistics.h"
 
 #include <atomic>
+#include <functional>
 #include <kodi/AudioEngine.h>
 #include <kodi/addon-instance/Web.h>
 #include <kodi/gui/dialogs/Select.h>
+#include <mutex>
 #include <queue>
 #include <set>
 
@@ -69,10 +74,10 @@ public:
   bool OpenWebsite(const std::string& url) override;
   void Render() override;
   bool Dirty() override;
-  void Reload() override { m_browser->Reload(); }
-  void StopLoad() override { m_browser->StopLoad(); }
-  void GoBack() override { m_browser->GoBack(); }
-  void GoForward() override { m_browser->GoForward(); }
+  void Reload() override;
+  void StopLoad() override;
+  void GoBack() override;
+  void GoForward() override;
   void OpenOwnContextMenu() override;
   bool GetHistory(std::vector<std::string>& historyWebsiteNames, bool behindCurrent) override;
   void SearchText(const std::string& text, bool forward, bool matchCase, bool findNext) override;
@@ -84,6 +89,7 @@ public:
 
   int GetUniqueId() { return m_uniqueClientId; }
   bool IsFullscreen() { return m_isFullScreen; }
+  bool UseExternalBeginFrame() const { return m_externalBeginFrame; }
 
   void SetContextMenuOpen(bool openClosed) { m_contextMenuOpenClosed = openClosed; }
   bool ContextMenuOpen() const { return m_contextMenuOpenClosed; }
@@ -93,6 +99,31 @@ public:
   bool SetActive();
   void CloseComplete();
 
+  /*!
+   * @brief Take over an already created browser of the pool, instead of
+   * CEF's OnAfterCreated() for a new one.
+   */
+  void AdoptBrowser(CefRefPtr<CefBrowser> browser);
+
+  /*!
+   * @brief Start of the control creation, to report the time until the
+   * first paint of the loaded site.
+   */
+  void SetCreationStart(CTimeStatistics::Clock::time_point start, bool pooled);
+  void ViewPainted();
+
+  /*!
+   * @brief State of the website to open it later again, from Kodi's main
+   * thread before the control is discarded.
+   */
+  ControlState GetState();
+
+  /*!
+   * @brief Open the website of a discarded control instead of the first one
+   * asked by Kodi, given before the browser is created.
+   */
+  void RestoreState(const ControlState& state);
+
   /// CefClient methods
   //@{
   bool OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
@@ -212,10 +243,27 @@ public:
   //@}
 
   bool IsLoading() { return m_isLoading; }
-  CefRefPtr<CefBrowser> GetBrowser() { return m_browser; }
+
+  /*!
+   * @brief The browser of the control, nullptr before its creation and after
+   * its close.
+   *
+   * Set and cleared on CEF's UI thread, the callers on other threads work
+   * with the returned reference.
+   */
+  CefRefPtr<CefBrowser> GetBrowser() const;
 
   CWebBrowser& GetMain() { return *m_mainBrowserHandler; }
 
+  /*!
+   * @brief Do the task on Kodi's main thread, needed for all calls into
+   * Kodi's web control interface from CEF's handlers.
+   *
+   * The client is kept until the task is done, after CloseComplete() are
+   * queued tasks dropped.
+   */
+  void RunOnMainThread(std::function<void()> task);
+
   void AddExtension(CefRefPtr<CefExtension> extension);
 
 private:
@@ -230,6 +278,9 @@ private:
 
   int ZoomLevelToPercentage(double zoomlevel);
   double PercentageToZoomLevel(int percent);
+  void SetZoomLevel(double zoomLevel);
+
+  bool GoToRestoredHistory(int offset);
 
   const int m_uniqueClientId; // Unique identification id of this control client
   CWebBrowser* m_mainBrowserHandler;
@@ -239,8 +290,9 @@ private:
   double m_scrollOffsetX{-1.0};
   double m_scrollOffsetY{-1.0};
 
-  bool m_contextMenuOpenClosed{false}; // To know for Keyboard that a context menu is opened
-  bool m_focusOnEditableField{false};
+  // Set from CEF's UI thread and used by Kodi's main thread
+  std::atomic_bool m_contextMenuOpenClosed{false}; // To know for Keyboard that a context menu is opened
+  std::atomic_bool m_focusOnEditableField{false};
   bool m_dragActive{false};
 
   bool m_renderViewReady{false};
@@ -250,18 +302,48 @@ private:
   int m_iMousePreviousFlags{0};
   cef_mouse_button_type_t m_iMousePreviousControl{MBT_LEFT};
 
-  bool m_isFullScreen{false};
-  bool m_isLoading{false};
+  std::atomic_bool m_isFullScreen{false};
+  // Fullscreen state given by Kodi for the control, only used by the frame
+  // rate governor, m_isFullScreen keeps its own handling of page requests
+  std::atomic_bool m_controlFullScreen{false};
+  std::atomic_bool m_isLoading{false};
+  bool m_closed{false};
+
+  // Time to first paint, used on CEF's UI thread after creation
+  CTimeStatistics::Clock::time_point m_creationStart;
+  bool m_pooledBrowser{false};
+  bool m_firstPaintArmed{false};
+  bool m_firstPaintReported{false};
+  bool m_externalBeginFrame{false};
+  // Only used on Kodi's main thread
   std::string m_currentURL;
   std::string m_currentTitle; // Last sended website title string
+  std::string m_currentIcon;
+  // Only used on CEF's UI thread
   std::string m_currentTooltip; // Last sended tooltip string
   std::string m_currentStatusMsg; // Last sended status message string
-  std::string m_currentIcon;
   std::vector<std::pair<std::string, bool>> m_historyWebsiteNames;
   std::string m_currentSearchText;
 
+  // State for a discard and restore, set on CEF's UI thread and used by
+  // Kodi's main thread
+  std::mutex m_stateMutex;
+  std::vector<ControlState::HistoryEntry> m_historyEntries;
+  size_t m_historyCurrent{0};
+  std::atomic<double> m_zoomLevel{0.0};
+  // History before the discard, used while the browser is on its first entry
+  std::vector<ControlState::HistoryEntry> m_restoredHistory;
+  size_t m_restoredCurrent{0};
+  // Restore of the first website, zoom and scroll offset
+  std::string m_restoreURL;
+  bool m_restoreView{false};
+  double m_restoreZoomLevel{0.0};
+  double m_restoreScrollX{0.0};
+  double m_restoreScrollY{0.0};
+
   MessageHandlerSet m_messageHandlers; // Set of Handlers registered with the message router.
 
+  mutable std::mutex m_browserMutex;
   CefRefPtr<CefBrowser> m_browser;
   CefRefPtr<CefMessageRouterBrowserSide> m_messageRouter;
   CefRefPtr<CefResourceManager>
@@ -270,6 +352,7 @@ private:
   CefRefPtr<CJSDialogHandler> m_jsDialogHandler;
   CefRefPtr<CRendererClient> m_renderer;
   CefRefPtr<CV8Kodi> m_v8Kodi;
+  CFrameRateGovernor m_frameRateGovernor;
   CefRefPtr<CRequestContextHandler> m_contextHandler;
 
   // Loaded extensions. Only accessed on the main thread.
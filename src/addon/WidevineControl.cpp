@@ -8,6 +8,8 @@
 
 #include "WidevineControl.h"
 
+#include "addon.h"
+
 #include "include/cef_app.h"
 #include "include/cef_version.h"
 #include "include/cef_web_plugin.h"
@@ -19,6 +21,18 @@
 #include <kodi/tools/StringUtils.h>
 #include <thread>
 
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <cstring>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <vector>
+
+extern char** environ;
+#endif
+
 // prevent the use of Windows Macros for file edit (are in conflict with Kodi's one)
 #ifdef WIN32
 #undef CreateDirectory
@@ -27,10 +41,37 @@
 
 using kodi::tools::StringUtils;
 
+namespace
+{
+
+// Longest time a website waits for the registration, it is loaded then also
+// without, e.g. if a dialog of the provisioning is still open
+constexpr auto DEFER_TIMEOUT = std::chrono::seconds(10);
+
+// Longest time for the probe process, its library load takes normally less
+// than a second
+constexpr auto PROBE_TIMEOUT = std::chrono::seconds(10);
+
+// Interval to check the end of the probe process
+constexpr auto PROBE_POLL_INTERVAL = std::chrono::milliseconds(10);
+
+// Library of inputstream.adaptive, copied without asking the user
+constexpr const char* INPUTSTREAM_LIB = "special://home/cdm/" WIDEVINE_LIB;
+
+// Switch of kodichromium to start as probe, see src/app/WidevineProbe.h
+constexpr const char* WIDEVINE_PROBE_SWITCH = "widevine-manifest";
+
+double ElapsedMs(CTimeStatistics::Clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(CTimeStatistics::Now() - start).count();
+}
+
+} // namespace
+
 class ATTRIBUTE_HIDDEN CRegisterCdmCallback : public CefRegisterCdmCallback
 {
 public:
-  CRegisterCdmCallback() = default;
+  CRegisterCdmCallback(CWidewineControl& control) : m_control(control) {}
   ~CRegisterCdmCallback() override = default;
 
   void OnCdmRegistrationComplete(cef_cdm_registration_error_t result,
@@ -41,61 +82,320 @@ public:
     else
       kodi::Log(ADDON_LOG_ERROR, "Chromium widevine registration failed with '%s'",
                 error_message.ToString().c_str());
+
+    m_control.RegistrationDone(result == CEF_CDM_REGISTRATION_ERROR_NONE);
   }
 
 private:
   IMPLEMENT_REFCOUNTING(CRegisterCdmCallback);
+
+  CWidewineControl& m_control;
 };
 
 //------------------------------------------------------------------------------
 
 bool CWidewineControl::InitializeWidevine()
 {
-  if (!CreateManifestAndInstall(false))
+  m_startTime = CTimeStatistics::Now();
+
+  if (!kodi::GetSettingBoolean("system.usewidevine"))
+  {
+    kodi::Log(
+        ADDON_LOG_INFO,
+        "Chromium widevine not present or disabled and ignored (Some streams are not supported!)");
+    m_state = State::Disabled;
     return false;
+  }
+
+  // Already installed, the registration itself is done by CEF in background
+  if (IsInstalled(kodi::GetBaseUserPath("widevine/")))
+  {
+    Register();
+    return true;
+  }
 
-  CefRegisterWidevineCdm(kodi::GetBaseUserPath("widevine"), new CRegisterCdmCallback);
+  m_provisionStop = false;
+  if (kodi::vfs::FileExists(INPUTSTREAM_LIB))
+  {
+    m_state = State::Provisioning;
+    StartProvisioning("");
+  }
+  else
+  {
+    // Dialogs are only shown on Kodi's main thread, see Process()
+    m_state = State::AskingPath;
+  }
   return true;
 }
 
-void CWidewineControl::DeinitializeWidevine()
+void CWidewineControl::Process()
 {
-  /*
-   * Check if widevine install with open of it was done, if yes check 32 seconds are done
-   * since them, if Kodi stopps before comes a crash.
-   */
-  if (m_cryticalInstallDone)
+  if (m_state == State::AskingPath)
   {
-    auto now = std::chrono::system_clock::now();
-    std::chrono::duration<double> time_span =
-        std::chrono::duration_cast<std::chrono::duration<double>>(now - m_installTime);
-    if (time_span.count() < 32.0)
+    // Changed before the dialogs, a Process() called from inside them does
+    // not ask again
+    m_state = State::Provisioning;
+    const std::string path = AskLibraryPath();
+    if (!path.empty())
+    {
+      StartProvisioning(path);
+    }
+    else
     {
-      kodi::Log(ADDON_LOG_WARNING,
-                "Widevine lib check was started %f seconds before, need to wait until 32 seconds "
-                "done before exit!",
-                time_span.count());
-      std::this_thread::sleep_for(std::chrono::duration<double>(32.0) - time_span);
+      kodi::Log(ADDON_LOG_INFO, "CWidewineControl::%s: No Widevine library selected", __func__);
+      m_state = State::Failed;
     }
   }
+  else if (m_state == State::Provisioned)
+  {
+    Register();
+  }
+
+  std::vector<std::function<void()>> deferred;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_deferred.empty())
+      return;
+
+    const bool waiting = RegistrationPending(m_state);
+    if (waiting && CTimeStatistics::Now() - m_deferredSince < DEFER_TIMEOUT)
+      return;
+
+    kodi::Log(waiting ? ADDON_LOG_WARNING : ADDON_LOG_DEBUG,
+              "CWidewineControl::%s: Loading %zu deferred websites after %.1f ms%s", __func__,
+              m_deferred.size(), ElapsedMs(m_deferredSince),
+              waiting ? ", Widevine registration not complete" : "");
+    deferred.swap(m_deferred);
+  }
+
+  for (const auto& load : deferred)
+    load();
 }
 
-bool CWidewineControl::CreateManifestAndInstall(bool force)
+bool CWidewineControl::DeferUntilRegistered(std::function<void()> load)
 {
-  if (!kodi::GetSettingBoolean("system.usewidevine"))
+  if (!RegistrationPending(m_state))
+    return false;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_deferred.empty())
+    m_deferredSince = CTimeStatistics::Now();
+  m_deferred.push_back(std::move(load));
+  return true;
+}
+
+void CWidewineControl::RegistrationDone(bool success)
+{
+  m_state = success ? State::Registered : State::Failed;
+  kodi::Log(ADDON_LOG_INFO, "CWidewineControl::%s: Widevine usable %.1f ms after add-on start",
+            __func__, ElapsedMs(m_startTime));
+}
+
+bool CWidewineControl::RegistrationPending(State state)
+{
+#if defined(TARGET_LINUX)
+  // A library provisioned now is only registered after a restart, see
+  // Provision()
+  return state == State::Registering;
+#else
+  return state == State::AskingPath || state == State::Provisioning ||
+         state == State::Provisioned || state == State::Registering;
+#endif
+}
+
+bool CWidewineControl::IsInstalled(const std::string& addonPath)
+{
+  return kodi::vfs::FileExists(addonPath + WIDEVINE_LIB) &&
+         kodi::vfs::FileExists(addonPath + "manifest.json");
+}
+
+std::string CWidewineControl::AskLibraryPath()
+{
+  std::string path;
+  bool canceled = true;
+  // Retry if Yes/No is canceled, until the add-on is stopped
+  while (canceled && !m_provisionStop)
   {
-    kodi::Log(
-        ADDON_LOG_INFO,
-        "Chromium widevine not present or disabled and ignored (Some streams are not supported!)");
+    kodi::gui::dialogs::FileBrowser::ShowAndGetFile(
+        "local", WIDEVINE_LIB,
+        StringUtils::Format(kodi::GetLocalizedString(30196).c_str(), WIDEVINE_LIB), path, true);
+    if (!path.empty())
+      break;
+
+    if (!kodi::gui::dialogs::YesNo::ShowAndGetInput(kodi::GetLocalizedString(30197),
+                                                    kodi::GetLocalizedString(30198), canceled))
+    {
+      if (!canceled && !m_provisionStop)
+        kodi::SetSettingBoolean("system.usewidevine", false);
+    }
+  }
+
+  if (m_provisionStop)
+    return "";
+
+  return path;
+}
+
+void CWidewineControl::StartProvisioning(const std::string& path)
+{
+  // DeinitializeWidevine() can come from an other thread while a dialog of
+  // AskLibraryPath() is open, no thread is started after it
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_provisionStop)
+  {
+    m_state = State::Failed;
+    return;
+  }
+
+  m_provisionThread = std::thread(&CWidewineControl::Provision, this, path);
+}
+
+void CWidewineControl::Provision(const std::string& path)
+{
+  const auto start = CTimeStatistics::Now();
+  const bool installed = CreateManifestAndInstall(false, path);
+  if (m_provisionStop)
+  {
+    kodi::Log(ADDON_LOG_INFO, "CWidewineControl::%s: Provisioning stopped", __func__);
+    return;
+  }
+
+  kodi::Log(ADDON_LOG_INFO, "CWidewineControl::%s: Provisioning %s in %.1f ms, off the add-on start",
+            __func__, installed ? "done" : "failed", ElapsedMs(start));
+
+  if (!installed)
+  {
+    m_state = State::Failed;
+    return;
+  }
+
+#if defined(TARGET_LINUX)
+  // On Linux CEF takes the CDM only if registered before CefInitialize()
+  m_state = State::NeedsRestart;
+  kodi::QueueNotification(QUEUE_INFO, kodi::GetLocalizedString(30194),
+                          kodi::GetLocalizedString(30335));
+#else
+  m_state = State::Provisioned;
+#endif
+}
+
+void CWidewineControl::Register()
+{
+  m_state = State::Registering;
+  CefRegisterWidevineCdm(kodi::GetBaseUserPath("widevine"), new CRegisterCdmCallback(*this));
+}
+
+void CWidewineControl::DeinitializeWidevine()
+{
+  std::thread provisionThread;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_provisionStop = true;
+    provisionThread.swap(m_provisionThread);
+    m_deferred.clear();
+  }
+
+  // Without dialogs the thread ends soon after the stop, the probe is killed
+  if (provisionThread.joinable())
+    provisionThread.join();
+}
+
+bool CWidewineControl::RunProbe(const std::string& addonPath, const std::atomic_bool& stop)
+{
+  const auto start = CTimeStatistics::Now();
+  const std::string& helper = m_instance.GetBrowserSubprocessPath();
+
+  // The folder without the closing separator, added by the probe itself
+  std::string folder = addonPath;
+  while (!folder.empty() && (folder.back() == '/' || folder.back() == '\\'))
+    folder.pop_back();
+  const std::string argument = StringUtils::Format("--%s=%s", WIDEVINE_PROBE_SWITCH, folder.c_str());
+
+  int exitCode = -1;
+#ifdef WIN32
+  std::wstring commandLine =
+      L"\"" + CefString(helper).ToWString() + L"\" \"" + CefString(argument).ToWString() + L"\"";
+  STARTUPINFOW startupInfo = {};
+  startupInfo.cb = sizeof(startupInfo);
+  PROCESS_INFORMATION processInfo = {};
+  if (!CreateProcessW(nullptr, &commandLine[0], nullptr, nullptr, FALSE, CREATE_NO_WINDOW, nullptr,
+                      nullptr, &startupInfo, &processInfo))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Widevine probe '%s' failed to start (%lu)", helper.c_str(),
+              GetLastError());
+    return false;
+  }
+
+  const DWORD interval = static_cast<DWORD>(PROBE_POLL_INTERVAL.count());
+  const auto deadline = start + PROBE_TIMEOUT;
+  while (true)
+  {
+    if (WaitForSingleObject(processInfo.hProcess, interval) == WAIT_OBJECT_0)
+    {
+      DWORD code = 0;
+      if (GetExitCodeProcess(processInfo.hProcess, &code))
+        exitCode = static_cast<int>(code);
+      break;
+    }
+
+    if (stop || CTimeStatistics::Now() >= deadline)
+    {
+      TerminateProcess(processInfo.hProcess, 1);
+      kodi::Log(ADDON_LOG_ERROR, "Widevine probe not done after %.1f ms, stopped", ElapsedMs(start));
+      break;
+    }
+  }
+  CloseHandle(processInfo.hThread);
+  CloseHandle(processInfo.hProcess);
+#else
+  std::vector<char*> args{const_cast<char*>(helper.c_str()), const_cast<char*>(argument.c_str()),
+                          nullptr};
+  pid_t pid = 0;
+  const int error = posix_spawn(&pid, helper.c_str(), nullptr, nullptr, args.data(), environ);
+  if (error != 0)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Widevine probe '%s' failed to start (%s)", helper.c_str(),
+              strerror(error));
     return false;
   }
 
+  int status = 0;
+  const auto deadline = start + PROBE_TIMEOUT;
+  while (true)
+  {
+    const pid_t result = waitpid(pid, &status, WNOHANG);
+    if (result == pid)
+    {
+      if (WIFEXITED(status))
+        exitCode = WEXITSTATUS(status);
+      break;
+    }
+    if (result < 0)
+      break;
+
+    if (stop || CTimeStatistics::Now() >= deadline)
+    {
+      kill(pid, SIGKILL);
+      waitpid(pid, &status, 0);
+      kodi::Log(ADDON_LOG_ERROR, "Widevine probe not done after %.1f ms, stopped", ElapsedMs(start));
+      break;
+    }
+    std::this_thread::sleep_for(PROBE_POLL_INTERVAL);
+  }
+#endif
+
+  kodi::Log(exitCode == 0 ? ADDON_LOG_DEBUG : ADDON_LOG_ERROR,
+            "Widevine probe ended with %i after %.1f ms", exitCode, ElapsedMs(start));
+  return exitCode == 0 && kodi::vfs::FileExists(addonPath + "manifest.json");
+}
+
+bool CWidewineControl::CreateManifestAndInstall(bool force, const std::string& selectedPath)
+{
   /*!
    * Check widevine already present for use on browser.
    */
   std::string addonPath = kodi::GetBaseUserPath("widevine/");
-  if (kodi::vfs::FileExists(addonPath + WIDEVINE_LIB) &&
-      kodi::vfs::FileExists(addonPath + "manifest.json") && !force)
+  if (IsInstalled(addonPath) && !force)
   {
     kodi::Log(ADDON_LOG_INFO, "Chromium widevine already present under '%s'", addonPath.c_str());
     return true;
@@ -107,13 +407,14 @@ bool CWidewineControl::CreateManifestAndInstall(bool force)
    *
    * If yes copy it to browser (independent copy to prevent change problems).
    *
-   * If it was not found becomes user asked to get a path too.
+   * If it was not found becomes user asked to get a path too, before by
+   * AskLibraryPath().
    */
   std::string path;
-  if (kodi::vfs::FileExists("special://home/cdm/" WIDEVINE_LIB))
+  if (selectedPath.empty())
   {
     kodi::Log(ADDON_LOG_INFO, "Found widevine from inputstream.adaptive and becomes used");
-    path = "special://home/cdm/" WIDEVINE_LIB;
+    path = INPUTSTREAM_LIB;
 
     /*!
      * Copy also his manifest if present
@@ -132,23 +433,7 @@ bool CWidewineControl::CreateManifestAndInstall(bool force)
   }
   else
   {
-    bool canceled = true;
-    // Retry if Yes/No is canceled
-    while (canceled)
-    {
-      kodi::gui::dialogs::FileBrowser::ShowAndGetFile(
-          "local", WIDEVINE_LIB,
-          StringUtils::Format(kodi::GetLocalizedString(30196).c_str(), WIDEVINE_LIB), path, true);
-      if (!path.empty())
-        break;
-
-      if (!kodi::gui::dialogs::YesNo::ShowAndGetInput(kodi::GetLocalizedString(30197),
-                                                      kodi::GetLocalizedString(30198), canceled))
-      {
-        if (!canceled)
-          kodi::SetSettingBoolean("system.usewidevine", false);
-      }
-    }
+    path = selectedPath;
 
     if (!ends_with(path, WIDEVINE_LIB))
     {
@@ -164,6 +449,9 @@ bool CWidewineControl::CreateManifestAndInstall(bool force)
   }
 
   // Copy selected library to Kodi's user addon folder
+  if (m_provisionStop)
+    return false;
+
   if (!kodi::vfs::CopyFile(path, addonPath + WIDEVINE_LIB))
   {
     kodi::Log(ADDON_LOG_ERROR, "Failed to copy '%s' widevine library to '%s'", path.c_str(),
@@ -177,54 +465,19 @@ bool CWidewineControl::CreateManifestAndInstall(bool force)
    * @brief Check needed manifest exists, if not create it now.
    *
    * @warning There seems by dlopen a thread inside widevine started where create
-   * a crash when Kodi is stopped until 30 seconds from call here! After 30 seconds
-   * it work.
+   * a crash when the process is stopped until 30 seconds from call here! This is
+   * why the version is asked by kodichromium as own process, see
+   * src/app/WidevineProbe.h.
    */
   if (!kodi::vfs::FileExists(addonPath + "manifest.json"))
   {
-    m_cryticalInstallDone = true;
-    m_installTime = std::chrono::system_clock::now();
-
-    // Get cdm version from selected library
-    if (!LoadDll(addonPath + WIDEVINE_LIB))
-    {
-      kodi::Log(ADDON_LOG_ERROR, "Widevine library failed to load '%s'", dlerror());
-      return false;
-    }
-
-    if (!RegisterSymbol(GetCdmVersion, "GetCdmVersion"))
-    {
-      kodi::Log(ADDON_LOG_ERROR, "Widevine library failed to get version call '%s'", dlerror());
-      return false;
-    }
-
-    std::string manifest =
-        StringUtils::Format("{\n"
-                            "  \"manifest_version\": 2,\n"
-                            "  \"name\": \"WidevineCdm\",\n"
-                            "  \"description\": \"Widevine Content Decryption Module Stub\",\n"
-                            "  \"offline_enabled\": false,\n"
-                            "  \"version\": \"%s\",\n"
-                            "  \"minimum_chrome_version\": \"%i.%i.%i.%i\",\n"
-                            "  \"os\": \"%s\",\n"
-                            "  \"arch\": \"%s\",\n"
-                            "  \"x-cdm-module-versions\": \"4\",\n"
-                            "  \"x-cdm-interface-versions\": \"10\",\n"
-                            "  \"x-cdm-host-versions\": \"10\",\n"
-                            "  \"x-cdm-codecs\": \"vp8,vp9.0,avc1,av01\"\n"
-                            "}\n",
-                            GetCdmVersion(), CHROME_VERSION_MAJOR, CHROME_VERSION_MINOR,
-                            CHROME_VERSION_BUILD, CHROME_VERSION_PATCH, WIDEVINE_OS, WIDEVINE_CPU);
-
     // Create directory if not exists
     kodi::vfs::CreateDirectory(addonPath);
 
-    kodi::vfs::CFile manifestFile;
-    std::string file = addonPath + "/manifest.json";
-    manifestFile.OpenFileForWrite(file, true);
-    manifestFile.Write(manifest.c_str(), manifest.size());
+    if (m_provisionStop || !RunProbe(addonPath, m_provisionStop))
+      return false;
 
-    kodi::Log(ADDON_LOG_INFO, "Created chromium widevine manifest on %s", file.c_str());
+    kodi::Log(ADDON_LOG_INFO, "Created chromium widevine manifest on %s", addonPath.c_str());
   }
 
   return true;
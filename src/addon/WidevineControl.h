@@ -8,25 +8,112 @@
 
 #pragma once
 
+#include "utils/TimeStatistics.h"
+
+#include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <kodi/tools/DllHelper.h>
+#include <functional>
+#include <kodi/General.h>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 class CWebBrowser;
 
-class ATTRIBUTE_HIDDEN CWidewineControl : public kodi::tools::CDllHelper
+/*!
+ * @brief Provisioning and registration of the Widevine CDM.
+ *
+ * If the library and its manifest are present, they are registered directly
+ * on StartInstance(). Otherwise the library copy and the manifest creation are
+ * done on a background thread, so the start of CEF does not wait for it. A
+ * library to be selected by the user is asked by Process() on Kodi's main
+ * thread before, the background thread never waits on a dialog.
+ *
+ * Websites opened until the registration is complete are deferred with
+ * DeferUntilRegistered(), they could otherwise not find the CDM. This is not
+ * done if the provisioned library can only be used after a restart.
+ */
+class ATTRIBUTE_HIDDEN CWidewineControl
 {
 public:
   CWidewineControl(CWebBrowser& instance) : m_instance(instance) {}
-  ~CWidewineControl() override = default;
+  ~CWidewineControl() = default;
 
   bool InitializeWidevine();
+
+  /*!
+   * @brief Stop a running provisioning and wait for its end.
+   *
+   * Only the library copy and the probe process can run, the probe is killed.
+   */
   void DeinitializeWidevine();
 
-  bool CryticalInstallDone() const { return m_cryticalInstallDone; }
+  /*!
+   * @brief Ask the user for the library, register a background provisioned
+   * library and run deferred loads if they can go, from Kodi's main loop.
+   */
+  void Process();
+
+  /*!
+   * @brief Keep the load of a website until the registration is complete,
+   * done then by Process().
+   *
+   * @param[in] load Called on Kodi's main thread
+   * @return true if deferred, false if the load can be done now
+   */
+  bool DeferUntilRegistered(std::function<void()> load);
+
+  /*!
+   * @brief Result of CefRegisterWidevineCdm(), from CEF's UI thread.
+   */
+  void RegistrationDone(bool success);
 
 private:
-  bool CreateManifestAndInstall(bool force);
+  enum class State
+  {
+    Disabled,
+    AskingPath,
+    Provisioning,
+    Provisioned,
+    Registering,
+    Registered,
+    NeedsRestart,
+    Failed,
+  };
+
+  /*!
+   * @brief Check the registration of this session is still to come.
+   */
+  static bool RegistrationPending(State state);
+
+  bool IsInstalled(const std::string& addonPath);
+
+  /*!
+   * @brief Ask the user with Kodi's dialogs for the library, on Kodi's main
+   * thread.
+   *
+   * @return Selected path or empty if none
+   */
+  std::string AskLibraryPath();
+
+  /*!
+   * @brief Start the background thread for the copy of the library.
+   *
+   * @param[in] path Selected library, empty for the one of
+   *                 inputstream.adaptive
+   */
+  void StartProvisioning(const std::string& path);
+  void Provision(const std::string& path);
+  void Register();
+  bool CreateManifestAndInstall(bool force, const std::string& selectedPath);
+
+  /*!
+   * @brief Create the manifest with the version of the copied library by a
+   * kodichromium process, so this process never loads the library.
+   */
+  bool RunProbe(const std::string& addonPath, const std::atomic_bool& stop);
 
   inline bool ends_with(std::string const& value, std::string const& ending)
   {
@@ -35,9 +122,14 @@ private:
     return std::equal(ending.rbegin(), ending.rend(), value.rbegin());
   }
 
-  const char* (*GetCdmVersion)() = nullptr;
-
-  bool m_cryticalInstallDone = false;
-  std::chrono::system_clock::time_point m_installTime;
   CWebBrowser& m_instance;
+
+  std::atomic<State> m_state{State::Disabled};
+  std::atomic_bool m_provisionStop{false};
+  std::thread m_provisionThread;
+  CTimeStatistics::Clock::time_point m_startTime;
+
+  std::mutex m_mutex;
+  std::vector<std::function<void()>> m_deferred;
+  CTimeStatistics::Clock::time_point m_deferredSince;
 };
@@ -29,7 +29,24 @@
 #include <kodi/Filesystem.h>
 #include <kodi/gui/dialogs/FileBrowser.h>
 #include <kodi/gui/dialogs/OK.h>
-#include <thread>
+#include <vector>
+
+namespace
+{
+
+// Longest wait for the browsers to close on shutdown, CefShutdown() is called
+// afterwards also with browsers left
+constexpr std::chrono::milliseconds SHUTDOWN_CLOSE_TIMEOUT{3000};
+
+// Longest time between two message loop works while waiting for the close
+constexpr std::chrono::microseconds SHUTDOWN_WORK_INTERVAL{1000};
+
+double ElapsedMs(CTimeStatistics::Clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(CTimeStatistics::Now() - start).count();
+}
+
+} // namespace
 
 std::atomic_int CWebBrowser::m_iUniqueClientId{0};
 
@@ -42,6 +59,8 @@ WEB_ADDON_ERROR CWebBrowser::StartInstance()
 {
   kodi::Log(ADDON_LOG_INFO, "CWebBrowser::%s: Creating the Google Chromium Internet Browser add-on", __func__);
 
+  const auto start = CTimeStatistics::Now();
+
 #if defined(TARGET_LINUX)
   // Load CEF library by self
   std::string cefLib = kodi::GetAddonPath(LIBRARY_PREFIX "cef" LIBRARY_SUFFIX);
@@ -80,11 +99,18 @@ WEB_ADDON_ERROR CWebBrowser::StartInstance()
     kodi::SetSettingString("downloads.path", path);
   }
 
-  // Initialize DRM widevine
-  m_widewineControl.InitializeWidevine();
-
   std::string language = kodi::GetLanguage(LANG_FMT_ISO_639_1, true);
 
+#if defined(TARGET_LINUX)
+  // CEF runs then its UI thread itself, all what needs Kodi's main thread is
+  // handed over by m_mainThreadTasks
+  m_multiThreaded = kodi::GetSettingBoolean("performance.multi_threaded_message_loop", false);
+#else
+  m_multiThreaded = false;
+#endif
+  kodi::Log(ADDON_LOG_INFO, "CWebBrowser::%s: Using %s", __func__,
+            m_multiThreaded ? "CEF's multi threaded message loop" : "Kodi's main thread as CEF UI thread");
+
   // Create and delete CefSettings itself, otherwise comes seqfault during
   // "CefSettingsTraits::clear" call on destruction of CWebBrowser
   m_cefSettings = new CefSettings;
@@ -107,12 +133,19 @@ WEB_ADDON_ERROR CWebBrowser::StartInstance()
 
   m_cefSettings->no_sandbox = false;
 #endif
+
+  // Initialize DRM widevine, a needed provisioning runs in background and
+  // uses the subprocess
+  const auto widevineStart = CTimeStatistics::Now();
+  m_widewineControl.InitializeWidevine();
+  const double widevineTime = ElapsedMs(widevineStart);
+
   CefString(&m_cefSettings->browser_subprocess_path) = m_browserSubprocessPath;
   CefString(&m_cefSettings->framework_dir_path) = m_frameworkDirPath;
   CefString(&m_cefSettings->resources_dir_path) = m_resourcesPath;
   CefString(&m_cefSettings->locales_dir_path) = m_localesPath;
-  m_cefSettings->multi_threaded_message_loop = false;
-  m_cefSettings->external_message_pump = true;
+  m_cefSettings->multi_threaded_message_loop = m_multiThreaded;
+  m_cefSettings->external_message_pump = !m_multiThreaded;
   m_cefSettings->windowless_rendering_enabled = true;
   m_cefSettings->command_line_args_disabled = false;
   CefString(&m_cefSettings->cache_path) = kodi::GetBaseUserPath("pchHTMLCache");
@@ -135,10 +168,11 @@ WEB_ADDON_ERROR CWebBrowser::StartInstance()
   m_cefSettings->background_color = 0;
   CefString(&m_cefSettings->accept_language_list) = language;
 
-  kodi::Log(ADDON_LOG_DEBUG, "CWebBrowser::%s: Started web browser add-on process", __func__);
+  kodi::Log(ADDON_LOG_DEBUG, "CWebBrowser::%s: Started web browser add-on process in %.1f ms (%.1f ms for Widevine)",
+            __func__, ElapsedMs(start), widevineTime);
 
   m_app = new CClientAppBrowser(*this);
-  m_audioHandler = new CAudioHandler(this, IsMuted());
+  m_audioHandler = new CAudioHandler(this, IsMuted(), std::make_shared<CAudioEngineOutput>());
   m_started = true;
   return WEB_ADDON_ERROR_NO_ERROR;
 }
@@ -177,18 +211,37 @@ void CWebBrowser::StopInstance()
  * thread!
  *
  * Due to special thread checks inside Chromium is it no more possible to run
- * over different thread as main.
+ * over different thread as main. With the multi threaded message loop (Linux
+ * only) runs CEF its own UI thread, the handlers give then everything needing
+ * Kodi's main thread to m_mainThreadTasks.
  *
  * Further is the for rendering done stream also mandatory to use main thread.
  * It use on Direct X shared textures between two processes and CEF brings
  * soon a shared memory usage to give GL rendering from sandbox to this.
  */
 
+ADDON_STATUS CWebBrowser::SetSetting(const std::string& settingName,
+                                     const kodi::CSettingValue& settingValue)
+{
+  // Paint traces can be started and stopped at runtime, the renderers check
+  // the state on every paint
+  if (settingName == "performance.paint_trace")
+    m_paintTrace = settingValue.GetBoolean();
+  else if (settingName == "performance.paint_trace_pixels")
+    m_paintTracePixels = settingValue.GetBoolean();
+
+  return ADDON_STATUS_OK;
+}
+
 bool CWebBrowser::MainInitialize()
 {
   if (!m_started)
     return false;
 
+  m_paintTrace = kodi::GetSettingBoolean("performance.paint_trace", false);
+  m_paintTracePixels = kodi::GetSettingBoolean("performance.paint_trace_pixels", false);
+  m_mainThreadTasks.Initialize(m_multiThreaded);
+
   // #ifndef WIN32
   //   const char* cmdLine[3];
   //   cmdLine[0] = "";
@@ -204,6 +257,10 @@ bool CWebBrowser::MainInitialize()
     return false;
   }
 
+  m_browserPool.Initialize(kodi::GetSettingInt("performance.browser_pool_size", 1));
+  m_inactiveControls.Initialize(kodi::GetSettingInt("performance.inactive_memory_budget", 1024),
+                                kodi::GetSettingInt("performance.inactive_max_time", 60));
+
   return true;
 }
 
@@ -212,8 +269,26 @@ void CWebBrowser::MainLoop()
   if (!m_started)
     return;
 
-  // Do CEF's message loop work
-  CefDoMessageLoopWork();
+  ProcessMainThreadWork();
+
+  // Fill the pool of ready browsers, done here and not on render passes to
+  // use only idle time
+  m_browserPool.Process();
+
+  m_widewineControl.Process();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_inactiveControls.Process();
+  }
+}
+
+void CWebBrowser::ProcessMainThreadWork()
+{
+  if (m_multiThreaded)
+    m_mainThreadTasks.Process();
+  else
+    m_messagePump.Process(); // Do CEF's message loop work if requested by CEF
 }
 
 void CWebBrowser::MainShutdown()
@@ -221,40 +296,87 @@ void CWebBrowser::MainShutdown()
   if (!m_started)
     return;
 
-  kodi::Log(ADDON_LOG_DEBUG, "Active clients during shutdown %li", m_browserClients.size());
-  kodi::Log(ADDON_LOG_DEBUG, "Inactive clients during shutdown %li",
-            m_browserClientsInactive.size());
-  kodi::Log(ADDON_LOG_DEBUG, "Clients in delete process during shutdown start %li",
-            m_browserClientsInDelete.size());
+  const auto start = CTimeStatistics::Now();
+  auto phase = start;
+
+  std::vector<CefRefPtr<CWebBrowserClient>> clients;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
 
-  if (!m_browserClients.empty() || !m_browserClientsInactive.empty())
-    kodi::Log(ADDON_LOG_FATAL,
-              "Still browser clients in use during shutdown (active: %li, inactive: %li",
-              m_browserClients.size(), m_browserClientsInactive.size());
+    kodi::Log(ADDON_LOG_DEBUG, "CWebBrowser::%s: Shutdown with %zu active, %zu inactive and %zu closing clients",
+              __func__, m_browserClients.size(), m_inactiveControls.Size(),
+              m_closeTracker.Pending());
+    if (!m_browserClients.empty())
+      kodi::Log(ADDON_LOG_ERROR, "CWebBrowser::%s: Still %zu browser clients in use during shutdown",
+                __func__, m_browserClients.size());
 
-  // Wait until all clients are deleted otherwise can CefShutdown() not work right!
-  int tries = 1000;
-  while (!m_browserClientsInDelete.empty() && tries-- > 0)
+    for (const auto& entry : m_browserClients)
+      clients.push_back(entry.second);
+    for (const auto& client : m_inactiveControls.Clear())
+      clients.push_back(client);
+    m_browserClients.clear();
+  }
+
+  // Request the close of all remaining browsers at once, they are then closed
+  // by CEF in parallel
+  m_browserPool.Shutdown();
+  for (const auto& client : clients)
   {
-    CefDoMessageLoopWork();
-    std::this_thread::sleep_for(std::chrono::microseconds(100));
+    m_closeTracker.CloseRequested(client->GetUniqueId());
+    client->CloseComplete();
   }
+  clients.clear();
+  LogShutdownPhase("Close request of remaining clients", phase);
+
+  // Wait until all clients are destroyed, woken up by InformDestroyed(). With
+  // the multi threaded message loop runs the close on CEF's UI thread, only
+  // the handed over tasks are done here.
+  const bool allDestroyed = m_closeTracker.WaitAll(
+      SHUTDOWN_CLOSE_TIMEOUT,
+      [this]() {
+        if (m_multiThreaded)
+          m_mainThreadTasks.Process();
+        else
+          CefDoMessageLoopWork();
+      },
+      SHUTDOWN_WORK_INTERVAL);
+  LogShutdownPhase("Wait for clients destroyed", phase);
+  if (!allDestroyed)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CWebBrowser::%s: Not all clients destroyed after %lli ms, shutdown anyway",
+              __func__, static_cast<long long>(SHUTDOWN_CLOSE_TIMEOUT.count()));
+    const size_t alive = m_closeTracker.LogPending();
+    if (alive > 0)
+      kodi::Log(ADDON_LOG_ERROR, "CWebBrowser::%s: CefShutdown with %zu browsers still alive, CEF can abort on it",
+                __func__, alive);
+  }
+  m_closeTracker.LogStatistics();
 
   // Do last process works, to confirm everything done
-  CefDoMessageLoopWork();
-
-  // shutdown CEF
-  size_t size = m_browserClientsInDelete.size();
-  if (size == 0)
-    CefShutdown();
+  if (m_multiThreaded)
+    m_mainThreadTasks.Process();
   else
-    kodi::Log(ADDON_LOG_FATAL, "Still %li browsers not deleted! CefShutdown() becomes not called",
-              size);
+    CefDoMessageLoopWork();
+  m_mainThreadTasks.Clear();
+  LogShutdownPhase("Last message loop work", phase);
+
+  CefShutdown();
+  LogShutdownPhase("CefShutdown", phase);
+
+  kodi::Log(ADDON_LOG_INFO, "CWebBrowser::%s: Shutdown done in %.1f ms", __func__,
+            ElapsedMs(start));
+}
+
+void CWebBrowser::LogShutdownPhase(const char* name, CTimeStatistics::Clock::time_point& phase)
+{
+  kodi::Log(ADDON_LOG_DEBUG, "CWebBrowser::MainShutdown: %s took %.1f ms", name, ElapsedMs(phase));
+  phase = CTimeStatistics::Now();
 }
 
 void CWebBrowser::InformDestroyed(int uniqueClientId)
 {
-  m_browserClientsInDelete.erase(uniqueClientId);
+  // Called from CEF's UI thread with the multi threaded message loop
+  m_closeTracker.Destroyed(uniqueClientId);
 }
 
 void CWebBrowser::SetMute(bool mute)
@@ -272,11 +394,65 @@ bool CWebBrowser::SetLanguage(const char* language)
   return true;
 }
 
+void CWebBrowser::GetBrowserCreateInfo(CefWindowInfo& info,
+                                       CefBrowserSettings& settings,
+                                       bool externalBeginFrame,
+                                       int frameRate)
+{
+  info.SetAsWindowless(kNullWindowHandle);
+#ifdef WIN32
+  info.shared_texture_enabled = true;
+  info.external_begin_frame_enabled = false;
+#else
+  info.external_begin_frame_enabled = externalBeginFrame;
+#endif // WIN32
+
+  //TODO Check CefBrowserHost::SetWindowlessFrameRate(...) usable for streams?
+  settings.windowless_frame_rate = frameRate;
+  CefString(&settings.standard_font_family) = "";
+  CefString(&settings.fixed_font_family) = "";
+  CefString(&settings.serif_font_family) = "";
+  CefString(&settings.sans_serif_font_family) = "";
+  CefString(&settings.cursive_font_family) = "";
+  CefString(&settings.fantasy_font_family) = "";
+  settings.default_font_size = 0;
+  settings.default_fixed_font_size = 0;
+  settings.minimum_font_size = 0;
+  settings.minimum_logical_font_size = 0;
+  CefString(&settings.default_encoding) = ""; // "ISO-8859-1" if empty
+  settings.remote_fonts = STATE_DEFAULT;
+  settings.javascript = STATE_ENABLED;
+  settings.javascript_close_windows = STATE_DEFAULT;
+  settings.javascript_access_clipboard = STATE_DEFAULT;
+  settings.javascript_dom_paste = STATE_DEFAULT;
+  settings.plugins = STATE_ENABLED;
+  settings.universal_access_from_file_urls = STATE_DEFAULT;
+  settings.file_access_from_file_urls = STATE_DEFAULT;
+  settings.web_security = STATE_DEFAULT;
+  settings.image_loading = STATE_DEFAULT;
+  settings.image_shrink_standalone_to_fit = STATE_DEFAULT;
+  settings.text_area_resize = STATE_DEFAULT;
+  settings.tab_to_links = STATE_DEFAULT;
+  settings.local_storage = STATE_DEFAULT;
+  settings.databases = STATE_DEFAULT;
+  settings.application_cache = STATE_DEFAULT;
+  settings.webgl = STATE_ENABLED;
+  settings.background_color = 0x00; // fully transparent
+  CefString(&settings.accept_language_list) = "";
+}
+
+CefRefPtr<CefDictionaryValue> CWebBrowser::GetBrowserExtraInfo(int webAddonAccess)
+{
+  CefRefPtr<CefDictionaryValue> extra_info = CefDictionaryValue::Create();
+  extra_info->SetInt(SettingValues::security_webaddon_access, webAddonAccess);
+  return extra_info;
+}
+
 kodi::addon::CWebControl* CWebBrowser::CreateControl(const std::string& sourceName,
                                                      const std::string& startURL,
                                                      KODI_HANDLE handle)
 {
-  CEF_REQUIRE_UI_THREAD();
+  DCHECK(m_mainThreadTasks.IsMainThread());
 
   if (!m_started)
     return nullptr;
@@ -287,13 +463,11 @@ kodi::addon::CWebControl* CWebBrowser::CreateControl(const std::string& sourceNa
 
   std::lock_guard<std::mutex> lock(m_mutex);
 
-  auto itr = m_browserClientsInactive.find(sourceName);
-  if (itr != m_browserClientsInactive.end())
+  browserClient = m_inactiveControls.Take(sourceName);
+  if (browserClient)
   {
     kodi::Log(ADDON_LOG_INFO, "CWebBrowser::%s: Found control in inactive mode and setting active", __func__);
-    browserClient = itr->second;
     browserClient->SetActive();
-    m_browserClientsInactive.erase(itr);
   }
   else
   {
@@ -305,67 +479,54 @@ kodi::addon::CWebControl* CWebBrowser::CreateControl(const std::string& sourceNa
       }
     }
 
-    CefRefPtr<CRequestContextHandler> contextHandler = new CRequestContextHandler;
+    const auto start = CTimeStatistics::Now();
+    const int webAddonAccess = kodi::GetSettingInt("security.webaddon.access");
+#ifndef WIN32
+    const bool externalBeginFrame =
+        kodi::GetSettingBoolean("performance.external_begin_frame", false);
+#else
+    const bool externalBeginFrame = false;
+#endif
+
+    CefRefPtr<CWarmBrowserClient> pooled = m_browserPool.Take(webAddonAccess, externalBeginFrame);
+    CefRefPtr<CRequestContextHandler> contextHandler =
+        pooled ? pooled->GetContextHandler() : new CRequestContextHandler;
     browserClient =
-        new CWebBrowserClient(handle, m_iUniqueClientId++, startURL, this, contextHandler);
+        new CWebBrowserClient(handle, NewUniqueClientId(), startURL, this, contextHandler);
     contextHandler->Init(browserClient);
+    browserClient->SetCreationStart(start, pooled != nullptr);
 
-    CefWindowInfo info;
-    info.SetAsWindowless(kNullWindowHandle);
-#ifdef WIN32
-    info.shared_texture_enabled = true;
-    info.external_begin_frame_enabled = false;
-#endif // WIN32
+    ControlState state;
+    if (m_inactiveControls.TakeDiscarded(sourceName, state))
+      browserClient->RestoreState(state);
 
-    CefBrowserSettings settings;
-    //TODO Check CefBrowserHost::SetWindowlessFrameRate(...) usable for streams?
-    settings.windowless_frame_rate = static_cast<int>(browserClient->GetFPS());
-    CefString(&settings.standard_font_family) = "";
-    CefString(&settings.fixed_font_family) = "";
-    CefString(&settings.serif_font_family) = "";
-    CefString(&settings.sans_serif_font_family) = "";
-    CefString(&settings.cursive_font_family) = "";
-    CefString(&settings.fantasy_font_family) = "";
-    settings.default_font_size = 0;
-    settings.default_fixed_font_size = 0;
-    settings.minimum_font_size = 0;
-    settings.minimum_logical_font_size = 0;
-    CefString(&settings.default_encoding) = ""; // "ISO-8859-1" if empty
-    settings.remote_fonts = STATE_DEFAULT;
-    settings.javascript = STATE_ENABLED;
-    settings.javascript_close_windows = STATE_DEFAULT;
-    settings.javascript_access_clipboard = STATE_DEFAULT;
-    settings.javascript_dom_paste = STATE_DEFAULT;
-    settings.plugins = STATE_ENABLED;
-    settings.universal_access_from_file_urls = STATE_DEFAULT;
-    settings.file_access_from_file_urls = STATE_DEFAULT;
-    settings.web_security = STATE_DEFAULT;
-    settings.image_loading = STATE_DEFAULT;
-    settings.image_shrink_standalone_to_fit = STATE_DEFAULT;
-    settings.text_area_resize = STATE_DEFAULT;
-    settings.tab_to_links = STATE_DEFAULT;
-    settings.local_storage = STATE_DEFAULT;
-    settings.databases = STATE_DEFAULT;
-    settings.application_cache = STATE_DEFAULT;
-    settings.webgl = STATE_ENABLED;
-    settings.background_color = 0x00; // fully transparent
-    CefString(&settings.accept_language_list) = "";
-
-    CefRefPtr<CefDictionaryValue> extra_info = CefDictionaryValue::Create();
-    extra_info->SetInt(SettingValues::security_webaddon_access,
-                       kodi::GetSettingInt("security.webaddon.access"));
-    CefRefPtr<CefRequestContext> request_context =
-        CefRequestContext::CreateContext(CefRequestContext::GetGlobalContext(), contextHandler);
-    if (!CefBrowserHost::CreateBrowser(info, browserClient, "", settings, extra_info,
-                                       request_context))
+    if (pooled)
+    {
+      kodi::Log(ADDON_LOG_DEBUG, "CWebBrowser::%s: Using pooled browser %i", __func__,
+                pooled->GetUniqueId());
+      pooled->SetTarget(browserClient);
+      browserClient->AdoptBrowser(pooled->GetBrowser());
+    }
+    else
     {
-      kodi::Log(ADDON_LOG_ERROR, "CWebBrowser::%s: Web browser creation failed", __func__);
-      if (browserClient)
+      CefWindowInfo info;
+      CefBrowserSettings settings;
+      GetBrowserCreateInfo(info, settings, externalBeginFrame,
+                           static_cast<int>(browserClient->GetFPS()));
+
+      CefRefPtr<CefRequestContext> request_context =
+          CefRequestContext::CreateContext(CefRequestContext::GetGlobalContext(), contextHandler);
+      if (!CefBrowserHost::CreateBrowser(info, browserClient, "", settings,
+                                         GetBrowserExtraInfo(webAddonAccess), request_context))
       {
-        contextHandler->Clear();
-        browserClient = nullptr;
+        kodi::Log(ADDON_LOG_ERROR, "CWebBrowser::%s: Web browser creation failed", __func__);
+        if (browserClient)
+        {
+          contextHandler->Clear();
+          browserClient = nullptr;
+        }
+        return nullptr;
       }
-      return nullptr;
     }
   }
 
@@ -398,13 +559,12 @@ bool CWebBrowser::DestroyControl(kodi::addon::CWebControl* control, bool complet
   if (complete)
   {
     kodi::Log(ADDON_LOG_DEBUG, "CWebBrowser::%s: Web browser control destroy complete", __func__);
-    const auto& inactiveClient = m_browserClientsInactive.find(browserClient->GetName());
-    if (inactiveClient != m_browserClientsInactive.end())
-      m_browserClientsInactive.erase(inactiveClient);
+    m_inactiveControls.Remove(browserClient->GetName());
 
-    m_browserClientsInDelete.insert(browserClient->GetUniqueId());
+    m_closeTracker.CloseRequested(browserClient->GetUniqueId());
     browserClient->CloseComplete();
-    CefDoMessageLoopWork();
+    if (!m_multiThreaded)
+      m_messagePump.ProcessNow();
   }
   else
   {
@@ -415,7 +575,7 @@ bool CWebBrowser::DestroyControl(kodi::addon::CWebControl* control, bool complet
                 __func__, browserClient->GetDataIdentifier());
       return false;
     }
-    m_browserClientsInactive[browserClient->GetName()] = browserClient;
+    m_inactiveControls.Add(browserClient->GetName(), browserClient);
   }
 
   kodi::Log(ADDON_LOG_DEBUG, "CWebBrowser::%s: Web browser control destroy done", __func__);
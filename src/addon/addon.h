@@ -8,6 +8,11 @@
 
 #pragma once
 
+#include "BrowserCloseTracker.h"
+#include "BrowserPool.h"
+#include "InactiveControls.h"
+#include "MainThreadTasks.h"
+#include "MessagePump.h"
 #include "WebBrowserClient.h"
 #include "WidevineControl.h"
 #include "audio/AudioHandler.h"
@@ -37,6 +42,9 @@ public:
   // ---------------------------------------------------------------------------
   // Kodi interface parts
 
+  ADDON_STATUS SetSetting(const std::string& settingName,
+                          const kodi::CSettingValue& settingValue) override;
+
   WEB_ADDON_ERROR StartInstance() override;
   void StopInstance() override;
 
@@ -57,14 +65,45 @@ public:
   CBrowserGUIManager& GetGUIManager() { return m_guiManager; }
   CefRefPtr<CefApp> GetApp() { return m_app; }
   CefRefPtr<CAudioHandler> GetAudioHandler() { return m_audioHandler; }
+  CMessagePump& GetMessagePump() { return m_messagePump; }
+  CMainThreadTasks& GetMainThreadTasks() { return m_mainThreadTasks; }
+  CBrowserCloseTracker& GetCloseTracker() { return m_closeTracker; }
+  CBrowserPool& GetBrowserPool() { return m_browserPool; }
+  CWidewineControl& GetWidevineControl() { return m_widewineControl; }
+  const std::string& GetBrowserSubprocessPath() const { return m_browserSubprocessPath; }
+  bool PaintTraceEnabled() const { return m_paintTrace; }
+  bool PaintTraceWithPixels() const { return m_paintTracePixels; }
+
+  /*!
+   * @brief Do the work waiting for Kodi's main thread, CEF's message loop
+   * work if due or with the multi threaded message loop the tasks given from
+   * CEF's UI thread.
+   */
+  void ProcessMainThreadWork();
 
   void InformDestroyed(int uniqueClientId);
 
+  static int NewUniqueClientId() { return m_iUniqueClientId++; }
+
+  /*!
+   * @brief Values used on creation of all browsers, for controls and the
+   * pool.
+   */
+  static void GetBrowserCreateInfo(CefWindowInfo& info,
+                                   CefBrowserSettings& settings,
+                                   bool externalBeginFrame,
+                                   int frameRate);
+  static CefRefPtr<CefDictionaryValue> GetBrowserExtraInfo(int webAddonAccess);
+
 private:
   static std::atomic_int m_iUniqueClientId;
 
+  void LogShutdownPhase(const char* name, CTimeStatistics::Clock::time_point& phase);
+
   CBrowserGUIManager m_guiManager{this};
   CWidewineControl m_widewineControl{*this};
+  CMessagePump m_messagePump;
+  CMainThreadTasks m_mainThreadTasks;
   CefRefPtr<CefApp> m_app;
   CefRefPtr<CAudioHandler> m_audioHandler;
 
@@ -81,7 +120,11 @@ private:
 #endif
 
   std::unordered_map<int, CefRefPtr<CWebBrowserClient>> m_browserClients;
-  std::unordered_map<std::string, CefRefPtr<CWebBrowserClient>> m_browserClientsInactive;
-  std::set<int> m_browserClientsInDelete;
+  CInactiveControls m_inactiveControls{*this};
+  CBrowserCloseTracker m_closeTracker;
+  CBrowserPool m_browserPool{*this};
+  bool m_multiThreaded = false;
   std::atomic_bool m_started{false};
+  std::atomic_bool m_paintTrace{false};
+  std::atomic_bool m_paintTracePixels{false};
 };
@@ -7,438 +7,256 @@
  */
 
 #include "AudioHandler.h"
+#include "AudioTrace.h"
+#include "ChannelLayout.h"
 
-bool CAudioHandler::GetAudioParameters(CefRefPtr<CefBrowser> browser,
-                                       CefAudioParameters& params)
+#include <algorithm>
+#include <ctime>
+#include <kodi/Filesystem.h>
+#include <kodi/General.h>
+
+namespace
 {
-  kodi::audioengine::AudioEngineFormat format;
-  if (!kodi::audioengine::GetCurrentSinkFormat(format))
-    return false;
 
-  std::vector<AudioEngineChannel> layout = format.GetChannelLayout();
+std::string TracePath(const std::string& name)
+{
+  const std::string path = kodi::GetBaseUserPath("traces");
+  kodi::vfs::CreateDirectory(path);
+  return path + "/" + name + "-" + std::to_string(std::time(nullptr));
+}
 
-  params.channel_layout = CEF_CHANNEL_LAYOUT_STEREO; // default
-  switch (layout.size())
+} // namespace
+
+CAudioHandler::~CAudioHandler()
+{
+  std::map<int, std::shared_ptr<CAudioStream>> streams;
   {
-    case 1:
-    {
-      params.channel_layout = CEF_CHANNEL_LAYOUT_MONO;
-      break;
-    }
-    case 2:
-    {
-      params.channel_layout = CEF_CHANNEL_LAYOUT_STEREO;
-      break;
-    }
-    case 3:
-    {
-      if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_BC)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_2_1;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_SURROUND;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_LFE)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_2POINT1;
-
-      break;
-    }
-    case 4:
-    {
-      if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FC && layout[2] == AUDIOENGINE_CH_FR && layout[3] == AUDIOENGINE_CH_BC)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_4_0;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_SL && layout[3] == AUDIOENGINE_CH_SR)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_2_2;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_BL && layout[3] == AUDIOENGINE_CH_BR)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_QUAD;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_LFE)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_3_1;
-
-      break;
-    }
-    case 5:
-    {
-      if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_SL && layout[4] == AUDIOENGINE_CH_SR)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_5_0;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_BL && layout[4] == AUDIOENGINE_CH_BR)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_5_0_BACK;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_SL && layout[3] == AUDIOENGINE_CH_SR && layout[4] == AUDIOENGINE_CH_LFE)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_4_1_QUAD_SIDE;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_BC && layout[4] == AUDIOENGINE_CH_LFE)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_4_1;
-
-      break;
-    }
-    case 6:
-    {
-      if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_LFE &&
-          layout[4] == AUDIOENGINE_CH_SL && layout[5] == AUDIOENGINE_CH_SR)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_5_1;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_LFE &&
-               layout[4] == AUDIOENGINE_CH_BL && layout[5] == AUDIOENGINE_CH_BR)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_5_1_BACK;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_SL &&
-               layout[4] == AUDIOENGINE_CH_SR && layout[5] == AUDIOENGINE_CH_BC)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_6_0;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_SL && layout[3] == AUDIOENGINE_CH_SR &&
-               layout[4] == AUDIOENGINE_CH_FLOC && layout[5] == AUDIOENGINE_CH_FROC)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_6_0_FRONT;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_BL &&
-               layout[4] == AUDIOENGINE_CH_BR && layout[5] == AUDIOENGINE_CH_BC)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_HEXAGONAL;
-
-      break;
-    }
-    case 7:
-    {
-      if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_SL &&
-          layout[4] == AUDIOENGINE_CH_SR && layout[5] == AUDIOENGINE_CH_BL && layout[6] == AUDIOENGINE_CH_BR)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_7_0;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_LFE &&
-               layout[4] == AUDIOENGINE_CH_SL && layout[5] == AUDIOENGINE_CH_SR && layout[6] == AUDIOENGINE_CH_BC)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_6_1;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_LFE &&
-               layout[4] == AUDIOENGINE_CH_BL && layout[5] == AUDIOENGINE_CH_BR && layout[6] == AUDIOENGINE_CH_BC)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_6_1_BACK;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_SL && layout[3] == AUDIOENGINE_CH_SR &&
-               layout[4] == AUDIOENGINE_CH_FLOC && layout[5] == AUDIOENGINE_CH_FROC && layout[6] == AUDIOENGINE_CH_LFE)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_6_1_FRONT;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_SL &&
-               layout[4] == AUDIOENGINE_CH_SR && layout[5] == AUDIOENGINE_CH_FLOC && layout[6] == AUDIOENGINE_CH_FROC)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_7_0_FRONT;
-
-      break;
-    }
-    case 8:
-    {
-      if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_LFE &&
-          layout[4] == AUDIOENGINE_CH_SL && layout[5] == AUDIOENGINE_CH_SR && layout[6] == AUDIOENGINE_CH_BL && layout[7] == AUDIOENGINE_CH_BR)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_7_1;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_LFE &&
-               layout[4] == AUDIOENGINE_CH_SL && layout[5] == AUDIOENGINE_CH_SR && layout[6] == AUDIOENGINE_CH_FLOC && layout[7] == AUDIOENGINE_CH_FROC)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_7_1_WIDE;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_LFE &&
-               layout[4] == AUDIOENGINE_CH_BL && layout[5] == AUDIOENGINE_CH_BR && layout[6] == AUDIOENGINE_CH_FLOC && layout[7] == AUDIOENGINE_CH_FROC)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_7_1_WIDE_BACK;
-      else if (layout[0] == AUDIOENGINE_CH_FL && layout[1] == AUDIOENGINE_CH_FR && layout[2] == AUDIOENGINE_CH_FC && layout[3] == AUDIOENGINE_CH_SL &&
-               layout[4] == AUDIOENGINE_CH_SR && layout[5] == AUDIOENGINE_CH_BL && layout[6] == AUDIOENGINE_CH_BR && layout[7] == AUDIOENGINE_CH_BC)
-        params.channel_layout = CEF_CHANNEL_LAYOUT_OCTAGONAL;
-
-      break;
-    }
-    default:
-      break;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    streams.swap(m_audioStreams);
   }
 
+  std::unique_ptr<CAudioMixer> mixer;
+  {
+    std::lock_guard<std::mutex> lock(m_mixerMutex);
+    mixer = std::move(m_mixer);
+  }
+  mixer.reset();
+
+  for (auto& stream : streams)
+    stream.second->Stop();
+}
+
+bool CAudioHandler::GetAudioParameters(CefRefPtr<CefBrowser> browser,
+                                       CefAudioParameters& params)
+{
+  kodi::audioengine::AudioEngineFormat format;
+  if (!m_output->GetSinkFormat(format))
+    return false;
+
+  // CEF delivers all channels the sink can play, the rest of the mix and the
+  // order of the sink are done on our side
+  params.channel_layout = ChannelMap::ForSink(format.GetChannelLayout());
   params.sample_rate = format.GetSampleRate();
   params.frames_per_buffer = format.GetFramesAmount();
   return true;
 }
 
-
 void CAudioHandler::OnAudioStreamStarted(CefRefPtr<CefBrowser> browser,
                                          const CefAudioParameters& params,
                                          int channels)
 {
-  std::vector<AudioEngineChannel> layout;
-  switch (params.channel_layout)
-  {
-    case CEF_CHANNEL_LAYOUT_MONO:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      break;
-
-    // Front L, Front R
-    case CEF_CHANNEL_LAYOUT_STEREO:
-    case CEF_CHANNEL_LAYOUT_STEREO_DOWNMIX:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      break;
-
-    // Front L, Front R, Back C
-    case CEF_CHANNEL_LAYOUT_2_1:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_BC);
-      break;
-
-    // Front L, Front R, Front C
-    case CEF_CHANNEL_LAYOUT_SURROUND:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      break;
-
-    // Front L, Front R, Front C, Back C
-    case CEF_CHANNEL_LAYOUT_4_0:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_BC);
-      break;
-
-    // Front L, Front R, Side L, Side R
-    case CEF_CHANNEL_LAYOUT_2_2:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_SL);
-      layout.push_back(AUDIOENGINE_CH_SR);
-      break;
-
-    // Front L, Front R, Back L, Back R
-    case CEF_CHANNEL_LAYOUT_QUAD:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_BL);
-      layout.push_back(AUDIOENGINE_CH_BR);
-      break;
-
-    // Front L, Front R, Front C, Side L, Side R
-    case CEF_CHANNEL_LAYOUT_5_0:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_SL);
-      layout.push_back(AUDIOENGINE_CH_SR);
-      break;
-
-    // Front L, Front R, Front C, LFE, Side L, Side R
-    case CEF_CHANNEL_LAYOUT_5_1:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_LFE);
-      layout.push_back(AUDIOENGINE_CH_SL);
-      layout.push_back(AUDIOENGINE_CH_SR);
-      break;
-
-    // Front L, Front R, Front C, Back L, Back R
-    case CEF_CHANNEL_LAYOUT_5_0_BACK:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_BL);
-      layout.push_back(AUDIOENGINE_CH_BR);
-      break;
-
-    // Front L, Front R, Front C, LFE, Back L, Back R
-    case CEF_CHANNEL_LAYOUT_5_1_BACK:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_LFE);
-      layout.push_back(AUDIOENGINE_CH_BL);
-      layout.push_back(AUDIOENGINE_CH_BR);
-      break;
-
-    // Front L, Front R, Front C, Side L, Side R, Back L, Back R
-    case CEF_CHANNEL_LAYOUT_7_0:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_SL);
-      layout.push_back(AUDIOENGINE_CH_SR);
-      layout.push_back(AUDIOENGINE_CH_BL);
-      layout.push_back(AUDIOENGINE_CH_BR);
-      break;
-
-    // Front L, Front R, Front C, LFE, Side L, Side R, Back L, Back R
-    case CEF_CHANNEL_LAYOUT_7_1:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_LFE);
-      layout.push_back(AUDIOENGINE_CH_SL);
-      layout.push_back(AUDIOENGINE_CH_SR);
-      layout.push_back(AUDIOENGINE_CH_BL);
-      layout.push_back(AUDIOENGINE_CH_BR);
-      break;
-
-    // Front L, Front R, Front C, LFE, Side L, Side R, Front LofC, Front RofC
-    case CEF_CHANNEL_LAYOUT_7_1_WIDE:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_LFE);
-      layout.push_back(AUDIOENGINE_CH_SL);
-      layout.push_back(AUDIOENGINE_CH_SR);
-      layout.push_back(AUDIOENGINE_CH_FLOC);
-      layout.push_back(AUDIOENGINE_CH_FROC);
-      break;
-
-    // Stereo L, Stereo R, LFE
-    case CEF_CHANNEL_LAYOUT_2POINT1:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_LFE);
-      break;
-
-    // Stereo L, Stereo R, Front C, LFE
-    case CEF_CHANNEL_LAYOUT_3_1:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_LFE);
-      break;
-
-    // Stereo L, Stereo R, Front C, Rear C, LFE
-    case CEF_CHANNEL_LAYOUT_4_1:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_BC);
-      layout.push_back(AUDIOENGINE_CH_LFE);
-      break;
-
-    // Stereo L, Stereo R, Front C, Side L, Side R, Back C
-    case CEF_CHANNEL_LAYOUT_6_0:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_SL);
-      layout.push_back(AUDIOENGINE_CH_SR);
-      layout.push_back(AUDIOENGINE_CH_BC);
-      break;
-
-    // Stereo L, Stereo R, Side L, Side R, Front LofC, Front RofC
-    case CEF_CHANNEL_LAYOUT_6_0_FRONT:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_SL);
-      layout.push_back(AUDIOENGINE_CH_SR);
-      layout.push_back(AUDIOENGINE_CH_FLOC);
-      layout.push_back(AUDIOENGINE_CH_FROC);
-      break;
-
-    // Stereo L, Stereo R, Front C, Rear L, Rear R, Rear C
-    case CEF_CHANNEL_LAYOUT_HEXAGONAL:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_BL);
-      layout.push_back(AUDIOENGINE_CH_BR);
-      layout.push_back(AUDIOENGINE_CH_BC);
-      break;
-
-    // Stereo L, Stereo R, Front C, LFE, Side L, Side R, Rear Center
-    case CEF_CHANNEL_LAYOUT_6_1:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_LFE);
-      layout.push_back(AUDIOENGINE_CH_SL);
-      layout.push_back(AUDIOENGINE_CH_SR);
-      layout.push_back(AUDIOENGINE_CH_BC);
-      break;
-
-    // Stereo L, Stereo R, Front C, LFE, Back L, Back R, Rear Center
-    case CEF_CHANNEL_LAYOUT_6_1_BACK:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_LFE);
-      layout.push_back(AUDIOENGINE_CH_BL);
-      layout.push_back(AUDIOENGINE_CH_BR);
-      layout.push_back(AUDIOENGINE_CH_BC);
-      break;
-
-    // Stereo L, Stereo R, Side L, Side R, Front LofC, Front RofC, LFE
-    case CEF_CHANNEL_LAYOUT_6_1_FRONT:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_SL);
-      layout.push_back(AUDIOENGINE_CH_SR);
-      layout.push_back(AUDIOENGINE_CH_FLOC);
-      layout.push_back(AUDIOENGINE_CH_FROC);
-      layout.push_back(AUDIOENGINE_CH_LFE);
-      break;
-
-    // Front L, Front R, Front C, Side L, Side R, Front LofC, Front RofC
-    case CEF_CHANNEL_LAYOUT_7_0_FRONT:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_SL);
-      layout.push_back(AUDIOENGINE_CH_SR);
-      layout.push_back(AUDIOENGINE_CH_FLOC);
-      layout.push_back(AUDIOENGINE_CH_FROC);
-      break;
-
-    // Front L, Front R, Front C, LFE, Back L, Back R, Front LofC, Front RofC
-    case CEF_CHANNEL_LAYOUT_7_1_WIDE_BACK:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_LFE);
-      layout.push_back(AUDIOENGINE_CH_BL);
-      layout.push_back(AUDIOENGINE_CH_BR);
-      layout.push_back(AUDIOENGINE_CH_FLOC);
-      layout.push_back(AUDIOENGINE_CH_FROC);
-      break;
-
-    // Front L, Front R, Front C, Side L, Side R, Rear L, Back R, Back C.
-    case CEF_CHANNEL_LAYOUT_OCTAGONAL:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_FC);
-      layout.push_back(AUDIOENGINE_CH_SL);
-      layout.push_back(AUDIOENGINE_CH_SR);
-      layout.push_back(AUDIOENGINE_CH_BL);
-      layout.push_back(AUDIOENGINE_CH_BR);
-      layout.push_back(AUDIOENGINE_CH_BC);
-      break;
-
-    // Front L, Front R, Side L, Side R, LFE
-    case CEF_CHANNEL_LAYOUT_4_1_QUAD_SIDE:
-      layout.push_back(AUDIOENGINE_CH_FL);
-      layout.push_back(AUDIOENGINE_CH_FR);
-      layout.push_back(AUDIOENGINE_CH_SL);
-      layout.push_back(AUDIOENGINE_CH_SR);
-      layout.push_back(AUDIOENGINE_CH_LFE);
-      break;
-
-    // Channels are not explicitly mapped to speakers.
-    case CEF_CHANNEL_LAYOUT_DISCRETE:
-      break;
-
-    // Front L, Front R, Front C. Front C contains the keyboard mic audio. This
-    // layout is only intended for input for WebRTC. The Front C channel
-    // is stripped away in the WebRTC audio input pipeline and never seen outside
-    // of that.
-    case CEF_CHANNEL_LAYOUT_STEREO_AND_KEYBOARD_MIC:
-      break;
-
-    case CEF_CHANNEL_LAYOUT_NONE:
-    case CEF_CHANNEL_LAYOUT_UNSUPPORTED:
-    default: ;
-  }
+  StreamStarted(browser->GetIdentifier(), params, channels);
+}
+
+void CAudioHandler::OnAudioStreamPacket(CefRefPtr<CefBrowser> browser,
+                                        const float** data,
+                                        int frames, int64_t pts)
+{
+  StreamPacket(browser->GetIdentifier(), data, frames, pts);
+}
+
+void CAudioHandler::OnAudioStreamStopped(CefRefPtr<CefBrowser> browser)
+{
+  StreamStopped(browser->GetIdentifier());
+}
+
+void CAudioHandler::StreamStarted(int browserId, const CefAudioParameters& params, int channels)
+{
+  std::vector<AudioEngineChannel> source;
+  if (!ChannelMap::ToChannels(params.channel_layout, source) ||
+      source.size() != static_cast<size_t>(channels))
+    source = ChannelMap::DefaultChannels(std::max(channels, 1));
+
+  // Mix to the layout of the sink, so AudioEngine gets no remap work
+  std::vector<AudioEngineChannel> layout = source;
+  kodi::audioengine::AudioEngineFormat sinkFormat;
+  const bool pcmSink = m_output->GetSinkFormat(sinkFormat) &&
+                       ChannelMap::IsPCM(sinkFormat.GetChannelLayout());
+  if (pcmSink)
+    layout = sinkFormat.GetChannelLayout();
+  else
+    layout.erase(std::remove(layout.begin(), layout.end(), AUDIOENGINE_CH_NULL), layout.end());
 
   kodi::audioengine::AudioEngineFormat format;
   format.SetDataFormat(AUDIOENGINE_FMT_FLOATP);
   format.SetChannelLayout(layout);
   format.SetSampleRate(params.sample_rate);
-  format.SetFrameSize(sizeof(float)*channels);//bytes_per_frame;
+  format.SetFrameSize(sizeof(float) * layout.size());
   format.SetFramesAmount(params.frames_per_buffer);
-  m_audioStreams[browser->GetIdentifier()] = new kodi::audioengine::CAEStream(format);
+
+  const int jitterMs = kodi::GetSettingInt("performance.audio_jitter_buffer", 40);
+  auto stream = std::make_shared<CAudioStream>(m_output, browserId, source, std::max(channels, 1),
+                                               format, std::max(jitterMs, 0));
+
+  // Optional own resampler, 0 leaves rate differences to AudioEngine. The
+  // mixer needs all streams at the sink rate, there it is always used.
+  // Drift correction by resampling needs it on also for equal rates.
+  const int resampler = kodi::GetSettingInt("performance.audio_resampler", 0);
+  const int drift = kodi::GetSettingInt("performance.audio_drift_correction", 0);
+  const bool mixStreams = pcmSink && kodi::GetSettingBoolean("performance.audio_mix_streams", false);
+  const bool rateDiffers = pcmSink && sinkFormat.GetSampleRate() != static_cast<unsigned int>(params.sample_rate);
+  const bool variable = drift == CAudioStream::DRIFT_CORRECTION_RESAMPLE;
+  bool resampled = false;
+  if ((rateDiffers && (resampler > 0 || mixStreams)) || variable)
+    resampled = stream->EnableResampler(rateDiffers ? sinkFormat.GetSampleRate() : params.sample_rate,
+                                        resampler > 0 ? static_cast<CResampler::Quality>(resampler)
+                                                      : CResampler::QUALITY_MEDIUM,
+                                        variable);
+  stream->SetDriftCorrection(static_cast<CAudioStream::DriftCorrection>(drift));
+
+  // Pages with an open WebAudio context send silence all the time
+  const int idleTimeout = kodi::GetSettingInt("performance.audio_idle_timeout", 10);
+  stream->SetIdleTimeout(static_cast<unsigned int>(std::max(idleTimeout, 0)) * 1000);
+
+  // Diagnostics, replays are not recorded again
+  if (browserId >= 0 && kodi::GetSettingBoolean("performance.audio_trace", false))
+  {
+    std::unique_ptr<CAudioTraceWriter> trace(new CAudioTraceWriter);
+    if (trace->Open(TracePath("audio-" + std::to_string(browserId)) + ".trace", params, channels))
+      stream->SetTrace(std::move(trace));
+  }
+  const bool capture = kodi::GetSettingBoolean("performance.audio_capture", false);
+  if (capture)
+    stream->SetCapture(TracePath("audio-" + std::to_string(browserId)) + ".wav");
+
+  std::shared_ptr<CAudioStream> previous;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::shared_ptr<CAudioStream>& entry = m_audioStreams[browserId];
+    previous = entry;
+    entry = stream;
+
+    const auto volume = m_volumes.find(browserId);
+    if (volume != m_volumes.end())
+      stream->SetGain(volume->second.muted ? 0.0f : volume->second.gain);
+  }
+
+  // Streams the mixer can't take, e.g. after a sink change, get their own
+  if (!mixStreams || (rateDiffers && !resampled) || !AddMixed(stream, capture))
+    stream->Start();
+
+  if (previous)
+    StopStream(previous);
 }
 
-void CAudioHandler::OnAudioStreamPacket(CefRefPtr<CefBrowser> browser,
-                                        const float** data,
-                                        int frames, int64_t pts)
+void CAudioHandler::StreamPacket(int browserId, const float** data, int frames, int64_t pts)
 {
   if (m_mute)
     return;
 
-  const auto& handler = m_audioStreams.find(browser->GetIdentifier());
-  if (handler != m_audioStreams.end())
-    handler->second->AddData((uint8_t* const *)(data), 0, frames, pts);
+  const auto start = std::chrono::steady_clock::now();
+  std::shared_ptr<CAudioStream> stream = GetStream(browserId);
+  if (stream)
+  {
+    stream->Push(data, frames, pts);
+    stream->AddPacketTime(std::chrono::steady_clock::now() - start);
+  }
 }
 
-void CAudioHandler::OnAudioStreamStopped(CefRefPtr<CefBrowser> browser)
+void CAudioHandler::StreamStopped(int browserId)
 {
-  const auto& handler = m_audioStreams.find(browser->GetIdentifier());
-  if (handler != m_audioStreams.end())
+  std::shared_ptr<CAudioStream> stream;
   {
-    delete handler->second;
-    m_audioStreams.erase(browser->GetIdentifier());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_audioStreams.find(browserId);
+    if (it == m_audioStreams.end())
+      return;
+    stream = it->second;
+    m_audioStreams.erase(it);
   }
+
+  StopStream(stream);
+}
+
+void CAudioHandler::SetBrowserGain(int browserId, float gain)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  StreamVolume& volume = m_volumes[browserId];
+  volume.gain = std::max(gain, 0.0f);
+  ApplyVolume(browserId, volume);
+}
+
+void CAudioHandler::SetBrowserMuted(int browserId, bool muted)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  StreamVolume& volume = m_volumes[browserId];
+  volume.muted = muted;
+  ApplyVolume(browserId, volume);
+}
+
+void CAudioHandler::ClearBrowserVolume(int browserId)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_volumes.erase(browserId);
+}
+
+void CAudioHandler::ApplyVolume(int browserId, const StreamVolume& volume)
+{
+  const auto it = m_audioStreams.find(browserId);
+  if (it != m_audioStreams.end())
+    it->second->SetGain(volume.muted ? 0.0f : volume.gain);
+}
+
+bool CAudioHandler::AddMixed(const std::shared_ptr<CAudioStream>& stream, bool capture)
+{
+  std::lock_guard<std::mutex> lock(m_mixerMutex);
+  if (!m_mixer)
+  {
+    m_mixer.reset(new CAudioMixer(m_output, stream->Format()));
+    if (capture)
+      m_mixer->SetCapture(TracePath("audio-mixer") + ".wav");
+  }
+  return m_mixer->Add(stream);
+}
+
+void CAudioHandler::StopStream(const std::shared_ptr<CAudioStream>& stream)
+{
+  std::unique_ptr<CAudioMixer> idle;
+  {
+    std::lock_guard<std::mutex> lock(m_mixerMutex);
+    if (!m_mixer || !m_mixer->Remove(stream))
+    {
+      stream->Stop();
+      return;
+    }
+
+    // Without streams the mixer goes, the next one opens with the sink
+    // format of then
+    if (m_mixer->Empty())
+      idle = std::move(m_mixer);
+  }
+}
+
+bool CAudioHandler::IsPlaying(int browserId)
+{
+  return GetStream(browserId) != nullptr;
+}
+
+std::shared_ptr<CAudioStream> CAudioHandler::GetStream(int browserId)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto it = m_audioStreams.find(browserId);
+  return it != m_audioStreams.end() ? it->second : nullptr;
 }
 
 void CAudioHandler::OnAudioStreamError(CefRefPtr<CefBrowser> browser, const CefString& message)
@@ -8,18 +8,33 @@
 
 #pragma once
 
+#include "AudioMixer.h"
+#include "AudioOutput.h"
+#include "AudioStream.h"
 #include "include/cef_audio_handler.h"
 #include "include/cef_app.h"
 
 #include <atomic>
 #include <kodi/AudioEngine.h>
+#include <map>
+#include <memory>
+#include <mutex>
 
 class CWebBrowser;
 
 class ATTRIBUTE_HIDDEN CAudioHandler : public CefAudioHandler
 {
 public:
-  CAudioHandler(CWebBrowser* addonMain, bool mute) : m_addonMain(addonMain), m_mute(mute) { }
+  /*!
+   * @param[in] addonMain Add-on instance, nullptr outside of Kodi
+   * @param[in] mute Start muted
+   * @param[in] output Where the streams are played
+   */
+  CAudioHandler(CWebBrowser* addonMain, bool mute, std::shared_ptr<IAudioOutput> output)
+    : m_addonMain(addonMain), m_mute(mute), m_output(std::move(output))
+  {
+  }
+  ~CAudioHandler() override;
 
   /// CefAudioHandler methods
   //@{
@@ -34,10 +49,58 @@ public:
 
   void SetMute(bool mute) { m_mute = mute; }
 
+  /*!
+   * @brief The work of the CEF callbacks by browser identifier, also used
+   * by CAudioTraceReplay with its own one.
+   */
+  //@{
+  void StreamStarted(int browserId, const CefAudioParameters& params, int channels);
+  void StreamPacket(int browserId, const float** data, int frames, int64_t pts);
+  void StreamStopped(int browserId);
+  //@}
+
+  /*!
+   * @brief Volume and mute of one browser, kept for its later streams until
+   * the browser is closed. Set by the page over `kodi.audio` of the V8 interface.
+   */
+  //@{
+  void SetBrowserGain(int browserId, float gain);
+  void SetBrowserMuted(int browserId, bool muted);
+  void ClearBrowserVolume(int browserId);
+  //@}
+
+  /*!
+   * @brief Check a browser has a started audio stream.
+   */
+  bool IsPlaying(int browserId);
+
 private:
   IMPLEMENT_REFCOUNTING(CAudioHandler);
+  friend class CAudioTraceReplay;
+
+  struct StreamVolume
+  {
+    float gain = 1.0f;
+    bool muted = false;
+  };
+
+  std::shared_ptr<CAudioStream> GetStream(int browserId);
+  void ApplyVolume(int browserId, const StreamVolume& volume);
+  bool AddMixed(const std::shared_ptr<CAudioStream>& stream, bool capture);
+  void StopStream(const std::shared_ptr<CAudioStream>& stream);
 
   CWebBrowser* m_addonMain;
-  std::map<int, kodi::audioengine::CAEStream*> m_audioStreams;
   std::atomic_bool m_mute;
+  const std::shared_ptr<IAudioOutput> m_output;
+
+  // Streams and volumes by browser identifier, the mutex is only hold to
+  // change or look up the maps and never while a stream starts or stops
+  std::mutex m_mutex;
+  std::map<int, std::shared_ptr<CAudioStream>> m_audioStreams;
+  std::map<int, StreamVolume> m_volumes;
+
+  // Shared stream of all browsers with performance.audio_mix_streams, only
+  // while at least one is playing
+  std::mutex m_mixerMutex;
+  std::unique_ptr<CAudioMixer> m_mixer;
 };
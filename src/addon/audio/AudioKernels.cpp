@@ -0,0 +1,162 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "AudioKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAS_AUDIO_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAS_AUDIO_NEON 1
+#endif
+
+namespace AudioKernels
+{
+
+void Scale(float* dst, const float* src, float scale, size_t frames)
+{
+  size_t i = 0;
+#if defined(HAS_AUDIO_SSE2)
+  const __m128 factor = _mm_set1_ps(scale);
+  for (; i + 4 <= frames; i += 4)
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), factor));
+#elif defined(HAS_AUDIO_NEON)
+  for (; i + 4 <= frames; i += 4)
+    vst1q_f32(dst + i, vmulq_n_f32(vld1q_f32(src + i), scale));
+#endif
+  for (; i < frames; ++i)
+    dst[i] = src[i] * scale;
+}
+
+void MulAdd(float* dst, const float* src, float scale, size_t frames)
+{
+  size_t i = 0;
+#if defined(HAS_AUDIO_SSE2)
+  const __m128 factor = _mm_set1_ps(scale);
+  for (; i + 4 <= frames; i += 4)
+    _mm_storeu_ps(dst + i,
+                  _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), factor)));
+#elif defined(HAS_AUDIO_NEON)
+  for (; i + 4 <= frames; i += 4)
+    vst1q_f32(dst + i, vmlaq_n_f32(vld1q_f32(dst + i), vld1q_f32(src + i), scale));
+#endif
+  for (; i < frames; ++i)
+    dst[i] += src[i] * scale;
+}
+
+void Ramp(float* dst, float start, float end, size_t frames)
+{
+  if (frames == 0)
+    return;
+
+  const float step = (end - start) / frames;
+  size_t i = 0;
+#if defined(HAS_AUDIO_SSE2)
+  __m128 gain = _mm_setr_ps(start, start + step, start + 2 * step, start + 3 * step);
+  const __m128 advance = _mm_set1_ps(4 * step);
+  for (; i + 4 <= frames; i += 4)
+  {
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), gain));
+    gain = _mm_add_ps(gain, advance);
+  }
+#elif defined(HAS_AUDIO_NEON)
+  const float first[4] = {start, start + step, start + 2 * step, start + 3 * step};
+  float32x4_t gain = vld1q_f32(first);
+  const float32x4_t advance = vdupq_n_f32(4 * step);
+  for (; i + 4 <= frames; i += 4)
+  {
+    vst1q_f32(dst + i, vmulq_f32(vld1q_f32(dst + i), gain));
+    gain = vaddq_f32(gain, advance);
+  }
+#endif
+  for (; i < frames; ++i)
+    dst[i] *= start + step * i;
+}
+
+void Clamp(float* dst, float limit, size_t frames)
+{
+  size_t i = 0;
+#if defined(HAS_AUDIO_SSE2)
+  const __m128 high = _mm_set1_ps(limit);
+  const __m128 low = _mm_set1_ps(-limit);
+  for (; i + 4 <= frames; i += 4)
+    _mm_storeu_ps(dst + i, _mm_max_ps(_mm_min_ps(_mm_loadu_ps(dst + i), high), low));
+#elif defined(HAS_AUDIO_NEON)
+  const float32x4_t high = vdupq_n_f32(limit);
+  const float32x4_t low = vdupq_n_f32(-limit);
+  for (; i + 4 <= frames; i += 4)
+    vst1q_f32(dst + i, vmaxq_f32(vminq_f32(vld1q_f32(dst + i), high), low));
+#endif
+  for (; i < frames; ++i)
+    dst[i] = std::min(std::max(dst[i], -limit), limit);
+}
+
+float Peak(const float* src, size_t frames)
+{
+  size_t i = 0;
+  float peak = 0.0f;
+#if defined(HAS_AUDIO_SSE2)
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  __m128 max = _mm_setzero_ps();
+  for (; i + 4 <= frames; i += 4)
+    max = _mm_max_ps(max, _mm_and_ps(_mm_loadu_ps(src + i), absMask));
+  max = _mm_max_ps(max, _mm_movehl_ps(max, max));
+  max = _mm_max_ss(max, _mm_shuffle_ps(max, max, 1));
+  peak = _mm_cvtss_f32(max);
+#elif defined(HAS_AUDIO_NEON)
+  float32x4_t max = vdupq_n_f32(0.0f);
+  for (; i + 4 <= frames; i += 4)
+    max = vmaxq_f32(max, vabsq_f32(vld1q_f32(src + i)));
+  const float32x2_t pair = vmax_f32(vget_low_f32(max), vget_high_f32(max));
+  peak = vget_lane_f32(vpmax_f32(pair, pair), 0);
+#endif
+  for (; i < frames; ++i)
+    peak = std::max(peak, std::fabs(src[i]));
+  return peak;
+}
+
+bool IsSilent(const float* src, float threshold, size_t frames)
+{
+  size_t i = 0;
+#if defined(HAS_AUDIO_SSE2)
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 limit = _mm_set1_ps(threshold);
+  for (; i + 16 <= frames; i += 16)
+  {
+    const __m128 max01 = _mm_max_ps(_mm_and_ps(_mm_loadu_ps(src + i), absMask),
+                                    _mm_and_ps(_mm_loadu_ps(src + i + 4), absMask));
+    const __m128 max23 = _mm_max_ps(_mm_and_ps(_mm_loadu_ps(src + i + 8), absMask),
+                                    _mm_and_ps(_mm_loadu_ps(src + i + 12), absMask));
+    if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_max_ps(max01, max23), limit)) != 0)
+      return false;
+  }
+#elif defined(HAS_AUDIO_NEON)
+  const float32x4_t limit = vdupq_n_f32(threshold);
+  for (; i + 16 <= frames; i += 16)
+  {
+    const float32x4_t max01 = vmaxq_f32(vabsq_f32(vld1q_f32(src + i)), vabsq_f32(vld1q_f32(src + i + 4)));
+    const float32x4_t max23 = vmaxq_f32(vabsq_f32(vld1q_f32(src + i + 8)), vabsq_f32(vld1q_f32(src + i + 12)));
+    const uint32x4_t above = vcgtq_f32(vmaxq_f32(max01, max23), limit);
+    const uint32x2_t pair = vorr_u32(vget_low_u32(above), vget_high_u32(above));
+    if (vget_lane_u32(vpmax_u32(pair, pair), 0) != 0)
+      return false;
+  }
+#endif
+  for (; i < frames; ++i)
+  {
+    if (std::fabs(src[i]) > threshold)
+      return false;
+  }
+  return true;
+}
+
+} // namespace AudioKernels
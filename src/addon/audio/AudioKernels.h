@@ -0,0 +1,51 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/*!
+ * @brief Loops over float planes, with SSE2 or NEON where present.
+ *
+ * None of the functions need aligned planes.
+ */
+namespace AudioKernels
+{
+
+/*!
+ * @brief dst = src * scale
+ */
+void Scale(float* dst, const float* src, float scale, size_t frames);
+
+/*!
+ * @brief dst += src * scale
+ */
+void MulAdd(float* dst, const float* src, float scale, size_t frames);
+
+/*!
+ * @brief dst *= gain, with the gain going linear from start to end.
+ */
+void Ramp(float* dst, float start, float end, size_t frames);
+
+/*!
+ * @brief Limit all samples to -limit .. limit.
+ */
+void Clamp(float* dst, float limit, size_t frames);
+
+/*!
+ * @brief Highest absolute sample value.
+ */
+float Peak(const float* src, size_t frames);
+
+/*!
+ * @brief Check no sample is above the threshold, stops at the first one.
+ */
+bool IsSilent(const float* src, float threshold, size_t frames);
+
+} // namespace AudioKernels
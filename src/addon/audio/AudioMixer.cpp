@@ -0,0 +1,262 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "AudioMixer.h"
+#include "AudioKernels.h"
+
+#include <algorithm>
+
+namespace
+{
+
+// Highest level of the sum, a bit below full scale
+constexpr float LIMITER_CEILING = 0.98f;
+
+// Time for the limiter to come back from any reduction to full level
+constexpr double LIMITER_RELEASE_SECONDS = 0.25;
+
+// Audio kept queued in the sink, at least this and four periods
+constexpr double MIN_SINK_DELAY_SECONDS = 0.04;
+
+// Below this amount of periods in the sink is mixed also with late streams
+constexpr double URGENT_SINK_PERIODS = 1.0;
+
+double CpuPerSecond(std::chrono::nanoseconds cpu, uint64_t frames, unsigned int sampleRate)
+{
+  if (frames == 0)
+    return 0.0;
+  return std::chrono::duration<double, std::milli>(cpu).count() / (static_cast<double>(frames) / sampleRate);
+}
+
+} // namespace
+
+CAudioMixer::CAudioMixer(std::shared_ptr<IAudioOutput> output,
+                         const kodi::audioengine::AudioEngineFormat& format)
+  : m_output(std::move(output)),
+    m_format(format),
+    m_channels(std::max(format.GetFrameSize() / static_cast<unsigned int>(sizeof(float)), 1u)),
+    m_sampleRate(std::max(format.GetSampleRate(), 1u)),
+    m_periodFrames(std::max(format.GetFramesAmount(), 64u))
+{
+}
+
+CAudioMixer::~CAudioMixer()
+{
+  m_running = false;
+  if (!m_thread.joinable())
+    return;
+
+  m_thread.join();
+  kodi::Log(ADDON_LOG_DEBUG, "CAudioMixer::%s: Mixer stopped after %.1f s, limiter and sink took %.3f ms CPU per second, stream closed %llu times for %.1f s",
+            __func__, static_cast<double>(m_mixedFrames) / m_sampleRate,
+            CpuPerSecond(m_mixCpu, m_mixedFrames, m_sampleRate),
+            static_cast<unsigned long long>(m_closes),
+            std::chrono::duration<double>(m_closedTime).count());
+}
+
+bool CAudioMixer::Add(const std::shared_ptr<CAudioStream>& stream)
+{
+  const kodi::audioengine::AudioEngineFormat& format = stream->Format();
+  if (format.GetSampleRate() != m_format.GetSampleRate() ||
+      format.GetFrameSize() != m_format.GetFrameSize() ||
+      format.GetChannelLayout() != m_format.GetChannelLayout())
+    return false;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Input input;
+    input.stream = stream;
+    m_inputs.push_back(input);
+    kodi::Log(ADDON_LOG_DEBUG, "CAudioMixer::%s: Browser %i joined the mixer, %zu streams mixed",
+              __func__, stream->BrowserId(), m_inputs.size());
+  }
+
+  if (!m_running)
+  {
+    m_running = true;
+    m_thread = std::thread(&CAudioMixer::Process, this);
+  }
+  return true;
+}
+
+bool CAudioMixer::Remove(const std::shared_ptr<CAudioStream>& stream)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto it = std::find_if(m_inputs.begin(), m_inputs.end(),
+                               [&stream](const Input& input) { return input.stream == stream; });
+  if (it == m_inputs.end())
+    return false;
+
+  kodi::Log(ADDON_LOG_DEBUG, "CAudioMixer::%s: Browser %i left the mixer after %.1f s, %.3f ms CPU per second, %llu underruns, %llu silent frames skipped",
+            __func__, stream->BrowserId(), static_cast<double>(it->frames) / m_sampleRate,
+            CpuPerSecond(it->cpu, it->frames, m_sampleRate),
+            static_cast<unsigned long long>(stream->Underruns()),
+            static_cast<unsigned long long>(stream->SkippedFrames()));
+  stream->LogPackets(__func__);
+  m_inputs.erase(it);
+  return true;
+}
+
+bool CAudioMixer::Empty()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_inputs.empty();
+}
+
+bool CAudioMixer::AllIdle()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return std::all_of(m_inputs.begin(), m_inputs.end(),
+                     [](const Input& input) { return input.stream->IsIdle(); });
+}
+
+void CAudioMixer::Limit(float* const* planes, size_t frames)
+{
+  float peak = 0.0f;
+  for (unsigned int channel = 0; channel < m_channels; ++channel)
+    peak = std::max(peak, AudioKernels::Peak(planes[channel], frames));
+
+  // Reduce at once inside this period, come back slowly over the next ones
+  const float target = peak > LIMITER_CEILING ? LIMITER_CEILING / peak : 1.0f;
+  const float release = static_cast<float>(frames / (LIMITER_RELEASE_SECONDS * m_sampleRate));
+  const float gain = target < m_limiterGain ? target : std::min(target, m_limiterGain + release);
+  if (gain == 1.0f && m_limiterGain == 1.0f)
+    return;
+
+  for (unsigned int channel = 0; channel < m_channels; ++channel)
+  {
+    AudioKernels::Ramp(planes[channel], m_limiterGain, gain, frames);
+    // The ramp starts above the target, catch peaks at its begin
+    AudioKernels::Clamp(planes[channel], LIMITER_CEILING, frames);
+  }
+  m_limiterGain = gain;
+}
+
+void CAudioMixer::Process()
+{
+  std::unique_ptr<IAudioSink> stream = m_output->OpenStream(m_format);
+  if (!m_capturePath.empty())
+    m_capture.Open(m_capturePath, m_channels, m_sampleRate);
+
+  std::vector<std::vector<float>> sum(m_channels, std::vector<float>(m_periodFrames));
+  std::vector<std::vector<float>> source(m_channels, std::vector<float>(m_periodFrames));
+  std::vector<float*> sumPointers;
+  std::vector<float*> sourcePointers;
+  for (unsigned int channel = 0; channel < m_channels; ++channel)
+  {
+    sumPointers.push_back(sum[channel].data());
+    sourcePointers.push_back(source[channel].data());
+  }
+
+  const auto pollInterval = std::chrono::microseconds(std::min(
+      std::max(static_cast<int64_t>(m_periodFrames) * 500000 / m_sampleRate, int64_t(2000)),
+      int64_t(20000)));
+  const unsigned int frameSize = m_channels * sizeof(float);
+  const double periodSeconds = static_cast<double>(m_periodFrames) / m_sampleRate;
+  const double sinkDelay = std::max(MIN_SINK_DELAY_SECONDS, 4.0 * periodSeconds);
+  std::chrono::steady_clock::time_point closedAt;
+
+  while (m_running)
+  {
+    // Closed while all streams were idle, open again with the first sound
+    if (!stream)
+    {
+      if (AllIdle())
+      {
+        std::this_thread::sleep_for(pollInterval);
+        continue;
+      }
+
+      stream = m_output->OpenStream(m_format);
+      m_closedTime += std::chrono::steady_clock::now() - closedAt;
+      kodi::Log(ADDON_LOG_DEBUG, "CAudioMixer::%s: Stream opened again", __func__);
+
+      // A sink waking up from suspend can lose its first milliseconds
+      for (auto& plane : sum)
+        std::fill(plane.begin(), plane.end(), 0.0f);
+      for (size_t preRoll = 0; preRoll < m_sampleRate * CAudioStream::PRE_ROLL_MS / 1000; preRoll += m_periodFrames)
+      {
+        stream->AddData(reinterpret_cast<uint8_t* const*>(sumPointers.data()), 0, m_periodFrames);
+        m_capture.Write(sumPointers.data(), m_periodFrames);
+      }
+    }
+
+    // Mix full periods only, all streams advance by the same amount. The sink
+    // paces the mixer, filling it further would only drain the browsers.
+    const double delay = stream->GetDelay();
+    if (delay > sinkDelay || stream->GetSpace() / frameSize < m_periodFrames)
+    {
+      std::this_thread::sleep_for(pollInterval);
+      continue;
+    }
+
+    // Wait for streams with a late packet, as long as the sink has enough
+    if (delay > URGENT_SINK_PERIODS * periodSeconds)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      const bool ready = std::all_of(m_inputs.begin(), m_inputs.end(), [this](const Input& input) {
+        return input.stream->CanPull(m_periodFrames);
+      });
+      lock.unlock();
+
+      if (!ready)
+      {
+        std::this_thread::sleep_for(pollInterval);
+        continue;
+      }
+    }
+
+    for (auto& plane : sum)
+      std::fill(plane.begin(), plane.end(), 0.0f);
+
+    bool active = false;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for (Input& input : m_inputs)
+      {
+        const auto start = std::chrono::steady_clock::now();
+        const size_t frames = input.stream->Pull(sourcePointers.data(), m_periodFrames);
+        const float gain = input.stream->Gain();
+        if (frames > 0 && gain > 0.0f)
+        {
+          for (unsigned int channel = 0; channel < m_channels; ++channel)
+            AudioKernels::MulAdd(sumPointers[channel], sourcePointers[channel], gain, frames);
+        }
+        active |= frames > 0;
+        input.frames += frames;
+        input.cpu += std::chrono::steady_clock::now() - start;
+      }
+    }
+
+    // Nothing to play, let the sink run empty instead of feeding silence.
+    // With all streams idle the stream is closed after it played the rest.
+    if (!active)
+    {
+      if (delay < periodSeconds && AllIdle())
+      {
+        stream.reset();
+        closedAt = std::chrono::steady_clock::now();
+        m_closes++;
+        kodi::Log(ADDON_LOG_DEBUG, "CAudioMixer::%s: All streams idle, stream closed", __func__);
+      }
+      std::this_thread::sleep_for(pollInterval);
+      continue;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    Limit(sumPointers.data(), m_periodFrames);
+    stream->AddData(reinterpret_cast<uint8_t* const*>(sumPointers.data()), 0, m_periodFrames);
+    m_capture.Write(sumPointers.data(), m_periodFrames);
+    m_mixedFrames += m_periodFrames;
+    m_mixCpu += std::chrono::steady_clock::now() - start;
+  }
+
+  if (!stream && m_closes > 0)
+    m_closedTime += std::chrono::steady_clock::now() - closedAt;
+  m_capture.Close();
+}
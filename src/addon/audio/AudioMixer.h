@@ -0,0 +1,92 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "AudioStream.h"
+#include "WavWriter.h"
+
+#include <atomic>
+#include <chrono>
+#include <kodi/AudioEngine.h>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*!
+ * @brief Sum of all browser streams into one stream of the audio output.
+ *
+ * Every added stream must already be converted to the format of the mixer
+ * (sink layout and rate). The mixer thread takes a period from each, adds
+ * them with their gain, and limits the sum so it does not clip.
+ *
+ * While all streams are idle the output stream is closed, and opened
+ * again with a pre-roll when one has sound.
+ */
+class ATTRIBUTE_HIDDEN CAudioMixer
+{
+public:
+  CAudioMixer(std::shared_ptr<IAudioOutput> output,
+              const kodi::audioengine::AudioEngineFormat& format);
+  ~CAudioMixer();
+
+  /*!
+   * @brief Add a stream, the mixer thread starts with the first one.
+   *
+   * @return false if the stream has another format than the mixer
+   */
+  bool Add(const std::shared_ptr<CAudioStream>& stream);
+
+  /*!
+   * @brief Remove a stream and log its mixing cost.
+   *
+   * @return false if the stream is not part of this mixer
+   */
+  bool Remove(const std::shared_ptr<CAudioStream>& stream);
+
+  bool Empty();
+
+  /*!
+   * @brief Capture the mixed audio into a WAV file, call before Add().
+   */
+  void SetCapture(const std::string& path) { m_capturePath = path; }
+
+private:
+  struct Input
+  {
+    std::shared_ptr<CAudioStream> stream;
+    uint64_t frames = 0;
+    std::chrono::nanoseconds cpu{0};
+  };
+
+  void Process();
+  void Limit(float* const* planes, size_t frames);
+  bool AllIdle();
+
+  const std::shared_ptr<IAudioOutput> m_output;
+  kodi::audioengine::AudioEngineFormat m_format;
+  const unsigned int m_channels;
+  const unsigned int m_sampleRate;
+  const unsigned int m_periodFrames;
+
+  std::mutex m_mutex;
+  std::vector<Input> m_inputs;
+
+  std::thread m_thread;
+  std::atomic_bool m_running{false};
+  float m_limiterGain = 1.0f;
+  uint64_t m_mixedFrames = 0;
+  std::chrono::nanoseconds m_mixCpu{0};
+  std::string m_capturePath;
+  CWavWriter m_capture;
+  uint64_t m_closes = 0;
+  std::chrono::nanoseconds m_closedTime{0};
+};
@@ -0,0 +1,45 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "AudioOutput.h"
+
+namespace
+{
+
+class CAudioEngineSink : public IAudioSink
+{
+public:
+  explicit CAudioEngineSink(kodi::audioengine::AudioEngineFormat format) : m_stream(format) {}
+
+  unsigned int GetSpace() override { return m_stream.GetSpace(); }
+  unsigned int AddData(uint8_t* const* data,
+                       unsigned int offset,
+                       unsigned int frames,
+                       double pts) override
+  {
+    return m_stream.AddData(data, offset, frames, pts);
+  }
+  double GetDelay() override { return m_stream.GetDelay(); }
+  void SetVolume(float volume) override { m_stream.SetVolume(volume); }
+
+private:
+  kodi::audioengine::CAEStream m_stream;
+};
+
+} // namespace
+
+bool CAudioEngineOutput::GetSinkFormat(kodi::audioengine::AudioEngineFormat& format)
+{
+  return kodi::audioengine::GetCurrentSinkFormat(format);
+}
+
+std::unique_ptr<IAudioSink> CAudioEngineOutput::OpenStream(
+    const kodi::audioengine::AudioEngineFormat& format)
+{
+  return std::unique_ptr<IAudioSink>(new CAudioEngineSink(format));
+}
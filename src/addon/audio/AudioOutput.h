@@ -0,0 +1,79 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include <kodi/AudioEngine.h>
+#include <memory>
+#include <stdint.h>
+
+/*!
+ * @brief One opened stream of the audio output, written by a single feeder
+ * or mixer thread.
+ */
+class ATTRIBUTE_HIDDEN IAudioSink
+{
+public:
+  virtual ~IAudioSink() = default;
+
+  /*!
+   * @brief Free space of the stream in bytes.
+   */
+  virtual unsigned int GetSpace() = 0;
+
+  /*!
+   * @brief Add planar frames of the stream format.
+   *
+   * @return Frames taken
+   */
+  virtual unsigned int AddData(uint8_t* const* data,
+                               unsigned int offset,
+                               unsigned int frames,
+                               double pts = 0.0) = 0;
+
+  /*!
+   * @brief Time in seconds until frames added now are heard.
+   */
+  virtual double GetDelay() = 0;
+
+  virtual void SetVolume(float volume) = 0;
+};
+
+/*!
+ * @brief Where the streams of the audio handler are played, Kodi's
+ * AudioEngine in the add-on.
+ */
+class ATTRIBUTE_HIDDEN IAudioOutput
+{
+public:
+  virtual ~IAudioOutput() = default;
+
+  /*!
+   * @brief Format the output device currently runs with.
+   *
+   * @return false if there is none
+   */
+  virtual bool GetSinkFormat(kodi::audioengine::AudioEngineFormat& format) = 0;
+
+  /*!
+   * @brief Open a stream, closed by destruction of it.
+   */
+  virtual std::unique_ptr<IAudioSink> OpenStream(
+      const kodi::audioengine::AudioEngineFormat& format) = 0;
+};
+
+/*!
+ * @brief Output by Kodi's AudioEngine.
+ */
+class ATTRIBUTE_HIDDEN CAudioEngineOutput : public IAudioOutput
+{
+public:
+  bool GetSinkFormat(kodi::audioengine::AudioEngineFormat& format) override;
+  std::unique_ptr<IAudioSink> OpenStream(
+      const kodi::audioengine::AudioEngineFormat& format) override;
+};
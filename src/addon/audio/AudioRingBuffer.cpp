@@ -0,0 +1,99 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "AudioRingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+void CAudioRingBuffer::Create(unsigned int channels, size_t capacityFrames)
+{
+  size_t capacity = 1;
+  while (capacity < capacityFrames)
+    capacity <<= 1;
+
+  m_channels = channels;
+  m_capacity = capacity;
+  m_mask = capacity - 1;
+  m_planes.assign(channels, std::vector<float>(capacity, 0.0f));
+  m_writePos.store(0, std::memory_order_relaxed);
+  m_readPos.store(0, std::memory_order_relaxed);
+}
+
+size_t CAudioRingBuffer::Write(const float* const* data, size_t frames)
+{
+  const size_t writePos = m_writePos.load(std::memory_order_relaxed);
+  const size_t readPos = m_readPos.load(std::memory_order_acquire);
+  const size_t count = std::min(frames, m_capacity - (writePos - readPos));
+  if (count == 0)
+    return 0;
+
+  CopyIn(writePos, data, count);
+
+  // Publish the frames after they are copied
+  m_writePos.store(writePos + count, std::memory_order_release);
+  return count;
+}
+
+size_t CAudioRingBuffer::Read(float* const* data, size_t frames)
+{
+  const size_t readPos = m_readPos.load(std::memory_order_relaxed);
+  const size_t writePos = m_writePos.load(std::memory_order_acquire);
+  const size_t count = std::min(frames, writePos - readPos);
+  if (count == 0)
+    return 0;
+
+  CopyOut(readPos, data, count);
+
+  // Give the space free after the frames are copied out
+  m_readPos.store(readPos + count, std::memory_order_release);
+  return count;
+}
+
+size_t CAudioRingBuffer::Skip(size_t frames)
+{
+  const size_t readPos = m_readPos.load(std::memory_order_relaxed);
+  const size_t writePos = m_writePos.load(std::memory_order_acquire);
+  const size_t count = std::min(frames, writePos - readPos);
+  m_readPos.store(readPos + count, std::memory_order_release);
+  return count;
+}
+
+size_t CAudioRingBuffer::AvailableRead() const
+{
+  const size_t readPos = m_readPos.load(std::memory_order_acquire);
+  const size_t writePos = m_writePos.load(std::memory_order_acquire);
+  return writePos - readPos;
+}
+
+void CAudioRingBuffer::CopyIn(size_t pos, const float* const* data, size_t frames)
+{
+  // Up to two parts, before and after the wrap of the ring
+  const size_t start = pos & m_mask;
+  const size_t first = std::min(frames, m_capacity - start);
+  for (unsigned int ch = 0; ch < m_channels; ++ch)
+  {
+    float* plane = m_planes[ch].data();
+    memcpy(plane + start, data[ch], first * sizeof(float));
+    if (first < frames)
+      memcpy(plane, data[ch] + first, (frames - first) * sizeof(float));
+  }
+}
+
+void CAudioRingBuffer::CopyOut(size_t pos, float* const* data, size_t frames) const
+{
+  const size_t start = pos & m_mask;
+  const size_t first = std::min(frames, m_capacity - start);
+  for (unsigned int ch = 0; ch < m_channels; ++ch)
+  {
+    const float* plane = m_planes[ch].data();
+    memcpy(data[ch], plane + start, first * sizeof(float));
+    if (first < frames)
+      memcpy(data[ch] + first, plane, (frames - first) * sizeof(float));
+  }
+}
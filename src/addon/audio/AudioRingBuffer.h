@@ -0,0 +1,70 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <vector>
+
+/*!
+ * @brief Lock-free ring of planar float audio frames.
+ *
+ * Safe for exactly one writer thread and one reader thread. Read and write
+ * position count frames since start and are only changed by their owner, so
+ * neither side ever waits for the other. The capacity is rounded up to a
+ * power of two.
+ */
+class CAudioRingBuffer
+{
+public:
+  CAudioRingBuffer() = default;
+
+  /*!
+   * @brief Allocate the ring, must be called before any reader or writer
+   * uses it.
+   */
+  void Create(unsigned int channels, size_t capacityFrames);
+
+  /*!
+   * @brief Copy frames into the ring (writer thread).
+   *
+   * @return Amount of frames written, less than requested if full
+   */
+  size_t Write(const float* const* data, size_t frames);
+
+  /*!
+   * @brief Copy frames out of the ring (reader thread).
+   *
+   * @return Amount of frames read, less than requested if empty
+   */
+  size_t Read(float* const* data, size_t frames);
+
+  /*!
+   * @brief Drop up to the given amount of frames (reader thread).
+   */
+  size_t Skip(size_t frames);
+
+  size_t AvailableRead() const;
+  size_t AvailableWrite() const { return m_capacity - AvailableRead(); }
+  size_t Capacity() const { return m_capacity; }
+  unsigned int Channels() const { return m_channels; }
+
+private:
+  void CopyIn(size_t pos, const float* const* data, size_t frames);
+  void CopyOut(size_t pos, float* const* data, size_t frames) const;
+
+  unsigned int m_channels = 0;
+  size_t m_capacity = 0;
+  size_t m_mask = 0;
+  std::vector<std::vector<float>> m_planes;
+
+  // On own cache lines, the two threads write only their own position
+  alignas(64) std::atomic<size_t> m_writePos{0};
+  alignas(64) std::atomic<size_t> m_readPos{0};
+};
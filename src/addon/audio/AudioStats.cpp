@@ -0,0 +1,51 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "AudioStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+void CLatencyHistogram::Add(std::chrono::nanoseconds time)
+{
+  const double us = std::chrono::duration<double, std::micro>(time).count();
+  const unsigned int bucket =
+      us < 1.0 ? 0 : std::min(static_cast<unsigned int>(std::log2(us) * 4.0) + 1, BUCKETS - 1);
+  m_buckets[bucket]++;
+  m_count++;
+  m_maxUs = std::max(m_maxUs, us);
+}
+
+double CLatencyHistogram::PercentileUs(double percent) const
+{
+  if (m_count == 0)
+    return 0.0;
+
+  const uint64_t rank = static_cast<uint64_t>(std::ceil(percent / 100.0 * m_count));
+  uint64_t seen = 0;
+  for (unsigned int bucket = 0; bucket < BUCKETS; ++bucket)
+  {
+    seen += m_buckets[bucket];
+    if (seen >= rank)
+      return std::min(BucketUs(bucket + 1), m_maxUs);
+  }
+  return m_maxUs;
+}
+
+double CLatencyHistogram::BucketUs(unsigned int bucket)
+{
+  return bucket == 0 ? 0.0 : std::exp2((bucket - 1) / 4.0);
+}
+
+void CFillLevel::Add(double ms)
+{
+  m_minMs = m_count > 0 ? std::min(m_minMs, ms) : ms;
+  m_maxMs = m_count > 0 ? std::max(m_maxMs, ms) : ms;
+  m_sumMs += ms;
+  m_count++;
+}
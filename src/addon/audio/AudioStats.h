@@ -0,0 +1,67 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <kodi/AudioEngine.h>
+#include <stdint.h>
+
+/*!
+ * @brief Histogram of handling times, with four buckets per octave from
+ * 1 us to about a minute.
+ *
+ * Only one thread may add, reading is safe after it stopped.
+ */
+class ATTRIBUTE_HIDDEN CLatencyHistogram
+{
+public:
+  static constexpr unsigned int BUCKETS = 104;
+
+  void Add(std::chrono::nanoseconds time);
+
+  uint64_t Count() const { return m_count; }
+  double MaxUs() const { return m_maxUs; }
+
+  /*!
+   * @brief Upper end of the bucket holding the percentile, in us.
+   */
+  double PercentileUs(double percent) const;
+
+  /*!
+   * @brief Lower end of a bucket in us, the upper end is the one of the next.
+   */
+  static double BucketUs(unsigned int bucket);
+  uint64_t BucketCount(unsigned int bucket) const { return m_buckets[bucket]; }
+
+private:
+  std::array<uint64_t, BUCKETS> m_buckets{};
+  uint64_t m_count = 0;
+  double m_maxUs = 0.0;
+};
+
+/*!
+ * @brief Lowest, highest and mean of a buffer fill level in ms.
+ */
+class ATTRIBUTE_HIDDEN CFillLevel
+{
+public:
+  void Add(double ms);
+
+  uint64_t Count() const { return m_count; }
+  double MinMs() const { return m_count > 0 ? m_minMs : 0.0; }
+  double MaxMs() const { return m_maxMs; }
+  double MeanMs() const { return m_count > 0 ? m_sumMs / m_count : 0.0; }
+
+private:
+  uint64_t m_count = 0;
+  double m_minMs = 0.0;
+  double m_maxMs = 0.0;
+  double m_sumMs = 0.0;
+};
@@ -0,0 +1,515 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "AudioStream.h"
+#include "AudioKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+// Difference to the expected pts seen as seek or pause of CEF
+constexpr int64_t PTS_JUMP_MS = 100;
+
+// Drop or insert starts above this error and stops below the second
+constexpr double DROP_INSERT_START_SECONDS = 0.004;
+constexpr double DROP_INSERT_STOP_SECONDS = 0.001;
+
+// Played time between two drift logs
+constexpr double DRIFT_LOG_SECONDS = 10.0;
+
+// Samples up to this level count as silence, below 16 bit resolution
+constexpr float SILENCE_THRESHOLD = 1.0f / 65536.0f;
+
+double Milliseconds(std::chrono::nanoseconds time)
+{
+  return std::chrono::duration<double, std::milli>(time).count();
+}
+
+void CreatePlanes(std::vector<std::vector<float>>& planes,
+                  std::vector<float*>& pointers,
+                  unsigned int channels,
+                  size_t frames)
+{
+  planes.assign(channels, std::vector<float>(frames));
+  pointers.clear();
+  for (auto& plane : planes)
+    pointers.push_back(plane.data());
+}
+
+} // namespace
+
+CAudioStream::CAudioStream(std::shared_ptr<IAudioOutput> output,
+                           int browserId,
+                           const std::vector<AudioEngineChannel>& sourceLayout,
+                           unsigned int sourceChannels,
+                           const kodi::audioengine::AudioEngineFormat& format,
+                           unsigned int jitterMs)
+  : m_browserId(browserId),
+    m_format(format),
+    m_sourceChannels(std::max(sourceChannels, 1u)),
+    m_channels(std::max(format.GetFrameSize() / static_cast<unsigned int>(sizeof(float)), 1u)),
+    m_sampleRate(std::max(format.GetSampleRate(), 1u)),
+    m_periodFrames(std::max(format.GetFramesAmount(), 64u)),
+    m_jitterFrames(static_cast<size_t>(m_sampleRate) * jitterMs / 1000),
+    m_output(std::move(output)),
+    m_startTime(std::chrono::steady_clock::now())
+{
+  // Room for the jitter buffer and some more to catch late feeder wakeups
+  m_ring.Create(m_sourceChannels, std::max<size_t>(m_jitterFrames * 4, m_sampleRate / 2));
+
+  const std::vector<AudioEngineChannel> sinkLayout = format.GetChannelLayout();
+  m_mixer.Configure(sourceLayout, sinkLayout);
+  m_mixing = !m_mixer.IsIdentity() || m_sourceChannels != m_channels;
+  if (m_mixing)
+    kodi::Log(ADDON_LOG_DEBUG, "CAudioStream::%s: Browser %i audio mixed from %u to %u channels",
+              __func__, m_browserId, m_sourceChannels, m_channels);
+}
+
+CAudioStream::~CAudioStream()
+{
+  Stop();
+}
+
+bool CAudioStream::EnableResampler(unsigned int outRate, CResampler::Quality quality, bool variable)
+{
+  if (m_thread.joinable() || (outRate == m_sampleRate && !variable))
+    return false;
+
+  if (!m_resampler.Configure(m_channels, m_sampleRate, outRate, quality, variable))
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "CAudioStream::%s: Browser %i rate %u to %u left to AudioEngine",
+              __func__, m_browserId, m_sampleRate, outRate);
+    return false;
+  }
+
+  kodi::Log(ADDON_LOG_DEBUG, "CAudioStream::%s: Browser %i resampled from %u to %u (%u taps, %u phases)",
+            __func__, m_browserId, m_sampleRate, outRate, m_resampler.Taps(), m_resampler.Phases());
+  m_format.SetSampleRate(outRate);
+  m_format.SetFramesAmount(static_cast<unsigned int>(
+      static_cast<uint64_t>(m_periodFrames) * outRate / m_sampleRate));
+  m_resampling = true;
+  return true;
+}
+
+void CAudioStream::SetDriftCorrection(DriftCorrection mode)
+{
+  if (mode == DRIFT_CORRECTION_RESAMPLE && !(m_resampling && m_resampler.IsVariable()))
+    mode = DRIFT_CORRECTION_DROP_INSERT;
+  m_driftCorrection = mode;
+}
+
+void CAudioStream::SetIdleTimeout(unsigned int timeoutMs)
+{
+  m_idleTimeoutFrames = static_cast<size_t>(m_sampleRate) * timeoutMs / 1000;
+}
+
+void CAudioStream::Start()
+{
+  if (m_running)
+    return;
+
+  m_running = true;
+  m_thread = std::thread(&CAudioStream::Process, this);
+}
+
+void CAudioStream::Stop()
+{
+  m_running = false;
+  if (!m_thread.joinable())
+    return;
+
+  m_thread.join();
+  kodi::Log(ADDON_LOG_DEBUG, "CAudioStream::%s: Browser %i audio stopped, %llu underruns, %llu overruns (%llu frames dropped)",
+            __func__, m_browserId, static_cast<unsigned long long>(m_underruns),
+            static_cast<unsigned long long>(m_overruns),
+            static_cast<unsigned long long>(m_droppedFrames));
+  LogDrift(__func__);
+  LogIdle(__func__);
+  LogPackets(__func__);
+}
+
+void CAudioStream::Push(const float** data, int frames, int64_t pts)
+{
+  if (frames <= 0)
+    return;
+
+  if (m_trace)
+    m_trace->Record(data, frames, pts);
+
+  // Silence after the timeout is not queued, the first sound ends it. The
+  // pts goes on, so the drift measurement has to start again.
+  if (m_idleTimeoutFrames > 0)
+  {
+    if (IsSilent(data, frames))
+    {
+      m_silentFrames += frames;
+      if (m_silentFrames >= m_idleTimeoutFrames)
+      {
+        m_idle = true;
+        m_skippedFrames += frames;
+        m_endPts.store(pts + static_cast<int64_t>(frames) * 1000 / m_sampleRate, std::memory_order_relaxed);
+        return;
+      }
+    }
+    else
+    {
+      m_silentFrames = 0;
+      if (m_idle.exchange(false))
+        m_ptsJump = true;
+    }
+  }
+
+  // Pts of CEF are in ms, allow their rounding against the frame count
+  if (m_pushed && std::llabs(pts - m_endPts.load(std::memory_order_relaxed)) > PTS_JUMP_MS)
+    m_ptsJump = true;
+  m_pushed = true;
+
+  const size_t written = m_ring.Write(data, frames);
+  m_endPts.store(pts + static_cast<int64_t>(frames) * 1000 / m_sampleRate, std::memory_order_relaxed);
+  if (written < static_cast<size_t>(frames))
+  {
+    m_overruns++;
+    m_droppedFrames += frames - written;
+  }
+}
+
+bool CAudioStream::IsSilent(const float** data, int frames) const
+{
+  for (unsigned int channel = 0; channel < m_sourceChannels; ++channel)
+  {
+    if (!AudioKernels::IsSilent(data[channel], SILENCE_THRESHOLD, frames))
+      return false;
+  }
+  return true;
+}
+
+void CAudioStream::CreateBuffers()
+{
+  if (!m_planes.empty())
+    return;
+
+  CreatePlanes(m_planes, m_planePointers, m_sourceChannels, m_periodFrames);
+  if (m_mixing)
+    CreatePlanes(m_mixed, m_mixedPointers, m_channels, m_periodFrames);
+  if (m_resampling)
+    CreatePlanes(m_resampled, m_resampledPointers, m_channels,
+                 m_resampler.MaxOutput(m_periodFrames));
+  m_pending.resize(m_channels);
+}
+
+size_t CAudioStream::Convert(size_t maxFrames, float* const*& data, int64_t& pts)
+{
+  // One frame per period less or more against drift, where it is not heard
+  size_t readFrames = std::min(maxFrames, static_cast<size_t>(m_periodFrames));
+  const bool insert = m_dropInsert < 0 && readFrames > 1;
+  if (insert)
+  {
+    readFrames--;
+  }
+  else if (m_dropInsert > 0 && m_ring.AvailableRead() > readFrames)
+  {
+    m_ring.Skip(1);
+    m_consumedFrames++;
+    m_droppedForDrift++;
+  }
+
+  size_t frames = m_ring.Read(m_planePointers.data(), readFrames);
+  m_consumedFrames += frames;
+  pts = m_endPts.load(std::memory_order_relaxed) -
+        static_cast<int64_t>((m_ring.AvailableRead() + frames) * 1000 / m_sampleRate);
+
+  if (insert && frames > 0)
+  {
+    for (unsigned int channel = 0; channel < m_sourceChannels; ++channel)
+      m_planes[channel][frames] = m_planes[channel][frames - 1];
+    frames++;
+    m_insertedForDrift++;
+  }
+
+  data = m_planePointers.data();
+  if (m_mixing)
+  {
+    m_mixer.Process(data, m_mixedPointers.data(), frames);
+    data = m_mixedPointers.data();
+  }
+
+  if (m_resampling)
+  {
+    const size_t resampled = m_resampler.Process(data, frames, m_resampledPointers.data());
+    data = m_resampledPointers.data();
+    pts -= static_cast<int64_t>(m_resampler.Delay());
+    return resampled;
+  }
+
+  return frames;
+}
+
+size_t CAudioStream::Pull(float* const* output, size_t frames)
+{
+  CreateBuffers();
+
+  if (m_buffering)
+  {
+    if (m_ring.AvailableRead() < std::max<size_t>(m_jitterFrames, 1))
+      return 0;
+    m_buffering = false;
+  }
+
+  // Convert until the wanted amount is there or the ring is empty
+  const auto start = std::chrono::steady_clock::now();
+  const uint64_t consumed = m_consumedFrames;
+  while (m_pending[0].size() < frames && m_ring.AvailableRead() > 0)
+  {
+    float* const* data;
+    int64_t pts;
+    const size_t converted = Convert(m_ring.AvailableRead(), data, pts);
+    for (unsigned int channel = 0; channel < m_channels; ++channel)
+      m_pending[channel].insert(m_pending[channel].end(), data[channel], data[channel] + converted);
+    UpdateDrift(static_cast<double>(m_pending[0].size()) / m_format.GetSampleRate());
+  }
+  m_convertCpu += std::chrono::steady_clock::now() - start;
+  m_convertedFrames += m_consumedFrames - consumed;
+  m_fillLevel.Add((static_cast<double>(m_ring.AvailableRead()) / m_sampleRate +
+                   static_cast<double>(m_pending[0].size()) / m_format.GetSampleRate()) * 1000.0);
+
+  const size_t taken = std::min(m_pending[0].size(), frames);
+  for (unsigned int channel = 0; channel < m_channels; ++channel)
+  {
+    memcpy(output[channel], m_pending[channel].data(), taken * sizeof(float));
+    m_pending[channel].erase(m_pending[channel].begin(), m_pending[channel].begin() + taken);
+  }
+
+  if (taken < frames)
+  {
+    // Running out after the idle timeout is wanted
+    if (!m_idle)
+      m_underruns++;
+    m_buffering = true;
+    m_drift.Reset();
+  }
+
+  return taken;
+}
+
+bool CAudioStream::CanPull(size_t frames) const
+{
+  const size_t available = m_ring.AvailableRead();
+  if ((m_buffering && available < std::max<size_t>(m_jitterFrames, 1)) || IsIdle())
+    return true;
+
+  // The resampler keeps its filter length back
+  size_t convertible = available;
+  if (m_resampling)
+    convertible = available > m_resampler.Taps()
+                      ? (available - m_resampler.Taps()) * m_format.GetSampleRate() / m_sampleRate
+                      : 0;
+
+  const size_t pending = m_pending.empty() ? 0 : m_pending[0].size();
+  return pending + convertible >= frames;
+}
+
+bool CAudioStream::IsIdle() const
+{
+  return m_idle && m_ring.AvailableRead() == 0 && (m_pending.empty() || m_pending[0].empty());
+}
+
+void CAudioStream::UpdateDrift(double queuedSeconds)
+{
+  if (m_ptsJump.exchange(false))
+    m_drift.Reset();
+
+  // Frames in the resampler are left out, they are the same all the time
+  const double played = static_cast<double>(m_consumedFrames) / m_sampleRate - queuedSeconds;
+  m_drift.Update(m_endPts.load(std::memory_order_relaxed) / 1000.0, played);
+
+  if (m_driftCorrection == DRIFT_CORRECTION_RESAMPLE)
+  {
+    m_resampler.SetRatioAdjust(m_drift.Correction());
+  }
+  else if (m_driftCorrection == DRIFT_CORRECTION_DROP_INSERT)
+  {
+    const double error = m_drift.Error();
+    if (error > DROP_INSERT_START_SECONDS)
+      m_dropInsert = 1;
+    else if (error < -DROP_INSERT_START_SECONDS)
+      m_dropInsert = -1;
+    else if (std::fabs(error) < DROP_INSERT_STOP_SECONDS)
+      m_dropInsert = 0;
+  }
+
+  if (played >= m_nextDriftLog)
+  {
+    if (m_nextDriftLog > 0.0)
+      LogDrift(__func__);
+    m_nextDriftLog = played + DRIFT_LOG_SECONDS;
+  }
+}
+
+void CAudioStream::LogDrift(const char* function)
+{
+  if (!m_drift.Locked())
+    return;
+
+  kodi::Log(ADDON_LOG_DEBUG, "CAudioStream::%s: Browser %i drift: error %+.1f ms, trend %+.0f ppm, correction %+.0f ppm, %llu frames dropped, %llu inserted",
+            function, m_browserId, m_drift.Error() * 1000.0, m_drift.TrendPpm(),
+            m_driftCorrection == DRIFT_CORRECTION_RESAMPLE ? (m_drift.Correction() - 1.0) * 1e6 : 0.0,
+            static_cast<unsigned long long>(m_droppedForDrift),
+            static_cast<unsigned long long>(m_insertedForDrift));
+}
+
+void CAudioStream::LogIdle(const char* function)
+{
+  if (m_closes == 0 && m_skippedFrames == 0)
+    return;
+
+  // Skipped frames would have cost the same as the converted ones
+  const double saved = m_convertedFrames > 0 ? Milliseconds(m_convertCpu) * m_skippedFrames / m_convertedFrames : 0.0;
+  kodi::Log(ADDON_LOG_DEBUG, "CAudioStream::%s: Browser %i idle: %.1f s of silence skipped, about %.1f ms CPU saved, stream closed %llu times for %.1f of %.1f s",
+            function, m_browserId, static_cast<double>(m_skippedFrames) / m_sampleRate, saved,
+            static_cast<unsigned long long>(m_closes), Milliseconds(m_closedTime) / 1000.0,
+            Milliseconds(std::chrono::steady_clock::now() - m_startTime) / 1000.0);
+}
+
+void CAudioStream::LogPackets(const char* function) const
+{
+  if (m_packetTimes.Count() == 0)
+    return;
+
+  kodi::Log(ADDON_LOG_DEBUG, "CAudioStream::%s: Browser %i packets: %llu, handling p50 %.1f us, p99 %.1f us, max %.1f us, fill min %.1f ms, mean %.1f ms, max %.1f ms",
+            function, m_browserId, static_cast<unsigned long long>(m_packetTimes.Count()),
+            m_packetTimes.PercentileUs(50.0), m_packetTimes.PercentileUs(99.0),
+            m_packetTimes.MaxUs(), m_fillLevel.MinMs(), m_fillLevel.MeanMs(), m_fillLevel.MaxMs());
+}
+
+void CAudioStream::OpenStream()
+{
+  m_stream = m_output->OpenStream(m_format);
+  if (m_closes == 0)
+    return;
+
+  m_closedTime += std::chrono::steady_clock::now() - m_closedAt;
+  kodi::Log(ADDON_LOG_DEBUG, "CAudioStream::%s: Browser %i audio resumed, stream opened again",
+            __func__, m_browserId);
+
+  // A sink waking up from suspend can lose its first milliseconds
+  std::vector<float> silence(static_cast<size_t>(m_format.GetSampleRate()) * PRE_ROLL_MS / 1000);
+  const std::vector<float*> planes(m_channels, silence.data());
+  m_stream->AddData(reinterpret_cast<uint8_t* const*>(planes.data()), 0,
+                    static_cast<unsigned int>(silence.size()));
+  m_capture.Write(planes.data(), silence.size());
+}
+
+void CAudioStream::CloseStream()
+{
+  m_stream.reset();
+  m_closedAt = std::chrono::steady_clock::now();
+  m_closes++;
+  m_drift.Reset();
+  kodi::Log(ADDON_LOG_DEBUG, "CAudioStream::%s: Browser %i audio idle, stream closed", __func__,
+            m_browserId);
+}
+
+void CAudioStream::Process()
+{
+  CreateBuffers();
+  OpenStream();
+  if (!m_capturePath.empty())
+    m_capture.Open(m_capturePath, m_channels, m_format.GetSampleRate());
+
+  // Poll the ring and the sink with a half period, CEF is never waked
+  const auto pollInterval = std::chrono::microseconds(std::min(
+      std::max(static_cast<int64_t>(m_periodFrames) * 500000 / m_sampleRate, int64_t(2000)),
+      int64_t(20000)));
+  const double periodSeconds = static_cast<double>(m_periodFrames) / m_sampleRate;
+  const unsigned int frameSize = m_channels * sizeof(float);
+
+  float gain = 1.0f;
+  bool buffering = true;
+  while (m_running)
+  {
+    const size_t available = m_ring.AvailableRead();
+    if (buffering)
+    {
+      if (available < std::max<size_t>(m_jitterFrames, 1))
+      {
+        std::this_thread::sleep_for(pollInterval);
+        continue;
+      }
+      buffering = false;
+
+      // Closed while idle, the stream comes back with the first sound
+      if (!m_stream)
+      {
+        OpenStream();
+        gain = 1.0f;
+      }
+    }
+
+    if (available == 0)
+    {
+      // The sink runs empty without new data, buffer again before continue.
+      // When idle, the stream is closed after it played the rest.
+      if (m_stream->GetDelay() < periodSeconds)
+      {
+        if (m_idle)
+        {
+          CloseStream();
+        }
+        else
+        {
+          m_underruns++;
+          m_drift.Reset();
+        }
+        buffering = true;
+      }
+      std::this_thread::sleep_for(pollInterval);
+      continue;
+    }
+
+    // Space is in frames of the sink, the ring has them at the rate of CEF
+    size_t space = m_stream->GetSpace() / frameSize;
+    if (m_resampling)
+      space = m_resampler.MaxInput(space);
+    if (space == 0)
+    {
+      std::this_thread::sleep_for(pollInterval);
+      continue;
+    }
+
+    if (gain != m_gain)
+    {
+      gain = m_gain;
+      m_stream->SetVolume(gain);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t consumed = m_consumedFrames;
+    float* const* data;
+    int64_t pts;
+    const size_t frames = Convert(std::min(available, space), data, pts);
+    m_stream->AddData(reinterpret_cast<uint8_t* const*>(data), 0, frames, pts);
+    m_capture.Write(data, frames);
+
+    const double delay = m_stream->GetDelay();
+    UpdateDrift(delay);
+    m_fillLevel.Add((static_cast<double>(m_ring.AvailableRead()) / m_sampleRate + delay) * 1000.0);
+    m_convertCpu += std::chrono::steady_clock::now() - start;
+    m_convertedFrames += m_consumedFrames - consumed;
+  }
+
+  if (!m_stream && m_closes > 0)
+    m_closedTime += std::chrono::steady_clock::now() - m_closedAt;
+  m_stream.reset();
+  m_capture.Close();
+}
@@ -0,0 +1,279 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "AudioOutput.h"
+#include "AudioRingBuffer.h"
+#include "AudioStats.h"
+#include "AudioTrace.h"
+#include "ChannelMixer.h"
+#include "DriftEstimator.h"
+#include "Resampler.h"
+#include "WavWriter.h"
+
+#include <atomic>
+#include <chrono>
+#include <kodi/AudioEngine.h>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*!
+ * @brief Audio of one browser from CEF to a stream of the audio output.
+ *
+ * CEF's audio thread only pushes the packets into a lock-free ring. A feeder
+ * thread opens the output stream and moves the frames from the ring into it,
+ * so every wait for the sink happens on the feeder.
+ *
+ * Playback starts after the ring holds the jitter buffer amount, and starts
+ * again in this way after an underrun.
+ *
+ * CEF delivers in its own layout, the feeder mixes it to the layout of the
+ * AudioEngine stream if they differ. With the resampler enabled it also
+ * converts to the rate of the sink, else AudioEngine does it.
+ *
+ * Instead of Start() the stream can also be used by CAudioMixer, which takes
+ * the converted frames with Pull() on its own thread.
+ *
+ * The drift of CEF's pts against the played frames is measured all the time
+ * and, if enabled, corrected by dropping or inserting single frames or by
+ * small changes of the resampling ratio.
+ *
+ * After the idle timeout of only silent packets they are no longer queued,
+ * and the feeder closes the AudioEngine stream once the sink has played the
+ * rest, so AudioEngine can suspend the sink. The next packet with sound opens
+ * it again, behind a short pre-roll of silence.
+ */
+class ATTRIBUTE_HIDDEN CAudioStream
+{
+public:
+  enum DriftCorrection
+  {
+    DRIFT_CORRECTION_OFF = 0,
+    DRIFT_CORRECTION_DROP_INSERT = 1,
+    DRIFT_CORRECTION_RESAMPLE = 2,
+  };
+
+  // Silence written into a newly opened AudioEngine stream before the sound
+  static constexpr unsigned int PRE_ROLL_MS = 30;
+
+  /*!
+   * @param[in] output Output the feeder opens its stream on
+   * @param[in] browserId Identifier of the browser, for logs
+   * @param[in] sourceLayout Channels of the CEF planes
+   * @param[in] sourceChannels Amount of CEF planes, can be more than mapped
+   * @param[in] format Format of the AudioEngine stream, planar float with
+   *                   the rate of CEF
+   * @param[in] jitterMs Amount buffered before playback starts
+   */
+  CAudioStream(std::shared_ptr<IAudioOutput> output,
+               int browserId,
+               const std::vector<AudioEngineChannel>& sourceLayout,
+               unsigned int sourceChannels,
+               const kodi::audioengine::AudioEngineFormat& format,
+               unsigned int jitterMs);
+  ~CAudioStream();
+
+  /*!
+   * @brief Resample in the feeder to the given rate, call before Start().
+   *
+   * @param[in] variable Allow ratio changes for drift correction, this
+   *                     resamples also if the rates are the same
+   * @return false if the ratio is not supported, the stream stays on the
+   *         rate of CEF then
+   */
+  bool EnableResampler(unsigned int outRate, CResampler::Quality quality, bool variable = false);
+
+  /*!
+   * @brief Set how drift is corrected, call before Start().
+   *
+   * Correction by resampling needs the variable resampler enabled, else
+   * frames are dropped and inserted.
+   */
+  void SetDriftCorrection(DriftCorrection mode);
+
+  /*!
+   * @brief Time of silence until the stream goes idle, 0 disables it. Call
+   * before Start().
+   */
+  void SetIdleTimeout(unsigned int timeoutMs);
+
+  /*!
+   * @brief Record the packets of CEF into the trace, call before Start().
+   */
+  void SetTrace(std::unique_ptr<CAudioTraceWriter> trace) { m_trace = std::move(trace); }
+
+  /*!
+   * @brief Capture all given to AudioEngine into a WAV file, call before
+   * Start().
+   */
+  void SetCapture(const std::string& path) { m_capturePath = path; }
+
+  void Start();
+  void Stop();
+
+  /*!
+   * @brief Give a packet of CEF into the ring, called on CEF's audio thread.
+   *
+   * Frames not fitting into the ring are dropped and counted as overrun.
+   */
+  void Push(const float** data, int frames, int64_t pts);
+
+  /*!
+   * @brief Add the time CEF's thread spent on a packet, on the same thread.
+   */
+  void AddPacketTime(std::chrono::nanoseconds time) { m_packetTimes.Add(time); }
+
+  /*!
+   * @brief Take converted frames in the format of the stream, for a mixer.
+   *
+   * @param[out] output One plane per channel of the stream format
+   * @param[in] frames Wanted frames
+   * @return Frames written, less while buffering or on an underrun
+   */
+  size_t Pull(float* const* output, size_t frames);
+
+  /*!
+   * @brief Check a Pull() of the frames gives all or nothing, so never runs
+   * into an underrun.
+   */
+  bool CanPull(size_t frames) const;
+
+  /*!
+   * @brief Only silence came for the idle timeout and all queued frames are
+   * taken.
+   */
+  bool IsIdle() const;
+
+  /*!
+   * @brief Volume of this browser, 0.0 is muted.
+   */
+  void SetGain(float gain) { m_gain = gain; }
+  float Gain() const { return m_gain; }
+
+  int BrowserId() const { return m_browserId; }
+  const kodi::audioengine::AudioEngineFormat& Format() const { return m_format; }
+
+  uint64_t Underruns() const { return m_underruns; }
+  uint64_t Overruns() const { return m_overruns; }
+  uint64_t DroppedFrames() const { return m_droppedFrames; }
+  uint64_t SkippedFrames() const { return m_skippedFrames; }
+
+  /*!
+   * @brief Audio in the ring and the sink, read after the stream stopped.
+   */
+  const CFillLevel& FillLevel() const { return m_fillLevel; }
+
+  /*!
+   * @brief Frames of CEF not yet taken by the reader.
+   */
+  size_t Queued() const { return m_ring.AvailableRead(); }
+
+  void LogPackets(const char* function) const;
+
+private:
+  void Process();
+  void CreateBuffers();
+  bool IsSilent(const float** data, int frames) const;
+  void OpenStream();
+  void CloseStream();
+  void LogIdle(const char* function);
+
+  /*!
+   * @brief Read up to the frames from the ring and convert them.
+   *
+   * @param[in] maxFrames Most frames to read, at the rate of CEF
+   * @param[out] data Planes with the result in the stream format
+   * @param[out] pts Time of the first result frame in ms
+   * @return Result frames
+   */
+  size_t Convert(size_t maxFrames, float* const*& data, int64_t& pts);
+
+  /*!
+   * @brief Feed the drift estimator and apply its correction.
+   *
+   * @param[in] queuedSeconds Converted audio not yet played
+   */
+  void UpdateDrift(double queuedSeconds);
+  void LogDrift(const char* function);
+
+  const int m_browserId;
+  kodi::audioengine::AudioEngineFormat m_format;
+  const unsigned int m_sourceChannels;
+  const unsigned int m_channels;
+  const unsigned int m_sampleRate;
+  const unsigned int m_periodFrames;
+  const size_t m_jitterFrames;
+
+  CAudioRingBuffer m_ring;
+  CChannelMixer m_mixer;
+  bool m_mixing = false;
+  CResampler m_resampler;
+  bool m_resampling = false;
+  std::shared_ptr<IAudioOutput> m_output;
+  std::unique_ptr<IAudioSink> m_stream;
+  std::thread m_thread;
+  std::atomic_bool m_running{false};
+  std::atomic<float> m_gain{1.0f};
+
+  // Work planes of the reading thread: as read, mixed and resampled
+  std::vector<std::vector<float>> m_planes;
+  std::vector<std::vector<float>> m_mixed;
+  std::vector<std::vector<float>> m_resampled;
+  std::vector<float*> m_planePointers;
+  std::vector<float*> m_mixedPointers;
+  std::vector<float*> m_resampledPointers;
+
+  // Converted frames not yet taken by Pull()
+  std::vector<std::vector<float>> m_pending;
+  bool m_buffering = true;
+
+  // Presentation time in ms behind the last pushed frame, a jump in the pts
+  // starts the drift measurement again
+  std::atomic<int64_t> m_endPts{0};
+  std::atomic_bool m_ptsJump{false};
+  bool m_pushed = false;
+
+  DriftCorrection m_driftCorrection = DRIFT_CORRECTION_OFF;
+  CDriftEstimator m_drift;
+  uint64_t m_consumedFrames = 0; // Read from the ring, dropped ones included
+  int m_dropInsert = 0;          // 1 drops, -1 inserts a frame per period
+  uint64_t m_droppedForDrift = 0;
+  uint64_t m_insertedForDrift = 0;
+  double m_nextDriftLog = 0.0;
+
+  // Written by Push() only, m_idle tells the feeder to close the stream
+  size_t m_idleTimeoutFrames = 0;
+  uint64_t m_silentFrames = 0;
+  std::atomic_bool m_idle{false};
+  std::atomic<uint64_t> m_skippedFrames{0};
+
+  // Idle statistics of the feeder, the saving is estimated from the cost
+  // per converted frame
+  std::chrono::steady_clock::time_point m_startTime;
+  std::chrono::steady_clock::time_point m_closedAt;
+  std::chrono::nanoseconds m_closedTime{0};
+  uint64_t m_closes = 0;
+  std::chrono::nanoseconds m_convertCpu{0};
+  uint64_t m_convertedFrames = 0;
+
+  // Diagnostics, the packet times are only written by CEF's thread and the
+  // fill level by the reader
+  std::unique_ptr<CAudioTraceWriter> m_trace;
+  std::string m_capturePath;
+  CWavWriter m_capture;
+  CLatencyHistogram m_packetTimes;
+  CFillLevel m_fillLevel;
+
+  std::atomic<uint64_t> m_underruns{0};
+  std::atomic<uint64_t> m_overruns{0};
+  std::atomic<uint64_t> m_droppedFrames{0};
+};
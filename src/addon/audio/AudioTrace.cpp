@@ -0,0 +1,316 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "AudioTrace.h"
+
+#include "AudioHandler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+
+namespace
+{
+
+constexpr char AUDIO_TRACE_MAGIC[4] = {'K', 'W', 'A', 'T'};
+
+constexpr double PI = 3.14159265358979323846;
+
+// Size where the collected records are written to file
+constexpr size_t WRITE_BLOCK_SIZE = 1024 * 1024;
+
+// Limits of a valid trace, to detect broken ones
+constexpr int MAX_TRACE_CHANNELS = 32;
+constexpr int MAX_TRACE_RATE = 768000;
+constexpr uint32_t MAX_TRACE_FRAMES = 1 << 20;
+
+// Identifier of the replayed stream, CEF's browser identifiers are positive
+constexpr int REPLAY_BROWSER_ID = -1;
+
+// Longest wait after the last packet until the reader took all
+constexpr auto REPLAY_TAIL = std::chrono::seconds(2);
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+bool CAudioTraceWriter::Open(const std::string& path, const CefAudioParameters& params, int channels)
+{
+  Close();
+
+  if (!m_file.OpenFileForWrite(path, true))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CAudioTraceWriter::%s: Failed to create trace '%s'", __func__,
+              path.c_str());
+    return false;
+  }
+
+  m_path = path;
+  m_open = true;
+  m_channels = channels;
+  m_start = std::chrono::steady_clock::now();
+  m_records = 0;
+  m_bytes = 0;
+
+  m_buffer.insert(m_buffer.end(), AUDIO_TRACE_MAGIC, AUDIO_TRACE_MAGIC + 4);
+  Put(AUDIO_TRACE_VERSION);
+  Put(static_cast<int32_t>(params.channel_layout));
+  Put(static_cast<int32_t>(params.sample_rate));
+  Put(static_cast<int32_t>(params.frames_per_buffer));
+  Put(static_cast<int32_t>(channels));
+
+  kodi::Log(ADDON_LOG_INFO, "CAudioTraceWriter::%s: Audio trace started on '%s'", __func__,
+            path.c_str());
+  return true;
+}
+
+void CAudioTraceWriter::Close()
+{
+  if (!m_open)
+    return;
+
+  Flush();
+  m_file.Close();
+  m_open = false;
+
+  kodi::Log(ADDON_LOG_INFO, "CAudioTraceWriter::%s: Audio trace '%s' closed, %llu records, %llu bytes",
+            __func__, m_path.c_str(), static_cast<unsigned long long>(m_records),
+            static_cast<unsigned long long>(m_bytes));
+}
+
+void CAudioTraceWriter::Record(const float** data, int frames, int64_t pts)
+{
+  if (!m_open || frames <= 0)
+    return;
+
+  const uint64_t time = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - m_start)
+                            .count();
+
+  Put(time);
+  Put(pts);
+  Put(static_cast<uint32_t>(frames));
+  for (int channel = 0; channel < m_channels; ++channel)
+  {
+    const uint8_t* samples = reinterpret_cast<const uint8_t*>(data[channel]);
+    m_buffer.insert(m_buffer.end(), samples, samples + frames * sizeof(float));
+  }
+
+  m_records++;
+  if (m_buffer.size() >= WRITE_BLOCK_SIZE)
+    Flush();
+}
+
+void CAudioTraceWriter::Flush()
+{
+  if (m_buffer.empty())
+    return;
+
+  if (m_file.Write(m_buffer.data(), m_buffer.size()) != static_cast<ssize_t>(m_buffer.size()))
+    kodi::Log(ADDON_LOG_ERROR, "CAudioTraceWriter::%s: Failed to write trace '%s'", __func__,
+              m_path.c_str());
+
+  m_bytes += m_buffer.size();
+  m_buffer.clear();
+}
+
+//------------------------------------------------------------------------------
+
+bool CAudioTraceReader::Open(const std::string& path)
+{
+  m_data.clear();
+  m_pos = 0;
+  m_channels = 0;
+
+  kodi::vfs::CFile file;
+  if (!file.OpenFile(path))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CAudioTraceReader::%s: Failed to open trace '%s'", __func__,
+              path.c_str());
+    return false;
+  }
+
+  const int64_t length = file.GetLength();
+  if (length > 0)
+  {
+    m_data.resize(static_cast<size_t>(length));
+    m_data.resize(std::max<ssize_t>(file.Read(m_data.data(), m_data.size()), 0));
+  }
+
+  char magic[4];
+  if (m_data.size() < sizeof(magic) || memcmp(m_data.data(), AUDIO_TRACE_MAGIC, sizeof(magic)) != 0)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CAudioTraceReader::%s: '%s' is no audio trace", __func__,
+              path.c_str());
+    return false;
+  }
+  m_pos = sizeof(magic);
+
+  uint32_t version;
+  int32_t layout, sampleRate, framesPerBuffer, channels;
+  if (!Get(version) || version != AUDIO_TRACE_VERSION || !Get(layout) || !Get(sampleRate) ||
+      !Get(framesPerBuffer) || !Get(channels) || channels <= 0 || channels > MAX_TRACE_CHANNELS ||
+      sampleRate <= 0 || sampleRate > MAX_TRACE_RATE)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CAudioTraceReader::%s: Unsupported version of audio trace '%s'",
+              __func__, path.c_str());
+    return false;
+  }
+
+  m_params.channel_layout = static_cast<cef_channel_layout_t>(layout);
+  m_params.sample_rate = sampleRate;
+  m_params.frames_per_buffer = framesPerBuffer;
+  m_channels = channels;
+  return true;
+}
+
+bool CAudioTraceReader::Next(AudioTraceRecord& record)
+{
+  uint32_t frames;
+  if (!Get(record.timeUs) || !Get(record.pts) || !Get(frames) || frames == 0 ||
+      frames > MAX_TRACE_FRAMES)
+    return false;
+
+  const size_t bytes = static_cast<size_t>(frames) * sizeof(float);
+  if (m_pos + bytes * m_channels > m_data.size())
+    return false;
+
+  record.frames = static_cast<int>(frames);
+  record.planes.resize(m_channels);
+  for (auto& plane : record.planes)
+  {
+    plane.resize(frames);
+    memcpy(plane.data(), m_data.data() + m_pos, bytes);
+    m_pos += bytes;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool CAudioTraceReplay::Run(const std::string& path, CAudioHandler& handler, Result& result)
+{
+  CAudioTraceReader reader;
+  if (!reader.Open(path))
+    return false;
+
+  Replay(handler, reader.Parameters(), reader.Channels(),
+         [&reader](AudioTraceRecord& record) { return reader.Next(record); }, result);
+  return true;
+}
+
+void CAudioTraceReplay::Run(const Synthetic& synthetic, CAudioHandler& handler, Result& result)
+{
+  const int rate = std::max(synthetic.params.sample_rate, 1);
+  const int frames = std::max(synthetic.params.frames_per_buffer, 1);
+  const uint64_t packets = static_cast<uint64_t>(synthetic.seconds * rate / frames);
+  const double periodUs = frames * 1e6 / rate;
+
+  // Fixed seed, every run sees the same cadence
+  std::mt19937 random(1);
+  std::uniform_real_distribution<double> jitter(-synthetic.jitterMs * 1000.0, synthetic.jitterMs * 1000.0);
+
+  uint64_t packet = 0;
+  uint64_t lastTimeUs = 0;
+  Replay(handler, synthetic.params, synthetic.channels,
+         [&](AudioTraceRecord& record) {
+           if (packet >= packets)
+             return false;
+
+           // Every channel with its own phase, so swapped channels are seen
+           record.frames = frames;
+           record.planes.resize(synthetic.channels);
+           for (int channel = 0; channel < synthetic.channels; ++channel)
+           {
+             record.planes[channel].resize(frames);
+             for (int i = 0; i < frames; ++i)
+             {
+               const double time = static_cast<double>(packet * frames + i) / rate;
+               record.planes[channel][i] = static_cast<float>(
+                   0.5 * std::sin(2.0 * PI * synthetic.frequency * time + channel * 0.5));
+             }
+           }
+
+           record.pts = static_cast<int64_t>(packet * frames * 1000 / rate);
+           const double timeUs = std::max(0.0, packet * periodUs + jitter(random));
+           record.timeUs = std::max(lastTimeUs, static_cast<uint64_t>(timeUs));
+           lastTimeUs = record.timeUs;
+           packet++;
+           return true;
+         },
+         result);
+}
+
+void CAudioTraceReplay::Replay(CAudioHandler& handler,
+                               const CefAudioParameters& params,
+                               int channels,
+                               const std::function<bool(AudioTraceRecord&)>& next,
+                               Result& result)
+{
+  result = Result();
+
+  handler.StreamStarted(REPLAY_BROWSER_ID, params, channels);
+  const std::shared_ptr<CAudioStream> stream = handler.GetStream(REPLAY_BROWSER_ID);
+
+  std::vector<const float*> planes;
+  AudioTraceRecord record;
+  const auto start = std::chrono::steady_clock::now();
+  while (next(record))
+  {
+    std::this_thread::sleep_until(start + std::chrono::microseconds(record.timeUs));
+
+    planes.clear();
+    for (const auto& plane : record.planes)
+      planes.push_back(plane.data());
+
+    const auto begin = std::chrono::steady_clock::now();
+    handler.StreamPacket(REPLAY_BROWSER_ID, planes.data(), record.frames, record.pts);
+    result.latency.Add(std::chrono::steady_clock::now() - begin);
+
+    result.packets++;
+    result.frames += record.frames;
+  }
+
+  // Stop like CEF does, before the sink runs empty
+  const auto tail = std::chrono::steady_clock::now() + REPLAY_TAIL;
+  while (stream && stream->Queued() > 0 && std::chrono::steady_clock::now() < tail)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  handler.StreamStopped(REPLAY_BROWSER_ID);
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  if (stream)
+  {
+    result.fillLevel = stream->FillLevel();
+    result.underruns = stream->Underruns();
+    result.overruns = stream->Overruns();
+  }
+}
+
+void CAudioTraceReplay::Log(const std::string& name, const Result& result)
+{
+  kodi::Log(ADDON_LOG_INFO,
+            "CAudioTraceReplay: %s: %llu packets, %llu frames in %.1f s, "
+            "handling p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us, "
+            "fill min %.1f ms, mean %.1f ms, max %.1f ms, %llu underruns, %llu overruns",
+            name.c_str(), static_cast<unsigned long long>(result.packets),
+            static_cast<unsigned long long>(result.frames), result.seconds,
+            result.latency.PercentileUs(50.0), result.latency.PercentileUs(90.0),
+            result.latency.PercentileUs(99.0), result.latency.MaxUs(), result.fillLevel.MinMs(),
+            result.fillLevel.MeanMs(), result.fillLevel.MaxMs(),
+            static_cast<unsigned long long>(result.underruns),
+            static_cast<unsigned long long>(result.overruns));
+
+  for (unsigned int bucket = 0; bucket < CLatencyHistogram::BUCKETS; ++bucket)
+  {
+    if (result.latency.BucketCount(bucket) > 0)
+      kodi::Log(ADDON_LOG_INFO, "CAudioTraceReplay: %s:   %10.1f .. %10.1f us: %llu", name.c_str(),
+                CLatencyHistogram::BucketUs(bucket), CLatencyHistogram::BucketUs(bucket + 1),
+                static_cast<unsigned long long>(result.latency.BucketCount(bucket)));
+  }
+}
@@ -0,0 +1,161 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "AudioStats.h"
+#include "include/cef_audio_handler.h"
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <kodi/Filesystem.h>
+#include <kodi/General.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class CAudioHandler;
+
+/*
+ * Trace of CEF's audio packets of one stream, to replay them through the
+ * audio handler.
+ *
+ * File layout, all values in host byte order:
+ *
+ *   Header:  char[4] "KWAT", uint32 version, int32 CEF channel layout,
+ *            int32 sample rate, int32 frames per buffer, int32 channels
+ *   Records: uint64 time in us since start, int64 pts in ms, uint32 frames,
+ *            then the float samples of every channel one plane after the other
+ */
+constexpr uint32_t AUDIO_TRACE_VERSION = 1;
+
+struct AudioTraceRecord
+{
+  uint64_t timeUs = 0;
+  int64_t pts = 0;
+  int frames = 0;
+  std::vector<std::vector<float>> planes;
+};
+
+class ATTRIBUTE_HIDDEN CAudioTraceWriter
+{
+public:
+  CAudioTraceWriter() = default;
+  ~CAudioTraceWriter() { Close(); }
+
+  bool Open(const std::string& path, const CefAudioParameters& params, int channels);
+  void Close();
+  bool IsOpen() const { return m_open; }
+
+  void Record(const float** data, int frames, int64_t pts);
+
+private:
+  template<typename T>
+  void Put(const T& value)
+  {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+    m_buffer.insert(m_buffer.end(), data, data + sizeof(T));
+  }
+  void Flush();
+
+  kodi::vfs::CFile m_file;
+  std::string m_path;
+  bool m_open = false;
+  int m_channels = 0;
+  std::chrono::steady_clock::time_point m_start;
+  std::vector<uint8_t> m_buffer;
+  uint64_t m_records = 0;
+  uint64_t m_bytes = 0;
+};
+
+class ATTRIBUTE_HIDDEN CAudioTraceReader
+{
+public:
+  CAudioTraceReader() = default;
+
+  bool Open(const std::string& path);
+  const CefAudioParameters& Parameters() const { return m_params; }
+  int Channels() const { return m_channels; }
+
+  /*!
+   * @brief Read the next record.
+   *
+   * @return false on end of trace or on a broken record
+   */
+  bool Next(AudioTraceRecord& record);
+
+private:
+  template<typename T>
+  bool Get(T& value)
+  {
+    if (m_pos + sizeof(T) > m_data.size())
+      return false;
+    memcpy(&value, m_data.data() + m_pos, sizeof(T));
+    m_pos += sizeof(T);
+    return true;
+  }
+
+  std::vector<uint8_t> m_data;
+  size_t m_pos = 0;
+  CefAudioParameters m_params;
+  int m_channels = 0;
+};
+
+/*!
+ * @brief Feed a trace or generated packets through the audio handler, at the
+ * times they came from CEF.
+ *
+ * The stream is set up with the current audio settings like one of a
+ * browser, so with performance.audio_capture the result can be compared
+ * against the input sample by sample.
+ */
+class ATTRIBUTE_HIDDEN CAudioTraceReplay
+{
+public:
+  struct Result
+  {
+    uint64_t packets = 0;
+    uint64_t frames = 0;
+    double seconds = 0.0;
+    CLatencyHistogram latency; // Handling time of every packet
+    CFillLevel fillLevel;      // Ring and sink, as seen by the feeder
+    uint64_t underruns = 0;
+    uint64_t overruns = 0;
+  };
+
+  /*!
+   * @brief Sine packets with a jittered cadence, the same on every run.
+   */
+  struct Synthetic
+  {
+    CefAudioParameters params;
+    int channels = 2;
+    double seconds = 10.0;
+    double frequency = 1000.0;
+    double jitterMs = 2.0;
+  };
+
+  /*!
+   * @param[in] path Trace file
+   * @param[in] handler Handler to feed, its browsers are not touched
+   * @param[out] result Collected values
+   * @return true if the trace was readable
+   */
+  static bool Run(const std::string& path, CAudioHandler& handler, Result& result);
+  static void Run(const Synthetic& synthetic, CAudioHandler& handler, Result& result);
+
+  static void Log(const std::string& name, const Result& result);
+
+private:
+  static void Replay(CAudioHandler& handler,
+                     const CefAudioParameters& params,
+                     int channels,
+                     const std::function<bool(AudioTraceRecord&)>& next,
+                     Result& result);
+};
@@ -0,0 +1,259 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "ChannelLayout.h"
+
+#include <algorithm>
+
+namespace
+{
+
+constexpr unsigned int MAX_LAYOUT_CHANNELS = 8;
+
+struct LayoutEntry
+{
+  cef_channel_layout_t layout;
+  unsigned int count;
+  AudioEngineChannel channels[MAX_LAYOUT_CHANNELS];
+};
+
+#define CH(name) AUDIOENGINE_CH_##name
+
+// Channel order as used by Chromium for the planes of a layout
+constexpr LayoutEntry LAYOUTS[] = {
+    {CEF_CHANNEL_LAYOUT_MONO, 1, {CH(FC)}},
+    {CEF_CHANNEL_LAYOUT_STEREO, 2, {CH(FL), CH(FR)}},
+    {CEF_CHANNEL_LAYOUT_2_1, 3, {CH(FL), CH(FR), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_SURROUND, 3, {CH(FL), CH(FR), CH(FC)}},
+    {CEF_CHANNEL_LAYOUT_4_0, 4, {CH(FL), CH(FR), CH(FC), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_2_2, 4, {CH(FL), CH(FR), CH(SL), CH(SR)}},
+    {CEF_CHANNEL_LAYOUT_QUAD, 4, {CH(FL), CH(FR), CH(BL), CH(BR)}},
+    {CEF_CHANNEL_LAYOUT_5_0, 5, {CH(FL), CH(FR), CH(FC), CH(SL), CH(SR)}},
+    {CEF_CHANNEL_LAYOUT_5_1, 6, {CH(FL), CH(FR), CH(FC), CH(LFE), CH(SL), CH(SR)}},
+    {CEF_CHANNEL_LAYOUT_5_0_BACK, 5, {CH(FL), CH(FR), CH(FC), CH(BL), CH(BR)}},
+    {CEF_CHANNEL_LAYOUT_5_1_BACK, 6, {CH(FL), CH(FR), CH(FC), CH(LFE), CH(BL), CH(BR)}},
+    {CEF_CHANNEL_LAYOUT_7_0, 7, {CH(FL), CH(FR), CH(FC), CH(SL), CH(SR), CH(BL), CH(BR)}},
+    {CEF_CHANNEL_LAYOUT_7_1, 8, {CH(FL), CH(FR), CH(FC), CH(LFE), CH(SL), CH(SR), CH(BL), CH(BR)}},
+    {CEF_CHANNEL_LAYOUT_7_1_WIDE, 8, {CH(FL), CH(FR), CH(FC), CH(LFE), CH(SL), CH(SR), CH(FLOC), CH(FROC)}},
+    {CEF_CHANNEL_LAYOUT_STEREO_DOWNMIX, 2, {CH(FL), CH(FR)}},
+    {CEF_CHANNEL_LAYOUT_2POINT1, 3, {CH(FL), CH(FR), CH(LFE)}},
+    {CEF_CHANNEL_LAYOUT_3_1, 4, {CH(FL), CH(FR), CH(FC), CH(LFE)}},
+    {CEF_CHANNEL_LAYOUT_4_1, 5, {CH(FL), CH(FR), CH(FC), CH(LFE), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_6_0, 6, {CH(FL), CH(FR), CH(FC), CH(SL), CH(SR), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_6_0_FRONT, 6, {CH(FL), CH(FR), CH(SL), CH(SR), CH(FLOC), CH(FROC)}},
+    {CEF_CHANNEL_LAYOUT_HEXAGONAL, 6, {CH(FL), CH(FR), CH(FC), CH(BL), CH(BR), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_6_1, 7, {CH(FL), CH(FR), CH(FC), CH(LFE), CH(SL), CH(SR), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_6_1_BACK, 7, {CH(FL), CH(FR), CH(FC), CH(LFE), CH(BL), CH(BR), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_6_1_FRONT, 7, {CH(FL), CH(FR), CH(SL), CH(SR), CH(FLOC), CH(FROC), CH(LFE)}},
+    {CEF_CHANNEL_LAYOUT_7_0_FRONT, 7, {CH(FL), CH(FR), CH(FC), CH(SL), CH(SR), CH(FLOC), CH(FROC)}},
+    {CEF_CHANNEL_LAYOUT_7_1_WIDE_BACK, 8, {CH(FL), CH(FR), CH(FC), CH(LFE), CH(BL), CH(BR), CH(FLOC), CH(FROC)}},
+    {CEF_CHANNEL_LAYOUT_OCTAGONAL, 8, {CH(FL), CH(FR), CH(FC), CH(SL), CH(SR), CH(BL), CH(BR), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_STEREO_AND_KEYBOARD_MIC, 3, {CH(FL), CH(FR), CH(NULL)}},
+    {CEF_CHANNEL_LAYOUT_4_1_QUAD_SIDE, 5, {CH(FL), CH(FR), CH(SL), CH(SR), CH(LFE)}},
+};
+
+// Layouts without speaker mapping, the streams get the default order
+constexpr cef_channel_layout_t UNMAPPED_LAYOUTS[] = {
+    CEF_CHANNEL_LAYOUT_NONE,
+    CEF_CHANNEL_LAYOUT_UNSUPPORTED,
+    CEF_CHANNEL_LAYOUT_DISCRETE,
+    CEF_CHANNEL_LAYOUT_BITSTREAM,
+};
+
+// Chromium's order for streams without layout
+constexpr AudioEngineChannel DEFAULT_ORDER[MAX_LAYOUT_CHANNELS] = {
+    CH(FL), CH(FR), CH(FC), CH(LFE), CH(SL), CH(SR), CH(BL), CH(BR)};
+
+#undef CH
+
+// Checks of the table, done by the compiler
+constexpr bool ValidEntry(const LayoutEntry& entry)
+{
+  if (entry.count == 0 || entry.count > MAX_LAYOUT_CHANNELS)
+    return false;
+
+  for (unsigned int i = 0; i < MAX_LAYOUT_CHANNELS; ++i)
+  {
+    // Used channels are set and unique, the rest stays unset
+    const bool used = i < entry.count;
+    if (used != (entry.channels[i] != AUDIOENGINE_CH_RAW))
+      return false;
+    for (unsigned int j = 0; used && j < i; ++j)
+    {
+      if (entry.channels[i] == entry.channels[j] && entry.channels[i] != AUDIOENGINE_CH_NULL)
+        return false;
+    }
+  }
+  return true;
+}
+
+constexpr bool ValidTable()
+{
+  for (const LayoutEntry& entry : LAYOUTS)
+  {
+    if (!ValidEntry(entry))
+      return false;
+  }
+  return true;
+}
+
+constexpr bool UniqueLayouts()
+{
+  for (size_t i = 0; i < sizeof(LAYOUTS) / sizeof(LAYOUTS[0]); ++i)
+  {
+    for (size_t j = 0; j < i; ++j)
+    {
+      if (LAYOUTS[i].layout == LAYOUTS[j].layout)
+        return false;
+    }
+  }
+  return true;
+}
+
+constexpr bool InTable(cef_channel_layout_t layout)
+{
+  for (const LayoutEntry& entry : LAYOUTS)
+  {
+    if (entry.layout == layout)
+      return true;
+  }
+  return false;
+}
+
+constexpr bool Unmapped(cef_channel_layout_t layout)
+{
+  for (cef_channel_layout_t unmapped : UNMAPPED_LAYOUTS)
+  {
+    if (unmapped == layout)
+      return true;
+  }
+  return false;
+}
+
+// Every layout of CEF is either mapped or known as unmapped, so a layout
+// added by a CEF update fails here until it is handled
+constexpr bool AllLayoutsCovered()
+{
+  for (int layout = 0; layout <= CEF_CHANNEL_LAYOUT_MAX; ++layout)
+  {
+    const cef_channel_layout_t value = static_cast<cef_channel_layout_t>(layout);
+    if (InTable(value) == Unmapped(value))
+      return false;
+  }
+  return true;
+}
+
+static_assert(AUDIOENGINE_CH_RAW == 0, "unset table entries must be AUDIOENGINE_CH_RAW");
+static_assert(ValidTable(), "channel layout table has a wrong count or a double channel");
+static_assert(UniqueLayouts(), "channel layout table has a layout twice");
+static_assert(AllLayoutsCovered(), "a CEF channel layout is neither mapped nor known as unmapped");
+static_assert(sizeof(LAYOUTS) / sizeof(LAYOUTS[0]) + sizeof(UNMAPPED_LAYOUTS) / sizeof(UNMAPPED_LAYOUTS[0]) ==
+                  CEF_CHANNEL_LAYOUT_MAX + 1,
+              "channel layout tables have an entry which is no CEF layout");
+
+// Layouts CEF can be asked for, stereo downmix is a matrix encoded stereo and
+// the keyboard mic no speaker
+constexpr bool Requestable(const LayoutEntry& entry)
+{
+  return entry.layout != CEF_CHANNEL_LAYOUT_STEREO_DOWNMIX &&
+         entry.layout != CEF_CHANNEL_LAYOUT_STEREO_AND_KEYBOARD_MIC;
+}
+
+bool HasChannel(const std::vector<AudioEngineChannel>& channels, AudioEngineChannel channel)
+{
+  return std::find(channels.begin(), channels.end(), channel) != channels.end();
+}
+
+} // namespace
+
+namespace ChannelMap
+{
+
+bool ToChannels(cef_channel_layout_t layout, std::vector<AudioEngineChannel>& channels)
+{
+  for (const LayoutEntry& entry : LAYOUTS)
+  {
+    if (entry.layout == layout)
+    {
+      channels.assign(entry.channels, entry.channels + entry.count);
+      return true;
+    }
+  }
+
+  channels.clear();
+  return false;
+}
+
+cef_channel_layout_t FromChannels(const std::vector<AudioEngineChannel>& channels)
+{
+  if (channels.size() == 1)
+    return CEF_CHANNEL_LAYOUT_MONO;
+
+  // First match, so stereo is preferred over stereo downmix
+  for (const LayoutEntry& entry : LAYOUTS)
+  {
+    if (entry.count == channels.size() &&
+        std::equal(channels.begin(), channels.end(), entry.channels))
+      return entry.layout;
+  }
+
+  return CEF_CHANNEL_LAYOUT_NONE;
+}
+
+cef_channel_layout_t ForSink(const std::vector<AudioEngineChannel>& sinkChannels)
+{
+  if (!IsPCM(sinkChannels))
+    return CEF_CHANNEL_LAYOUT_STEREO;
+
+  // Exact layout of the sink, nothing to do on our side
+  const cef_channel_layout_t exact = FromChannels(sinkChannels);
+  if (exact != CEF_CHANNEL_LAYOUT_NONE)
+    return exact;
+
+  // Otherwise the smallest layout with all sink channels, our mixer drops the
+  // rest. Without one the layout which reaches most sink channels.
+  const LayoutEntry* covering = nullptr;
+  const LayoutEntry* closest = nullptr;
+  unsigned int closestHits = 0;
+  for (const LayoutEntry& entry : LAYOUTS)
+  {
+    if (!Requestable(entry))
+      continue;
+
+    unsigned int hits = 0;
+    for (unsigned int i = 0; i < entry.count; ++i)
+      hits += HasChannel(sinkChannels, entry.channels[i]) ? 1 : 0;
+
+    if (hits == sinkChannels.size() && (!covering || entry.count < covering->count))
+      covering = &entry;
+    if (hits > closestHits || (closest && hits == closestHits && entry.count < closest->count))
+    {
+      closest = &entry;
+      closestHits = hits;
+    }
+  }
+
+  if (covering)
+    return covering->layout;
+  return closest ? closest->layout : CEF_CHANNEL_LAYOUT_STEREO;
+}
+
+std::vector<AudioEngineChannel> DefaultChannels(unsigned int count)
+{
+  return std::vector<AudioEngineChannel>(DEFAULT_ORDER,
+                                         DEFAULT_ORDER + std::min(count, MAX_LAYOUT_CHANNELS));
+}
+
+bool IsPCM(const std::vector<AudioEngineChannel>& channels)
+{
+  return !channels.empty() && std::none_of(channels.begin(), channels.end(), [](AudioEngineChannel channel) {
+    return channel <= AUDIOENGINE_CH_RAW || channel >= AUDIOENGINE_CH_MAX;
+  });
+}
+
+} // namespace ChannelMap
@@ -0,0 +1,64 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "include/cef_audio_handler.h"
+
+#include <kodi/AudioEngine.h>
+#include <vector>
+
+/*!
+ * @brief Mapping between CEF channel layouts and AudioEngine channels.
+ *
+ * Both directions use the same table, where the channel order of every layout
+ * is the order of the planes given by CEF.
+ */
+namespace ChannelMap
+{
+
+/*!
+ * @brief Get the AudioEngine channels of a CEF layout.
+ *
+ * Planes which are not for playback, like the keyboard mic of
+ * CEF_CHANNEL_LAYOUT_STEREO_AND_KEYBOARD_MIC, are AUDIOENGINE_CH_NULL.
+ *
+ * @return false if the layout has no fixed speaker mapping (e.g. discrete)
+ */
+bool ToChannels(cef_channel_layout_t layout, std::vector<AudioEngineChannel>& channels);
+
+/*!
+ * @brief Get the CEF layout with exactly the given channels in this order.
+ *
+ * A single channel is always mono.
+ *
+ * @return CEF_CHANNEL_LAYOUT_NONE if there is no such layout
+ */
+cef_channel_layout_t FromChannels(const std::vector<AudioEngineChannel>& channels);
+
+/*!
+ * @brief Get the layout CEF should deliver for a sink.
+ *
+ * That is the layout of the sink itself if CEF has it, else the smallest one
+ * with all channels of the sink, so CEF mixes nothing away and the remaining
+ * mix to the sink is done by CChannelMixer. Sinks without PCM get stereo.
+ */
+cef_channel_layout_t ForSink(const std::vector<AudioEngineChannel>& sinkChannels);
+
+/*!
+ * @brief Channels used for streams without speaker mapping, in the order of
+ * Chromium's channel layouts. More than 8 channels are not mapped.
+ */
+std::vector<AudioEngineChannel> DefaultChannels(unsigned int count);
+
+/*!
+ * @brief Check the channels can be played as PCM (no raw or unknown entries).
+ */
+bool IsPCM(const std::vector<AudioEngineChannel>& channels);
+
+} // namespace ChannelMap
@@ -0,0 +1,202 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "ChannelMixer.h"
+#include "AudioKernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+constexpr float EQUAL_POWER = 0.7071067811865476f;
+
+#define CH(name) AUDIOENGINE_CH_##name
+
+// Where a channel missing in the output goes, the first rule where all
+// targets are present in the output is used
+struct FoldRule
+{
+  AudioEngineChannel source;
+  AudioEngineChannel targets[2];
+  float scale;
+};
+
+constexpr FoldRule FOLD_RULES[] = {
+    {CH(FL), {CH(FC), CH(NULL)}, EQUAL_POWER},
+    {CH(FR), {CH(FC), CH(NULL)}, EQUAL_POWER},
+    {CH(FC), {CH(FL), CH(FR)}, EQUAL_POWER},
+    {CH(LFE), {CH(FC), CH(NULL)}, 1.0f},
+    {CH(LFE), {CH(FL), CH(FR)}, EQUAL_POWER},
+    {CH(SL), {CH(BL), CH(NULL)}, 1.0f},
+    {CH(SL), {CH(BC), CH(NULL)}, EQUAL_POWER},
+    {CH(SL), {CH(FL), CH(NULL)}, EQUAL_POWER},
+    {CH(SL), {CH(FC), CH(NULL)}, 0.5f},
+    {CH(SR), {CH(BR), CH(NULL)}, 1.0f},
+    {CH(SR), {CH(BC), CH(NULL)}, EQUAL_POWER},
+    {CH(SR), {CH(FR), CH(NULL)}, EQUAL_POWER},
+    {CH(SR), {CH(FC), CH(NULL)}, 0.5f},
+    {CH(BL), {CH(SL), CH(NULL)}, 1.0f},
+    {CH(BL), {CH(BC), CH(NULL)}, EQUAL_POWER},
+    {CH(BL), {CH(FL), CH(NULL)}, EQUAL_POWER},
+    {CH(BL), {CH(FC), CH(NULL)}, 0.5f},
+    {CH(BR), {CH(SR), CH(NULL)}, 1.0f},
+    {CH(BR), {CH(BC), CH(NULL)}, EQUAL_POWER},
+    {CH(BR), {CH(FR), CH(NULL)}, EQUAL_POWER},
+    {CH(BR), {CH(FC), CH(NULL)}, 0.5f},
+    {CH(BC), {CH(BL), CH(BR)}, EQUAL_POWER},
+    {CH(BC), {CH(SL), CH(SR)}, EQUAL_POWER},
+    {CH(BC), {CH(FL), CH(FR)}, 0.5f},
+    {CH(BC), {CH(FC), CH(NULL)}, EQUAL_POWER},
+    {CH(FLOC), {CH(FL), CH(NULL)}, 1.0f},
+    {CH(FLOC), {CH(FC), CH(NULL)}, EQUAL_POWER},
+    {CH(FROC), {CH(FR), CH(NULL)}, 1.0f},
+    {CH(FROC), {CH(FC), CH(NULL)}, EQUAL_POWER},
+    {CH(BLOC), {CH(BL), CH(NULL)}, 1.0f},
+    {CH(BLOC), {CH(SL), CH(NULL)}, 1.0f},
+    {CH(BLOC), {CH(FL), CH(NULL)}, EQUAL_POWER},
+    {CH(BROC), {CH(BR), CH(NULL)}, 1.0f},
+    {CH(BROC), {CH(SR), CH(NULL)}, 1.0f},
+    {CH(BROC), {CH(FR), CH(NULL)}, EQUAL_POWER},
+    {CH(TFL), {CH(FL), CH(NULL)}, EQUAL_POWER},
+    {CH(TFR), {CH(FR), CH(NULL)}, EQUAL_POWER},
+    {CH(TFC), {CH(FC), CH(NULL)}, EQUAL_POWER},
+    {CH(TFC), {CH(FL), CH(FR)}, 0.5f},
+    {CH(TC), {CH(FC), CH(NULL)}, EQUAL_POWER},
+    {CH(TC), {CH(FL), CH(FR)}, 0.5f},
+    {CH(TBL), {CH(BL), CH(NULL)}, EQUAL_POWER},
+    {CH(TBL), {CH(SL), CH(NULL)}, EQUAL_POWER},
+    {CH(TBL), {CH(FL), CH(NULL)}, 0.5f},
+    {CH(TBR), {CH(BR), CH(NULL)}, EQUAL_POWER},
+    {CH(TBR), {CH(SR), CH(NULL)}, EQUAL_POWER},
+    {CH(TBR), {CH(FR), CH(NULL)}, 0.5f},
+    {CH(TBC), {CH(BC), CH(NULL)}, EQUAL_POWER},
+    {CH(TBC), {CH(FL), CH(FR)}, 0.5f},
+};
+
+#undef CH
+
+} // namespace
+
+void CChannelMixer::Configure(const std::vector<AudioEngineChannel>& input,
+                              const std::vector<AudioEngineChannel>& output,
+                              bool normalize)
+{
+  m_inputs = static_cast<unsigned int>(input.size());
+  m_outputs = static_cast<unsigned int>(output.size());
+  m_matrix.assign(m_outputs * m_inputs, 0.0f);
+
+  auto outputIndex = [&output](AudioEngineChannel channel) {
+    const auto it = std::find(output.begin(), output.end(), channel);
+    return it != output.end() ? static_cast<int>(it - output.begin()) : -1;
+  };
+
+  for (unsigned int in = 0; in < m_inputs; ++in)
+  {
+    const AudioEngineChannel channel = input[in];
+
+    // Planes which are not for playback, e.g. a keyboard mic
+    if (channel == AUDIOENGINE_CH_NULL)
+      continue;
+
+    const int direct = outputIndex(channel);
+    if (direct >= 0)
+    {
+      m_matrix[direct * m_inputs + in] = 1.0f;
+      continue;
+    }
+
+    // Mono is copied to the front pair
+    if (m_inputs == 1 && outputIndex(AUDIOENGINE_CH_FL) >= 0 && outputIndex(AUDIOENGINE_CH_FR) >= 0)
+    {
+      m_matrix[outputIndex(AUDIOENGINE_CH_FL) * m_inputs + in] = 1.0f;
+      m_matrix[outputIndex(AUDIOENGINE_CH_FR) * m_inputs + in] = 1.0f;
+      continue;
+    }
+
+    bool folded = false;
+    for (const FoldRule& rule : FOLD_RULES)
+    {
+      if (rule.source != channel)
+        continue;
+
+      const int first = outputIndex(rule.targets[0]);
+      const int second = rule.targets[1] != AUDIOENGINE_CH_NULL ? outputIndex(rule.targets[1]) : -2;
+      if (first < 0 || second == -1)
+        continue;
+
+      m_matrix[first * m_inputs + in] += rule.scale;
+      if (second >= 0)
+        m_matrix[second * m_inputs + in] += rule.scale;
+      folded = true;
+      break;
+    }
+
+    // Layouts without any usable neighbour get it on the first channel
+    if (!folded && m_outputs > 0)
+      m_matrix[in] += EQUAL_POWER;
+  }
+
+  if (normalize)
+  {
+    float maxSum = 0.0f;
+    for (unsigned int out = 0; out < m_outputs; ++out)
+    {
+      float sum = 0.0f;
+      for (unsigned int in = 0; in < m_inputs; ++in)
+        sum += m_matrix[out * m_inputs + in];
+      maxSum = std::max(maxSum, sum);
+    }
+
+    if (maxSum > 1.0f)
+    {
+      for (float& coefficient : m_matrix)
+        coefficient /= maxSum;
+    }
+  }
+
+  m_identity = m_inputs == m_outputs;
+  for (unsigned int out = 0; m_identity && out < m_outputs; ++out)
+  {
+    for (unsigned int in = 0; in < m_inputs; ++in)
+    {
+      if (m_matrix[out * m_inputs + in] != (in == out ? 1.0f : 0.0f))
+      {
+        m_identity = false;
+        break;
+      }
+    }
+  }
+}
+
+void CChannelMixer::Process(const float* const* input, float* const* output, size_t frames) const
+{
+  for (unsigned int out = 0; out < m_outputs; ++out)
+  {
+    const float* row = &m_matrix[out * m_inputs];
+    bool written = false;
+    for (unsigned int in = 0; in < m_inputs; ++in)
+    {
+      const float coefficient = row[in];
+      if (coefficient == 0.0f)
+        continue;
+
+      if (written)
+        AudioKernels::MulAdd(output[out], input[in], coefficient, frames);
+      else if (coefficient == 1.0f)
+        memcpy(output[out], input[in], frames * sizeof(float));
+      else
+        AudioKernels::Scale(output[out], input[in], coefficient, frames);
+      written = true;
+    }
+
+    if (!written)
+      memset(output[out], 0, frames * sizeof(float));
+  }
+}
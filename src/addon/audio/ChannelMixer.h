@@ -0,0 +1,58 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include <kodi/AudioEngine.h>
+#include <stddef.h>
+#include <vector>
+
+/*!
+ * @brief Down- and upmix of planar float audio with a mixing matrix.
+ *
+ * The matrix follows the rules of Chromium's channel mixer: channels missing
+ * in the output are folded into their nearest neighbours, mono input is
+ * copied to front left and right. With normalize are all coefficients scaled
+ * down so no output channel sums up above 1.0.
+ */
+class ATTRIBUTE_HIDDEN CChannelMixer
+{
+public:
+  CChannelMixer() = default;
+
+  void Configure(const std::vector<AudioEngineChannel>& input,
+                 const std::vector<AudioEngineChannel>& output,
+                 bool normalize = true);
+
+  /*!
+   * @brief Mix the frames, input and output must not overlap.
+   *
+   * @param[in] input One plane per input channel
+   * @param[out] output One plane per output channel
+   * @param[in] frames Frames per plane
+   */
+  void Process(const float* const* input, float* const* output, size_t frames) const;
+
+  bool IsIdentity() const { return m_identity; }
+  unsigned int InputChannels() const { return m_inputs; }
+  unsigned int OutputChannels() const { return m_outputs; }
+
+  /*!
+   * @brief Coefficient of an input channel in an output channel.
+   */
+  float Coefficient(unsigned int output, unsigned int input) const
+  {
+    return m_matrix[output * m_inputs + input];
+  }
+
+private:
+  unsigned int m_inputs = 0;
+  unsigned int m_outputs = 0;
+  bool m_identity = true;
+  std::vector<float> m_matrix; // Row per output channel
+};
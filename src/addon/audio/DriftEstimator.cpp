@@ -0,0 +1,91 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "DriftEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// Smoothing of the packet and period steps in the offset
+constexpr double FILTER_SECONDS = 1.0;
+
+// Played time before the reference is taken
+constexpr double SETTLE_SECONDS = 3.0;
+
+// A 10 ms error gives 1000 ppm, the integral takes the clock difference
+constexpr double PROPORTIONAL = 1.0 / 10.0;
+constexpr double INTEGRAL = PROPORTIONAL / 20.0;
+
+// Below 3.5 cent pitch change
+constexpr double MAX_CORRECTION = 0.002;
+
+// Interval and smoothing of the trend
+constexpr double TREND_INTERVAL_SECONDS = 1.0;
+constexpr double TREND_FILTER_SECONDS = 30.0;
+
+} // namespace
+
+void CDriftEstimator::Reset()
+{
+  // The clock difference stays the same, only the offset is taken new
+  const double integral = m_integral;
+  const double correction = m_correction;
+  const double trend = m_trend;
+  *this = CDriftEstimator();
+  m_integral = integral;
+  m_correction = correction;
+  m_trend = trend;
+}
+
+void CDriftEstimator::Update(double sourceSeconds, double playedSeconds)
+{
+  const double offset = sourceSeconds - playedSeconds;
+  if (!m_started)
+  {
+    m_started = true;
+    m_lastPlayed = playedSeconds;
+    m_filtered = offset;
+    return;
+  }
+
+  const double delta = playedSeconds - m_lastPlayed;
+  if (delta <= 0.0)
+    return;
+  m_lastPlayed = playedSeconds;
+
+  m_filtered += (offset - m_filtered) * (1.0 - std::exp(-delta / FILTER_SECONDS));
+  m_elapsed += delta;
+  if (!m_locked)
+  {
+    if (m_elapsed >= SETTLE_SECONDS)
+    {
+      m_locked = true;
+      m_reference = m_filtered;
+      m_trendTime = m_elapsed;
+    }
+    return;
+  }
+
+  const double error = m_filtered - m_reference;
+  m_integral = std::min(std::max(m_integral + error * delta, -MAX_CORRECTION / INTEGRAL),
+                        MAX_CORRECTION / INTEGRAL);
+  m_correction = std::min(std::max(PROPORTIONAL * error + INTEGRAL * m_integral, -MAX_CORRECTION),
+                          MAX_CORRECTION);
+
+  if (m_elapsed - m_trendTime >= TREND_INTERVAL_SECONDS)
+  {
+    const double interval = m_elapsed - m_trendTime;
+    const double slope = (error - m_trendError) / interval;
+    m_trend += (slope - m_trend) * (1.0 - std::exp(-interval / TREND_FILTER_SECONDS));
+    m_trendError = error;
+    m_trendTime = m_elapsed;
+  }
+}
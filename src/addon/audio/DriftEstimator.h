@@ -0,0 +1,70 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include <kodi/AudioEngine.h>
+
+/*!
+ * @brief Drift between the media clock of CEF and the clock of the sink.
+ *
+ * The offset is the pts of CEF behind the last pushed frame minus the source
+ * time played by the sink. It holds the buffered audio and stays constant if
+ * both clocks run at the same speed. After a settle time the filtered offset
+ * is taken as reference, and a PI controller gives the correction to keep it.
+ */
+class ATTRIBUTE_HIDDEN CDriftEstimator
+{
+public:
+  CDriftEstimator() = default;
+
+  /*!
+   * @brief Start again, e.g. after an underrun or a jump in the pts.
+   *
+   * The learned correction is kept, it is a property of the two clocks.
+   */
+  void Reset();
+
+  /*!
+   * @param[in] sourceSeconds Media time of CEF behind the last pushed frame
+   * @param[in] playedSeconds Media time of CEF the sink has played
+   */
+  void Update(double sourceSeconds, double playedSeconds);
+
+  bool Locked() const { return m_locked; }
+
+  /*!
+   * @brief Filtered offset against the reference, positive if the sink falls
+   * behind CEF.
+   */
+  double Error() const { return m_locked ? m_filtered - m_reference : 0.0; }
+
+  /*!
+   * @brief Change of the error per second of audio, as parts per million.
+   */
+  double TrendPpm() const { return m_trend * 1e6; }
+
+  /*!
+   * @brief Ratio change for a resampler, above 1.0 means CEF runs faster.
+   */
+  double Correction() const { return 1.0 + m_correction; }
+
+private:
+  bool m_started = false;
+  bool m_locked = false;
+  double m_lastPlayed = 0.0;
+  double m_elapsed = 0.0;
+  double m_filtered = 0.0;
+  double m_reference = 0.0;
+  double m_integral = 0.0;
+  double m_correction = 0.0;
+
+  double m_trend = 0.0;
+  double m_trendError = 0.0;
+  double m_trendTime = 0.0;
+};
@@ -0,0 +1,274 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "Resampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAS_RESAMPLE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAS_RESAMPLE_NEON 1
+#endif
+
+namespace
+{
+
+// M_PI is no standard C++ and missing on MSVC without _USE_MATH_DEFINES
+constexpr double PI = 3.14159265358979323846;
+
+constexpr unsigned int MAX_TAPS = 512;
+
+// Most change of the ratio in variable mode
+constexpr double MAX_RATIO_ADJUST = 0.01;
+
+struct QualityPreset
+{
+  unsigned int taps; // Filter length without downsampling
+  double beta;       // Kaiser window, sets the stopband attenuation
+  double rolloff;    // Passband end relative to the lower Nyquist rate
+};
+
+// About 60, 85 and 100 dB stopband attenuation
+constexpr QualityPreset PRESETS[] = {
+    {16, 6.0, 0.90},
+    {32, 8.0, 0.94},
+    {64, 10.0, 0.96},
+};
+
+unsigned int Gcd(unsigned int a, unsigned int b)
+{
+  while (b != 0)
+  {
+    const unsigned int rest = a % b;
+    a = b;
+    b = rest;
+  }
+  return a;
+}
+
+double BesselI0(double x)
+{
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 32; ++k)
+  {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+    if (term < sum * 1e-12)
+      break;
+  }
+  return sum;
+}
+
+float Dot(const float* a, const float* b, unsigned int count)
+{
+  unsigned int i = 0;
+  float sum = 0.0f;
+#if defined(HAS_RESAMPLE_SSE2)
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  for (; i + 8 <= count; i += 8)
+  {
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+  for (; i + 4 <= count; i += 4)
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+  acc0 = _mm_add_ps(acc0, acc1);
+  acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+  acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+  sum = _mm_cvtss_f32(acc0);
+#elif defined(HAS_RESAMPLE_NEON)
+  float32x4_t acc = vdupq_n_f32(0.0f);
+  for (; i + 4 <= count; i += 4)
+    acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+  const float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+  sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+  for (; i < count; ++i)
+    sum += a[i] * b[i];
+  return sum;
+}
+
+} // namespace
+
+bool CResampler::Configure(unsigned int channels,
+                           unsigned int inRate,
+                           unsigned int outRate,
+                           Quality quality,
+                           bool variable)
+{
+  m_channels = 0;
+  m_filters.clear();
+  m_history.clear();
+  if (channels == 0 || inRate == 0 || outRate == 0)
+    return false;
+
+  const unsigned int divisor = Gcd(inRate, outRate);
+  m_channels = channels;
+  m_inRate = inRate;
+  m_outRate = outRate;
+  m_up = outRate / divisor;
+  m_down = inRate / divisor;
+  m_variable = variable || m_up > MAX_PHASES;
+
+  const QualityPreset& preset =
+      PRESETS[std::min(std::max(static_cast<int>(quality), 1), 3) - 1];
+
+  // On downsampling the cutoff goes down, the filter gets longer by the same
+  // amount to keep the transition band
+  const double ratio = std::min(1.0, static_cast<double>(outRate) / inRate);
+  m_taps = static_cast<unsigned int>(std::ceil(preset.taps / ratio));
+  m_taps = std::min((m_taps + 3) & ~3u, MAX_TAPS);
+
+  // The variable mode needs the filter after the last phase to interpolate
+  CreateFilters(m_variable ? VARIABLE_PHASES + 1 : m_up, preset.rolloff * ratio, preset.beta);
+
+  m_history.resize(m_channels);
+  SetRatioAdjust(1.0);
+  Reset();
+  return true;
+}
+
+void CResampler::CreateFilters(unsigned int phases, double cutoff, double beta)
+{
+  const unsigned int steps = m_variable ? VARIABLE_PHASES : m_up;
+  const int half = m_taps / 2;
+  const double windowNorm = BesselI0(beta);
+  m_filters.resize(static_cast<size_t>(phases) * m_taps);
+  for (unsigned int phase = 0; phase < phases; ++phase)
+  {
+    // Output lies between tap half-1 and half, by the phase fraction
+    const double fraction = static_cast<double>(phase) / steps;
+    float* filter = &m_filters[static_cast<size_t>(phase) * m_taps];
+    double sum = 0.0;
+    for (unsigned int tap = 0; tap < m_taps; ++tap)
+    {
+      const double x = static_cast<double>(tap) - (half - 1) - fraction;
+      const double arg = PI * cutoff * x;
+      const double sinc = x == 0.0 ? 1.0 : std::sin(arg) / arg;
+      const double relative = x / half;
+      const double window =
+          relative * relative >= 1.0
+              ? 0.0
+              : BesselI0(beta * std::sqrt(1.0 - relative * relative)) / windowNorm;
+      filter[tap] = static_cast<float>(sinc * window);
+      sum += filter[tap];
+    }
+
+    // Unity gain for every phase, else the phases modulate the level
+    for (unsigned int tap = 0; tap < m_taps; ++tap)
+      filter[tap] = static_cast<float>(filter[tap] / sum);
+  }
+}
+
+void CResampler::SetRatioAdjust(double adjust)
+{
+  if (m_outRate == 0)
+    return;
+
+  adjust = std::min(std::max(adjust, 1.0 - MAX_RATIO_ADJUST), 1.0 + MAX_RATIO_ADJUST);
+  const double step = static_cast<double>(m_inRate) / m_outRate * adjust;
+  m_step = static_cast<uint64_t>(std::llround(step * 4294967296.0));
+}
+
+void CResampler::Reset()
+{
+  // Silence before the first frame, so the first output is at its time
+  for (auto& history : m_history)
+    history.assign(m_taps / 2 - 1, 0.0f);
+  m_position = 0;
+  m_phase = 0;
+  m_fraction = 0;
+}
+
+size_t CResampler::Process(const float* const* input, size_t inFrames, float* const* output)
+{
+  if (m_channels == 0)
+    return 0;
+
+  for (unsigned int channel = 0; channel < m_channels; ++channel)
+    m_history[channel].insert(m_history[channel].end(), input[channel], input[channel] + inFrames);
+
+  const size_t length = m_history[0].size();
+  size_t frames = 0;
+  if (m_variable)
+  {
+    // Top bits of the fraction select the phase, the rest weights the next
+    constexpr unsigned int PHASE_SHIFT = 32 - 8;
+    static_assert(VARIABLE_PHASES == 1u << (32 - PHASE_SHIFT), "phase bits do not match");
+    while (m_position + m_taps <= length)
+    {
+      const unsigned int phase = m_fraction >> PHASE_SHIFT;
+      const float weight =
+          static_cast<float>(m_fraction & ((1u << PHASE_SHIFT) - 1)) / (1u << PHASE_SHIFT);
+      const float* filter = &m_filters[static_cast<size_t>(phase) * m_taps];
+      for (unsigned int channel = 0; channel < m_channels; ++channel)
+      {
+        const float* history = &m_history[channel][m_position];
+        const float first = Dot(filter, history, m_taps);
+        const float second = Dot(filter + m_taps, history, m_taps);
+        output[channel][frames] = first + (second - first) * weight;
+      }
+      frames++;
+
+      const uint64_t next = m_fraction + m_step;
+      m_position += static_cast<size_t>(next >> 32);
+      m_fraction = static_cast<uint32_t>(next);
+    }
+  }
+  else
+  {
+    while (m_position + m_taps <= length)
+    {
+      const float* filter = &m_filters[static_cast<size_t>(m_phase) * m_taps];
+      for (unsigned int channel = 0; channel < m_channels; ++channel)
+        output[channel][frames] = Dot(filter, &m_history[channel][m_position], m_taps);
+      frames++;
+
+      m_phase += m_down;
+      m_position += m_phase / m_up;
+      m_phase %= m_up;
+    }
+  }
+
+  // Keep only what the next outputs still need
+  const size_t consumed = std::min(m_position, length);
+  for (auto& history : m_history)
+    history.erase(history.begin(), history.begin() + consumed);
+  m_position -= consumed;
+
+  return frames;
+}
+
+size_t CResampler::MaxOutput(size_t inFrames) const
+{
+  // Room for the smallest step SetRatioAdjust() can set
+  if (m_variable)
+    return static_cast<size_t>(static_cast<double>(inFrames) * m_outRate /
+                               (m_inRate * (1.0 - MAX_RATIO_ADJUST))) + 2;
+  return inFrames * m_up / m_down + 2;
+}
+
+size_t CResampler::MaxInput(size_t outFrames) const
+{
+  if (outFrames <= 2)
+    return 0;
+  if (m_variable)
+    return static_cast<size_t>((static_cast<double>(outFrames - 2) * m_step) / 4294967296.0);
+  return (outFrames - 2) * m_down / m_up;
+}
+
+double CResampler::Delay() const
+{
+  return m_inRate > 0 ? (m_taps / 2) * 1000.0 / m_inRate : 0.0;
+}
@@ -0,0 +1,112 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include <kodi/AudioEngine.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/*!
+ * @brief Polyphase resampler for planar float audio.
+ *
+ * The rate ratio is used as exact fraction L/M, with one Kaiser windowed sinc
+ * filter for each of the L phases. Every output frame is one dot product of
+ * the filter length, done with SSE2 or NEON where present.
+ *
+ * Ratios needing more than MAX_PHASES filters, or a stream where the ratio
+ * is adjusted by SetRatioAdjust(), use the variable mode: VARIABLE_PHASES
+ * filters with linear interpolation between the two nearest.
+ */
+class ATTRIBUTE_HIDDEN CResampler
+{
+public:
+  enum Quality
+  {
+    QUALITY_LOW = 1,
+    QUALITY_MEDIUM = 2,
+    QUALITY_HIGH = 3,
+  };
+
+  static constexpr unsigned int MAX_PHASES = 1024;
+  static constexpr unsigned int VARIABLE_PHASES = 256;
+
+  CResampler() = default;
+
+  /*!
+   * @brief Create the filters, clears all stored frames.
+   *
+   * @param[in] variable Use the variable mode, also for equal rates
+   * @return false on invalid values
+   */
+  bool Configure(unsigned int channels,
+                 unsigned int inRate,
+                 unsigned int outRate,
+                 Quality quality,
+                 bool variable = false);
+
+  /*!
+   * @brief Change the ratio by a factor close to 1.0, variable mode only.
+   *
+   * Above 1.0 is more input used per output frame. Limited to +-1%.
+   */
+  void SetRatioAdjust(double adjust);
+
+  /*!
+   * @brief Convert a block, all input frames are consumed.
+   *
+   * @param[in] input One plane per channel
+   * @param[in] inFrames Frames per input plane
+   * @param[out] output One plane per channel, with room for MaxOutput(inFrames)
+   * @return Frames written per output plane
+   */
+  size_t Process(const float* const* input, size_t inFrames, float* const* output);
+
+  /*!
+   * @brief Most output frames a block of input frames can give.
+   */
+  size_t MaxOutput(size_t inFrames) const;
+
+  /*!
+   * @brief Most input frames where the output fits into outFrames.
+   */
+  size_t MaxInput(size_t outFrames) const;
+
+  /*!
+   * @brief Delay of the filter in milliseconds.
+   */
+  double Delay() const;
+
+  void Reset();
+
+  unsigned int Taps() const { return m_taps; }
+  unsigned int Phases() const { return m_variable ? VARIABLE_PHASES : m_up; }
+  bool IsVariable() const { return m_variable; }
+
+private:
+  void CreateFilters(unsigned int phases, double cutoff, double beta);
+
+  unsigned int m_channels = 0;
+  unsigned int m_inRate = 0;
+  unsigned int m_outRate = 0;
+  unsigned int m_up = 1;   // L, phases
+  unsigned int m_down = 1; // M, input step per output in 1/L
+  unsigned int m_taps = 0;
+  bool m_variable = false;
+  std::vector<float> m_filters; // m_taps per phase, phase after phase
+
+  // Input frames not fully used yet, with the filter history before them
+  std::vector<std::vector<float>> m_history;
+  size_t m_position = 0;    // First history frame of the next output
+  unsigned int m_phase = 0; // Fraction of the next output in 1/L
+
+  // Variable mode, input step and fraction of the next output in 1/2^32
+  uint64_t m_step = 0;
+  uint32_t m_fraction = 0;
+};
@@ -0,0 +1,137 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "WavWriter.h"
+
+#include <algorithm>
+
+namespace
+{
+
+// Samples collected before they are written to file
+constexpr size_t WRITE_BLOCK_SAMPLES = 256 * 1024;
+
+// Largest data chunk the 32 bit sizes of the header can describe
+constexpr uint64_t MAX_DATA_BYTES = 0xffffffffull - 58;
+
+constexpr uint16_t WAVE_FORMAT_IEEE_FLOAT = 3;
+
+template<typename T>
+void Put(std::vector<uint8_t>& header, T value)
+{
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+  header.insert(header.end(), data, data + sizeof(T));
+}
+
+void PutTag(std::vector<uint8_t>& header, const char* tag)
+{
+  header.insert(header.end(), tag, tag + 4);
+}
+
+} // namespace
+
+bool CWavWriter::Open(const std::string& path, unsigned int channels, unsigned int sampleRate)
+{
+  Close();
+
+  if (channels == 0 || sampleRate == 0 || !m_file.OpenFileForWrite(path, true))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CWavWriter::%s: Failed to create capture '%s'", __func__,
+              path.c_str());
+    return false;
+  }
+
+  m_path = path;
+  m_open = true;
+  m_channels = channels;
+  m_sampleRate = sampleRate;
+  m_dataBytes = 0;
+  m_buffer.reserve(WRITE_BLOCK_SAMPLES + channels);
+  WriteHeader(0);
+
+  kodi::Log(ADDON_LOG_INFO, "CWavWriter::%s: Audio capture started on '%s' (%u channels, %u Hz)",
+            __func__, path.c_str(), channels, sampleRate);
+  return true;
+}
+
+void CWavWriter::Close()
+{
+  if (!m_open)
+    return;
+
+  Flush();
+  m_file.Seek(0, SEEK_SET);
+  WriteHeader(static_cast<uint32_t>(std::min(m_dataBytes, MAX_DATA_BYTES)));
+  m_file.Close();
+  m_open = false;
+
+  kodi::Log(ADDON_LOG_INFO, "CWavWriter::%s: Audio capture '%s' closed, %.1f s",
+            __func__, m_path.c_str(),
+            static_cast<double>(m_dataBytes) / (sizeof(float) * m_channels * m_sampleRate));
+}
+
+void CWavWriter::Write(const float* const* planes, size_t frames)
+{
+  if (!m_open)
+    return;
+
+  for (size_t frame = 0; frame < frames; ++frame)
+  {
+    for (unsigned int channel = 0; channel < m_channels; ++channel)
+      m_buffer.push_back(planes[channel][frame]);
+
+    if (m_buffer.size() >= WRITE_BLOCK_SAMPLES)
+      Flush();
+  }
+}
+
+void CWavWriter::WriteHeader(uint32_t dataBytes)
+{
+  // RIFF is little endian, as are all hosts Kodi runs on
+  const uint32_t frameBytes = sizeof(float) * m_channels;
+  std::vector<uint8_t> header;
+  PutTag(header, "RIFF");
+  Put<uint32_t>(header, 4 + (8 + 18) + (8 + 4) + 8 + dataBytes);
+  PutTag(header, "WAVE");
+
+  PutTag(header, "fmt ");
+  Put<uint32_t>(header, 18);
+  Put<uint16_t>(header, WAVE_FORMAT_IEEE_FLOAT);
+  Put<uint16_t>(header, static_cast<uint16_t>(m_channels));
+  Put<uint32_t>(header, m_sampleRate);
+  Put<uint32_t>(header, m_sampleRate * frameBytes);
+  Put<uint16_t>(header, static_cast<uint16_t>(frameBytes));
+  Put<uint16_t>(header, 32);
+  Put<uint16_t>(header, 0);
+
+  // Required for all formats besides integer PCM
+  PutTag(header, "fact");
+  Put<uint32_t>(header, 4);
+  Put<uint32_t>(header, dataBytes / frameBytes);
+
+  PutTag(header, "data");
+  Put<uint32_t>(header, dataBytes);
+
+  if (m_file.Write(header.data(), header.size()) != static_cast<ssize_t>(header.size()))
+    kodi::Log(ADDON_LOG_ERROR, "CWavWriter::%s: Failed to write capture '%s'", __func__,
+              m_path.c_str());
+}
+
+void CWavWriter::Flush()
+{
+  if (m_buffer.empty())
+    return;
+
+  const size_t bytes = m_buffer.size() * sizeof(float);
+  if (m_file.Write(m_buffer.data(), bytes) != static_cast<ssize_t>(bytes))
+    kodi::Log(ADDON_LOG_ERROR, "CWavWriter::%s: Failed to write capture '%s'", __func__,
+              m_path.c_str());
+
+  m_dataBytes += bytes;
+  m_buffer.clear();
+}
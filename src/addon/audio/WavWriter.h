@@ -0,0 +1,48 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include <kodi/AudioEngine.h>
+#include <kodi/Filesystem.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*!
+ * @brief Capture of planar float audio into a 32 bit float WAV file.
+ *
+ * The samples are written interleaved and unchanged, so the file holds
+ * exactly the values given to AudioEngine. The sizes in the header are set
+ * on Close().
+ */
+class ATTRIBUTE_HIDDEN CWavWriter
+{
+public:
+  CWavWriter() = default;
+  ~CWavWriter() { Close(); }
+
+  bool Open(const std::string& path, unsigned int channels, unsigned int sampleRate);
+  void Close();
+  bool IsOpen() const { return m_open; }
+
+  void Write(const float* const* planes, size_t frames);
+
+private:
+  void WriteHeader(uint32_t dataBytes);
+  void Flush();
+
+  kodi::vfs::CFile m_file;
+  std::string m_path;
+  bool m_open = false;
+  unsigned int m_channels = 0;
+  unsigned int m_sampleRate = 0;
+  std::vector<float> m_buffer;
+  uint64_t m_dataBytes = 0;
+};
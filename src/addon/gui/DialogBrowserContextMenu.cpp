@@ -169,11 +169,20 @@ bool CBrowerDialogContextMenu::OnContextMenuCommand(CefRefPtr<CefBrowser> browse
       m_client->OpenWebsite(params->GetLinkUrl().ToString());
       break;
     case CLIENT_ID_OPEN_SELECTED_SIDE_IN_NEW_TAB:
-      m_client->RequestOpenSiteInNewTab(params->GetLinkUrl().ToString());
+    {
+      CefRefPtr<CWebBrowserClient> client = m_client;
+      const std::string url = params->GetLinkUrl().ToString();
+      m_client->RunOnMainThread([client, url]() { client->RequestOpenSiteInNewTab(url); });
       break;
+    }
     case CLIENT_ID_OPEN_KEYBOARD:
-      m_client->GetMain().GetGUIManager().GetKeyboard().Show(m_client, CEF_TEXT_INPUT_MODE_DEFAULT);
+    {
+      CefRefPtr<CWebBrowserClient> client = m_client;
+      m_client->RunOnMainThread([client]() {
+        client->GetMain().GetGUIManager().GetKeyboard().Show(client, CEF_TEXT_INPUT_MODE_DEFAULT);
+      });
       break;
+    }
     default:
       return false;
   }
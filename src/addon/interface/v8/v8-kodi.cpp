@@ -8,6 +8,7 @@
 
 #include "v8-kodi.h"
 #include "WebBrowserClient.h"
+#include "addon.h"
 
 #include <kodi/General.h>
 
@@ -41,5 +42,20 @@ bool CV8Kodi::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefProcess
     kodi::QueueNotification(type, header, text, imageFile, displayTime, withSound, messageTime);
     return true;
   }
+  else if (funcName == "SetAudioVolume")
+  {
+    CefRefPtr<CAudioHandler> audioHandler = m_client->GetMain().GetAudioHandler();
+    if (audioHandler)
+      audioHandler->SetBrowserGain(browser->GetIdentifier(),
+                                   static_cast<float>(message->GetArgumentList()->GetDouble(1)));
+    return true;
+  }
+  else if (funcName == "SetAudioMuted")
+  {
+    CefRefPtr<CAudioHandler> audioHandler = m_client->GetMain().GetAudioHandler();
+    if (audioHandler)
+      audioHandler->SetBrowserMuted(browser->GetIdentifier(), message->GetArgumentList()->GetBool(1));
+    return true;
+  }
   return false;
 }
@@ -0,0 +1,149 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "DirtyRectOptimizer.h"
+
+#include <algorithm>
+#include <utility>
+
+void CDirtyRectOptimizer::SetCosts(int callOverheadPixels, float fullUploadRatio)
+{
+  m_callOverheadPixels = std::max(0, callOverheadPixels);
+  m_fullUploadRatio = std::min(std::max(fullUploadRatio, 0.0f), 1.0f);
+}
+
+bool CDirtyRectOptimizer::Optimize(const CefRenderHandler::RectList& dirtyRects,
+                                   int viewWidth,
+                                   int viewHeight,
+                                   CefRenderHandler::RectList& uploadRects)
+{
+  uploadRects.clear();
+  m_inputRects += dirtyRects.size();
+
+  if (viewWidth <= 0 || viewHeight <= 0)
+    return false;
+
+  for (const auto& rect : dirtyRects)
+  {
+    CefRect clipped = rect;
+    if (Clip(clipped, viewWidth, viewHeight))
+      uploadRects.push_back(clipped);
+  }
+
+  // Too much for pairwise check, reduce them first by merge inside the grid
+  // cells. Stopped with four cells left, the rest are rectangles which are
+  // cheaper to upload separate.
+  const int largestCell = std::max(viewWidth, viewHeight) / 2;
+  for (int cellSize = MERGE_CELL_SIZE;
+       uploadRects.size() > MAX_MERGE_RECTS && cellSize <= largestCell; cellSize *= 2)
+    MergeInCells(uploadRects, cellSize);
+
+  if (uploadRects.size() <= MAX_MERGE_RECTS)
+  {
+    while (MergePass(uploadRects))
+    {
+    }
+  }
+
+  int64_t covered = 0;
+  for (const auto& rect : uploadRects)
+    covered += Area(rect);
+
+  const CefRect view(0, 0, viewWidth, viewHeight);
+  if (!uploadRects.empty() && covered >= static_cast<int64_t>(m_fullUploadRatio * Area(view)))
+  {
+    uploadRects.assign(1, view);
+    m_fullUploads++;
+    m_outputRects++;
+    return true;
+  }
+
+  m_outputRects += uploadRects.size();
+  return false;
+}
+
+CefRect CDirtyRectOptimizer::Union(const CefRect& a, const CefRect& b)
+{
+  const int x = std::min(a.x, b.x);
+  const int y = std::min(a.y, b.y);
+  const int right = std::max(a.x + a.width, b.x + b.width);
+  const int bottom = std::max(a.y + a.height, b.y + b.height);
+  return CefRect(x, y, right - x, bottom - y);
+}
+
+bool CDirtyRectOptimizer::Clip(CefRect& rect, int viewWidth, int viewHeight)
+{
+  const int x = std::max(rect.x, 0);
+  const int y = std::max(rect.y, 0);
+  const int right = std::min(rect.x + rect.width, viewWidth);
+  const int bottom = std::min(rect.y + rect.height, viewHeight);
+  if (right <= x || bottom <= y)
+    return false;
+
+  rect = CefRect(x, y, right - x, bottom - y);
+  return true;
+}
+
+void CDirtyRectOptimizer::MergeInCells(CefRenderHandler::RectList& rects, int cellSize) const
+{
+  // Sorted by the cell of the rectangle center, the rectangles of a cell
+  // follow each other
+  const auto cell = [cellSize](const CefRect& rect) {
+    return std::make_pair((rect.y + rect.height / 2) / cellSize,
+                          (rect.x + rect.width / 2) / cellSize);
+  };
+  std::stable_sort(rects.begin(), rects.end(),
+                   [&cell](const CefRect& a, const CefRect& b) { return cell(a) < cell(b); });
+
+  CefRenderHandler::RectList merged;
+  CefRenderHandler::RectList group;
+  for (size_t start = 0; start < rects.size();)
+  {
+    size_t end = start + 1;
+    while (end < rects.size() && cell(rects[end]) == cell(rects[start]))
+      ++end;
+
+    group.assign(rects.begin() + start, rects.begin() + end);
+    while (MergePass(group))
+    {
+    }
+    merged.insert(merged.end(), group.begin(), group.end());
+    start = end;
+  }
+
+  rects.swap(merged);
+}
+
+bool CDirtyRectOptimizer::MergePass(CefRenderHandler::RectList& rects) const
+{
+  bool changed = false;
+  for (size_t i = 0; i < rects.size(); ++i)
+  {
+    size_t j = i + 1;
+    while (j < rects.size())
+    {
+      const CefRect merged = Union(rects[i], rects[j]);
+      const int64_t mergedCost = m_callOverheadPixels + Area(merged);
+      const int64_t separateCost = 2 * m_callOverheadPixels + Area(rects[i]) + Area(rects[j]);
+      if (mergedCost <= separateCost)
+      {
+        rects[i] = merged;
+        rects.erase(rects.begin() + j);
+        // The grown rectangle can reach already checked ones
+        j = i + 1;
+        changed = true;
+      }
+      else
+      {
+        ++j;
+      }
+    }
+  }
+
+  return changed;
+}
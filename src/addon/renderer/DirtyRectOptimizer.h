@@ -0,0 +1,98 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "include/cef_render_handler.h"
+
+#include <kodi/General.h>
+#include <stdint.h>
+
+/*!
+ * @brief Reduce the dirty rectangles given by CEF on paint to a smaller set of
+ * upload regions.
+ *
+ * Every texture upload call has a fixed cost (state changes, driver validation,
+ * transfer setup), where a merged rectangle costs the transferred pixels which
+ * were not dirty. Two rectangles are merged if the bounding box of them is
+ * cheaper to upload than both separate:
+ *
+ *   overhead + area(bounds) <= 2 * overhead + area(a) + area(b)
+ *
+ * Above MAX_MERGE_RECTS rectangles (spinners, tickers, scattered glyphs) the
+ * pairwise check becomes too expensive. The rectangles are then merged first
+ * only with the ones in the same cell of a coarse grid, with growing cells
+ * until few enough are left for the pairwise check.
+ *
+ * If after merging the result covers more than the configured ratio of the
+ * view, it is cheaper to upload the whole view with one call.
+ *
+ * The class has no dependency to a render system and can be used by every
+ * IRenderer implementation.
+ */
+class CDirtyRectOptimizer
+{
+public:
+  CDirtyRectOptimizer() = default;
+
+  /*!
+   * @param[in] callOverheadPixels Cost of one upload call, given as amount of
+   *                               pixels which can be transferred at same time
+   * @param[in] fullUploadRatio Covered part of view (0.0 - 1.0) where the
+   *                            whole view becomes uploaded
+   */
+  void SetCosts(int callOverheadPixels, float fullUploadRatio);
+
+  /*!
+   * @brief Create the optimized upload rectangle list.
+   *
+   * @param[in] dirtyRects The rectangles reported by CEF
+   * @param[in] viewWidth Width of the view
+   * @param[in] viewHeight Height of the view
+   * @param[out] uploadRects The rectangles to upload, clipped to view. They
+   *                         can still overlap, where the union of two costs
+   *                         more than both separate (e.g. a cross shape)
+   * @return true if the whole view should be uploaded, in this case contains
+   *         uploadRects one rectangle with full view size
+   */
+  bool Optimize(const CefRenderHandler::RectList& dirtyRects,
+                int viewWidth,
+                int viewHeight,
+                CefRenderHandler::RectList& uploadRects);
+
+  /// Statistic values since creation
+  //@{
+  uint64_t InputRects() const { return m_inputRects; }
+  uint64_t OutputRects() const { return m_outputRects; }
+  uint64_t FullUploads() const { return m_fullUploads; }
+  //@}
+
+private:
+  static int64_t Area(const CefRect& rect)
+  {
+    return static_cast<int64_t>(rect.width) * rect.height;
+  }
+  static CefRect Union(const CefRect& a, const CefRect& b);
+  static bool Clip(CefRect& rect, int viewWidth, int viewHeight);
+
+  bool MergePass(CefRenderHandler::RectList& rects) const;
+  void MergeInCells(CefRenderHandler::RectList& rects, int cellSize) const;
+
+  // Rect amount from where pairwise merge becomes too expensive
+  static constexpr size_t MAX_MERGE_RECTS = 64;
+
+  // Cell size of the first grid used above MAX_MERGE_RECTS, doubled per round
+  static constexpr int MERGE_CELL_SIZE = 128;
+
+  int64_t m_callOverheadPixels = 4096;
+  float m_fullUploadRatio = 0.7f;
+
+  uint64_t m_inputRects = 0;
+  uint64_t m_outputRects = 0;
+  uint64_t m_fullUploads = 0;
+};
@@ -8,26 +8,21 @@
 
 #include "IRenderer.h"
 
-#include "WebBrowserClient.h"
+// Cost of one texture upload call, expressed as amount of pixels (64x64)
+#define UPLOAD_CALL_OVERHEAD_PIXELS 4096
 
-#include <kodi/General.h>
-
-IRenderer::IRenderer(CefRefPtr<CWebBrowserClient> client)
-  : m_client(client),
-    m_viewWidth(0),
-    m_viewHeight(0)
+IRenderer::IRenderer(const RendererConfig& config)
+  : m_viewWidth(0),
+    m_viewHeight(0),
+    m_useTileHash(config.tileHash)
 {
-  uint32_t color = m_client->GetBackgroundColorARGB();
+  uint32_t color = config.backgroundColor;
   m_backgroundColor[3] = float(CefColorGetA(color)) / 255.0f;
   m_backgroundColor[2] = float(CefColorGetR(color)) / 255.0f;
   m_backgroundColor[1] = float(CefColorGetG(color)) / 255.0f;
   m_backgroundColor[0] = float(CefColorGetB(color)) / 255.0f;
-  m_useTransparentBackground = m_client->UseTransparentBackground();
-}
-
-void IRenderer::ClearClient()
-{
-  m_client = nullptr;
+  m_useTransparentBackground = config.transparentBackground;
+  m_rectOptimizer.SetCosts(UPLOAD_CALL_OVERHEAD_PIXELS, config.fullUploadRatio);
 }
 
 void IRenderer::OnPopupShow(CefRefPtr<CefBrowser> browser, bool show)
@@ -44,7 +39,22 @@ void IRenderer::OnPopupSize(CefRefPtr<CefBrowser> browser, const CefRect& rect)
   if (rect.width <= 0 || rect.height <= 0)
     return;
   m_originalPopupRect = rect;
-  m_popupRect = GetPopupRectInWebView(m_originalPopupRect);
+  m_popupRect = GetPopupRectInWebView(ScaleToBuffer(m_originalPopupRect));
+}
+
+void IRenderer::SetRenderScale(float scale)
+{
+  m_renderScale = scale;
+  if (!m_originalPopupRect.IsEmpty())
+    m_popupRect = GetPopupRectInWebView(ScaleToBuffer(m_originalPopupRect));
+  SetDirty();
+}
+
+CefRect IRenderer::ScaleToBuffer(const CefRect& rect)
+{
+  return CefRect(static_cast<int>(rect.x * m_renderScale), static_cast<int>(rect.y * m_renderScale),
+                 static_cast<int>(rect.width * m_renderScale + 0.5f),
+                 static_cast<int>(rect.height * m_renderScale + 0.5f));
 }
 
 CefRect IRenderer::GetPopupRectInWebView(const CefRect& original_rect)
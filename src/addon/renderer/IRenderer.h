@@ -8,18 +8,29 @@
 
 #pragma once
 
+#include "DirtyRectOptimizer.h"
 #include "include/cef_render_handler.h"
 
-class CWebBrowserClient;
+#include <stdint.h>
+
+/*!
+ * @brief Appearance and settings of a renderer, given by CRendererClient so
+ * the renderers need neither the client nor Kodi's settings.
+ */
+struct RendererConfig
+{
+  uint32_t backgroundColor = 0xFFFFFFFF; // ARGB
+  bool transparentBackground = false;
+  float fullUploadRatio = 0.7f; // performance.full_upload_ratio
+  bool tileHash = false; // performance.tile_hash
+};
 
 class IRenderer
 {
 public:
-  IRenderer(CefRefPtr<CWebBrowserClient> client);
+  IRenderer(const RendererConfig& config);
   virtual ~IRenderer() = default;
 
-  void ClearClient();
-
   virtual void OnPaint(CefBrowserHost::PaintElementType type, const CefRenderHandler::RectList& dirtyRects, const void* buffer, int width, int height) { }
   virtual void OnAcceleratedPaint(CefBrowserHost::PaintElementType type, const CefRenderHandler::RectList& dirtyRects, void* shared_handle) { }
   void SetDirty() { m_dirty = true; }
@@ -32,24 +43,70 @@ public:
   virtual void Deinitialize() { }
   virtual void Render() { }
   virtual void ScreenSizeChange(float x, float y, float width, float height) { }
+
+  /*!
+   * @brief Free textures and buffers while the control is parked inactive.
+   *
+   * Resume() creates them again, the view must be painted completely then.
+   */
+  virtual void Suspend() { Deinitialize(); }
+  virtual bool Resume() { m_viewWidth = 0; m_viewHeight = 0; SetDirty(); return Initialize(); }
+
+  /*!
+   * @brief Bytes of texture and buffer memory currently allocated.
+   */
+  virtual size_t AllocatedBytes() const { return 0; }
   virtual void OnPopupShow(CefRefPtr<CefBrowser> browser, bool show);
   virtual void OnPopupSize(CefRefPtr<CefBrowser> browser, const CefRect& rect);
 
+  /*!
+   * @brief Scale of the painted buffers against the control size, below 1.0
+   * is the view upscaled on render.
+   *
+   * The popup rectangle of CEF is in view coordinates and scaled with it to
+   * the buffer.
+   */
+  void SetRenderScale(float scale);
+
+  /*!
+   * @brief Sum of bytes and calls uploaded by the backend, e.g. for replay of
+   * paint traces.
+   */
+  uint64_t UploadedBytes() const { return m_uploadedBytes; }
+  uint64_t UploadCalls() const { return m_uploadCalls; }
+
   bool m_dirty = true;
   int m_viewWidth;
   int m_viewHeight;
   CefRect m_updateRect;
 
 protected:
+  bool OptimizeDirtyRects(const CefRenderHandler::RectList& dirtyRects,
+                          CefRenderHandler::RectList& uploadRects)
+  {
+    return m_rectOptimizer.Optimize(dirtyRects, m_viewWidth, m_viewHeight, uploadRects);
+  }
+
+  void CountUpload(uint64_t bytes, uint64_t calls)
+  {
+    m_uploadedBytes += bytes;
+    m_uploadCalls += calls;
+  }
+
+  CDirtyRectOptimizer m_rectOptimizer;
   bool m_useTransparentBackground;
   float m_backgroundColor[4];
+  const bool m_useTileHash;
   CefRect m_popupRect;
   CefRect m_originalPopupRect;
+  float m_renderScale = 1.0f;
 
 private:
-  CefRefPtr<CWebBrowserClient> m_client;
+  uint64_t m_uploadedBytes = 0;
+  uint64_t m_uploadCalls = 0;
 
   CefRect GetPopupRectInWebView(const CefRect& original_rect);
+  CefRect ScaleToBuffer(const CefRect& rect);
   void ClearPopupRects();
 };
 
@@ -0,0 +1,327 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "PaintTrace.h"
+
+#include "IRenderer.h"
+
+#include <algorithm>
+
+namespace
+{
+
+constexpr char PAINT_TRACE_MAGIC[4] = {'K', 'W', 'P', 'T'};
+
+// Size where the collected records are written to file
+constexpr size_t WRITE_BLOCK_SIZE = 1024 * 1024;
+
+// Largest accepted view or popup size, to detect broken traces
+constexpr int MAX_TRACE_SIZE = 16384;
+
+bool ClipRect(const CefRect& rect, int width, int height, CefRect& clipped)
+{
+  const int x = std::max(rect.x, 0);
+  const int y = std::max(rect.y, 0);
+  const int w = std::min(rect.x + rect.width, width) - x;
+  const int h = std::min(rect.y + rect.height, height) - y;
+  if (w <= 0 || h <= 0)
+    return false;
+
+  clipped.Set(x, y, w, h);
+  return true;
+}
+
+double Percentile(const std::vector<double>& sorted, double percent)
+{
+  if (sorted.empty())
+    return 0.0;
+  const size_t index = static_cast<size_t>(percent / 100.0 * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+bool CPaintTraceWriter::Open(const std::string& path, bool withPixels)
+{
+  Close();
+
+  if (!m_file.OpenFileForWrite(path, true))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CPaintTraceWriter::%s: Failed to create trace '%s'", __func__,
+              path.c_str());
+    return false;
+  }
+
+  m_path = path;
+  m_open = true;
+  m_withPixels = withPixels;
+  m_start = std::chrono::steady_clock::now();
+  m_records = 0;
+  m_bytes = 0;
+
+  m_buffer.insert(m_buffer.end(), PAINT_TRACE_MAGIC, PAINT_TRACE_MAGIC + 4);
+  Put(PAINT_TRACE_VERSION);
+  Put(withPixels ? PAINT_TRACE_PIXELS : uint32_t(0));
+
+  kodi::Log(ADDON_LOG_INFO, "CPaintTraceWriter::%s: Paint trace started on '%s'%s", __func__,
+            path.c_str(), withPixels ? " with pixels" : "");
+  return true;
+}
+
+void CPaintTraceWriter::Close()
+{
+  if (!m_open)
+    return;
+
+  Flush();
+  m_file.Close();
+  m_open = false;
+
+  kodi::Log(ADDON_LOG_INFO, "CPaintTraceWriter::%s: Paint trace '%s' closed, %llu records, %llu bytes",
+            __func__, m_path.c_str(), static_cast<unsigned long long>(m_records),
+            static_cast<unsigned long long>(m_bytes));
+}
+
+void CPaintTraceWriter::Record(CefBrowserHost::PaintElementType type,
+                               const CefRenderHandler::RectList& dirtyRects,
+                               const void* buffer,
+                               int width,
+                               int height)
+{
+  if (!m_open)
+    return;
+
+  const uint64_t time = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - m_start)
+                            .count();
+
+  Put(time);
+  Put(static_cast<uint8_t>(type));
+  Put(static_cast<uint8_t>(m_withPixels ? 1 : 0));
+  Put(uint16_t(0));
+  Put(static_cast<int32_t>(width));
+  Put(static_cast<int32_t>(height));
+  Put(static_cast<uint32_t>(dirtyRects.size()));
+  for (const auto& rect : dirtyRects)
+  {
+    Put(static_cast<int32_t>(rect.x));
+    Put(static_cast<int32_t>(rect.y));
+    Put(static_cast<int32_t>(rect.width));
+    Put(static_cast<int32_t>(rect.height));
+  }
+
+  if (m_withPixels)
+  {
+    const uint8_t* pixels = static_cast<const uint8_t*>(buffer);
+    const size_t stride = static_cast<size_t>(width) * 4;
+    for (const auto& rect : dirtyRects)
+    {
+      CefRect clipped;
+      if (!ClipRect(rect, width, height, clipped))
+        continue;
+
+      for (int row = clipped.y; row < clipped.y + clipped.height; ++row)
+      {
+        const uint8_t* src = pixels + row * stride + clipped.x * 4;
+        m_buffer.insert(m_buffer.end(), src, src + clipped.width * 4);
+      }
+    }
+  }
+
+  m_records++;
+  if (m_buffer.size() >= WRITE_BLOCK_SIZE)
+    Flush();
+}
+
+void CPaintTraceWriter::Flush()
+{
+  if (m_buffer.empty())
+    return;
+
+  if (m_file.Write(m_buffer.data(), m_buffer.size()) != static_cast<ssize_t>(m_buffer.size()))
+    kodi::Log(ADDON_LOG_ERROR, "CPaintTraceWriter::%s: Failed to write trace '%s'", __func__,
+              m_path.c_str());
+
+  m_bytes += m_buffer.size();
+  m_buffer.clear();
+}
+
+//------------------------------------------------------------------------------
+
+bool CPaintTraceReader::Open(const std::string& path)
+{
+  m_data.clear();
+  m_pos = 0;
+  m_flags = 0;
+
+  kodi::vfs::CFile file;
+  if (!file.OpenFile(path))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CPaintTraceReader::%s: Failed to open trace '%s'", __func__,
+              path.c_str());
+    return false;
+  }
+
+  const int64_t length = file.GetLength();
+  if (length > 0)
+  {
+    m_data.resize(static_cast<size_t>(length));
+    m_data.resize(std::max<ssize_t>(file.Read(m_data.data(), m_data.size()), 0));
+  }
+
+  char magic[4];
+  uint32_t version;
+  if (m_data.size() < sizeof(magic) || memcmp(m_data.data(), PAINT_TRACE_MAGIC, sizeof(magic)) != 0)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CPaintTraceReader::%s: '%s' is no paint trace", __func__,
+              path.c_str());
+    return false;
+  }
+  m_pos = sizeof(magic);
+
+  if (!Get(version) || version != PAINT_TRACE_VERSION || !Get(m_flags))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CPaintTraceReader::%s: Unsupported version of paint trace '%s'",
+              __func__, path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool CPaintTraceReader::Next(PaintTraceRecord& record)
+{
+  uint8_t type;
+  uint8_t hasPixels;
+  uint16_t reserved;
+  int32_t width;
+  int32_t height;
+  uint32_t count;
+  if (!Get(record.timeUs) || !Get(type) || !Get(hasPixels) || !Get(reserved) || !Get(width) ||
+      !Get(height) || !Get(count))
+    return false;
+
+  if (type > PET_POPUP || width <= 0 || height <= 0 || width > MAX_TRACE_SIZE ||
+      height > MAX_TRACE_SIZE || count > m_data.size())
+    return false;
+
+  record.type = static_cast<CefBrowserHost::PaintElementType>(type);
+  record.width = width;
+  record.height = height;
+  record.dirtyRects.clear();
+  record.pixels.clear();
+
+  size_t pixelBytes = 0;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    int32_t x, y, w, h;
+    if (!Get(x) || !Get(y) || !Get(w) || !Get(h))
+      return false;
+
+    const CefRect rect(x, y, w, h);
+    record.dirtyRects.push_back(rect);
+
+    CefRect clipped;
+    if (ClipRect(rect, width, height, clipped))
+      pixelBytes += static_cast<size_t>(clipped.width) * clipped.height * 4;
+  }
+
+  if (hasPixels)
+  {
+    if (m_pos + pixelBytes > m_data.size())
+      return false;
+    record.pixels.assign(m_data.begin() + m_pos, m_data.begin() + m_pos + pixelBytes);
+    m_pos += pixelBytes;
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool CPaintTraceReplay::Run(const std::string& path, IRenderer& renderer, bool render, Result& result)
+{
+  CPaintTraceReader reader;
+  if (!reader.Open(path))
+    return false;
+
+  result = Result();
+
+  const uint64_t startBytes = renderer.UploadedBytes();
+  const uint64_t startCalls = renderer.UploadCalls();
+
+  std::vector<uint8_t> buffers[2];
+  std::vector<double> latencies;
+  uint8_t fill = 0;
+
+  PaintTraceRecord record;
+  while (reader.Next(record))
+  {
+    const int index = record.type == PET_POPUP ? 1 : 0;
+    std::vector<uint8_t>& buffer = buffers[index];
+    buffer.resize(static_cast<size_t>(record.width) * record.height * 4);
+
+    // Bring the pixels of the record in the buffer, or mark them as changed
+    const size_t stride = static_cast<size_t>(record.width) * 4;
+    const uint8_t* src = record.pixels.data();
+    ++fill;
+    for (const auto& rect : record.dirtyRects)
+    {
+      CefRect clipped;
+      if (!ClipRect(rect, record.width, record.height, clipped))
+        continue;
+
+      for (int row = clipped.y; row < clipped.y + clipped.height; ++row)
+      {
+        uint8_t* dst = buffer.data() + row * stride + clipped.x * 4;
+        if (!record.pixels.empty())
+        {
+          memcpy(dst, src, clipped.width * 4);
+          src += clipped.width * 4;
+        }
+        else
+        {
+          memset(dst, fill, clipped.width * 4);
+        }
+      }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    renderer.OnPaint(record.type, record.dirtyRects, buffer.data(), record.width, record.height);
+    if (render)
+      renderer.Render();
+    const double ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    latencies.push_back(ms);
+    result.totalMs += ms;
+    result.paints++;
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  result.uploadBytes = renderer.UploadedBytes() - startBytes;
+  result.uploadCalls = renderer.UploadCalls() - startCalls;
+  result.p50Ms = Percentile(latencies, 50.0);
+  result.p90Ms = Percentile(latencies, 90.0);
+  result.p99Ms = Percentile(latencies, 99.0);
+  result.maxMs = latencies.empty() ? 0.0 : latencies.back();
+  return true;
+}
+
+void CPaintTraceReplay::Log(const std::string& name, const Result& result)
+{
+  kodi::Log(ADDON_LOG_INFO,
+            "CPaintTraceReplay: %s: %llu paints, %.1f MB uploaded in %llu calls, "
+            "total %.2f ms, p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms",
+            name.c_str(), static_cast<unsigned long long>(result.paints),
+            result.uploadBytes / (1024.0 * 1024.0),
+            static_cast<unsigned long long>(result.uploadCalls), result.totalMs, result.p50Ms,
+            result.p90Ms, result.p99Ms, result.maxMs);
+}
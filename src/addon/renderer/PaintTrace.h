@@ -0,0 +1,145 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "include/cef_render_handler.h"
+
+#include <chrono>
+#include <cstring>
+#include <kodi/Filesystem.h>
+#include <kodi/General.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class IRenderer;
+
+/*
+ * Trace of CEF's OnPaint calls, to replay real workloads on the renderers.
+ *
+ * File layout, all values in host byte order:
+ *
+ *   Header:  char[4] "KWPT", uint32 version, uint32 flags (PAINT_TRACE_PIXELS)
+ *   Records: uint64 time in us since start, uint8 paint type, uint8 has pixels,
+ *            uint16 reserved, int32 width, int32 height, uint32 rect count,
+ *            int32[4] x/y/width/height per rect, if has pixels then the BGRA
+ *            rows of every rect (clipped to the buffer size)
+ */
+constexpr uint32_t PAINT_TRACE_VERSION = 1;
+constexpr uint32_t PAINT_TRACE_PIXELS = 0x1;
+
+struct PaintTraceRecord
+{
+  uint64_t timeUs = 0;
+  CefBrowserHost::PaintElementType type = PET_VIEW;
+  int width = 0;
+  int height = 0;
+  CefRenderHandler::RectList dirtyRects;
+  std::vector<uint8_t> pixels; // Rows of all rects one after the other, empty without pixels
+};
+
+class ATTRIBUTE_HIDDEN CPaintTraceWriter
+{
+public:
+  CPaintTraceWriter() = default;
+  ~CPaintTraceWriter() { Close(); }
+
+  bool Open(const std::string& path, bool withPixels);
+  void Close();
+  bool IsOpen() const { return m_open; }
+
+  void Record(CefBrowserHost::PaintElementType type,
+              const CefRenderHandler::RectList& dirtyRects,
+              const void* buffer,
+              int width,
+              int height);
+
+private:
+  template<typename T>
+  void Put(const T& value)
+  {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+    m_buffer.insert(m_buffer.end(), data, data + sizeof(T));
+  }
+  void Flush();
+
+  kodi::vfs::CFile m_file;
+  std::string m_path;
+  bool m_open = false;
+  bool m_withPixels = false;
+  std::chrono::steady_clock::time_point m_start;
+  std::vector<uint8_t> m_buffer;
+  uint64_t m_records = 0;
+  uint64_t m_bytes = 0;
+};
+
+class ATTRIBUTE_HIDDEN CPaintTraceReader
+{
+public:
+  CPaintTraceReader() = default;
+
+  bool Open(const std::string& path);
+  bool HasPixels() const { return (m_flags & PAINT_TRACE_PIXELS) != 0; }
+
+  /*!
+   * @brief Read the next record.
+   *
+   * @return false on end of trace or on a broken record
+   */
+  bool Next(PaintTraceRecord& record);
+
+private:
+  template<typename T>
+  bool Get(T& value)
+  {
+    if (m_pos + sizeof(T) > m_data.size())
+      return false;
+    memcpy(&value, m_data.data() + m_pos, sizeof(T));
+    m_pos += sizeof(T);
+    return true;
+  }
+
+  std::vector<uint8_t> m_data;
+  size_t m_pos = 0;
+  uint32_t m_flags = 0;
+};
+
+/*!
+ * @brief Feed a trace through a renderer as fast as possible.
+ *
+ * Traces without pixels get the dirty rectangles filled with a changing value,
+ * so change detection on renderer side sees them as changed.
+ */
+class ATTRIBUTE_HIDDEN CPaintTraceReplay
+{
+public:
+  struct Result
+  {
+    uint64_t paints = 0;
+    uint64_t uploadBytes = 0;
+    uint64_t uploadCalls = 0;
+    double totalMs = 0.0;
+    double p50Ms = 0.0;
+    double p90Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+  };
+
+  /*!
+   * @param[in] path Trace file
+   * @param[in] renderer Initialized renderer to use
+   * @param[in] render Call Render() after every paint, to include the work
+   *                   which is deferred to render by the backend
+   * @param[out] result Collected values
+   * @return true if the trace was readable
+   */
+  static bool Run(const std::string& path, IRenderer& renderer, bool render, Result& result);
+
+  static void Log(const std::string& name, const Result& result);
+};
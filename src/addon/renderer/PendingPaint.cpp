@@ -0,0 +1,146 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "PendingPaint.h"
+
+#include "IRenderer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <kodi/General.h>
+
+void CPendingPaint::Store(CefRenderHandler::PaintElementType type,
+                          const CefRenderHandler::RectList& dirtyRects,
+                          const void* buffer,
+                          int width,
+                          int height)
+{
+  if (type < PET_VIEW || type > PET_POPUP || !buffer || width <= 0 || height <= 0)
+    return;
+
+  const size_t stride = static_cast<size_t>(width) * 4;
+  const uint8_t* src = static_cast<const uint8_t*>(buffer);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  Element& element = m_elements[type];
+  if (element.width != width || element.height != height)
+  {
+    // CEF's buffer holds always the complete view, take it whole on a new
+    // size as nothing is kept yet
+    element.width = width;
+    element.height = height;
+    element.buffer.resize(stride * height);
+    memcpy(element.buffer.data(), src, element.buffer.size());
+    element.dirtyRects.clear();
+    element.dirtyRects.emplace_back(0, 0, width, height);
+  }
+  else
+  {
+    if (!element.dirtyRects.empty())
+      m_merged++;
+
+    for (const auto& rect : dirtyRects)
+    {
+      const int x = std::max(rect.x, 0);
+      const int y = std::max(rect.y, 0);
+      const int right = std::min(rect.x + rect.width, width);
+      const int bottom = std::min(rect.y + rect.height, height);
+      if (right <= x || bottom <= y)
+        continue;
+
+      const size_t offset = static_cast<size_t>(x) * 4;
+      const size_t bytes = static_cast<size_t>(right - x) * 4;
+      for (int row = y; row < bottom; ++row)
+        memcpy(element.buffer.data() + row * stride + offset, src + row * stride + offset, bytes);
+
+      AddDirtyRect(element, CefRect(x, y, right - x, bottom - y));
+    }
+  }
+
+  m_paints++;
+  m_pending = true;
+}
+
+void CPendingPaint::SetRenderScale(float scale)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_renderScale = scale;
+  m_pending = true;
+}
+
+bool CPendingPaint::Apply(IRenderer& renderer)
+{
+  if (!m_pending)
+    return false;
+
+  // The lock is held during the upload, so a paint of CEF given meanwhile
+  // waits at most for one upload
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_pending = false;
+
+  if (m_renderScale > 0.0f)
+  {
+    renderer.SetRenderScale(m_renderScale);
+    m_renderScale = 0.0f;
+  }
+
+  for (int type = PET_VIEW; type <= PET_POPUP; ++type)
+  {
+    Element& element = m_elements[type];
+    if (element.dirtyRects.empty())
+      continue;
+
+    renderer.OnPaint(static_cast<CefRenderHandler::PaintElementType>(type), element.dirtyRects,
+                     element.buffer.data(), element.width, element.height);
+    element.dirtyRects.clear();
+  }
+
+  return true;
+}
+
+void CPendingPaint::Clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_paints > 0)
+    kodi::Log(ADDON_LOG_DEBUG, "CPendingPaint::%s: %llu paints handed to main thread, %llu merged",
+              __func__, static_cast<unsigned long long>(m_paints),
+              static_cast<unsigned long long>(m_merged));
+
+  for (auto& element : m_elements)
+    element = Element();
+  m_renderScale = 0.0f;
+  m_pending = false;
+  m_paints = 0;
+  m_merged = 0;
+}
+
+void CPendingPaint::AddDirtyRect(Element& element, const CefRect& rect)
+{
+  if (element.dirtyRects.size() < MAX_DIRTY_RECTS)
+  {
+    element.dirtyRects.push_back(rect);
+    return;
+  }
+
+  int x = rect.x;
+  int y = rect.y;
+  int right = rect.x + rect.width;
+  int bottom = rect.y + rect.height;
+  for (const auto& entry : element.dirtyRects)
+  {
+    x = std::min(x, entry.x);
+    y = std::min(y, entry.y);
+    right = std::max(right, entry.x + entry.width);
+    bottom = std::max(bottom, entry.y + entry.height);
+  }
+
+  element.dirtyRects.clear();
+  element.dirtyRects.emplace_back(x, y, right - x, bottom - y);
+}
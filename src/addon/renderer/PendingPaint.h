@@ -0,0 +1,80 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "include/cef_render_handler.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+class IRenderer;
+
+/*!
+ * @brief Paints of CEF's UI thread kept for the upload on Kodi's main thread.
+ *
+ * Used with CEF's multi threaded message loop, where OnPaint() is no more
+ * called inside Kodi's main thread. Only the dirty areas are copied into one
+ * buffer per element type, paints until the next render pass are merged
+ * there. Apply() gives them then to the renderer like a single paint.
+ */
+class CPendingPaint
+{
+public:
+  CPendingPaint() = default;
+
+  /*!
+   * @brief Copy the dirty areas of a paint, from CEF's UI thread.
+   */
+  void Store(CefRenderHandler::PaintElementType type,
+             const CefRenderHandler::RectList& dirtyRects,
+             const void* buffer,
+             int width,
+             int height);
+
+  /*!
+   * @brief Keep a changed render scale, set with the next Apply().
+   */
+  void SetRenderScale(float scale);
+
+  /*!
+   * @brief Give the kept paints to the renderer, only from Kodi's main thread.
+   *
+   * @return true if something was given
+   */
+  bool Apply(IRenderer& renderer);
+
+  /*!
+   * @brief Drop the kept paints and free the buffers.
+   */
+  void Clear();
+
+private:
+  // More rectangles are merged to their bounds
+  static constexpr size_t MAX_DIRTY_RECTS = 32;
+
+  struct Element
+  {
+    std::vector<uint8_t> buffer;
+    int width = 0;
+    int height = 0;
+    CefRenderHandler::RectList dirtyRects;
+  };
+
+  static void AddDirtyRect(Element& element, const CefRect& rect);
+
+  std::mutex m_mutex;
+  std::atomic_bool m_pending{false};
+  Element m_elements[PET_POPUP + 1];
+  float m_renderScale = 0.0f;
+
+  uint64_t m_paints = 0;
+  uint64_t m_merged = 0;
+};
@@ -0,0 +1,69 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "PixelConvert.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAS_SSE2_CONVERT 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAS_NEON_CONVERT 1
+#endif
+
+namespace PixelConvert
+{
+
+/*
+ * A pixel read as little endian 32 bit value is 0xAARRGGBB, the conversion
+ * swaps the R and B bytes by (x & 0xFF00FF00) | rotate16(x & 0x00FF00FF).
+ */
+void BGRAToRGBA(uint8_t* dst, const uint8_t* src, size_t pixels)
+{
+  size_t i = 0;
+
+#if defined(HAS_SSE2_CONVERT)
+  const __m128i maskAG = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+  const __m128i maskRB = _mm_set1_epi32(0x00FF00FF);
+  for (; i + 8 <= pixels; i += 8)
+  {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4 + 16));
+    const __m128i rbA = _mm_and_si128(a, maskRB);
+    const __m128i rbB = _mm_and_si128(b, maskRB);
+    const __m128i outA = _mm_or_si128(_mm_and_si128(a, maskAG),
+                                      _mm_or_si128(_mm_slli_epi32(rbA, 16), _mm_srli_epi32(rbA, 16)));
+    const __m128i outB = _mm_or_si128(_mm_and_si128(b, maskAG),
+                                      _mm_or_si128(_mm_slli_epi32(rbB, 16), _mm_srli_epi32(rbB, 16)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), outA);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4 + 16), outB);
+  }
+#elif defined(HAS_NEON_CONVERT)
+  for (; i + 16 <= pixels; i += 16)
+  {
+    uint8x16x4_t v = vld4q_u8(src + i * 4);
+    const uint8x16_t b = v.val[0];
+    v.val[0] = v.val[2];
+    v.val[2] = b;
+    vst4q_u8(dst + i * 4, v);
+  }
+#endif
+
+  for (; i < pixels; ++i)
+  {
+    uint32_t pixel;
+    memcpy(&pixel, src + i * 4, sizeof(pixel));
+    const uint32_t rb = pixel & 0x00FF00FFu;
+    pixel = (pixel & 0xFF00FF00u) | (rb << 16) | (rb >> 16);
+    memcpy(dst + i * 4, &pixel, sizeof(pixel));
+  }
+}
+
+} /* namespace PixelConvert */
@@ -0,0 +1,29 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace PixelConvert
+{
+
+/*!
+ * @brief Convert BGRA pixels (as given by CEF) to RGBA.
+ *
+ * Vectorized with SSE2 or NEON if available. Source and destination can be
+ * the same, but must not overlap otherwise.
+ *
+ * @param[out] dst Target of the converted pixels
+ * @param[in] src Source pixels
+ * @param[in] pixels Amount of pixels to convert
+ */
+void BGRAToRGBA(uint8_t* dst, const uint8_t* src, size_t pixels);
+
+} /* namespace PixelConvert */
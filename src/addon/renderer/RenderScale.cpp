@@ -0,0 +1,111 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "RenderScale.h"
+
+#include <algorithm>
+
+namespace
+{
+
+// Steps of the automatic mode
+constexpr float SCALE_LEVELS[] = {1.0f, 0.75f, 0.66f, 0.5f};
+constexpr int SCALE_LEVEL_COUNT = sizeof(SCALE_LEVELS) / sizeof(SCALE_LEVELS[0]);
+
+// Paints checked together
+constexpr unsigned int WINDOW_SAMPLES = 60;
+
+// Windows without problems before the next step up, doubled on every failed try
+constexpr unsigned int MIN_GOOD_WINDOWS = 5;
+constexpr unsigned int MAX_GOOD_WINDOWS = 80;
+
+// Mean paint cost against Kodi's frame time to step down, and the one
+// expected for the next larger scale to step up
+constexpr double STEP_DOWN_RATIO = 0.5;
+constexpr double STEP_UP_RATIO = 0.35;
+
+// Used if Kodi gives no frame rate
+constexpr float DEFAULT_FPS = 60.0f;
+
+} // namespace
+
+void CRenderScale::Initialize(float fps)
+{
+  const int percent = kodi::GetSettingInt("performance.render_scale", 100);
+
+  m_automatic = percent == 0;
+  m_frameMs = 1000.0 / (fps > 0.0f ? fps : DEFAULT_FPS);
+  m_failedLevel = -1;
+  m_requiredGoodWindows = MIN_GOOD_WINDOWS;
+  SetLevel(0);
+  if (!m_automatic)
+    m_scale = std::min(std::max(percent, 25), 100) / 100.0f;
+
+  kodi::Log(ADDON_LOG_DEBUG, "CRenderScale::%s: Render scale %s, frame time %.1f ms", __func__,
+            m_automatic ? "automatic" : std::to_string(percent).c_str(), m_frameMs);
+}
+
+bool CRenderScale::AddPaintCost(double costMs)
+{
+  if (!m_automatic)
+    return false;
+
+  m_sumMs += costMs;
+  if (++m_samples < WINDOW_SAMPLES)
+    return false;
+
+  const double meanMs = m_sumMs / m_samples;
+  m_samples = 0;
+  m_sumMs = 0.0;
+
+  if (meanMs > m_frameMs * STEP_DOWN_RATIO)
+  {
+    if (m_level + 1 >= SCALE_LEVEL_COUNT)
+      return false;
+
+    // Slow directly after a step up, wait longer until the next try
+    if (m_failedLevel == m_level)
+      m_requiredGoodWindows = std::min(m_requiredGoodWindows * 2, MAX_GOOD_WINDOWS);
+
+    kodi::Log(ADDON_LOG_DEBUG, "CRenderScale::%s: Paint cost %.1f ms above %.1f ms, scale down",
+              __func__, meanMs, m_frameMs * STEP_DOWN_RATIO);
+    SetLevel(m_level + 1);
+    return true;
+  }
+
+  m_failedLevel = -1;
+  if (m_level == 0)
+    return false;
+
+  // The cost grows with the amount of pixels
+  const double ratio = SCALE_LEVELS[m_level - 1] / SCALE_LEVELS[m_level];
+  const double expectedMs = meanMs * ratio * ratio;
+  if (expectedMs > m_frameMs * STEP_UP_RATIO)
+  {
+    m_goodWindows = 0;
+    return false;
+  }
+
+  if (++m_goodWindows < m_requiredGoodWindows)
+    return false;
+
+  kodi::Log(ADDON_LOG_DEBUG, "CRenderScale::%s: Paint cost %.1f ms expected to fit, scale up",
+            __func__, expectedMs);
+  SetLevel(m_level - 1);
+  m_failedLevel = m_level;
+  return true;
+}
+
+void CRenderScale::SetLevel(int level)
+{
+  m_level = level;
+  m_scale = SCALE_LEVELS[level];
+  m_goodWindows = 0;
+  m_samples = 0;
+  m_sumMs = 0.0;
+}
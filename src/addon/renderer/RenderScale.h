@@ -0,0 +1,63 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include <kodi/General.h>
+
+/*!
+ * @brief Scale of the internal render resolution against the control size.
+ *
+ * CEF rasterizes the view in software, where the cost grows with the amount
+ * of pixels. The view keeps the control size, the scale is given to CEF as
+ * device scale factor of the simulated screen. With a scale below 1.0 are
+ * the painted buffers smaller and upscaled by the renderer to the control.
+ *
+ * The automatic mode starts at full size and steps down if the measured
+ * cost of the view paints takes too much of Kodi's frame time, and up again
+ * if the cost expected for the larger size fits after a while. A failed step
+ * up doubles the time until the next try.
+ */
+class ATTRIBUTE_HIDDEN CRenderScale
+{
+public:
+  CRenderScale() = default;
+
+  /*!
+   * @brief Read the setting, 0 is automatic, otherwise the scale in percent.
+   *
+   * @param[in] fps Frame rate of Kodi's GUI, the paint cost is compared with
+   *                its frame time
+   */
+  void Initialize(float fps);
+
+  float Scale() const { return m_scale; }
+  bool IsAutomatic() const { return m_automatic; }
+
+  /*!
+   * @brief Give the cost of a view paint to the automatic mode.
+   *
+   * @param[in] costMs Time of the paint, from the begin frame request if
+   *                   known until the paint is handed to the renderer
+   * @return true if the scale was changed and the screen info must be updated
+   */
+  bool AddPaintCost(double costMs);
+
+private:
+  void SetLevel(int level);
+
+  bool m_automatic = false;
+  float m_scale = 1.0f;
+  double m_frameMs = 0.0;
+  int m_level = 0;
+  int m_failedLevel = -1;
+  unsigned int m_requiredGoodWindows = 0;
+  unsigned int m_goodWindows = 0;
+  unsigned int m_samples = 0;
+  double m_sumMs = 0.0;
+};
@@ -11,7 +11,9 @@
 #include "addon.h"
 #include "WebBrowserClient.h"
 
-#if defined(HAS_GL) | defined(HAS_GLES)
+#if defined(HAS_MEMORY_RENDERER)
+#include "RendererMemory.h"
+#elif defined(HAS_GL) | defined(HAS_GLES)
 #include "RendererGL.h"
 #elif defined(HAS_DX)
 #include "RendererDX.h"
@@ -19,22 +21,40 @@
 #error Render system is not supported.
 #endif
 
+#include "include/base/cef_bind.h"
 #include "include/cef_browser.h"
 #include "include/internal/cef_types_wrappers.h"
+#include "include/wrapper/cef_closure_task.h"
 #include "include/wrapper/cef_helpers.h"
 
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <kodi/Filesystem.h>
 #include <kodi/gui/dialogs/Keyboard.h>
 
-CRendererClient::CRendererClient(CefRefPtr<CWebBrowserClient> client) : m_client(client)
+CRendererClient::CRendererClient(CefRefPtr<CWebBrowserClient> client)
+  : m_client(client),
+    m_mainThreadTasks(client->GetMain().GetMainThreadTasks())
 {
-#if defined(HAS_GL) || defined(HAS_GLES)
-  m_renderer = new CRendererClientOpenGL(m_client);
+  RendererConfig config;
+  config.backgroundColor = client->GetBackgroundColorARGB();
+  config.transparentBackground = client->UseTransparentBackground();
+  config.fullUploadRatio = float(kodi::GetSettingInt("performance.full_upload_ratio", 70)) / 100.0f;
+  config.tileHash = kodi::GetSettingBoolean("performance.tile_hash");
+
+#if defined(HAS_MEMORY_RENDERER)
+  m_renderer = new CRendererClientMemory(config);
+#elif defined(HAS_GL) || defined(HAS_GLES)
+  m_renderer = new CRendererClientOpenGL(config);
 #elif defined(HAS_DX)
-  m_renderer = new CRendererClientDirectX(m_client);
-#else
-  m_renderer = new IRenderer(m_client);
+  m_renderer = new CRendererClientDirectX(config);
 #endif
   m_renderer->Initialize();
+  m_paintOnMainThread = m_mainThreadTasks.MultiThreaded();
+
+  m_renderScale.Initialize(client->GetFPS());
+  m_renderer->SetRenderScale(m_renderScale.Scale());
 }
 
 CRendererClient::~CRendererClient()
@@ -44,21 +64,44 @@ CRendererClient::~CRendererClient()
 
 void CRendererClient::ClearClient()
 {
-  m_renderer->ClearClient();
-  m_client = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(m_clientMutex);
+    m_client = nullptr;
+  }
+
+  // The trace is written by OnPaint()
+  if (CefCurrentlyOn(TID_UI))
+    ClosePaintTrace();
+  else
+    CefPostTask(TID_UI, base::Bind(&CRendererClient::ClosePaintTrace, this));
+}
+
+CefRefPtr<CWebBrowserClient> CRendererClient::GetClient()
+{
+  std::lock_guard<std::mutex> lock(m_clientMutex);
+  return m_client;
+}
+
+void CRendererClient::ClosePaintTrace()
+{
+  m_paintTrace.Close();
+  m_paintTraceFailed = false;
 }
 
 void CRendererClient::Render()
 {
-  CEF_REQUIRE_UI_THREAD();
   m_renderer->Render();
 }
 
 bool CRendererClient::Dirty()
 {
-  CEF_REQUIRE_UI_THREAD();
-
-  CefDoMessageLoopWork();
+  // Do CEF's message loop work if due, or the tasks of CEF's own UI thread,
+  // for a short latency between the request and the paint.
+  CefRefPtr<CWebBrowserClient> client = GetClient();
+  if (client)
+    client->GetMain().ProcessMainThreadWork();
+  if (m_paintOnMainThread)
+    m_pendingPaint.Apply(*m_renderer);
   return m_renderer->Dirty();
 }
 
@@ -66,12 +109,72 @@ void CRendererClient::ScreenSizeChange(float x, float y, float width, float heig
 {
   m_renderer->ScreenSizeChange(x, y, width, height);
 }
+
+void CRendererClient::Suspend(CefRefPtr<CefBrowser> browser)
+{
+  if (m_suspended)
+    return;
+
+  m_suspended = true;
+  if (browser)
+    browser->GetHost()->WasHidden(true);
+
+  const size_t before = m_renderer->AllocatedBytes();
+  m_renderer->Suspend();
+
+  // Paints of CEF's UI thread can be on the way, dropped there after it
+  if (CefCurrentlyOn(TID_UI))
+    ResetPaintTiming();
+  else
+    CefPostTask(TID_UI, base::Bind(&CRendererClient::ResetPaintTiming, this));
+
+  kodi::Log(ADDON_LOG_DEBUG, "CRendererClient::%s: Renderer suspended, memory %.1f MB before, %.1f MB after",
+            __func__, before / (1024.0 * 1024.0), m_renderer->AllocatedBytes() / (1024.0 * 1024.0));
+}
+
+void CRendererClient::Resume(CefRefPtr<CefBrowser> browser)
+{
+  if (!m_suspended)
+    return;
+
+  m_suspended = false;
+  if (!m_renderer->Resume())
+    kodi::Log(ADDON_LOG_ERROR, "CRendererClient::%s: Failed to resume renderer", __func__);
+
+  if (browser)
+  {
+    browser->GetHost()->WasHidden(false);
+    browser->GetHost()->Invalidate(PET_VIEW);
+  }
+
+  kodi::Log(ADDON_LOG_DEBUG, "CRendererClient::%s: Renderer resumed", __func__);
+}
+
+void CRendererClient::ResetPaintTiming()
+{
+  m_pendingPaint.Clear();
+  m_lastViewPaint = CTimeStatistics::Clock::time_point();
+
+  std::lock_guard<std::mutex> lock(m_beginFrameMutex);
+  m_pendingBeginFrames = 0;
+}
+
+void CRendererClient::SendExternalBeginFrame(CefRefPtr<CefBrowser> browser)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_beginFrameMutex);
+    if (m_pendingBeginFrames++ == 0)
+      m_firstPendingBeginFrame = CTimeStatistics::Now();
+  }
+  browser->GetHost()->SendExternalBeginFrame();
+}
   
 void CRendererClient::GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect)
 {
   CEF_REQUIRE_UI_THREAD();
 
-  if (!m_client)
+  CefRefPtr<CWebBrowserClient> client = GetClient();
+  if (!client)
   {
     // Set to prevent SIGTRAP expections by cef/libcef/browser/osr/render_widget_host_view_osr.cc:749
     rect.x = 0;
@@ -85,8 +188,22 @@ void CRendererClient::GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect)
   // for popup menus to be located and sized inside the view.
   rect.x = 0;
   rect.y = 0;
-  rect.width = static_cast<int>(m_client->GetWidth());
-  rect.height = static_cast<int>(m_client->GetHeight());
+  rect.width = std::max(static_cast<int>(client->GetWidth()), 1);
+  rect.height = std::max(static_cast<int>(client->GetHeight()), 1);
+}
+
+bool CRendererClient::GetScreenInfo(CefRefPtr<CefBrowser> browser, CefScreenInfo& screen_info)
+{
+  CEF_REQUIRE_UI_THREAD();
+
+  // A reduced render scale is given as device scale factor, CEF rasterizes
+  // then less pixels for the same view and the renderer upscales them
+  CefRect rect;
+  GetViewRect(browser, rect);
+  screen_info.device_scale_factor = m_renderScale.Scale();
+  screen_info.rect = rect;
+  screen_info.available_rect = rect;
+  return true;
 }
 
 bool CRendererClient::GetScreenPoint(CefRefPtr<CefBrowser> browser, int viewX, int viewY, int& screenX, int& screenY)
@@ -104,7 +221,85 @@ void CRendererClient::OnPaint(CefRefPtr<CefBrowser> browser, PaintElementType ty
 {
   CEF_REQUIRE_UI_THREAD();
 
-  m_renderer->OnPaint(type, dirtyRects, buffer, width, height);
+  // A parked control has no renderer resources, Resume() requests a complete
+  // paint again
+  if (m_suspended)
+    return;
+
+  CefRefPtr<CWebBrowserClient> client = GetClient();
+  UpdatePaintTrace(client);
+  m_paintTrace.Record(type, dirtyRects, buffer, width, height);
+
+  const auto start = CTimeStatistics::Now();
+  if (m_paintOnMainThread)
+    m_pendingPaint.Store(type, dirtyRects, buffer, width, height);
+  else
+    m_renderer->OnPaint(type, dirtyRects, buffer, width, height);
+
+  if (type != PET_VIEW)
+    return;
+
+  const auto now = CTimeStatistics::Now();
+  if (m_lastViewPaint != CTimeStatistics::Clock::time_point())
+    m_paintIntervalStats.AddSample(now - m_lastViewPaint);
+  m_lastViewPaint = now;
+
+  // With external begin frames is the time of the page for the frame known
+  // and part of the cost
+  auto cost = now - start;
+  unsigned int pendingBeginFrames;
+  CTimeStatistics::Clock::time_point firstPendingBeginFrame;
+  {
+    std::lock_guard<std::mutex> lock(m_beginFrameMutex);
+    pendingBeginFrames = m_pendingBeginFrames;
+    firstPendingBeginFrame = m_firstPendingBeginFrame;
+    m_pendingBeginFrames = 0;
+  }
+  if (pendingBeginFrames > 0)
+  {
+    m_beginFrameStats.AddSample(start - firstPendingBeginFrame, 0, pendingBeginFrames);
+    cost += start - firstPendingBeginFrame;
+  }
+  m_paintCostStats.AddSample(cost);
+
+  if (m_renderScale.AddPaintCost(std::chrono::duration<double, std::milli>(cost).count()))
+  {
+    // Takes effect with the next paint in the new size
+    if (m_paintOnMainThread)
+      m_pendingPaint.SetRenderScale(m_renderScale.Scale());
+    else
+      m_renderer->SetRenderScale(m_renderScale.Scale());
+    browser->GetHost()->NotifyScreenInfoChanged();
+    browser->GetHost()->WasResized();
+  }
+
+  if (client)
+    client->ViewPainted();
+}
+
+void CRendererClient::RunOnMainThread(std::function<void()> task)
+{
+  m_mainThreadTasks.Run(std::move(task));
+}
+
+void CRendererClient::UpdatePaintTrace(CefRefPtr<CWebBrowserClient> client)
+{
+  const bool enabled = client && client->GetMain().PaintTraceEnabled();
+  if (!enabled)
+  {
+    ClosePaintTrace();
+    return;
+  }
+
+  if (m_paintTrace.IsOpen() || m_paintTraceFailed)
+    return;
+
+  const std::string path = kodi::GetBaseUserPath("traces");
+  kodi::vfs::CreateDirectory(path);
+  m_paintTraceFailed = !m_paintTrace.Open(path + "/paint-" +
+                                              std::to_string(client->GetUniqueId()) + "-" +
+                                              std::to_string(std::time(nullptr)) + ".trace",
+                                          client->GetMain().PaintTraceWithPixels());
 }
 
 void CRendererClient::OnAcceleratedPaint(CefRefPtr<CefBrowser> browser, PaintElementType type, 
@@ -117,12 +312,14 @@ void CRendererClient::OnAcceleratedPaint(CefRefPtr<CefBrowser> browser, PaintEle
 
 void CRendererClient::OnPopupShow(CefRefPtr<CefBrowser> browser, bool show)
 {
-  m_renderer->OnPopupShow(browser, show);
+  CefRefPtr<CRendererClient> self(this);
+  RunOnMainThread([self, browser, show]() { self->m_renderer->OnPopupShow(browser, show); });
 }
 
 void CRendererClient::OnPopupSize(CefRefPtr<CefBrowser> browser, const CefRect& rect)
 {
-  m_renderer->OnPopupSize(browser, rect);
+  CefRefPtr<CRendererClient> self(this);
+  RunOnMainThread([self, browser, rect]() { self->m_renderer->OnPopupSize(browser, rect); });
 }
 
 void CRendererClient::OnCursorChange(CefRefPtr<CefBrowser> browser, CefCursorHandle cursor, CursorType type, const CefCursorInfo& custom_cursor_info)
@@ -159,11 +356,15 @@ void CRendererClient::OnTextSelectionChanged(CefRefPtr<CefBrowser> browser, cons
 
 void CRendererClient::OnVirtualKeyboardRequested(CefRefPtr<CefBrowser> browser, TextInputMode input_mode)
 {
-  if (m_client && !m_client->ContextMenuOpen())
-  {
-    if (input_mode != CEF_TEXT_INPUT_MODE_NONE)
-      m_client->GetMain().GetGUIManager().GetKeyboard().Show(m_client, input_mode);
-    else
-      m_client->GetMain().GetGUIManager().GetKeyboard().Close();
-  }
+  CefRefPtr<CRendererClient> self(this);
+  RunOnMainThread([self, input_mode]() {
+    CefRefPtr<CWebBrowserClient> client = self->GetClient();
+    if (client && !client->ContextMenuOpen())
+    {
+      if (input_mode != CEF_TEXT_INPUT_MODE_NONE)
+        client->GetMain().GetGUIManager().GetKeyboard().Show(client, input_mode);
+      else
+        client->GetMain().GetGUIManager().GetKeyboard().Close();
+    }
+  });
 }
@@ -11,7 +11,16 @@
 #include "include/cef_render_handler.h"
 #include "include/internal/cef_ptr.h"
 #include "include/cef_base.h"
+#include "PaintTrace.h"
+#include "PendingPaint.h"
+#include "RenderScale.h"
+#include "utils/TimeStatistics.h"
 
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+class CMainThreadTasks;
 class CWebBrowserClient;
 class IRenderer;
 
@@ -29,12 +38,32 @@ public:
   bool Dirty();
   void ScreenSizeChange(float x, float y, float width, float height);
 
+  /*!
+   * @brief Hide the browser and free the renderer resources of a parked
+   * control.
+   */
+  void Suspend(CefRefPtr<CefBrowser> browser);
+
+  /*!
+   * @brief Show the browser again and request a complete paint for the
+   * recreated renderer resources.
+   */
+  void Resume(CefRefPtr<CefBrowser> browser);
+
+  /*!
+   * @brief Request a new frame from CEF if external begin frames are used.
+   *
+   * Collects also the time until the page answers with a paint.
+   */
+  void SendExternalBeginFrame(CefRefPtr<CefBrowser> browser);
+
   double ScrollOffsetX() { return m_scrollOffsetX; }
   double ScrollOffsetY() { return m_scrollOffsetY; }
 
   /// CefRenderHandler functions
   //@{
   void GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect) override;
+  bool GetScreenInfo(CefRefPtr<CefBrowser> browser, CefScreenInfo& screen_info) override;
   bool GetScreenPoint(CefRefPtr<CefBrowser> browser, int viewX, int viewY, int& screenX, int& screenY) override;
   void OnPaint(CefRefPtr<CefBrowser> browser, PaintElementType type, const RectList& dirtyRects, const void* buffer, int width, int height) override;
   void OnAcceleratedPaint(CefRefPtr<CefBrowser> browser, PaintElementType type, const RectList& dirtyRects, void* shared_handle) override;
@@ -51,9 +80,47 @@ public:
 
 private:
   IMPLEMENT_REFCOUNTING(CRendererClient);
-  
-  double m_scrollOffsetX = 0.0;
-  double m_scrollOffsetY = 0.0;
+
+  CefRefPtr<CWebBrowserClient> GetClient();
+  void UpdatePaintTrace(CefRefPtr<CWebBrowserClient> client);
+  void RunOnMainThread(std::function<void()> task);
+
+  /*!
+   * @brief Parts of ClearClient() and Suspend() used by OnPaint(), done on
+   * CEF's UI thread.
+   */
+  void ClosePaintTrace();
+  void ResetPaintTiming();
+
+  std::atomic<double> m_scrollOffsetX{0.0};
+  std::atomic<double> m_scrollOffsetY{0.0};
+
+  // Cleared on Kodi's main thread while CEF's UI thread can use it
+  std::mutex m_clientMutex;
   CefRefPtr<CWebBrowserClient> m_client;
+
   IRenderer* m_renderer;
+  CMainThreadTasks& m_mainThreadTasks;
+
+  // Frame timing, used to compare timer and external begin frame mode. The
+  // last view paint is only used on CEF's UI thread. The begin frames are
+  // sent from Kodi's main thread, with the multi threaded message loop in
+  // parallel to the paints, both values are only changed together.
+  CTimeStatistics::Clock::time_point m_lastViewPaint;
+  std::mutex m_beginFrameMutex;
+  CTimeStatistics::Clock::time_point m_firstPendingBeginFrame;
+  unsigned int m_pendingBeginFrames = 0;
+  CTimeStatistics m_paintIntervalStats{"CRendererClient: View paint interval", 300};
+  CTimeStatistics m_paintCostStats{"CRendererClient: View paint cost", 300};
+  CPaintTraceWriter m_paintTrace;
+  bool m_paintTraceFailed = false;
+  std::atomic_bool m_suspended{false};
+  CRenderScale m_renderScale;
+
+  // With CEF's multi threaded message loop are the paints uploaded on Kodi's
+  // main thread
+  bool m_paintOnMainThread = false;
+  CPendingPaint m_pendingPaint;
+
+  CTimeStatistics m_beginFrameStats{"CRendererClient: Begin frame to view paint (calls = begin frames)", 300};
 };
@@ -83,8 +83,8 @@ void PopupLayer::set_bounds(const CefRect& bounds)
   move(x, y, w, h);
 }
 
-CRendererClientDirectX::CRendererClientDirectX(CefRefPtr<CWebBrowserClient> client)
-  : IRenderer(client)
+CRendererClientDirectX::CRendererClientDirectX(const RendererConfig& config)
+  : IRenderer(config)
 {
 }
 
@@ -56,7 +56,7 @@ private:
 class ATTRIBUTE_HIDDEN CRendererClientDirectX : public IRenderer
 {
 public:
-  CRendererClientDirectX(CefRefPtr<CWebBrowserClient> client);
+  CRendererClientDirectX(const RendererConfig& config);
   ~CRendererClientDirectX() = default;
 
   bool Initialize() override;
@@ -8,23 +8,22 @@
 
 #include "RendererGL.h"
 
+#include "PixelConvert.h"
 #include "addon.h"
 #include "WebBrowserClient.h"
 #include "utils/Utils.h"
 
 #include "include/wrapper/cef_helpers.h"
 
+#include <algorithm>
+#include <cstring>
 #include <kodi/General.h>
 #include <glm/glm.hpp>
 
-#if !defined(GL_UNPACK_ROW_LENGTH)
-  #if defined(GL_UNPACK_ROW_LENGTH_EXT)
-    #define GL_UNPACK_ROW_LENGTH GL_UNPACK_ROW_LENGTH_EXT
-    #define GL_UNPACK_SKIP_ROWS GL_UNPACK_SKIP_ROWS_EXT
-    #define GL_UNPACK_SKIP_PIXELS GL_UNPACK_SKIP_PIXELS_EXT
-  #else
-    #undef HAS_GLES
-  #endif
+// Row length is on OpenGL ES 2.0 only present with GL_EXT_unpack_subimage,
+// without it are the rows of dirty rectangles packed before upload.
+#if !defined(GL_UNPACK_ROW_LENGTH) && defined(GL_UNPACK_ROW_LENGTH_EXT)
+#define GL_UNPACK_ROW_LENGTH GL_UNPACK_ROW_LENGTH_EXT
 #endif
 
 #ifndef GL_BGR
@@ -50,8 +49,47 @@
 
 // #define SHOW_UPDATE_RECT 1
 
-CRendererClientOpenGL::CRendererClientOpenGL(CefRefPtr<CWebBrowserClient> client)
-  : IRenderer(client),
+// Pixel buffer objects need glMapBufferRange() (OpenGL 3.0 / OpenGL ES 3.0)
+#if defined(GL_PIXEL_UNPACK_BUFFER) && defined(GL_MAP_WRITE_BIT)
+#define HAS_PBO_UPLOAD 1
+#endif
+
+namespace
+{
+
+// Strength of the unsharp mask on upscale by a half render scale
+constexpr float SHARPEN_STRENGTH = 0.5f;
+
+bool HasExtension(const char* extensions, const char* name)
+{
+  if (!extensions)
+    return false;
+
+  const size_t length = strlen(name);
+  for (const char* pos = strstr(extensions, name); pos; pos = strstr(pos + length, name))
+  {
+    if ((pos == extensions || pos[-1] == ' ') && (pos[length] == ' ' || pos[length] == '\0'))
+      return true;
+  }
+  return false;
+}
+
+int GetGLMajorVersion(const char* version)
+{
+  if (!version)
+    return 0;
+
+  const char* esVersion = strstr(version, "OpenGL ES ");
+  int major = 0;
+  if (sscanf(esVersion ? esVersion + strlen("OpenGL ES ") : version, "%d", &major) != 1)
+    return 0;
+  return major;
+}
+
+} // namespace
+
+CRendererClientOpenGL::CRendererClientOpenGL(const RendererConfig& config)
+  : IRenderer(config),
     m_textureId(0)
 {
   m_vertexPos[0] = glm::vec3(-1.0f,  1.0f, 0.0f);
@@ -80,25 +118,93 @@ bool CRendererClientOpenGL::Initialize()
     return false;
   }
 
-  glGenBuffers(2, m_vertexVBO);
-  glGenBuffers(1, &m_indexVBO);
-  glGenTextures(1, &m_textureId);
-  glBindTexture(GL_TEXTURE_2D, m_textureId);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  CreateResources();
+  NegotiateUploadFormat();
+
+  m_usePBO = kodi::GetSettingBoolean("performance.pbo_upload") && CheckPBOSupport();
+  kodi::Log(ADDON_LOG_DEBUG, "CRendererClientOpenGL::%s: Texture upload done over %s", __func__,
+            m_usePBO ? "pixel buffer object ring" : "direct calls");
+
   m_dirty = true;
   return true;
 }
 
 void CRendererClientOpenGL::Deinitialize()
 {
+  DestroyResources();
+}
+
+void CRendererClientOpenGL::Suspend()
+{
+  // Shader stays, it is small and shared code with all other controls
+  DestroyResources();
+  std::vector<uint8_t>().swap(m_scratch);
+
+  // Next paint is then handled as resize and creates the texture again
+  m_viewWidth = 0;
+  m_viewHeight = 0;
+}
+
+bool CRendererClientOpenGL::Resume()
+{
+  // The first paint after it is always handled as resize and uploads the
+  // whole view
+  m_viewWidth = 0;
+  m_viewHeight = 0;
+
+  if (m_textureId)
+  {
+    SetDirty();
+    return true;
+  }
+
+  CreateResources();
+  SetDirty();
+  return true;
+}
+
+size_t CRendererClientOpenGL::AllocatedBytes() const
+{
+  if (!m_textureId)
+    return 0;
+
+  const size_t viewBytes = static_cast<size_t>(m_viewWidth) * m_viewHeight * 4;
+  size_t bytes = viewBytes + static_cast<size_t>(m_popupTextureWidth) * m_popupTextureHeight * 4;
+  if (m_pbo[0])
+    bytes += viewBytes * PBO_RING_SIZE;
+  return bytes + m_scratch.capacity();
+}
+
+void CRendererClientOpenGL::CreateResources()
+{
+  glGenBuffers(2, m_vertexVBO);
+  glGenBuffers(1, &m_indexVBO);
+  glGenTextures(1, &m_textureId);
+  glGenTextures(1, &m_popupTextureId);
+  for (const GLuint texture : {m_textureId, m_popupTextureId})
+  {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void CRendererClientOpenGL::DestroyResources()
+{
+  DestroyPBOs();
+
   glDeleteTextures(1, &m_textureId);
+  glDeleteTextures(1, &m_popupTextureId);
   glDeleteBuffers(2, m_vertexVBO);
   glDeleteBuffers(1, &m_indexVBO);
 
   m_textureId = 0;
+  m_popupTextureId = 0;
+  m_popupTextureWidth = 0;
+  m_popupTextureHeight = 0;
   m_vertexVBO[0] = 0;
   m_vertexVBO[1] = 0;
   m_indexVBO = 0;
@@ -106,6 +212,10 @@ void CRendererClientOpenGL::Deinitialize()
 
 void CRendererClientOpenGL::OnPaint(CefBrowserHost::PaintElementType type, const CefRenderHandler::RectList& dirtyRects, const void* buffer, int width, int height)
 {
+  // Textures are freed while suspended
+  if (!m_textureId)
+    return;
+
   if (type == PET_VIEW)
   {
     int old_width = m_viewWidth;
@@ -118,141 +228,497 @@ void CRendererClientOpenGL::OnPaint(CefBrowserHost::PaintElementType type, const
     m_updateRect = dirtyRects[0];
 #endif // SHOW_UPDATE_RECT
 
-    if (old_width != m_viewWidth || old_height != m_viewHeight ||
-        (dirtyRects.size() == 1 &&
-        dirtyRects[0] == CefRect(0, 0, m_viewWidth, m_viewHeight)))
+    const bool resized = old_width != m_viewWidth || old_height != m_viewHeight;
+
+    // On resize the whole texture becomes recreated, otherwise are the dirty
+    // rectangles merged to less upload calls. With tile hash are before the
+    // unchanged parts of them removed.
+    CefRenderHandler::RectList uploadRects;
+    if (resized)
+    {
+      if (m_useTileHash)
+        m_tileDetector.Reset(m_viewWidth, m_viewHeight);
+      uploadRects.assign(1, CefRect(0, 0, m_viewWidth, m_viewHeight));
+    }
+    else if (m_useTileHash)
     {
-      // Update/resize the whole texture.
-      glBindTexture(GL_TEXTURE_2D, m_textureId);
-      glPixelStorei(GL_UNPACK_ROW_LENGTH, m_viewWidth);
-      glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
-      glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_viewWidth, m_viewHeight, 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, buffer);
+      CefRenderHandler::RectList changedRects;
+      m_tileDetector.Filter(dirtyRects, buffer, changedRects);
+      OptimizeDirtyRects(changedRects, uploadRects);
     }
     else
     {
-      // Update just the dirty rectangles.
-      for (const auto& rect : dirtyRects)
-      {
-        DCHECK(rect.x + rect.width <= m_viewWidth);
-        DCHECK(rect.y + rect.height <= m_viewHeight);
-
-        glBindTexture(GL_TEXTURE_2D, m_textureId);
-        glPixelStorei(GL_UNPACK_ROW_LENGTH, m_viewWidth);
-        glPixelStorei(GL_UNPACK_SKIP_PIXELS, rect.x);
-        glPixelStorei(GL_UNPACK_SKIP_ROWS, rect.y);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width, rect.height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, buffer);
-      }
+      OptimizeDirtyRects(dirtyRects, uploadRects);
+    }
+
+    if (!uploadRects.empty())
+    {
+      uint64_t bytes = 0;
+      for (const auto& rect : uploadRects)
+        bytes += static_cast<uint64_t>(rect.width) * rect.height * 4;
+
+      const auto start = CTimeStatistics::Now();
+      if (m_usePBO)
+        UploadViewPBO(uploadRects, buffer, resized);
+      else
+        UploadViewDirect(uploadRects, buffer, resized);
+      m_uploadStats.AddSample(start, bytes, static_cast<unsigned int>(uploadRects.size()));
+      CountUpload(bytes, uploadRects.size());
     }
   }
-  else if (type == PET_POPUP && m_popupRect.width > 0 && m_popupRect.height > 0)
+  else if (type == PET_POPUP)
   {
-    int skip_pixels = 0, x = m_popupRect.x;
-    int skip_rows = 0, y = m_popupRect.y;
-    int w = width;
-    int h = height;
+    // The popup has his own texture, the view texture stays untouched and
+    // needs no repaint from CEF if the popup is moved or closed.
+    UploadPopup(dirtyRects, buffer, width, height);
+  }
+
+  SetDirty();
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  SetUnpackRowLength(0);
+}
+
+void CRendererClientOpenGL::UploadViewDirect(const CefRenderHandler::RectList& dirtyRects,
+                                             const void* buffer,
+                                             bool resized)
+{
+  glBindTexture(GL_TEXTURE_2D, m_textureId);
 
-    // Adjust the popup to fit inside the view.
-    if (x < 0)
+  if (resized)
+  {
+    // Resize and update the whole texture.
+    TexImage(m_viewWidth, m_viewHeight, buffer);
+  }
+  else
+  {
+    // Update just the dirty rectangles.
+    for (const auto& rect : dirtyRects)
     {
-      skip_pixels = -x;
-      x = 0;
+      DCHECK(rect.x + rect.width <= m_viewWidth);
+      DCHECK(rect.y + rect.height <= m_viewHeight);
+
+      TexSubImage(rect, buffer, m_viewWidth);
     }
-    if (y < 0)
+  }
+}
+
+void CRendererClientOpenGL::TexImage(int width, int height, const void* buffer)
+{
+  const void* pixels = buffer;
+  if (m_uploadFormat == UploadFormat::CPU_CONVERT)
+  {
+    m_scratch.resize(static_cast<size_t>(width) * height * 4);
+    PixelConvert::BGRAToRGBA(m_scratch.data(), static_cast<const uint8_t*>(buffer),
+                             static_cast<size_t>(width) * height);
+    pixels = m_scratch.data();
+  }
+
+  SetUnpackRowLength(0);
+  glTexImage2D(GL_TEXTURE_2D, 0, m_texInternalFormat, width, height, 0, m_texFormat, m_texType, pixels);
+}
+
+void CRendererClientOpenGL::TexSubImage(const CefRect& rect, const void* buffer, int bufferWidth)
+{
+  const size_t stride = static_cast<size_t>(bufferWidth) * 4;
+  const uint8_t* src = static_cast<const uint8_t*>(buffer) + rect.y * stride + rect.x * 4;
+
+  // The rows can be used in place if the driver knows the stride of the
+  // buffer or if they follow each other
+  const bool contiguous = rect.x == 0 && rect.width == bufferWidth;
+  if (m_uploadFormat != UploadFormat::CPU_CONVERT && (m_unpackRowLength || contiguous))
+  {
+    SetUnpackRowLength(contiguous ? 0 : bufferWidth);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width, rect.height, m_texFormat, m_texType, src);
+    return;
+  }
+
+  // Otherwise only the rows of the rectangle are copied packed into the
+  // scratch buffer, converted if needed
+  const size_t rowBytes = static_cast<size_t>(rect.width) * 4;
+  m_scratch.resize(rowBytes * rect.height);
+  if (contiguous)
+  {
+    CopyPixels(m_scratch.data(), src, static_cast<size_t>(rect.width) * rect.height);
+  }
+  else
+  {
+    for (int row = 0; row < rect.height; ++row)
+      CopyPixels(m_scratch.data() + row * rowBytes, src + row * stride, rect.width);
+  }
+
+  SetUnpackRowLength(0);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width, rect.height, m_texFormat, m_texType, m_scratch.data());
+}
+
+void CRendererClientOpenGL::CopyPixels(uint8_t* dst, const uint8_t* src, size_t pixels)
+{
+  if (m_uploadFormat == UploadFormat::CPU_CONVERT)
+    PixelConvert::BGRAToRGBA(dst, src, pixels);
+  else
+    memcpy(dst, src, pixels * 4);
+}
+
+void CRendererClientOpenGL::SetUnpackRowLength(int length)
+{
+#if defined(GL_UNPACK_ROW_LENGTH)
+  if (m_unpackRowLength)
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, length);
+#endif
+}
+
+void CRendererClientOpenGL::UploadPopup(const CefRenderHandler::RectList& dirtyRects,
+                                        const void* buffer,
+                                        int width,
+                                        int height)
+{
+  glBindTexture(GL_TEXTURE_2D, m_popupTextureId);
+
+  if (width != m_popupTextureWidth || height != m_popupTextureHeight)
+  {
+    TexImage(width, height, buffer);
+    m_popupTextureWidth = width;
+    m_popupTextureHeight = height;
+    CountUpload(static_cast<uint64_t>(width) * height * 4, 1);
+    return;
+  }
+
+  // Dirty rectangles are relative to the popup
+  for (const auto& rect : dirtyRects)
+  {
+    const int x = std::max(rect.x, 0);
+    const int y = std::max(rect.y, 0);
+    const int w = std::min(rect.x + rect.width, width) - x;
+    const int h = std::min(rect.y + rect.height, height) - y;
+    if (w <= 0 || h <= 0)
+      continue;
+
+    TexSubImage(CefRect(x, y, w, h), buffer, width);
+    CountUpload(static_cast<uint64_t>(w) * h * 4, 1);
+  }
+}
+
+bool CRendererClientOpenGL::UpdatePopupQuad()
+{
+  if (!m_popupShown || m_popupTextureWidth <= 0 || m_popupTextureHeight <= 0 ||
+      m_popupRect.width <= 0 || m_popupRect.height <= 0 || m_viewWidth <= 0 || m_viewHeight <= 0)
+    return false;
+
+  // Visible part of the popup inside the view
+  const int left = std::max(m_popupRect.x, 0);
+  const int top = std::max(m_popupRect.y, 0);
+  const int right = std::min(m_popupRect.x + m_popupRect.width, m_viewWidth);
+  const int bottom = std::min(m_popupRect.y + m_popupRect.height, m_viewHeight);
+  if (right <= left || bottom <= top)
+    return false;
+
+  // View pixels to normalized device coordinates, where y goes upwards
+  const float x0 = 2.0f * left / m_viewWidth - 1.0f;
+  const float x1 = 2.0f * right / m_viewWidth - 1.0f;
+  const float y0 = 1.0f - 2.0f * top / m_viewHeight;
+  const float y1 = 1.0f - 2.0f * bottom / m_viewHeight;
+  m_popupVertexPos[0] = glm::vec3(x0, y0, 0.0f);
+  m_popupVertexPos[1] = glm::vec3(x1, y0, 0.0f);
+  m_popupVertexPos[2] = glm::vec3(x1, y1, 0.0f);
+  m_popupVertexPos[3] = glm::vec3(x0, y1, 0.0f);
+
+  const float u0 = float(left - m_popupRect.x) / m_popupRect.width;
+  const float u1 = float(right - m_popupRect.x) / m_popupRect.width;
+  const float v0 = float(top - m_popupRect.y) / m_popupRect.height;
+  const float v1 = float(bottom - m_popupRect.y) / m_popupRect.height;
+  m_popupVertexCoord[0] = glm::vec2(u0, v0);
+  m_popupVertexCoord[1] = glm::vec2(u1, v0);
+  m_popupVertexCoord[2] = glm::vec2(u1, v1);
+  m_popupVertexCoord[3] = glm::vec2(u0, v1);
+  return true;
+}
+
+/*
+ * Upload over pixel buffer objects.
+ *
+ * The dirty regions of the CEF buffer are copied into the next free buffer of
+ * the ring, the texture itself is updated from this buffer later (before the
+ * next paint or before render). The texture transfer is then done by the GPU
+ * asynchronously while the CPU copies the next frame in another buffer of the
+ * ring, where by the ring size prevents to wait for a buffer still in use.
+ */
+void CRendererClientOpenGL::UploadViewPBO(const CefRenderHandler::RectList& dirtyRects,
+                                          const void* buffer,
+                                          bool resized)
+{
+#if defined(HAS_PBO_UPLOAD)
+  if (resized)
+  {
+    // Staged pixels of old size are worthless now
+    m_pboPending = -1;
+    if (!CreatePBOs(m_viewWidth, m_viewHeight))
     {
-      skip_rows = -y;
-      y = 0;
+      UploadViewDirect(dirtyRects, buffer, true);
+      return;
     }
-    if (x + w > m_viewWidth)
-      w -= x + w - m_viewWidth;
-    if (y + h > m_viewHeight)
-      h -= y + h - m_viewHeight;
+  }
+  else
+  {
+    // Start GPU transfer of previous frame before the next becomes staged
+    FlushPendingPBO();
+  }
 
-    // Update the popup rectangle.
-    glBindTexture(GL_TEXTURE_2D, m_textureId);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
-    glPixelStorei(GL_UNPACK_SKIP_PIXELS, skip_pixels);
-    glPixelStorei(GL_UNPACK_SKIP_ROWS, skip_rows);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, buffer);
+  const int index = m_pboIndex;
+  m_pboIndex = (m_pboIndex + 1) % PBO_RING_SIZE;
+
+  const size_t stride = static_cast<size_t>(m_viewWidth) * 4;
+  const size_t size = stride * m_viewHeight;
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo[index]);
+  uint8_t* dst = static_cast<uint8_t*>(glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+  if (!dst)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CRendererClientOpenGL::%s: Failed to map pixel buffer object, using direct upload", __func__);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    DestroyPBOs();
+    m_usePBO = false;
+    UploadViewDirect(dirtyRects, buffer, true);
+    return;
   }
 
-  SetDirty();
+  const uint8_t* src = static_cast<const uint8_t*>(buffer);
+  m_pboPendingRects.clear();
+  if (resized)
+  {
+    CopyPixels(dst, src, static_cast<size_t>(m_viewWidth) * m_viewHeight);
+    m_pboPendingRects.push_back(CefRect(0, 0, m_viewWidth, m_viewHeight));
+  }
+  else
+  {
+    for (const auto& rect : dirtyRects)
+    {
+      DCHECK(rect.x + rect.width <= m_viewWidth);
+      DCHECK(rect.y + rect.height <= m_viewHeight);
 
-  glBindTexture(GL_TEXTURE_2D, 0);
-  glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
-  glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
-  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+      const size_t offset = rect.y * stride + rect.x * 4;
+      if (rect.x == 0 && rect.width == m_viewWidth)
+      {
+        CopyPixels(dst + offset, src + offset, static_cast<size_t>(m_viewWidth) * rect.height);
+      }
+      else
+      {
+        for (int row = 0; row < rect.height; ++row)
+          CopyPixels(dst + offset + row * stride, src + offset + row * stride, rect.width);
+      }
+      m_pboPendingRects.push_back(rect);
+    }
+  }
+
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  m_pboPending = index;
+  m_pboPendingResize = resized;
+#else
+  UploadViewDirect(dirtyRects, buffer, resized);
+#endif
 }
 
-void CRendererClientOpenGL::Render()
+void CRendererClientOpenGL::FlushPendingPBO()
 {
-  if (m_useTransparentBackground)
+#if defined(HAS_PBO_UPLOAD)
+  if (m_pboPending < 0)
+    return;
+
+  glBindTexture(GL_TEXTURE_2D, m_textureId);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo[m_pboPending]);
+
+  // With a bound unpack buffer is the data pointer the offset inside it, the
+  // pixels in it are already in texture format
+  if (m_pboPendingResize)
   {
-    // Enable alpha blending.
-    glEnable(GL_BLEND);
+    SetUnpackRowLength(0);
+    glTexImage2D(GL_TEXTURE_2D, 0, m_texInternalFormat, m_viewWidth, m_viewHeight, 0, m_texFormat, m_texType, nullptr);
+  }
+  else
+  {
+    SetUnpackRowLength(m_viewWidth);
+    for (const auto& rect : m_pboPendingRects)
+    {
+      const size_t offset = (static_cast<size_t>(rect.y) * m_viewWidth + rect.x) * 4;
+      glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width, rect.height, m_texFormat, m_texType, reinterpret_cast<const void*>(offset));
+    }
+  }
 
-    // Alpha blending style. Texture values have premultiplied alpha.
-    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  SetUnpackRowLength(0);
+
+  m_pboPending = -1;
+  m_pboPendingRects.clear();
+#endif
+}
+
+bool CRendererClientOpenGL::CheckPBOSupport()
+{
+#if defined(HAS_PBO_UPLOAD)
+  const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  if (!version)
+    return false;
+
+  // glMapBufferRange() is present since OpenGL 3.0 and OpenGL ES 3.0, the
+  // staged rectangles need also the row length
+  if (GetGLMajorVersion(version) < 3 || !m_unpackRowLength)
+  {
+    kodi::Log(ADDON_LOG_INFO, "CRendererClientOpenGL::%s: Pixel buffer objects not usable with '%s', using direct upload",
+              __func__, version);
+    return false;
   }
 
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, m_textureId);
+  return true;
+#else
+  kodi::Log(ADDON_LOG_INFO, "CRendererClientOpenGL::%s: Pixel buffer objects not supported by build, using direct upload",
+            __func__);
+  return false;
+#endif
+}
 
-  EnableShader();
+void CRendererClientOpenGL::NegotiateUploadFormat()
+{
+  const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
 
 #if defined(HAS_GL)
-  glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO[0]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(m_vertexPos), m_vertexPos, GL_STATIC_DRAW);
-  glVertexAttribPointer(m_aPosition, 3, GL_FLOAT, 0, sizeof(glm::vec3), 0);
-  glEnableVertexAttribArray(m_aPosition);
+  const bool nativeBGRA = true;
+  m_unpackRowLength = true;
+#else
+  const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+  const bool nativeBGRA = HasExtension(extensions, "GL_EXT_texture_format_BGRA8888") ||
+                          HasExtension(extensions, "GL_APPLE_texture_format_BGRA8888");
+#if defined(GL_UNPACK_ROW_LENGTH)
+  m_unpackRowLength =
+      GetGLMajorVersion(version) >= 3 || HasExtension(extensions, "GL_EXT_unpack_subimage");
+#else
+  m_unpackRowLength = false;
+#endif
+#endif
 
-  glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO[1]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(m_vertexCoord), m_vertexCoord, GL_STATIC_DRAW);
-  glVertexAttribPointer(m_aCoord, 2, GL_FLOAT, 0, sizeof(glm::vec2), 0);
-  glEnableVertexAttribArray(m_aCoord);
+  // Automatic selection takes the cheapest usable way
+  UploadFormat format = nativeBGRA ? UploadFormat::NATIVE_BGRA
+                                   : (m_uSwizzle >= 0 ? UploadFormat::SHADER_SWIZZLE
+                                                      : UploadFormat::CPU_CONVERT);
+  switch (kodi::GetSettingInt("performance.upload_format", 0))
+  {
+    case 1:
+      if (nativeBGRA)
+        format = UploadFormat::NATIVE_BGRA;
+      else
+        kodi::Log(ADDON_LOG_WARNING, "CRendererClientOpenGL::%s: BGRA textures not supported by '%s', using automatic selection",
+                  __func__, version ? version : "");
+      break;
+    case 2:
+      format = m_uSwizzle >= 0 ? UploadFormat::SHADER_SWIZZLE : UploadFormat::CPU_CONVERT;
+      break;
+    case 3:
+      format = UploadFormat::CPU_CONVERT;
+      break;
+    default:
+      break;
+  }
 
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLubyte)*4, m_idx, GL_STATIC_DRAW);
+  m_uploadFormat = format;
+  if (m_uploadFormat == UploadFormat::NATIVE_BGRA)
+  {
+#if defined(HAS_GL)
+    m_texInternalFormat = GL_RGBA;
+    m_texFormat = GL_BGRA;
+    m_texType = GL_UNSIGNED_INT_8_8_8_8_REV;
+#else
+    // OpenGL ES needs the same internal format as the pixel format
+    m_texInternalFormat = GL_BGRA;
+    m_texFormat = GL_BGRA;
+    m_texType = GL_UNSIGNED_BYTE;
+#endif
+  }
+  else
+  {
+    m_texInternalFormat = GL_RGBA;
+    m_texFormat = GL_RGBA;
+    m_texType = GL_UNSIGNED_BYTE;
+  }
+
+  static const char* names[] = {"native BGRA", "shader swizzle", "CPU conversion"};
+  kodi::Log(ADDON_LOG_INFO, "CRendererClientOpenGL::%s: Texture upload with %s%s", __func__,
+            names[static_cast<int>(m_uploadFormat)],
+            m_unpackRowLength ? "" : ", dirty rows packed (no unpack row length)");
+}
+
+bool CRendererClientOpenGL::CreatePBOs(int width, int height)
+{
+#if defined(HAS_PBO_UPLOAD)
+  DestroyPBOs();
 
-  if (!m_useTransparentBackground)
+  glGenBuffers(PBO_RING_SIZE, m_pbo);
+  for (const GLuint pbo : m_pbo)
   {
-    glUniform1i(m_uClearColor, true);
-    glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<size_t>(width) * height * 4, nullptr, GL_STREAM_DRAW);
   }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
-  glUniform1i(m_uClearColor, false);
-  glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_BYTE, 0);
+  if (glGetError() != GL_NO_ERROR)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CRendererClientOpenGL::%s: Failed to create pixel buffer objects with %ix%i, using direct upload",
+              __func__, width, height);
+    DestroyPBOs();
+    m_usePBO = false;
+    return false;
+  }
 
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  m_pboIndex = 0;
+  return true;
+#else
+  return false;
+#endif
+}
 
-  glDisableVertexAttribArray(m_aPosition);
-  glDisableVertexAttribArray(m_aCoord);
+void CRendererClientOpenGL::DestroyPBOs()
+{
+  if (m_pbo[0] != 0)
+  {
+    glDeleteBuffers(PBO_RING_SIZE, m_pbo);
+    for (GLuint& pbo : m_pbo)
+      pbo = 0;
+  }
 
-#elif defined(HAS_GLES)
-  glVertexAttribPointer(m_aPosition, 3, GL_FLOAT, 0, 0, m_vertexPos);
-  glEnableVertexAttribArray(m_aPosition);
+  m_pboPending = -1;
+  m_pboPendingRects.clear();
+}
 
-  glVertexAttribPointer(m_aCoord, 2, GL_FLOAT, 0, 0, m_vertexCoord);
-  glEnableVertexAttribArray(m_aCoord);
+void CRendererClientOpenGL::Render()
+{
+  // Bring last staged frame to the texture
+  FlushPendingPBO();
 
-  if (!m_useTransparentBackground)
+  if (m_useTransparentBackground)
   {
-    glUniform1i(m_uClearColor, true);
-    glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_BYTE, m_idx);
+    // Enable alpha blending.
+    glEnable(GL_BLEND);
+
+    // Alpha blending style. Texture values have premultiplied alpha.
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
   }
 
-  glUniform1i(m_uClearColor, false);
-  glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_BYTE, m_idx);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, m_textureId);
 
-  glDisableVertexAttribArray(m_aPosition);
-  glDisableVertexAttribArray(m_aCoord);
+  EnableShader();
 
-#endif
+  SetSharpen(m_viewWidth, m_viewHeight);
+  DrawQuad(m_vertexPos, m_vertexCoord, !m_useTransparentBackground);
+
+  if (UpdatePopupQuad())
+  {
+    glBindTexture(GL_TEXTURE_2D, m_popupTextureId);
+    SetSharpen(m_popupTextureWidth, m_popupTextureHeight);
+    DrawQuad(m_popupVertexPos, m_popupVertexCoord, false);
+    glBindTexture(GL_TEXTURE_2D, m_textureId);
+  }
 
   // Disable alpha blending.
   if (m_useTransparentBackground)
@@ -307,16 +773,111 @@ void CRendererClientOpenGL::Render()
   DisableShader();
 }
 
+void CRendererClientOpenGL::DrawQuad(const glm::vec3* vertexPos,
+                                     const glm::vec2* vertexCoord,
+                                     bool clearBackground)
+{
+#if defined(HAS_GL)
+  glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO[0]);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * 4, vertexPos, GL_STATIC_DRAW);
+  glVertexAttribPointer(m_aPosition, 3, GL_FLOAT, 0, sizeof(glm::vec3), 0);
+  glEnableVertexAttribArray(m_aPosition);
+
+  glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO[1]);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * 4, vertexCoord, GL_STATIC_DRAW);
+  glVertexAttribPointer(m_aCoord, 2, GL_FLOAT, 0, sizeof(glm::vec2), 0);
+  glEnableVertexAttribArray(m_aCoord);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLubyte)*4, m_idx, GL_STATIC_DRAW);
+
+  if (clearBackground)
+  {
+    glUniform1i(m_uClearColor, true);
+    glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_BYTE, 0);
+  }
+
+  glUniform1i(m_uClearColor, false);
+  glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_BYTE, 0);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  glDisableVertexAttribArray(m_aPosition);
+  glDisableVertexAttribArray(m_aCoord);
+
+#elif defined(HAS_GLES)
+  glVertexAttribPointer(m_aPosition, 3, GL_FLOAT, 0, 0, vertexPos);
+  glEnableVertexAttribArray(m_aPosition);
+
+  glVertexAttribPointer(m_aCoord, 2, GL_FLOAT, 0, 0, vertexCoord);
+  glEnableVertexAttribArray(m_aCoord);
+
+  if (clearBackground)
+  {
+    glUniform1i(m_uClearColor, true);
+    glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_BYTE, m_idx);
+  }
+
+  glUniform1i(m_uClearColor, false);
+  glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_BYTE, m_idx);
+
+  glDisableVertexAttribArray(m_aPosition);
+  glDisableVertexAttribArray(m_aCoord);
+
+#endif
+}
+
+void CRendererClientOpenGL::SetSharpen(int textureWidth, int textureHeight)
+{
+  if (m_uSharpen < 0 || textureWidth <= 0 || textureHeight <= 0)
+    return;
+
+  // The bilinear upscale of a reduced render scale looks soft, more with
+  // smaller scales
+  float sharpen = 0.0f;
+  if (m_renderScale < 1.0f)
+    sharpen = std::min(1.0f / m_renderScale - 1.0f, 1.0f) * SHARPEN_STRENGTH;
+
+  glUniform1f(m_uSharpen, sharpen);
+  if (m_uTexelSize >= 0)
+    glUniform2f(m_uTexelSize, 1.0f / textureWidth, 1.0f / textureHeight);
+}
+
 void CRendererClientOpenGL::ScreenSizeChange(float x, float y, float width, float height)
 {
 }
 
+void CRendererClientOpenGL::OnPopupShow(CefRefPtr<CefBrowser> browser, bool show)
+{
+  IRenderer::OnPopupShow(browser, show);
+
+  // Old popup content must not become visible on the next show
+  m_popupShown = show;
+  if (!show)
+  {
+    m_popupTextureWidth = 0;
+    m_popupTextureHeight = 0;
+  }
+
+  SetDirty();
+}
+
+void CRendererClientOpenGL::OnPopupSize(CefRefPtr<CefBrowser> browser, const CefRect& rect)
+{
+  IRenderer::OnPopupSize(browser, rect);
+  SetDirty();
+}
+
 void CRendererClientOpenGL::OnCompiledAndLinked()
 {
   // Variables passed directly to the Vertex shader
   m_uModelProjMatrix = glGetUniformLocation(ProgramHandle(), "u_modelProjMatrix");
   m_uBackgroundColor = glGetUniformLocation(ProgramHandle(), "u_backgroundColor");
   m_uClearColor = glGetUniformLocation(ProgramHandle(), "u_clearColor");
+  m_uSwizzle = glGetUniformLocation(ProgramHandle(), "u_swizzle");
+  m_uSharpen = glGetUniformLocation(ProgramHandle(), "u_sharpen");
+  m_uTexelSize = glGetUniformLocation(ProgramHandle(), "u_texelSize");
   m_aPosition = glGetAttribLocation(ProgramHandle(), "a_position");
   m_aCoord = glGetAttribLocation(ProgramHandle(), "a_coord");
 }
@@ -326,6 +887,8 @@ bool CRendererClientOpenGL::OnEnabled()
   // This is called after glUseProgram()
   glUniformMatrix4fv(m_uModelProjMatrix, 1, GL_FALSE, glm::value_ptr(m_modelProjMat));
   glUniform4f(m_uBackgroundColor, m_backgroundColor[0], m_backgroundColor[1], m_backgroundColor[2], m_backgroundColor[3]);
+  if (m_uSwizzle >= 0)
+    glUniform1i(m_uSwizzle, m_uploadFormat == UploadFormat::SHADER_SWIZZLE);
   return true;
 }
 
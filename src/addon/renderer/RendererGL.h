@@ -9,11 +9,14 @@
 #pragma once
 
 #include "IRenderer.h"
+#include "TileChangeDetector.h"
 #include "include/cef_render_handler.h"
+#include "utils/TimeStatistics.h"
 
 #include <kodi/gui/gl/GL.h>
 #include <kodi/gui/gl/Shader.h>
 #include <glm/gtc/type_ptr.hpp>
+#include <vector>
 
 class CWebBrowserClient;
 
@@ -22,23 +25,57 @@ class ATTRIBUTE_HIDDEN CRendererClientOpenGL
     public kodi::gui::gl::CShaderProgram
 {
 public:
-  CRendererClientOpenGL(CefRefPtr<CWebBrowserClient> client);
+  CRendererClientOpenGL(const RendererConfig& config);
   ~CRendererClientOpenGL() override;
 
   bool Initialize() override;
   void Deinitialize() override;
+  void Suspend() override;
+  bool Resume() override;
+  size_t AllocatedBytes() const override;
 
   void OnPaint(CefBrowserHost::PaintElementType type, const CefRenderHandler::RectList& dirtyRects, const void* buffer, int width, int height) override;
 
   void Render() override;
   void ScreenSizeChange(float x, float y, float width, float height) override;
+  void OnPopupShow(CefRefPtr<CefBrowser> browser, bool show) override;
+  void OnPopupSize(CefRefPtr<CefBrowser> browser, const CefRect& rect) override;
 
   void OnCompiledAndLinked() override;
   bool OnEnabled() override;
 
 private:
+  static constexpr int PBO_RING_SIZE = 3;
+
+  // Way the BGRA pixels of CEF come into the RGBA sampled texture
+  enum class UploadFormat
+  {
+    NATIVE_BGRA, // Driver takes BGRA (desktop GL, GLES with BGRA8888 extension)
+    SHADER_SWIZZLE, // Uploaded as RGBA, channels swapped by fragment shader
+    CPU_CONVERT, // Channels swapped on CPU before upload
+  };
+
   void GetShaderPath(std::string& vert, std::string& frag);
 
+  void CreateResources();
+  void DestroyResources();
+  bool CheckPBOSupport();
+  bool CreatePBOs(int width, int height);
+  void DestroyPBOs();
+  void UploadViewDirect(const CefRenderHandler::RectList& dirtyRects, const void* buffer, bool resized);
+  void UploadViewPBO(const CefRenderHandler::RectList& dirtyRects, const void* buffer, bool resized);
+  void FlushPendingPBO();
+  void UploadPopup(const CefRenderHandler::RectList& dirtyRects, const void* buffer, int width, int height);
+  bool UpdatePopupQuad();
+  void DrawQuad(const glm::vec3* vertexPos, const glm::vec2* vertexCoord, bool clearBackground);
+
+  void NegotiateUploadFormat();
+  void TexImage(int width, int height, const void* buffer);
+  void TexSubImage(const CefRect& rect, const void* buffer, int bufferWidth);
+  void CopyPixels(uint8_t* dst, const uint8_t* src, size_t pixels);
+  void SetUnpackRowLength(int length);
+  void SetSharpen(int textureWidth, int textureHeight);
+
   glm::mat4 m_modelProjMat = glm::mat4(1.0f);
   glm::vec3 m_vertexPos[4];
   glm::vec2 m_vertexCoord[4];
@@ -50,8 +87,40 @@ private:
   GLint m_uModelProjMatrix = -1;
   GLint m_uBackgroundColor = -1;
   GLint m_uClearColor = -1;
+  GLint m_uSwizzle = -1;
+  GLint m_uSharpen = -1;
+  GLint m_uTexelSize = -1;
   GLint m_aPosition = -1;
   GLint m_aCoord = -1;
 
   GLuint m_textureId = 0;
+
+  // Negotiated texture upload, set on Initialize()
+  UploadFormat m_uploadFormat = UploadFormat::NATIVE_BGRA;
+  GLint m_texInternalFormat = GL_RGBA;
+  GLenum m_texFormat = GL_RGBA;
+  GLenum m_texType = GL_UNSIGNED_BYTE;
+  bool m_unpackRowLength = true;
+  std::vector<uint8_t> m_scratch;
+
+  // Popup (e.g. <select> dropdown) as own layer over the view
+  GLuint m_popupTextureId = 0;
+  int m_popupTextureWidth = 0;
+  int m_popupTextureHeight = 0;
+  bool m_popupShown = false;
+  glm::vec3 m_popupVertexPos[4];
+  glm::vec2 m_popupVertexCoord[4];
+
+  // Asynchronous texture upload over a ring of pixel buffer objects
+  bool m_usePBO = false;
+  GLuint m_pbo[PBO_RING_SIZE] = {0};
+  int m_pboIndex = 0;
+  int m_pboPending = -1;
+  bool m_pboPendingResize = false;
+  CefRenderHandler::RectList m_pboPendingRects;
+
+  // Skip upload of tiles where pixels not changed
+  CTileChangeDetector m_tileDetector;
+
+  CTimeStatistics m_uploadStats{"CRendererClientOpenGL: View upload", 300};
 };
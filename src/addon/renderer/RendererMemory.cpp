@@ -0,0 +1,311 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "RendererMemory.h"
+
+#include "include/wrapper/cef_helpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <kodi/General.h>
+
+namespace
+{
+
+/*!
+ * @brief Source position of a destination pixel center in 1/256 pixels,
+ * clamped to the edge texels like GL_LINEAR with GL_CLAMP_TO_EDGE.
+ */
+int SamplePosition(int dst, int dstSize, int srcSize)
+{
+  const int64_t position =
+      (static_cast<int64_t>(2 * dst + 1) * srcSize * 256) / (2 * dstSize) - 128;
+  return static_cast<int>(std::min<int64_t>(std::max<int64_t>(position, 0), (srcSize - 1) * 256));
+}
+
+} // namespace
+
+CRendererClientMemory::CRendererClientMemory(const RendererConfig& config)
+  : IRenderer(config)
+{
+}
+
+bool CRendererClientMemory::Initialize()
+{
+  m_dirty = true;
+  return true;
+}
+
+void CRendererClientMemory::Deinitialize()
+{
+  // Swap to give the memory really free, clear() keeps the capacity
+  std::vector<uint8_t>().swap(m_viewBuffer);
+  std::vector<uint8_t>().swap(m_popupBuffer);
+  std::vector<uint8_t>().swap(m_frameBuffer);
+  m_viewWidth = 0;
+  m_viewHeight = 0;
+  m_popupWidth = 0;
+  m_popupHeight = 0;
+  m_frameWidth = 0;
+  m_frameHeight = 0;
+}
+
+size_t CRendererClientMemory::AllocatedBytes() const
+{
+  return m_viewBuffer.capacity() + m_popupBuffer.capacity() + m_frameBuffer.capacity();
+}
+
+void CRendererClientMemory::OnPaint(CefBrowserHost::PaintElementType type,
+                                    const CefRenderHandler::RectList& dirtyRects,
+                                    const void* buffer,
+                                    int width,
+                                    int height)
+{
+  const auto start = CTimeStatistics::Now();
+  const uint8_t* src = static_cast<const uint8_t*>(buffer);
+
+  m_current.paints++;
+  m_current.dirtyRects += dirtyRects.size();
+
+  if (type == PET_VIEW)
+  {
+    const bool resized = width != m_viewWidth || height != m_viewHeight;
+    m_viewWidth = width;
+    m_viewHeight = height;
+
+    // Same selection of the rectangles as done by the GL renderer
+    CefRenderHandler::RectList uploadRects;
+    bool fullUpload = true;
+    if (resized)
+    {
+      m_viewBuffer.resize(static_cast<size_t>(m_viewWidth) * m_viewHeight * 4);
+      if (m_useTileHash)
+        m_tileDetector.Reset(m_viewWidth, m_viewHeight);
+      uploadRects.assign(1, CefRect(0, 0, m_viewWidth, m_viewHeight));
+    }
+    else if (m_useTileHash)
+    {
+      CefRenderHandler::RectList changedRects;
+      m_tileDetector.Filter(dirtyRects, buffer, changedRects);
+      fullUpload = OptimizeDirtyRects(changedRects, uploadRects);
+    }
+    else
+    {
+      fullUpload = OptimizeDirtyRects(dirtyRects, uploadRects);
+    }
+
+    uint64_t bytes = 0;
+    for (const auto& rect : uploadRects)
+    {
+      CopyRect(rect, src);
+      bytes += static_cast<uint64_t>(rect.width) * rect.height * 4;
+    }
+
+    m_current.fullUpload |= fullUpload;
+    m_current.uploadRects += uploadRects.size();
+    m_current.uploadBytes += bytes;
+    m_paintStats.AddSample(start, bytes, static_cast<unsigned int>(uploadRects.size()));
+    CountUpload(bytes, uploadRects.size());
+  }
+  else if (type == PET_POPUP)
+  {
+    const size_t stride = static_cast<size_t>(width) * 4;
+    if (width != m_popupWidth || height != m_popupHeight)
+    {
+      m_popupWidth = width;
+      m_popupHeight = height;
+      m_popupBuffer.assign(src, src + stride * height);
+      m_current.uploadRects++;
+      m_current.uploadBytes += m_popupBuffer.size();
+      CountUpload(m_popupBuffer.size(), 1);
+    }
+    else
+    {
+      // Dirty rectangles are relative to the popup
+      for (const auto& rect : dirtyRects)
+      {
+        const int x = std::max(rect.x, 0);
+        const int y = std::max(rect.y, 0);
+        const int w = std::min(rect.x + rect.width, width) - x;
+        const int h = std::min(rect.y + rect.height, height) - y;
+        if (w <= 0 || h <= 0)
+          continue;
+
+        for (int row = y; row < y + h; ++row)
+          memcpy(&m_popupBuffer[row * stride + x * 4], src + row * stride + x * 4, w * 4);
+        m_current.uploadRects++;
+        m_current.uploadBytes += static_cast<uint64_t>(w) * h * 4;
+        CountUpload(static_cast<uint64_t>(w) * h * 4, 1);
+      }
+    }
+  }
+
+  m_current.paintMs +=
+      std::chrono::duration<double, std::milli>(CTimeStatistics::Now() - start).count();
+
+  SetDirty();
+}
+
+void CRendererClientMemory::OnPopupShow(CefRefPtr<CefBrowser> browser, bool show)
+{
+  IRenderer::OnPopupShow(browser, show);
+
+  // Old popup content must not become visible on the next show
+  m_popupShown = show;
+  if (!show)
+  {
+    m_popupBuffer.clear();
+    m_popupWidth = 0;
+    m_popupHeight = 0;
+  }
+
+  SetDirty();
+}
+
+void CRendererClientMemory::OnPopupSize(CefRefPtr<CefBrowser> browser, const CefRect& rect)
+{
+  IRenderer::OnPopupSize(browser, rect);
+  SetDirty();
+}
+
+void CRendererClientMemory::Render()
+{
+  m_frameWidth = m_viewWidth;
+  m_frameHeight = m_viewHeight;
+  m_frameBuffer = m_viewBuffer;
+  BlendPopup();
+
+  m_frames++;
+  m_total.paints += m_current.paints;
+  m_total.dirtyRects += m_current.dirtyRects;
+  m_total.uploadRects += m_current.uploadRects;
+  m_total.uploadBytes += m_current.uploadBytes;
+  m_total.fullUpload |= m_current.fullUpload;
+  m_total.paintMs += m_current.paintMs;
+  m_lastFrame = m_current;
+  m_current = FrameStats();
+}
+
+bool CRendererClientMemory::DumpFrame(const std::string& path) const
+{
+  if (m_frameBuffer.empty())
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CRendererClientMemory::%s: No frame rendered to dump", __func__);
+    return false;
+  }
+
+  const std::string header =
+      "P6\n" + std::to_string(m_frameWidth) + " " + std::to_string(m_frameHeight) + "\n255\n";
+
+  std::vector<uint8_t> data(header.begin(), header.end());
+  data.reserve(header.size() + static_cast<size_t>(m_frameWidth) * m_frameHeight * 3);
+  for (size_t i = 0; i < m_frameBuffer.size(); i += 4)
+  {
+    // BGRA to RGB
+    data.push_back(m_frameBuffer[i + 2]);
+    data.push_back(m_frameBuffer[i + 1]);
+    data.push_back(m_frameBuffer[i + 0]);
+  }
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "CRendererClientMemory::%s: Failed to open '%s' for write",
+              __func__, path.c_str());
+    return false;
+  }
+
+  const bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+  return fclose(file) == 0 && written;
+}
+
+void CRendererClientMemory::CopyRect(const CefRect& rect, const uint8_t* src)
+{
+  DCHECK(rect.x + rect.width <= m_viewWidth);
+  DCHECK(rect.y + rect.height <= m_viewHeight);
+
+  const size_t stride = static_cast<size_t>(m_viewWidth) * 4;
+  const size_t offset = rect.y * stride + rect.x * 4;
+  if (rect.x == 0 && rect.width == m_viewWidth)
+  {
+    memcpy(&m_viewBuffer[offset], src + offset, stride * rect.height);
+    return;
+  }
+
+  const size_t rowSize = static_cast<size_t>(rect.width) * 4;
+  for (int row = 0; row < rect.height; ++row)
+    memcpy(&m_viewBuffer[offset + row * stride], src + offset + row * stride, rowSize);
+}
+
+void CRendererClientMemory::BlendPopup()
+{
+  if (!m_popupShown || m_popupBuffer.empty() || m_popupRect.width <= 0 ||
+      m_popupRect.height <= 0 || m_frameBuffer.empty())
+    return;
+
+  // Visible part of the popup inside the view, same clip as the GL quad
+  const int left = std::max(m_popupRect.x, 0);
+  const int top = std::max(m_popupRect.y, 0);
+  const int right = std::min(m_popupRect.x + m_popupRect.width, m_frameWidth);
+  const int bottom = std::min(m_popupRect.y + m_popupRect.height, m_frameHeight);
+  if (right <= left || bottom <= top)
+    return;
+
+  const size_t dstStride = static_cast<size_t>(m_frameWidth) * 4;
+  const size_t srcStride = static_cast<size_t>(m_popupWidth) * 4;
+  const bool sameSize = m_popupRect.width == m_popupWidth && m_popupRect.height == m_popupHeight;
+
+  for (int y = top; y < bottom; ++y)
+  {
+    uint8_t* dst = &m_frameBuffer[y * dstStride + left * 4];
+
+    // Texel centers meet pixel centers, the samples are the texels itself
+    if (sameSize && !m_useTransparentBackground)
+    {
+      memcpy(dst, &m_popupBuffer[(y - m_popupRect.y) * srcStride + (left - m_popupRect.x) * 4],
+             (right - left) * 4);
+      continue;
+    }
+
+    // Bilinear sample otherwise, the GL texture is scaled with GL_LINEAR by
+    // the quad
+    const int sy = SamplePosition(y - m_popupRect.y, m_popupRect.height, m_popupHeight);
+    const int fy = sy & 255;
+    const uint8_t* row0 = &m_popupBuffer[(sy >> 8) * srcStride];
+    const uint8_t* row1 = &m_popupBuffer[std::min((sy >> 8) + 1, m_popupHeight - 1) * srcStride];
+
+    for (int x = left; x < right; ++x, dst += 4)
+    {
+      const int sx = SamplePosition(x - m_popupRect.x, m_popupRect.width, m_popupWidth);
+      const int fx = sx & 255;
+      const size_t x0 = static_cast<size_t>(sx >> 8) * 4;
+      const size_t x1 = static_cast<size_t>(std::min((sx >> 8) + 1, m_popupWidth - 1)) * 4;
+
+      uint8_t src[4];
+      for (int c = 0; c < 4; ++c)
+      {
+        const int upper = row0[x0 + c] * (256 - fx) + row0[x1 + c] * fx;
+        const int lower = row1[x0 + c] * (256 - fx) + row1[x1 + c] * fx;
+        src[c] = static_cast<uint8_t>((upper * (256 - fy) + lower * fy + 32768) >> 16);
+      }
+
+      if (!m_useTransparentBackground)
+      {
+        memcpy(dst, src, 4);
+        continue;
+      }
+
+      // Premultiplied alpha, same as glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA)
+      const unsigned int inverse = 255 - src[3];
+      for (int c = 0; c < 4; ++c)
+        dst[c] = static_cast<uint8_t>(src[c] + (dst[c] * inverse + 127) / 255);
+    }
+  }
+}
@@ -0,0 +1,100 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "IRenderer.h"
+#include "TileChangeDetector.h"
+#include "include/cef_render_handler.h"
+#include "utils/TimeStatistics.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*!
+ * @brief Renderer where the "texture" is a framebuffer in system memory.
+ *
+ * Applies the view and popup paints in the same way as the GL renderer, only
+ * without any GPU. Used by the add-on if built with KODICHROMIUM_MEMORY_RENDERER,
+ * and by the paint replay to check and benchmark the paint path without
+ * display. It needs neither the client nor Kodi's settings and files.
+ *
+ * All buffers are BGRA with premultiplied alpha, like given by CEF.
+ */
+class ATTRIBUTE_HIDDEN CRendererClientMemory : public IRenderer
+{
+public:
+  struct FrameStats
+  {
+    uint64_t paints = 0; // View and popup paints since last Render()
+    uint64_t dirtyRects = 0; // Dirty rectangles given by CEF
+    uint64_t uploadRects = 0; // Rectangles copied after optimize
+    uint64_t uploadBytes = 0; // Bytes copied into view and popup buffer
+    bool fullUpload = false; // A paint was done as full view copy
+    double paintMs = 0.0; // Time used inside OnPaint()
+  };
+
+  CRendererClientMemory(const RendererConfig& config);
+  ~CRendererClientMemory() override = default;
+
+  bool Initialize() override;
+  void Deinitialize() override;
+  size_t AllocatedBytes() const override;
+
+  void OnPaint(CefBrowserHost::PaintElementType type, const CefRenderHandler::RectList& dirtyRects, const void* buffer, int width, int height) override;
+  void OnPopupShow(CefRefPtr<CefBrowser> browser, bool show) override;
+  void OnPopupSize(CefRefPtr<CefBrowser> browser, const CefRect& rect) override;
+
+  /*!
+   * @brief Compose view and popup into the frame buffer, as it would be shown.
+   */
+  void Render() override;
+
+  const std::vector<uint8_t>& ViewBuffer() const { return m_viewBuffer; }
+  const std::vector<uint8_t>& FrameBuffer() const { return m_frameBuffer; }
+  int FrameWidth() const { return m_frameWidth; }
+  int FrameHeight() const { return m_frameHeight; }
+
+  /*!
+   * @brief Values of the last rendered frame and the sum of all frames.
+   */
+  const FrameStats& LastFrameStats() const { return m_lastFrame; }
+  const FrameStats& TotalStats() const { return m_total; }
+  uint64_t Frames() const { return m_frames; }
+
+  /*!
+   * @brief Write the last rendered frame as binary PPM (without alpha).
+   *
+   * @param[in] path Local file path
+   * @return true if successfully written
+   */
+  bool DumpFrame(const std::string& path) const;
+
+private:
+  void CopyRect(const CefRect& rect, const uint8_t* src);
+  void BlendPopup();
+
+  std::vector<uint8_t> m_viewBuffer;
+  std::vector<uint8_t> m_popupBuffer;
+  int m_popupWidth = 0;
+  int m_popupHeight = 0;
+  bool m_popupShown = false;
+
+  std::vector<uint8_t> m_frameBuffer;
+  int m_frameWidth = 0;
+  int m_frameHeight = 0;
+
+  CTileChangeDetector m_tileDetector;
+
+  uint64_t m_frames = 0;
+  FrameStats m_current;
+  FrameStats m_lastFrame;
+  FrameStats m_total;
+  CTimeStatistics m_paintStats{"CRendererClientMemory: View paint", 300};
+};
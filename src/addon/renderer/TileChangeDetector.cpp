@@ -0,0 +1,220 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "TileChangeDetector.h"
+
+#include <algorithm>
+#include <cstring>
+#include <kodi/General.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAS_SSE2_HASH 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAS_NEON_HASH 1
+#endif
+
+namespace
+{
+
+/*
+ * The hash uses four independent 32 bit lanes where every 16 byte block is
+ * mixed in with "lane = (lane ^ data) * prime". As the step is a bijection for
+ * lane and data, a single changed block is always detected. The lanes are
+ * folded together to 64 bit at end.
+ */
+constexpr uint32_t HASH_PRIME = 0x9E3779B1u;
+constexpr uint32_t HASH_SEED[4] = {0x85EBCA77u, 0xC2B2AE3Du, 0x27D4EB2Fu, 0x165667B1u};
+
+inline uint64_t Fmix64(uint64_t k)
+{
+  k ^= k >> 33;
+  k *= 0xFF51AFD7ED558CCDull;
+  k ^= k >> 33;
+  k *= 0xC4CEB9FE1A85EC53ull;
+  k ^= k >> 33;
+  return k;
+}
+
+#if defined(HAS_SSE2_HASH)
+inline __m128i Mul32(__m128i a, __m128i b)
+{
+  // SSE2 has no 32 bit low multiply, use two 32x32->64 multiplies
+  const __m128i even = _mm_mul_epu32(a, b);
+  const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#endif
+
+} // namespace
+
+void CTileChangeDetector::Reset(int viewWidth, int viewHeight)
+{
+  m_viewWidth = std::max(viewWidth, 0);
+  m_viewHeight = std::max(viewHeight, 0);
+  m_tilesX = (m_viewWidth + TILE_SIZE - 1) / TILE_SIZE;
+  m_tilesY = (m_viewHeight + TILE_SIZE - 1) / TILE_SIZE;
+
+  const size_t count = static_cast<size_t>(m_tilesX) * m_tilesY;
+  m_hashes.assign(count, 0);
+  m_valid.assign(count, 0);
+  m_checked.assign(count, 0);
+}
+
+void CTileChangeDetector::Invalidate(const CefRect& rect)
+{
+  int x0, y0, x1, y1;
+  if (!TileRange(rect, x0, y0, x1, y1))
+    return;
+
+  for (int ty = y0; ty <= y1; ++ty)
+    std::fill_n(m_valid.begin() + ty * m_tilesX + x0, x1 - x0 + 1, 0);
+}
+
+void CTileChangeDetector::Filter(const CefRenderHandler::RectList& dirtyRects,
+                                 const void* buffer,
+                                 CefRenderHandler::RectList& changedRects)
+{
+  changedRects.clear();
+  std::fill(m_checked.begin(), m_checked.end(), 0);
+
+  const uint8_t* pixels = static_cast<const uint8_t*>(buffer);
+  const size_t stride = static_cast<size_t>(m_viewWidth) * 4;
+
+  for (const auto& rect : dirtyRects)
+  {
+    int x0, y0, x1, y1;
+    if (!TileRange(rect, x0, y0, x1, y1))
+      continue;
+
+    for (int ty = y0; ty <= y1; ++ty)
+    {
+      for (int tx = x0; tx <= x1; ++tx)
+      {
+        const size_t idx = static_cast<size_t>(ty) * m_tilesX + tx;
+        if (m_checked[idx])
+          continue;
+        m_checked[idx] = 1;
+
+        // Copied, std::min would bind the static member by reference
+        const int tileSize = TILE_SIZE;
+        const int x = tx * tileSize;
+        const int y = ty * tileSize;
+        const int w = std::min(tileSize, m_viewWidth - x);
+        const int h = std::min(tileSize, m_viewHeight - y);
+
+        const uint64_t hash = HashPixels(pixels + y * stride + x * 4, stride, w, h);
+        if (m_valid[idx] && m_hashes[idx] == hash)
+        {
+          m_skippedTiles++;
+          continue;
+        }
+
+        m_hashes[idx] = hash;
+        m_valid[idx] = 1;
+        m_uploadedTiles++;
+        changedRects.push_back(CefRect(x, y, w, h));
+      }
+    }
+  }
+
+  if (++m_filterCalls % 300 == 0)
+  {
+    const uint64_t total = m_uploadedTiles + m_skippedTiles;
+    kodi::Log(ADDON_LOG_DEBUG,
+              "CTileChangeDetector: %llu tiles uploaded, %llu tiles skipped (%.1f %% skipped)",
+              static_cast<unsigned long long>(m_uploadedTiles),
+              static_cast<unsigned long long>(m_skippedTiles),
+              total > 0 ? 100.0 * m_skippedTiles / total : 0.0);
+  }
+}
+
+uint64_t CTileChangeDetector::HashPixels(const uint8_t* data, size_t stride, int width, int height)
+{
+  const size_t rowBytes = static_cast<size_t>(width) * 4;
+  const size_t blockBytes = rowBytes & ~size_t(15);
+  uint32_t lanes[4];
+
+#if defined(HAS_SSE2_HASH)
+  const __m128i prime = _mm_set1_epi32(static_cast<int>(HASH_PRIME));
+  __m128i acc = _mm_loadu_si128(reinterpret_cast<const __m128i*>(HASH_SEED));
+  for (int y = 0; y < height; ++y)
+  {
+    const uint8_t* row = data + y * stride;
+    for (size_t i = 0; i < blockBytes; i += 16)
+    {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+      acc = Mul32(_mm_xor_si128(acc, v), prime);
+    }
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+#elif defined(HAS_NEON_HASH)
+  const uint32x4_t prime = vdupq_n_u32(HASH_PRIME);
+  uint32x4_t acc = vld1q_u32(HASH_SEED);
+  for (int y = 0; y < height; ++y)
+  {
+    const uint8_t* row = data + y * stride;
+    for (size_t i = 0; i < blockBytes; i += 16)
+    {
+      const uint32x4_t v = vreinterpretq_u32_u8(vld1q_u8(row + i));
+      acc = vmulq_u32(veorq_u32(acc, v), prime);
+    }
+  }
+  vst1q_u32(lanes, acc);
+#else
+  std::copy(HASH_SEED, HASH_SEED + 4, lanes);
+  for (int y = 0; y < height; ++y)
+  {
+    const uint8_t* row = data + y * stride;
+    for (size_t i = 0; i < blockBytes; i += 16)
+    {
+      uint32_t v[4];
+      memcpy(v, row + i, sizeof(v));
+      for (int l = 0; l < 4; ++l)
+        lanes[l] = (lanes[l] ^ v[l]) * HASH_PRIME;
+    }
+  }
+#endif
+
+  // Remaining pixels of rows where width is not a multiple of 4
+  if (blockBytes != rowBytes)
+  {
+    for (int y = 0; y < height; ++y)
+    {
+      const uint8_t* row = data + y * stride;
+      for (size_t i = blockBytes, l = 0; i < rowBytes; i += 4, ++l)
+      {
+        uint32_t v;
+        memcpy(&v, row + i, sizeof(v));
+        lanes[l] = (lanes[l] ^ v) * HASH_PRIME;
+      }
+    }
+  }
+
+  const uint64_t low = (static_cast<uint64_t>(lanes[1]) << 32) | lanes[0];
+  const uint64_t high = (static_cast<uint64_t>(lanes[3]) << 32) | lanes[2];
+  return Fmix64(low ^ Fmix64(high + rowBytes * height));
+}
+
+bool CTileChangeDetector::TileRange(const CefRect& rect, int& x0, int& y0, int& x1, int& y1) const
+{
+  const int left = std::max(rect.x, 0);
+  const int top = std::max(rect.y, 0);
+  const int right = std::min(rect.x + rect.width, m_viewWidth);
+  const int bottom = std::min(rect.y + rect.height, m_viewHeight);
+  if (right <= left || bottom <= top)
+    return false;
+
+  x0 = left / TILE_SIZE;
+  y0 = top / TILE_SIZE;
+  x1 = (right - 1) / TILE_SIZE;
+  y1 = (bottom - 1) / TILE_SIZE;
+  return true;
+}
@@ -0,0 +1,86 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "include/cef_render_handler.h"
+
+#include <stdint.h>
+#include <vector>
+
+/*!
+ * @brief Detect the really changed parts inside dirty rectangles.
+ *
+ * CEF reports often big dirty regions where the pixels are the same as before
+ * (e.g. whole view after a layout flush). To prevent the upload of them is the
+ * view split in fixed tiles and a 64 bit hash of every uploaded tile stored.
+ * Only tiles inside a dirty rectangle where the hash changed are returned.
+ *
+ * Tiles where the texture got other content as the view buffer must be marked
+ * with Invalidate(), so they are uploaded again on next paint independent of
+ * their hash.
+ */
+class CTileChangeDetector
+{
+public:
+  static constexpr int TILE_SIZE = 64;
+
+  CTileChangeDetector() = default;
+
+  /*!
+   * @brief Set a new view size, all tiles are unknown afterwards.
+   */
+  void Reset(int viewWidth, int viewHeight);
+
+  /*!
+   * @brief Mark all tiles touched by the given rectangle as unknown.
+   */
+  void Invalidate(const CefRect& rect);
+
+  /*!
+   * @brief Get the changed tiles inside the dirty rectangles.
+   *
+   * @param[in] dirtyRects The rectangles reported by CEF
+   * @param[in] buffer View pixel buffer (BGRA) with size given on Reset()
+   * @param[out] changedRects The rectangles of changed tiles
+   */
+  void Filter(const CefRenderHandler::RectList& dirtyRects,
+              const void* buffer,
+              CefRenderHandler::RectList& changedRects);
+
+  /*!
+   * @brief Calculate the 64 bit hash of a 32 bit pixel region.
+   *
+   * @param[in] data Pointer to first pixel
+   * @param[in] stride Bytes per row
+   * @param[in] width Pixels per row
+   * @param[in] height Amount of rows
+   */
+  static uint64_t HashPixels(const uint8_t* data, size_t stride, int width, int height);
+
+  /// Statistic values since creation
+  //@{
+  uint64_t UploadedTiles() const { return m_uploadedTiles; }
+  uint64_t SkippedTiles() const { return m_skippedTiles; }
+  //@}
+
+private:
+  bool TileRange(const CefRect& rect, int& x0, int& y0, int& x1, int& y1) const;
+
+  int m_viewWidth = 0;
+  int m_viewHeight = 0;
+  int m_tilesX = 0;
+  int m_tilesY = 0;
+  std::vector<uint64_t> m_hashes;
+  std::vector<uint8_t> m_valid;
+  std::vector<uint8_t> m_checked; // To check a tile only once per paint
+
+  uint64_t m_uploadedTiles = 0;
+  uint64_t m_skippedTiles = 0;
+  uint64_t m_filterCalls = 0;
+};
@@ -0,0 +1,79 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "TimeStatistics.h"
+
+namespace
+{
+
+inline double ToMs(CTimeStatistics::Clock::duration duration)
+{
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // namespace
+
+CTimeStatistics::CTimeStatistics(const std::string& name, unsigned int logInterval)
+  : m_name(name), m_logInterval(logInterval)
+{
+}
+
+void CTimeStatistics::AddSample(Clock::duration duration, uint64_t bytes, unsigned int calls)
+{
+  m_samples++;
+  m_bytes += bytes;
+  m_calls += calls;
+  m_total += duration;
+  if (duration < m_minimum)
+    m_minimum = duration;
+  if (duration > m_maximum)
+    m_maximum = duration;
+
+  if (m_logInterval > 0 && m_samples >= m_logInterval)
+  {
+    Log();
+    Reset();
+  }
+}
+
+void CTimeStatistics::Reset()
+{
+  m_samples = 0;
+  m_bytes = 0;
+  m_calls = 0;
+  m_total = Clock::duration::zero();
+  m_minimum = Clock::duration::max();
+  m_maximum = Clock::duration::zero();
+}
+
+void CTimeStatistics::Log(const AddonLog level) const
+{
+  if (m_samples == 0)
+    return;
+
+  kodi::Log(level,
+            "%s: %llu samples, avg %.3f ms, min %.3f ms, max %.3f ms, %llu calls, %.2f KiB/sample",
+            m_name.c_str(), static_cast<unsigned long long>(m_samples), AverageMs(), MinimumMs(),
+            MaximumMs(), static_cast<unsigned long long>(m_calls),
+            static_cast<double>(m_bytes) / 1024.0 / m_samples);
+}
+
+double CTimeStatistics::AverageMs() const
+{
+  return m_samples > 0 ? ToMs(m_total) / m_samples : 0.0;
+}
+
+double CTimeStatistics::MinimumMs() const
+{
+  return m_samples > 0 ? ToMs(m_minimum) : 0.0;
+}
+
+double CTimeStatistics::MaximumMs() const
+{
+  return ToMs(m_maximum);
+}
@@ -0,0 +1,62 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <kodi/General.h>
+#include <stdint.h>
+#include <string>
+
+/*!
+ * @brief Small helper to collect timings of a repeated work step (e.g. a
+ * texture upload per frame) and to print them periodically to Kodi's log.
+ *
+ * Not thread safe, the owner must call it always from the same thread.
+ */
+class ATTRIBUTE_HIDDEN CTimeStatistics
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /*!
+   * @param[in] name Name printed in front of the log line
+   * @param[in] logInterval Amount of samples after them the values are logged
+   *                        and reset, 0 to log only on request
+   */
+  CTimeStatistics(const std::string& name, unsigned int logInterval = 0);
+
+  static Clock::time_point Now() { return Clock::now(); }
+
+  void AddSample(Clock::duration duration, uint64_t bytes = 0, unsigned int calls = 1);
+  void AddSample(Clock::time_point start, uint64_t bytes = 0, unsigned int calls = 1)
+  {
+    AddSample(Now() - start, bytes, calls);
+  }
+
+  void Reset();
+  void Log(const AddonLog level = ADDON_LOG_DEBUG) const;
+
+  uint64_t Samples() const { return m_samples; }
+  uint64_t Bytes() const { return m_bytes; }
+  uint64_t Calls() const { return m_calls; }
+  double AverageMs() const;
+  double MinimumMs() const;
+  double MaximumMs() const;
+
+private:
+  const std::string m_name;
+  const unsigned int m_logInterval;
+
+  uint64_t m_samples = 0;
+  uint64_t m_bytes = 0;
+  uint64_t m_calls = 0;
+  Clock::duration m_total = Clock::duration::zero();
+  Clock::duration m_minimum = Clock::duration::max();
+  Clock::duration m_maximum = Clock::duration::zero();
+};
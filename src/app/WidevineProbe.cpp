@@ -0,0 +1,163 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "WidevineProbe.h"
+
+#include "include/cef_version.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef WIN32
+#include "include/internal/cef_string.h"
+
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
+
+const char kWidevineManifestSwitch[] = "widevine-manifest";
+
+namespace
+{
+
+// Exit codes of the probe, read by the add-on
+constexpr int PROBE_EXIT_OK = 0;
+constexpr int PROBE_EXIT_LOAD_FAILED = 1;
+constexpr int PROBE_EXIT_NO_VERSION = 2;
+constexpr int PROBE_EXIT_WRITE_FAILED = 3;
+
+std::string CreateManifest(const char* version)
+{
+  char buffer[1024];
+  snprintf(buffer, sizeof(buffer),
+           "{\n"
+           "  \"manifest_version\": 2,\n"
+           "  \"name\": \"WidevineCdm\",\n"
+           "  \"description\": \"Widevine Content Decryption Module Stub\",\n"
+           "  \"offline_enabled\": false,\n"
+           "  \"version\": \"%s\",\n"
+           "  \"minimum_chrome_version\": \"%i.%i.%i.%i\",\n"
+           "  \"os\": \"%s\",\n"
+           "  \"arch\": \"%s\",\n"
+           "  \"x-cdm-module-versions\": \"4\",\n"
+           "  \"x-cdm-interface-versions\": \"10\",\n"
+           "  \"x-cdm-host-versions\": \"10\",\n"
+           "  \"x-cdm-codecs\": \"vp8,vp9.0,avc1,av01\"\n"
+           "}\n",
+           version, CHROME_VERSION_MAJOR, CHROME_VERSION_MINOR, CHROME_VERSION_BUILD,
+           CHROME_VERSION_PATCH, WIDEVINE_OS, WIDEVINE_CPU);
+  return buffer;
+}
+
+FILE* OpenFile(const std::string& path)
+{
+#ifdef WIN32
+  return _wfopen(CefString(path).ToWString().c_str(), L"wb");
+#else
+  return fopen(path.c_str(), "wb");
+#endif
+}
+
+bool MoveToFile(const std::string& from, const std::string& to)
+{
+#ifdef WIN32
+  return MoveFileExW(CefString(from).ToWString().c_str(), CefString(to).ToWString().c_str(),
+                     MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+[[noreturn]] void EndProcess(int code)
+{
+  fflush(stdout);
+  fflush(stderr);
+
+  // Ended without unload of the library and without static destructors, see
+  // RunWidevineProbe()
+#ifdef WIN32
+  TerminateProcess(GetCurrentProcess(), code);
+#endif
+  _exit(code);
+}
+
+} // namespace
+
+bool GetWidevineProbeFolder(int argc, char* argv[], std::string& folder)
+{
+  const std::string prefix = std::string("--") + kWidevineManifestSwitch + "=";
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strncmp(argv[i], prefix.c_str(), prefix.size()) == 0)
+    {
+      folder = argv[i] + prefix.size();
+      return !folder.empty();
+    }
+  }
+
+  return false;
+}
+
+int RunWidevineProbe(const std::string& folder)
+{
+  const std::string library = folder + "/" WIDEVINE_LIB;
+
+  typedef const char* (*GetCdmVersionFunc)();
+  GetCdmVersionFunc getCdmVersion = nullptr;
+
+#ifdef WIN32
+  HMODULE handle = LoadLibraryW(CefString(library).ToWString().c_str());
+  if (!handle)
+  {
+    fprintf(stderr, "ERROR: Widevine library '%s' failed to load (%lu)\n", library.c_str(),
+            GetLastError());
+    EndProcess(PROBE_EXIT_LOAD_FAILED);
+  }
+  getCdmVersion = reinterpret_cast<GetCdmVersionFunc>(GetProcAddress(handle, "GetCdmVersion"));
+#else
+  void* handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!handle)
+  {
+    fprintf(stderr, "ERROR: Widevine library failed to load '%s'\n", dlerror());
+    EndProcess(PROBE_EXIT_LOAD_FAILED);
+  }
+  getCdmVersion = reinterpret_cast<GetCdmVersionFunc>(dlsym(handle, "GetCdmVersion"));
+#endif
+
+  const char* version = getCdmVersion ? getCdmVersion() : nullptr;
+  if (!version || !*version)
+  {
+    fprintf(stderr, "ERROR: Widevine library '%s' gives no version\n", library.c_str());
+    EndProcess(PROBE_EXIT_NO_VERSION);
+  }
+
+  // Written beside and renamed, the add-on takes an existing manifest as
+  // complete install
+  const std::string manifest = CreateManifest(version);
+  const std::string file = folder + "/manifest.json";
+  const std::string tempFile = file + ".tmp";
+  FILE* out = OpenFile(tempFile);
+  if (!out)
+  {
+    fprintf(stderr, "ERROR: Widevine manifest '%s' could not be created\n", tempFile.c_str());
+    EndProcess(PROBE_EXIT_WRITE_FAILED);
+  }
+
+  const bool written = fwrite(manifest.c_str(), 1, manifest.size(), out) == manifest.size();
+  if (fclose(out) != 0 || !written || !MoveToFile(tempFile, file))
+  {
+    fprintf(stderr, "ERROR: Widevine manifest '%s' could not be written\n", file.c_str());
+    EndProcess(PROBE_EXIT_WRITE_FAILED);
+  }
+
+  printf("%s\n", version);
+  EndProcess(PROBE_EXIT_OK);
+}
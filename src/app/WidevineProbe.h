@@ -0,0 +1,37 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include <string>
+
+// Switch to start kodichromium as Widevine probe, used as
+// "--widevine-manifest=<folder>" by the add-on's CWidewineControl.
+extern const char kWidevineManifestSwitch[];
+
+/*!
+ * @brief Get the folder of the probe switch from the process arguments.
+ *
+ * Checked before CEF is loaded, the probe needs nothing of it.
+ *
+ * @return true if the process is started as probe
+ */
+bool GetWidevineProbeFolder(int argc, char* argv[], std::string& folder);
+
+/*!
+ * @brief Load the Widevine CDM library of the folder, write its manifest
+ * there and end the process.
+ *
+ * The library starts a thread which crashes if the library is unloaded too
+ * early, this is why it is never loaded by Kodi's process itself. The probe
+ * ends without unload of it.
+ *
+ * @param[in] folder UTF-8 path of the folder with the library
+ * @return Exit code if the process could not be ended by itself
+ */
+int RunWidevineProbe(const std::string& folder);
@@ -7,6 +7,7 @@
  */
 
 #include "AppOther.h"
+#include "WidevineProbe.h"
 #include "renderer/AppRenderer.h"
 
 #include "include/base/cef_logging.h"
@@ -26,6 +27,11 @@ int main(int argc, char* argv[])
 {
   int ret = -1;
 
+  // Started by the add-on as Widevine probe, needs nothing of CEF
+  std::string widevineFolder;
+  if (GetWidevineProbeFolder(argc, argv, widevineFolder))
+    return RunWidevineProbe(widevineFolder);
+
   // Get the path where this sandbox app part is located. This is needed
   // to know from where the needed libcef becomes loaded.
   std::string path = argv[0];
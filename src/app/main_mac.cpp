@@ -7,6 +7,7 @@
  */
 
 #include "AppOther.h"
+#include "WidevineProbe.h"
 #include "renderer/AppRenderer.h"
 
 #include "include/base/cef_logging.h"
@@ -33,6 +34,11 @@ int main(int argc, char* argv[])
 {
   int ret = -1;
 
+  // Started by the add-on as Widevine probe, needs nothing of CEF
+  std::string widevineFolder;
+  if (GetWidevineProbeFolder(argc, argv, widevineFolder))
+    return RunWidevineProbe(widevineFolder);
+
 #if defined(CEF_USE_SANDBOX)
   // Initialize the macOS sandbox for this helper process.
   CefScopedSandboxContext sandbox_context;
@@ -7,6 +7,7 @@
  */
 
 #include "AppOther.h"
+#include "WidevineProbe.h"
 #include "renderer/AppRenderer.h"
 
 #include "include/base/cef_logging.h"
@@ -46,6 +47,10 @@ int APIENTRY wWinMain(HINSTANCE hInstance,
   CefRefPtr<CefCommandLine> command_line = CefCommandLine::CreateCommandLine();
   command_line->InitFromString(::GetCommandLineW());
 
+  // Started by the add-on as Widevine probe
+  if (command_line->HasSwitch(kWidevineManifestSwitch))
+    return RunWidevineProbe(command_line->GetSwitchValue(kWidevineManifestSwitch).ToString());
+
   // Create a ClientApp of the correct type.
   CefRefPtr<CefApp> app;
   const std::string& process_type = command_line->GetSwitchValue(kProcessType);
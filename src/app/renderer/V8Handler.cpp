@@ -56,6 +56,12 @@ function test_kodi_DialogYesNo()
     document.getElementById('yesNoRet').innerText = "returned "+ret;
   });
 }
+
+function test_kodi_AudioVolume()
+{
+  kodi.audio.SetVolume(0.5);
+  kodi.audio.SetMuted(false);
+}
  */
 
 bool CV8Handler::Execute(const CefString& name,
@@ -101,6 +107,36 @@ bool CV8Handler::Execute(const CefString& name,
     m_renderer->GetBrowser()->GetMainFrame()->SendProcessMessage(PID_BROWSER, browserMessage);
     return true;
   }
+  else if (name == "SetAudioVolume")
+  {
+    // Same range as volume of HTMLMediaElement, used for all audio of the browser
+    if (arguments.size() != 1 || !arguments[0]->IsDouble() ||
+        arguments[0]->GetDoubleValue() < 0.0 || arguments[0]->GetDoubleValue() > 1.0)
+    {
+      exception = "Value of '" + name.ToString() + "' must be a number between 0.0 and 1.0";
+      return true;
+    }
+
+    CefRefPtr<CefProcessMessage> browserMessage = CefProcessMessage::Create(RendererMessage::V8AddonCall);
+    browserMessage->GetArgumentList()->SetString(0, name);
+    browserMessage->GetArgumentList()->SetDouble(1, arguments[0]->GetDoubleValue());
+    m_renderer->GetBrowser()->GetMainFrame()->SendProcessMessage(PID_BROWSER, browserMessage);
+    return true;
+  }
+  else if (name == "SetAudioMuted")
+  {
+    if (arguments.size() != 1 || !arguments[0]->IsBool())
+    {
+      exception = "Value of '" + name.ToString() + "' must be a boolean";
+      return true;
+    }
+
+    CefRefPtr<CefProcessMessage> browserMessage = CefProcessMessage::Create(RendererMessage::V8AddonCall);
+    browserMessage->GetArgumentList()->SetString(0, name);
+    browserMessage->GetArgumentList()->SetBool(1, arguments[0]->GetBoolValue());
+    m_renderer->GetBrowser()->GetMainFrame()->SendProcessMessage(PID_BROWSER, browserMessage);
+    return true;
+  }
 
   return false;
 }
@@ -116,6 +152,7 @@ void CV8Handler::OnWebKitInitialized(CWebAppRenderer* renderer)
     "    kodi.gui.dialogs = {};"
     "    kodi.gui.dialogs.OK = {};"
     "    kodi.gui.dialogs.YesNo = {};"
+    "    kodi.audio = {};"
     "}"
     "const QUEUE_INFO = " + std::to_string(QUEUE_INFO) + ";"
     "const QUEUE_WARNING = " + std::to_string(QUEUE_WARNING) + ";"
@@ -148,6 +185,14 @@ void CV8Handler::OnWebKitInitialized(CWebAppRenderer* renderer)
     "    native function QueueNotification();"
     "    return QueueNotification(options);"
     "  };"
+    "  kodi.audio.SetVolume = function(volume) {"
+    "    native function SetAudioVolume();"
+    "    return SetAudioVolume(volume);"
+    "  };"
+    "  kodi.audio.SetMuted = function(muted) {"
+    "    native function SetAudioMuted();"
+    "    return SetAudioMuted(muted);"
+    "  };"
     "  kodi.GetAddonInfo = function(id, cb) {"
     "    window.kodiQuery({"
     "      request: 'kodi.GetAddonInfo '+id ,"
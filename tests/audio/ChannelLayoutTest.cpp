@@ -0,0 +1,255 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "TestUtils.h"
+#include "audio/ChannelLayout.h"
+#include "audio/ChannelMixer.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+#define CH(name) AUDIOENGINE_CH_##name
+
+struct ExpectedLayout
+{
+  cef_channel_layout_t layout;
+  std::vector<AudioEngineChannel> channels; // Empty if not mapped
+};
+
+// Every layout of CEF, in Chromium's channel order
+const std::vector<ExpectedLayout> EXPECTED = {
+    {CEF_CHANNEL_LAYOUT_NONE, {}},
+    {CEF_CHANNEL_LAYOUT_UNSUPPORTED, {}},
+    {CEF_CHANNEL_LAYOUT_MONO, {CH(FC)}},
+    {CEF_CHANNEL_LAYOUT_STEREO, {CH(FL), CH(FR)}},
+    {CEF_CHANNEL_LAYOUT_2_1, {CH(FL), CH(FR), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_SURROUND, {CH(FL), CH(FR), CH(FC)}},
+    {CEF_CHANNEL_LAYOUT_4_0, {CH(FL), CH(FR), CH(FC), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_2_2, {CH(FL), CH(FR), CH(SL), CH(SR)}},
+    {CEF_CHANNEL_LAYOUT_QUAD, {CH(FL), CH(FR), CH(BL), CH(BR)}},
+    {CEF_CHANNEL_LAYOUT_5_0, {CH(FL), CH(FR), CH(FC), CH(SL), CH(SR)}},
+    {CEF_CHANNEL_LAYOUT_5_1, {CH(FL), CH(FR), CH(FC), CH(LFE), CH(SL), CH(SR)}},
+    {CEF_CHANNEL_LAYOUT_5_0_BACK, {CH(FL), CH(FR), CH(FC), CH(BL), CH(BR)}},
+    {CEF_CHANNEL_LAYOUT_5_1_BACK, {CH(FL), CH(FR), CH(FC), CH(LFE), CH(BL), CH(BR)}},
+    {CEF_CHANNEL_LAYOUT_7_0, {CH(FL), CH(FR), CH(FC), CH(SL), CH(SR), CH(BL), CH(BR)}},
+    {CEF_CHANNEL_LAYOUT_7_1, {CH(FL), CH(FR), CH(FC), CH(LFE), CH(SL), CH(SR), CH(BL), CH(BR)}},
+    {CEF_CHANNEL_LAYOUT_7_1_WIDE,
+     {CH(FL), CH(FR), CH(FC), CH(LFE), CH(SL), CH(SR), CH(FLOC), CH(FROC)}},
+    {CEF_CHANNEL_LAYOUT_STEREO_DOWNMIX, {CH(FL), CH(FR)}},
+    {CEF_CHANNEL_LAYOUT_2POINT1, {CH(FL), CH(FR), CH(LFE)}},
+    {CEF_CHANNEL_LAYOUT_3_1, {CH(FL), CH(FR), CH(FC), CH(LFE)}},
+    {CEF_CHANNEL_LAYOUT_4_1, {CH(FL), CH(FR), CH(FC), CH(LFE), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_6_0, {CH(FL), CH(FR), CH(FC), CH(SL), CH(SR), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_6_0_FRONT, {CH(FL), CH(FR), CH(SL), CH(SR), CH(FLOC), CH(FROC)}},
+    {CEF_CHANNEL_LAYOUT_HEXAGONAL, {CH(FL), CH(FR), CH(FC), CH(BL), CH(BR), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_6_1, {CH(FL), CH(FR), CH(FC), CH(LFE), CH(SL), CH(SR), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_6_1_BACK, {CH(FL), CH(FR), CH(FC), CH(LFE), CH(BL), CH(BR), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_6_1_FRONT,
+     {CH(FL), CH(FR), CH(SL), CH(SR), CH(FLOC), CH(FROC), CH(LFE)}},
+    {CEF_CHANNEL_LAYOUT_7_0_FRONT,
+     {CH(FL), CH(FR), CH(FC), CH(SL), CH(SR), CH(FLOC), CH(FROC)}},
+    {CEF_CHANNEL_LAYOUT_7_1_WIDE_BACK,
+     {CH(FL), CH(FR), CH(FC), CH(LFE), CH(BL), CH(BR), CH(FLOC), CH(FROC)}},
+    {CEF_CHANNEL_LAYOUT_OCTAGONAL,
+     {CH(FL), CH(FR), CH(FC), CH(SL), CH(SR), CH(BL), CH(BR), CH(BC)}},
+    {CEF_CHANNEL_LAYOUT_DISCRETE, {}},
+    {CEF_CHANNEL_LAYOUT_STEREO_AND_KEYBOARD_MIC, {CH(FL), CH(FR), CH(NULL)}},
+    {CEF_CHANNEL_LAYOUT_4_1_QUAD_SIDE, {CH(FL), CH(FR), CH(SL), CH(SR), CH(LFE)}},
+    {CEF_CHANNEL_LAYOUT_BITSTREAM, {}},
+};
+
+// Kodi's order of a 7.1 sink, no CEF layout has it
+const std::vector<AudioEngineChannel> SINK_7_1 = {CH(FL), CH(FR), CH(FC), CH(LFE),
+                                                  CH(BL), CH(BR), CH(SL), CH(SR)};
+
+#undef CH
+
+/*!
+ * @brief Mix one full scale frame per input channel and give the level on
+ * every output channel.
+ */
+std::vector<std::vector<float>> MixEachChannel(const std::vector<AudioEngineChannel>& input,
+                                               const std::vector<AudioEngineChannel>& output)
+{
+  CChannelMixer mixer;
+  mixer.Configure(input, output);
+
+  std::vector<std::vector<float>> levels;
+  std::vector<float> in(input.size());
+  std::vector<float> out(output.size());
+  std::vector<const float*> inPlanes(input.size());
+  std::vector<float*> outPlanes(output.size());
+  for (size_t i = 0; i < input.size(); ++i)
+    inPlanes[i] = &in[i];
+  for (size_t i = 0; i < output.size(); ++i)
+    outPlanes[i] = &out[i];
+
+  for (size_t channel = 0; channel < input.size(); ++channel)
+  {
+    std::fill(in.begin(), in.end(), 0.0f);
+    in[channel] = 1.0f;
+    mixer.Process(inPlanes.data(), outPlanes.data(), 1);
+    levels.push_back(out);
+  }
+  return levels;
+}
+
+float Sum(const std::vector<float>& values)
+{
+  float sum = 0.0f;
+  for (float value : values)
+    sum += value;
+  return sum;
+}
+
+} // namespace
+
+TEST_CASE(EveryLayoutListed)
+{
+  TEST_CHECK(EXPECTED.size() == CEF_CHANNEL_LAYOUT_MAX + 1);
+  for (size_t i = 0; i < EXPECTED.size(); ++i)
+    TEST_CHECK(EXPECTED[i].layout == static_cast<cef_channel_layout_t>(i));
+}
+
+TEST_CASE(ToChannelsPerLayout)
+{
+  for (const auto& expected : EXPECTED)
+  {
+    std::vector<AudioEngineChannel> channels{AUDIOENGINE_CH_FL};
+    const bool mapped = ChannelMap::ToChannels(expected.layout, channels);
+    if (mapped != !expected.channels.empty() || channels != expected.channels)
+      TestUtils::Fail(__FILE__, __LINE__, "layout " + std::to_string(expected.layout));
+  }
+}
+
+TEST_CASE(FromChannelsRoundTrip)
+{
+  for (const auto& expected : EXPECTED)
+  {
+    if (expected.channels.empty())
+      continue;
+
+    // Stereo downmix has the same channels as stereo, where stereo is preferred
+    cef_channel_layout_t wanted = expected.layout;
+    if (wanted == CEF_CHANNEL_LAYOUT_STEREO_DOWNMIX)
+      wanted = CEF_CHANNEL_LAYOUT_STEREO;
+
+    if (ChannelMap::FromChannels(expected.channels) != wanted)
+      TestUtils::Fail(__FILE__, __LINE__, "layout " + std::to_string(expected.layout));
+  }
+
+  TEST_CHECK(ChannelMap::FromChannels({AUDIOENGINE_CH_FL}) == CEF_CHANNEL_LAYOUT_MONO);
+  TEST_CHECK(ChannelMap::FromChannels(SINK_7_1) == CEF_CHANNEL_LAYOUT_NONE);
+}
+
+TEST_CASE(EveryLayoutMixesToStereo)
+{
+  const std::vector<AudioEngineChannel> stereo = {AUDIOENGINE_CH_FL, AUDIOENGINE_CH_FR};
+  for (const auto& expected : EXPECTED)
+  {
+    if (expected.channels.empty())
+      continue;
+
+    const auto levels = MixEachChannel(expected.channels, stereo);
+    for (size_t channel = 0; channel < expected.channels.size(); ++channel)
+    {
+      const AudioEngineChannel source = expected.channels[channel];
+      const float left = levels[channel][0];
+      const float right = levels[channel][1];
+
+      // Nothing is lost, except the planes without playback
+      const bool heard = left + right > 0.0f;
+      const bool wanted = source != AUDIOENGINE_CH_NULL;
+      // Left and right channels stay on their side
+      const bool leftOnly = source != AUDIOENGINE_CH_FL || right == 0.0f;
+      const bool rightOnly = source != AUDIOENGINE_CH_FR || left == 0.0f;
+      // Normalized, no clip of a single channel
+      const bool limited = left <= 1.0f && right <= 1.0f;
+
+      if (heard != wanted || !leftOnly || !rightOnly || !limited)
+        TestUtils::Fail(__FILE__, __LINE__,
+                        "layout " + std::to_string(expected.layout) + " channel " +
+                            std::to_string(channel));
+    }
+  }
+}
+
+TEST_CASE(EveryLayoutToItself)
+{
+  for (const auto& expected : EXPECTED)
+  {
+    if (expected.channels.empty() || expected.layout == CEF_CHANNEL_LAYOUT_STEREO_AND_KEYBOARD_MIC)
+      continue;
+
+    CChannelMixer mixer;
+    mixer.Configure(expected.channels, expected.channels);
+    if (!mixer.IsIdentity())
+      TestUtils::Fail(__FILE__, __LINE__, "layout " + std::to_string(expected.layout));
+  }
+}
+
+TEST_CASE(KeyboardMicDropped)
+{
+  std::vector<AudioEngineChannel> channels;
+  TEST_CHECK(ChannelMap::ToChannels(CEF_CHANNEL_LAYOUT_STEREO_AND_KEYBOARD_MIC, channels));
+
+  const auto levels = MixEachChannel(channels, {AUDIOENGINE_CH_FL, AUDIOENGINE_CH_FR});
+  TEST_CHECK_NEAR(levels[0][0], 1.0, 1e-6);
+  TEST_CHECK_NEAR(levels[1][1], 1.0, 1e-6);
+  TEST_CHECK_NEAR(Sum(levels[2]), 0.0, 1e-6);
+}
+
+TEST_CASE(ForSink)
+{
+  using ChannelMap::ForSink;
+
+  // Layouts CEF has itself
+  TEST_CHECK(ForSink({AUDIOENGINE_CH_FC}) == CEF_CHANNEL_LAYOUT_MONO);
+  TEST_CHECK(ForSink({AUDIOENGINE_CH_FL, AUDIOENGINE_CH_FR}) == CEF_CHANNEL_LAYOUT_STEREO);
+  TEST_CHECK(ForSink({AUDIOENGINE_CH_FL, AUDIOENGINE_CH_FR, AUDIOENGINE_CH_FC, AUDIOENGINE_CH_LFE,
+                      AUDIOENGINE_CH_BL, AUDIOENGINE_CH_BR}) == CEF_CHANNEL_LAYOUT_5_1_BACK);
+
+  // Other order, all channels still come from CEF
+  TEST_CHECK(ForSink(SINK_7_1) == CEF_CHANNEL_LAYOUT_7_1);
+  TEST_CHECK(ForSink({AUDIOENGINE_CH_FR, AUDIOENGINE_CH_FL}) == CEF_CHANNEL_LAYOUT_STEREO);
+
+  // Smallest layout with all channels
+  TEST_CHECK(ForSink({AUDIOENGINE_CH_FL, AUDIOENGINE_CH_FR, AUDIOENGINE_CH_BL}) ==
+             CEF_CHANNEL_LAYOUT_QUAD);
+
+  // Top channels has no CEF layout, most of the others
+  TEST_CHECK(ForSink({AUDIOENGINE_CH_FL, AUDIOENGINE_CH_FR, AUDIOENGINE_CH_FC, AUDIOENGINE_CH_LFE,
+                      AUDIOENGINE_CH_BL, AUDIOENGINE_CH_BR, AUDIOENGINE_CH_TFL,
+                      AUDIOENGINE_CH_TFR}) == CEF_CHANNEL_LAYOUT_5_1_BACK);
+
+  // Without PCM
+  TEST_CHECK(ForSink({}) == CEF_CHANNEL_LAYOUT_STEREO);
+  TEST_CHECK(ForSink({AUDIOENGINE_CH_RAW}) == CEF_CHANNEL_LAYOUT_STEREO);
+}
+
+TEST_CASE(DefaultChannelsAndPCM)
+{
+  TEST_CHECK(ChannelMap::DefaultChannels(2) ==
+             std::vector<AudioEngineChannel>({AUDIOENGINE_CH_FL, AUDIOENGINE_CH_FR}));
+  TEST_CHECK(ChannelMap::DefaultChannels(12).size() == 8);
+  TEST_CHECK(ChannelMap::DefaultChannels(0).empty());
+
+  TEST_CHECK(ChannelMap::IsPCM(SINK_7_1));
+  TEST_CHECK(!ChannelMap::IsPCM({}));
+  TEST_CHECK(!ChannelMap::IsPCM({AUDIOENGINE_CH_FL, AUDIOENGINE_CH_RAW}));
+  TEST_CHECK(!ChannelMap::IsPCM({AUDIOENGINE_CH_NULL}));
+}
+
+int main()
+{
+  return TestUtils::RunAll();
+}
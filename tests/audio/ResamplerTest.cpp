@@ -0,0 +1,272 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "TestUtils.h"
+#include "audio/Resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr double PI = 3.14159265358979323846;
+
+// Block size of the input, like the packets of CEF
+constexpr size_t BLOCK_FRAMES = 480;
+
+struct RatePair
+{
+  unsigned int in;
+  unsigned int out;
+};
+
+constexpr RatePair RATES[] = {{44100, 48000}, {48000, 44100}, {32000, 48000}, {96000, 48000}};
+
+constexpr CResampler::Quality QUALITIES[] = {CResampler::QUALITY_LOW, CResampler::QUALITY_MEDIUM,
+                                             CResampler::QUALITY_HIGH};
+
+// Least signal to error ratio per quality up to 70 % of the lower Nyquist
+// rate, further up the low quality already rolls off
+constexpr double MIN_SNR_DB[] = {55.0, 80.0, 100.0};
+
+// Least attenuation per quality behind the transition band
+constexpr double MIN_REJECTION_DB[] = {55.0, 80.0, 95.0};
+
+/*!
+ * @brief Resample a signal given as function of time in seconds, block by
+ * block over two channels.
+ */
+std::vector<float> Resample(CResampler& resampler,
+                            unsigned int inRate,
+                            double seconds,
+                            const std::function<double(double)>& signal)
+{
+  const size_t total = static_cast<size_t>(seconds * inRate);
+  std::vector<float> input(BLOCK_FRAMES);
+  std::vector<float> output(resampler.MaxOutput(BLOCK_FRAMES));
+  std::vector<float> unused(output.size());
+  std::vector<float> result;
+
+  for (size_t start = 0; start < total; start += BLOCK_FRAMES)
+  {
+    const size_t frames = std::min(BLOCK_FRAMES, total - start);
+    for (size_t i = 0; i < frames; ++i)
+      input[i] = static_cast<float>(signal(static_cast<double>(start + i) / inRate));
+
+    const float* in[2] = {input.data(), input.data()};
+    float* out[2] = {output.data(), unused.data()};
+    const size_t produced = resampler.Process(in, frames, out);
+    result.insert(result.end(), output.begin(), output.begin() + produced);
+  }
+  return result;
+}
+
+/*!
+ * @brief Ratio of the ideal signal to the error against it in dB, where the
+ * output frame n is at time n / outRate.
+ */
+double SignalToError(const std::vector<float>& output,
+                     unsigned int outRate,
+                     size_t skip,
+                     const std::function<double(double)>& signal,
+                     const std::function<bool(double)>& use)
+{
+  double signalPower = 0.0;
+  double errorPower = 0.0;
+  for (size_t n = skip; n < output.size(); ++n)
+  {
+    const double time = static_cast<double>(n) / outRate;
+    if (!use(time))
+      continue;
+    const double ideal = signal(time);
+    signalPower += ideal * ideal;
+    errorPower += (output[n] - ideal) * (output[n] - ideal);
+  }
+  return 10.0 * std::log10(signalPower / std::max(errorPower, 1e-30));
+}
+
+double Level(const std::vector<float>& output, size_t skip)
+{
+  double power = 0.0;
+  for (size_t n = skip; n < output.size(); ++n)
+    power += output[n] * output[n];
+  return 10.0 * std::log10(std::max(power / std::max<size_t>(output.size() - skip, 1), 1e-30));
+}
+
+std::string Name(const RatePair& rates, int quality)
+{
+  return std::to_string(rates.in) + " -> " + std::to_string(rates.out) + " quality " +
+         std::to_string(quality);
+}
+
+} // namespace
+
+TEST_CASE(Configure)
+{
+  CResampler resampler;
+  TEST_CHECK(!resampler.Configure(0, 48000, 44100, CResampler::QUALITY_MEDIUM));
+  TEST_CHECK(!resampler.Configure(2, 0, 44100, CResampler::QUALITY_MEDIUM));
+  TEST_CHECK(!resampler.Configure(2, 48000, 0, CResampler::QUALITY_MEDIUM));
+  TEST_CHECK(resampler.Configure(2, 48000, 44100, CResampler::QUALITY_MEDIUM));
+  TEST_CHECK(!resampler.IsVariable());
+  TEST_CHECK(resampler.Phases() == 147);
+
+  // 44100 -> 48001 needs more phases than allowed
+  TEST_CHECK(resampler.Configure(2, 44100, 48001, CResampler::QUALITY_MEDIUM));
+  TEST_CHECK(resampler.IsVariable());
+}
+
+TEST_CASE(SineSweepQuality)
+{
+  for (const RatePair& rates : RATES)
+  {
+    // Log sweep from 20 Hz to 70 % of the lower Nyquist rate
+    const double seconds = 2.0;
+    const double low = 20.0;
+    const double high = 0.7 * std::min(rates.in, rates.out) / 2.0;
+    const double growth = std::log(high / low);
+    const auto sweep = [=](double time) {
+      return 0.5 * std::sin(2.0 * PI * low * seconds / growth *
+                            (std::exp(growth * time / seconds) - 1.0));
+    };
+
+    for (int q = 0; q < 3; ++q)
+    {
+      CResampler resampler;
+      TEST_CHECK(resampler.Configure(2, rates.in, rates.out, QUALITIES[q]));
+
+      const auto output = Resample(resampler, rates.in, seconds, sweep);
+      const size_t skip = static_cast<size_t>(resampler.Taps()) * rates.out / rates.in;
+      const double snr = SignalToError(output, rates.out, skip, sweep, [](double) { return true; });
+      if (snr < MIN_SNR_DB[q])
+        TestUtils::Fail(__FILE__, __LINE__,
+                        Name(rates, q + 1) + ": " + std::to_string(snr) + " dB");
+    }
+  }
+}
+
+TEST_CASE(QualityOrder)
+{
+  // Close to the passband end are the differences of the presets largest
+  const RatePair rates = {44100, 48000};
+  const auto sine = [](double time) { return 0.5 * std::sin(2.0 * PI * 18000.0 * time); };
+
+  double last = 0.0;
+  for (int q = 0; q < 3; ++q)
+  {
+    CResampler resampler;
+    resampler.Configure(1, rates.in, rates.out, QUALITIES[q]);
+    const auto output = Resample(resampler, rates.in, 0.5, sine);
+    const double snr = SignalToError(output, rates.out, resampler.Taps() * 2, sine,
+                                     [](double) { return true; });
+    TEST_CHECK(snr > last);
+    last = snr;
+  }
+}
+
+TEST_CASE(StopbandRejection)
+{
+  // A tone above the Nyquist rate of the output must not alias back, 30 kHz
+  // on 96 -> 48 kHz is behind the transition band of every preset
+  for (int q = 0; q < 3; ++q)
+  {
+    CResampler resampler;
+    resampler.Configure(1, 96000, 48000, QUALITIES[q]);
+    const auto output = Resample(resampler, 96000, 0.5, [](double time) {
+      return 0.5 * std::sin(2.0 * PI * 30000.0 * time);
+    });
+
+    // -9 dB is the level of the tone itself
+    const double level = Level(output, resampler.Taps() * 2);
+    if (level > -9.0 - MIN_REJECTION_DB[q])
+      TestUtils::Fail(__FILE__, __LINE__,
+                      "quality " + std::to_string(q + 1) + ": " + std::to_string(level) + " dB");
+  }
+}
+
+TEST_CASE(NoTimeShift)
+{
+  // An impulse comes out where its time is, the delay is only lookahead
+  for (const RatePair& rates : RATES)
+  {
+    CResampler resampler;
+    resampler.Configure(1, rates.in, rates.out, CResampler::QUALITY_HIGH);
+
+    const size_t impulse = 1000;
+    const auto output = Resample(resampler, rates.in, 0.1, [&](double time) {
+      return std::lround(time * rates.in) == static_cast<long>(impulse) ? 1.0 : 0.0;
+    });
+
+    const auto magnitude = [](float a, float b) { return std::fabs(a) < std::fabs(b); };
+    const size_t peak =
+        std::max_element(output.begin(), output.end(), magnitude) - output.begin();
+    const double expected = static_cast<double>(impulse) * rates.out / rates.in;
+    if (std::fabs(peak - expected) > 1.0)
+      TestUtils::Fail(__FILE__, __LINE__,
+                      Name(rates, 3) + ": peak at " + std::to_string(peak) + ", expected " +
+                          std::to_string(expected));
+  }
+}
+
+TEST_CASE(Latency)
+{
+  for (const RatePair& rates : RATES)
+  {
+    for (int q = 0; q < 3; ++q)
+    {
+      CResampler resampler;
+      resampler.Configure(1, rates.in, rates.out, QUALITIES[q]);
+
+      // Held back are the input frames of the lookahead, half the filter
+      TEST_CHECK_NEAR(resampler.Delay(), (resampler.Taps() / 2) * 1000.0 / rates.in, 1e-9);
+      TEST_CHECK(resampler.Delay() <= 10.0);
+
+      const size_t input = rates.in / 10;
+      const auto output = Resample(resampler, rates.in, 0.1, [](double) { return 0.0; });
+      const double held =
+          static_cast<double>(input) - output.size() * static_cast<double>(rates.in) / rates.out;
+      if (held < resampler.Taps() / 2 - 2.0 || held > resampler.Taps() / 2 + 2.0)
+        TestUtils::Fail(__FILE__, __LINE__,
+                        Name(rates, q + 1) + ": " + std::to_string(held) + " frames held");
+    }
+  }
+}
+
+TEST_CASE(VariableRatio)
+{
+  const auto sine = [](double time) { return 0.5 * std::sin(2.0 * PI * 1000.0 * time); };
+
+  CResampler resampler;
+  TEST_CHECK(resampler.Configure(1, 48000, 48000, CResampler::QUALITY_MEDIUM, true));
+  TEST_CHECK(resampler.IsVariable());
+
+  const auto same = Resample(resampler, 48000, 1.0, sine);
+  TEST_CHECK(SignalToError(same, 48000, resampler.Taps(), sine, [](double) { return true; }) >
+             MIN_SNR_DB[1] - 10.0);
+
+  // 0.5 % more input per output gives 0.5 % less output
+  resampler.Reset();
+  resampler.SetRatioAdjust(1.005);
+  const auto faster = Resample(resampler, 48000, 1.0, sine);
+  TEST_CHECK_NEAR(static_cast<double>(faster.size()) / same.size(), 1.0 / 1.005, 0.001);
+
+  // Limited to 1 %
+  resampler.Reset();
+  resampler.SetRatioAdjust(1.5);
+  const auto limited = Resample(resampler, 48000, 1.0, sine);
+  TEST_CHECK_NEAR(static_cast<double>(limited.size()) / same.size(), 1.0 / 1.01, 0.001);
+}
+
+int main()
+{
+  return TestUtils::RunAll();
+}
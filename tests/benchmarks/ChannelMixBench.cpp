@@ -0,0 +1,130 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+/*
+ * Throughput of CChannelMixer from every mapped CEF layout to the usual sink
+ * layouts.
+ *
+ *   channel_mix_bench [--seconds <s>] [--period <frames>]
+ *
+ * Prints per layout the mixed frames per second and how many times faster
+ * than real time at 48 kHz that is.
+ */
+
+#include "audio/ChannelLayout.h"
+#include "audio/ChannelMixer.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr unsigned int SAMPLE_RATE = 48000;
+
+struct Sink
+{
+  const char* name;
+  std::vector<AudioEngineChannel> channels;
+};
+
+const std::vector<Sink> SINKS = {
+    {"stereo", {AUDIOENGINE_CH_FL, AUDIOENGINE_CH_FR}},
+    {"5.1", {AUDIOENGINE_CH_FL, AUDIOENGINE_CH_FR, AUDIOENGINE_CH_FC, AUDIOENGINE_CH_LFE,
+             AUDIOENGINE_CH_BL, AUDIOENGINE_CH_BR}},
+    {"7.1", {AUDIOENGINE_CH_FL, AUDIOENGINE_CH_FR, AUDIOENGINE_CH_FC, AUDIOENGINE_CH_LFE,
+             AUDIOENGINE_CH_BL, AUDIOENGINE_CH_BR, AUDIOENGINE_CH_SL, AUDIOENGINE_CH_SR}},
+};
+
+std::vector<std::vector<float>> Planes(size_t channels, size_t frames)
+{
+  std::vector<std::vector<float>> planes(channels, std::vector<float>(frames));
+  for (size_t channel = 0; channel < channels; ++channel)
+  {
+    for (size_t frame = 0; frame < frames; ++frame)
+      planes[channel][frame] = 0.5f * static_cast<float>(std::sin(0.01 * (frame + channel * 7)));
+  }
+  return planes;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  double seconds = 60.0;
+  unsigned int period = 1024;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--seconds") == 0 && hasValue)
+      seconds = atof(argv[++i]);
+    else if (strcmp(argv[i], "--period") == 0 && hasValue)
+      period = static_cast<unsigned int>(atoi(argv[++i]));
+    else
+    {
+      fprintf(stderr, "Usage: %s [--seconds <s>] [--period <frames>]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (seconds <= 0.0 || period == 0)
+    return 2;
+
+  const size_t periods = static_cast<size_t>(seconds * SAMPLE_RATE / period) + 1;
+  float check = 0.0f;
+
+  printf("%-30s %-7s %14s %12s\n", "layout", "sink", "frames/s", "x realtime");
+  for (int value = 0; value <= CEF_CHANNEL_LAYOUT_MAX; ++value)
+  {
+    const cef_channel_layout_t layout = static_cast<cef_channel_layout_t>(value);
+    std::vector<AudioEngineChannel> channels;
+    if (!ChannelMap::ToChannels(layout, channels))
+      continue;
+
+    const auto input = Planes(channels.size(), period);
+    std::vector<const float*> inputPointers;
+    for (const auto& plane : input)
+      inputPointers.push_back(plane.data());
+
+    for (const Sink& sink : SINKS)
+    {
+      CChannelMixer mixer;
+      mixer.Configure(channels, sink.channels);
+
+      auto output = Planes(sink.channels.size(), period);
+      std::vector<float*> outputPointers;
+      for (auto& plane : output)
+        outputPointers.push_back(plane.data());
+
+      const auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < periods; ++i)
+        mixer.Process(inputPointers.data(), outputPointers.data(), period);
+      const double used =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      // Keeps the work from being optimized away
+      check += output[0][period / 2];
+
+      const double frames = static_cast<double>(periods) * period;
+      const double perSecond = used > 0.0 ? frames / used : 0.0;
+      printf("%-30s %-7s %14.0f %12.1f\n",
+             ("CEF_CHANNEL_LAYOUT " + std::to_string(value) + " (" +
+              std::to_string(channels.size()) + " ch)")
+                 .c_str(),
+             sink.name, perSecond, perSecond / SAMPLE_RATE);
+    }
+  }
+
+  return std::isfinite(check) ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+/*
+ * Micro benchmark of CDirtyRectOptimizer, replays rectangle lists of typical
+ * paints or of paint traces.
+ *
+ *   dirty_rect_bench [--iterations <n>] [--ratio <0.0-1.0>] [trace ...]
+ *
+ * Prints per list set the time of one Optimize() call and how much the
+ * rectangles and uploaded pixels were reduced.
+ */
+
+#include "renderer/DirtyRectOptimizer.h"
+#include "renderer/PaintTrace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr int VIEW_WIDTH = 1920;
+constexpr int VIEW_HEIGHT = 1080;
+
+// Same call cost as used by the renderers
+constexpr int CALL_OVERHEAD_PIXELS = 4096;
+
+struct RectLists
+{
+  std::string name;
+  int viewWidth = VIEW_WIDTH;
+  int viewHeight = VIEW_HEIGHT;
+  std::vector<CefRenderHandler::RectList> lists;
+};
+
+/*!
+ * @brief Rectangle lists as given by CEF on usual pages.
+ */
+std::vector<RectLists> SyntheticLists()
+{
+  std::vector<RectLists> sets(6);
+
+  sets[0].name = "caret";
+  sets[0].lists.push_back({CefRect(400, 300, 2, 18)});
+
+  sets[1].name = "scroll";
+  sets[1].lists.push_back({CefRect(0, 80, VIEW_WIDTH, VIEW_HEIGHT - 80)});
+
+  sets[2].name = "widgets";
+  sets[2].lists.push_back({CefRect(20, 20, 120, 40), CefRect(VIEW_WIDTH - 140, 20, 120, 40),
+                           CefRect(20, VIEW_HEIGHT - 60, 120, 40),
+                           CefRect(VIEW_WIDTH - 140, VIEW_HEIGHT - 60, 120, 40)});
+
+  // Glyphs of an animated text line, partly overlapping
+  sets[3].name = "text-32";
+  CefRenderHandler::RectList text;
+  for (int i = 0; i < 32; ++i)
+    text.emplace_back(200 + i * 14, 500, 16, 20);
+  sets[3].lists.push_back(text);
+
+  // Up to the limit of the pairwise merge, spread over the view
+  sets[4].name = "scatter-64";
+  CefRenderHandler::RectList scatter;
+  for (int i = 0; i < 64; ++i)
+    scatter.emplace_back((i * 397) % (VIEW_WIDTH - 60), (i * 211) % (VIEW_HEIGHT - 40), 60, 40);
+  sets[4].lists.push_back(scatter);
+
+  // Above the limit, only the bounding box
+  sets[5].name = "scatter-200";
+  scatter.clear();
+  for (int i = 0; i < 200; ++i)
+    scatter.emplace_back((i * 397) % (VIEW_WIDTH - 30), (i * 211) % (VIEW_HEIGHT - 20), 30, 20);
+  sets[5].lists.push_back(scatter);
+
+  return sets;
+}
+
+bool TraceLists(const std::string& path, RectLists& set)
+{
+  CPaintTraceReader reader;
+  if (!reader.Open(path))
+    return false;
+
+  set.name = path;
+  PaintTraceRecord record;
+  while (reader.Next(record))
+  {
+    if (record.type != PET_VIEW)
+      continue;
+    set.viewWidth = record.width;
+    set.viewHeight = record.height;
+    set.lists.push_back(record.dirtyRects);
+  }
+  return !set.lists.empty();
+}
+
+int64_t Pixels(const CefRenderHandler::RectList& rects)
+{
+  int64_t pixels = 0;
+  for (const auto& rect : rects)
+    pixels += static_cast<int64_t>(rect.width) * rect.height;
+  return pixels;
+}
+
+void Run(const RectLists& set, int iterations, float ratio)
+{
+  CDirtyRectOptimizer optimizer;
+  optimizer.SetCosts(CALL_OVERHEAD_PIXELS, ratio);
+
+  CefRenderHandler::RectList uploadRects;
+  uint64_t fullUploads = 0;
+  int64_t dirtyPixels = 0;
+  int64_t uploadPixels = 0;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i)
+  {
+    for (const auto& list : set.lists)
+    {
+      if (optimizer.Optimize(list, set.viewWidth, set.viewHeight, uploadRects))
+        fullUploads++;
+      if (i == 0)
+      {
+        dirtyPixels += Pixels(list);
+        uploadPixels += Pixels(uploadRects);
+      }
+    }
+  }
+  const double ns =
+      std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  const uint64_t calls = static_cast<uint64_t>(iterations) * set.lists.size();
+  printf("%-24s %10.1f ns/call %8.2f rects in %8.2f rects out %6.1f %% full %8.2f upload/dirty\n",
+         set.name.c_str(), ns / calls, static_cast<double>(optimizer.InputRects()) / calls,
+         static_cast<double>(optimizer.OutputRects()) / calls, 100.0 * fullUploads / calls,
+         dirtyPixels > 0 ? static_cast<double>(uploadPixels) / dirtyPixels : 0.0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  int iterations = 100000;
+  float ratio = 0.7f;
+  std::vector<std::string> traces;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--iterations") == 0 && hasValue)
+      iterations = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--ratio") == 0 && hasValue)
+      ratio = static_cast<float>(atof(argv[++i]));
+    else if (argv[i][0] == '-')
+    {
+      fprintf(stderr, "Usage: %s [--iterations <n>] [--ratio <0.0-1.0>] [trace ...]\n", argv[0]);
+      return 2;
+    }
+    else
+      traces.push_back(argv[i]);
+  }
+
+  if (iterations <= 0)
+    return 2;
+
+  std::vector<RectLists> sets;
+  if (traces.empty())
+    sets = SyntheticLists();
+
+  for (const auto& trace : traces)
+  {
+    RectLists set;
+    if (!TraceLists(trace, set))
+      return 1;
+    sets.push_back(set);
+  }
+
+  for (const auto& set : sets)
+    Run(set, iterations, ratio);
+
+  return 0;
+}
@@ -0,0 +1,195 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+/*
+ * CPU side of the texture upload strategies of the GL renderer, for the
+ * dirty rectangles of typical paints.
+ *
+ *   pixel_convert_bench [--iterations <n>]
+ *
+ * The upload itself needs a GL context and is not part of it. Native BGRA
+ * and shader swizzle hand the CEF buffer to the driver in place if it knows
+ * GL_UNPACK_ROW_LENGTH, else they pack the rows into a scratch buffer. The
+ * CPU conversion always packs and swaps the channels with PixelConvert, the
+ * scalar loop is given as reference for its SSE2 or NEON path.
+ */
+
+#include "renderer/PixelConvert.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr int VIEW_WIDTH = 1920;
+constexpr int VIEW_HEIGHT = 1080;
+
+struct Rect
+{
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+struct RectSet
+{
+  const char* name;
+  std::vector<Rect> rects;
+};
+
+using RowCopy = std::function<void(uint8_t* dst, const uint8_t* src, size_t pixels)>;
+
+std::vector<RectSet> RectSets()
+{
+  std::vector<RectSet> sets = {
+      {"full", {{0, 0, VIEW_WIDTH, VIEW_HEIGHT}}},
+      {"scroll", {{0, 80, VIEW_WIDTH, VIEW_HEIGHT - 80}}},
+      {"widgets",
+       {{20, 20, 120, 40},
+        {VIEW_WIDTH - 140, 20, 120, 40},
+        {20, VIEW_HEIGHT - 60, 120, 40},
+        {VIEW_WIDTH - 140, VIEW_HEIGHT - 60, 120, 40}}},
+      {"video-720p", {{320, 180, 1280, 720}}},
+      {"text-32", {}},
+  };
+  for (int i = 0; i < 32; ++i)
+    sets.back().rects.push_back({200 + i * 14, 500, 16, 20});
+  return sets;
+}
+
+void ScalarBGRAToRGBA(uint8_t* dst, const uint8_t* src, size_t pixels)
+{
+  for (size_t i = 0; i < pixels; ++i)
+  {
+    dst[i * 4 + 0] = src[i * 4 + 2];
+    dst[i * 4 + 1] = src[i * 4 + 1];
+    dst[i * 4 + 2] = src[i * 4 + 0];
+    dst[i * 4 + 3] = src[i * 4 + 3];
+  }
+}
+
+/*!
+ * @brief Pack the rows of every rectangle into the scratch buffer, the same
+ * way as CRendererClientOpenGL::TexSubImage does it.
+ */
+void Pack(const RectSet& set,
+          const std::vector<uint8_t>& buffer,
+          std::vector<uint8_t>& scratch,
+          const RowCopy& copy)
+{
+  const size_t stride = static_cast<size_t>(VIEW_WIDTH) * 4;
+  for (const Rect& rect : set.rects)
+  {
+    const uint8_t* src = buffer.data() + rect.y * stride + rect.x * 4;
+    const size_t rowBytes = static_cast<size_t>(rect.width) * 4;
+    scratch.resize(rowBytes * rect.height);
+    if (rect.x == 0 && rect.width == VIEW_WIDTH)
+    {
+      copy(scratch.data(), src, static_cast<size_t>(rect.width) * rect.height);
+    }
+    else
+    {
+      for (int row = 0; row < rect.height; ++row)
+        copy(scratch.data() + row * rowBytes, src + row * stride, rect.width);
+    }
+  }
+}
+
+int64_t Pixels(const RectSet& set)
+{
+  int64_t pixels = 0;
+  for (const Rect& rect : set.rects)
+    pixels += static_cast<int64_t>(rect.width) * rect.height;
+  return pixels;
+}
+
+void Run(const char* strategy,
+         const RectSet& set,
+         int iterations,
+         const std::vector<uint8_t>& buffer,
+         const RowCopy& copy)
+{
+  // The driver reads the buffer itself, nothing to time
+  if (!copy)
+  {
+    printf("%-12s %-22s %21s\n", set.name, strategy, "no CPU copy");
+    return;
+  }
+
+  std::vector<uint8_t> scratch;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i)
+    Pack(set, buffer, scratch, copy);
+  const double ns =
+      std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+      iterations;
+
+  const double bytes = static_cast<double>(Pixels(set)) * 4;
+  printf("%-12s %-22s %12.1f us/paint %8.2f GB/s\n", set.name, strategy, ns / 1000.0,
+         ns > 0.0 ? bytes / ns : 0.0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  int iterations = 200;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--iterations") == 0 && hasValue)
+      iterations = atoi(argv[++i]);
+    else
+    {
+      fprintf(stderr, "Usage: %s [--iterations <n>]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (iterations <= 0)
+    return 2;
+
+  std::vector<uint8_t> buffer(static_cast<size_t>(VIEW_WIDTH) * VIEW_HEIGHT * 4);
+  for (size_t i = 0; i < buffer.size(); ++i)
+    buffer[i] = static_cast<uint8_t>(i * 7 + i / 4);
+
+  // The vector path must give the same pixels as the scalar one, also on odd
+  // lengths where its tail is used
+  std::vector<uint8_t> vector(buffer.size());
+  std::vector<uint8_t> scalar(buffer.size());
+  const size_t odd = static_cast<size_t>(VIEW_WIDTH) * VIEW_HEIGHT - 13;
+  PixelConvert::BGRAToRGBA(vector.data(), buffer.data() + 4, odd);
+  ScalarBGRAToRGBA(scalar.data(), buffer.data() + 4, odd);
+  if (vector != scalar)
+  {
+    fprintf(stderr, "PixelConvert::BGRAToRGBA differs from the scalar conversion\n");
+    return 1;
+  }
+
+  const RowCopy packed = [](uint8_t* dst, const uint8_t* src, size_t pixels) {
+    memcpy(dst, src, pixels * 4);
+  };
+
+  for (const RectSet& set : RectSets())
+  {
+    Run("bgra/swizzle in place", set, iterations, buffer, nullptr);
+    Run("bgra/swizzle packed", set, iterations, buffer, packed);
+    Run("cpu convert", set, iterations, buffer, PixelConvert::BGRAToRGBA);
+    Run("cpu convert scalar", set, iterations, buffer, ScalarBGRAToRGBA);
+  }
+
+  return 0;
+}
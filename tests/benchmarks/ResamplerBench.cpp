@@ -0,0 +1,118 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+/*
+ * CPU cost of CResampler for the usual rate pairs, channel counts and
+ * qualities.
+ *
+ *   resampler_bench [--seconds <s>] [--period <frames>]
+ *
+ * Prints per case the CPU time used for one second of audio and the
+ * filter length.
+ */
+
+#include "audio/Resampler.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+namespace
+{
+
+struct Case
+{
+  unsigned int inRate;
+  unsigned int outRate;
+  bool variable;
+};
+
+// Fixed ratios of CEF against the sink and the variable mode of the clock
+// correction
+constexpr Case CASES[] = {
+    {44100, 48000, false}, {48000, 44100, false}, {96000, 48000, false}, {48000, 48000, true},
+};
+
+constexpr unsigned int CHANNELS[] = {2, 6, 8};
+
+constexpr CResampler::Quality QUALITIES[] = {CResampler::QUALITY_LOW, CResampler::QUALITY_MEDIUM,
+                                             CResampler::QUALITY_HIGH};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  double seconds = 20.0;
+  unsigned int period = 480;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--seconds") == 0 && hasValue)
+      seconds = atof(argv[++i]);
+    else if (strcmp(argv[i], "--period") == 0 && hasValue)
+      period = static_cast<unsigned int>(atoi(argv[++i]));
+    else
+    {
+      fprintf(stderr, "Usage: %s [--seconds <s>] [--period <frames>]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (seconds <= 0.0 || period == 0)
+    return 2;
+
+  std::vector<float> plane(period);
+  for (unsigned int frame = 0; frame < period; ++frame)
+    plane[frame] = 0.5f * static_cast<float>(std::sin(0.01 * frame));
+
+  float check = 0.0f;
+
+  printf("%-24s %3s %8s %5s %14s\n", "rates", "ch", "quality", "taps", "CPU ms/s audio");
+  for (const Case& rates : CASES)
+  {
+    for (unsigned int channels : CHANNELS)
+    {
+      for (CResampler::Quality quality : QUALITIES)
+      {
+        CResampler resampler;
+        resampler.Configure(channels, rates.inRate, rates.outRate, quality, rates.variable);
+        if (rates.variable)
+          resampler.SetRatioAdjust(1.002);
+
+        std::vector<std::vector<float>> output(channels,
+                                               std::vector<float>(resampler.MaxOutput(period)));
+        std::vector<const float*> inputPointers(channels, plane.data());
+        std::vector<float*> outputPointers;
+        for (auto& out : output)
+          outputPointers.push_back(out.data());
+
+        const size_t periods = static_cast<size_t>(seconds * rates.inRate / period) + 1;
+        const std::clock_t start = std::clock();
+        for (size_t i = 0; i < periods; ++i)
+          resampler.Process(inputPointers.data(), period, outputPointers.data());
+        const double used = static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+
+        // Keeps the work from being optimized away
+        check += output[0][0];
+
+        const double audio = static_cast<double>(periods) * period / rates.inRate;
+        char name[32];
+        snprintf(name, sizeof(name), "%u -> %u%s", rates.inRate, rates.outRate,
+                 rates.variable ? " variable" : "");
+        printf("%-24s %3u %8d %5u %14.3f\n", name, channels, static_cast<int>(quality),
+               resampler.Taps(), 1000.0 * used / audio);
+      }
+    }
+  }
+
+  return std::isfinite(check) ? 0 : 1;
+}
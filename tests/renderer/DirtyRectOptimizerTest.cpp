@@ -0,0 +1,270 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "TestUtils.h"
+#include "renderer/DirtyRectOptimizer.h"
+
+namespace
+{
+
+constexpr int VIEW_WIDTH = 1920;
+constexpr int VIEW_HEIGHT = 1080;
+
+// Same call cost as used by the renderers
+constexpr int CALL_OVERHEAD_PIXELS = 4096;
+
+bool Contains(const CefRect& outer, const CefRect& inner)
+{
+  return inner.x >= outer.x && inner.y >= outer.y &&
+         inner.x + inner.width <= outer.x + outer.width &&
+         inner.y + inner.height <= outer.y + outer.height;
+}
+
+bool Covered(const CefRenderHandler::RectList& uploadRects, const CefRect& dirty)
+{
+  for (const auto& rect : uploadRects)
+  {
+    if (Contains(rect, dirty))
+      return true;
+  }
+  return false;
+}
+
+} // namespace
+
+TEST_CASE(EmptyAndInvalid)
+{
+  CDirtyRectOptimizer optimizer;
+  CefRenderHandler::RectList uploadRects{CefRect(1, 2, 3, 4)};
+
+  TEST_CHECK(!optimizer.Optimize({}, VIEW_WIDTH, VIEW_HEIGHT, uploadRects));
+  TEST_CHECK(uploadRects.empty());
+
+  TEST_CHECK(!optimizer.Optimize({CefRect(0, 0, 10, 10)}, 0, VIEW_HEIGHT, uploadRects));
+  TEST_CHECK(uploadRects.empty());
+}
+
+TEST_CASE(ClipToView)
+{
+  CDirtyRectOptimizer optimizer;
+  optimizer.SetCosts(0, 1.0f);
+  CefRenderHandler::RectList uploadRects;
+
+  optimizer.Optimize({CefRect(-10, -20, 30, 40), CefRect(VIEW_WIDTH, 0, 10, 10),
+                      CefRect(VIEW_WIDTH - 5, VIEW_HEIGHT - 5, 10, 10)},
+                     VIEW_WIDTH, VIEW_HEIGHT, uploadRects);
+
+  TEST_CHECK(uploadRects.size() == 2);
+  TEST_CHECK(uploadRects[0] == CefRect(0, 0, 20, 20));
+  TEST_CHECK(uploadRects[1] == CefRect(VIEW_WIDTH - 5, VIEW_HEIGHT - 5, 5, 5));
+}
+
+TEST_CASE(MergeAdjacent)
+{
+  CDirtyRectOptimizer optimizer;
+  optimizer.SetCosts(CALL_OVERHEAD_PIXELS, 0.7f);
+  CefRenderHandler::RectList uploadRects;
+
+  TEST_CHECK(!optimizer.Optimize({CefRect(0, 0, 10, 10), CefRect(10, 0, 10, 10)}, VIEW_WIDTH,
+                                 VIEW_HEIGHT, uploadRects));
+  TEST_CHECK(uploadRects.size() == 1);
+  TEST_CHECK(uploadRects[0] == CefRect(0, 0, 20, 10));
+}
+
+TEST_CASE(MergeOverlapping)
+{
+  CDirtyRectOptimizer optimizer;
+  optimizer.SetCosts(CALL_OVERHEAD_PIXELS, 0.7f);
+  CefRenderHandler::RectList uploadRects;
+
+  // 150x150 + overhead is cheaper than 2 x (100x100 + overhead)
+  optimizer.Optimize({CefRect(0, 0, 100, 100), CefRect(50, 50, 100, 100)}, VIEW_WIDTH,
+                     VIEW_HEIGHT, uploadRects);
+  TEST_CHECK(uploadRects.size() == 1);
+  TEST_CHECK(uploadRects[0] == CefRect(0, 0, 150, 150));
+
+  // A contained rectangle is always merged, even without call cost
+  optimizer.SetCosts(0, 0.7f);
+  optimizer.Optimize({CefRect(0, 0, 100, 100), CefRect(20, 20, 10, 10)}, VIEW_WIDTH, VIEW_HEIGHT,
+                     uploadRects);
+  TEST_CHECK(uploadRects.size() == 1);
+  TEST_CHECK(uploadRects[0] == CefRect(0, 0, 100, 100));
+}
+
+TEST_CASE(KeepDistant)
+{
+  CDirtyRectOptimizer optimizer;
+  optimizer.SetCosts(CALL_OVERHEAD_PIXELS, 0.7f);
+  CefRenderHandler::RectList uploadRects;
+
+  const CefRenderHandler::RectList dirtyRects{CefRect(0, 0, 200, 200),
+                                              CefRect(1500, 800, 200, 200)};
+  TEST_CHECK(!optimizer.Optimize(dirtyRects, VIEW_WIDTH, VIEW_HEIGHT, uploadRects));
+  TEST_CHECK(uploadRects == dirtyRects);
+}
+
+TEST_CASE(MergeGrownReachesChecked)
+{
+  CDirtyRectOptimizer optimizer;
+  optimizer.SetCosts(0, 1.0f);
+  CefRenderHandler::RectList uploadRects;
+
+  // First and second only fit together after the others grew the first
+  optimizer.Optimize({CefRect(0, 0, 10, 10), CefRect(0, 20, 20, 10), CefRect(0, 10, 10, 10),
+                      CefRect(10, 0, 10, 20)},
+                     VIEW_WIDTH, VIEW_HEIGHT, uploadRects);
+  TEST_CHECK(uploadRects.size() == 1);
+  TEST_CHECK(uploadRects[0] == CefRect(0, 0, 20, 30));
+}
+
+TEST_CASE(AllDirtyCovered)
+{
+  CDirtyRectOptimizer optimizer;
+  optimizer.SetCosts(CALL_OVERHEAD_PIXELS, 0.7f);
+  CefRenderHandler::RectList uploadRects;
+
+  CefRenderHandler::RectList dirtyRects;
+  for (int i = 0; i < 40; ++i)
+    dirtyRects.emplace_back((i * 397) % (VIEW_WIDTH - 50), (i * 211) % (VIEW_HEIGHT - 30), 50, 30);
+
+  optimizer.Optimize(dirtyRects, VIEW_WIDTH, VIEW_HEIGHT, uploadRects);
+  TEST_CHECK(!uploadRects.empty());
+  TEST_CHECK(uploadRects.size() <= dirtyRects.size());
+  for (const auto& dirty : dirtyRects)
+    TEST_CHECK(Covered(uploadRects, dirty));
+}
+
+TEST_CASE(PairwiseUpTo64Rects)
+{
+  CDirtyRectOptimizer optimizer;
+  optimizer.SetCosts(0, 1.0f);
+  CefRenderHandler::RectList uploadRects;
+
+  // Without call cost are separated rectangles never merged
+  CefRenderHandler::RectList dirtyRects;
+  for (int i = 0; i < 64; ++i)
+    dirtyRects.emplace_back((i % 16) * 100, (i / 16) * 100, 50, 50);
+
+  optimizer.Optimize(dirtyRects, VIEW_WIDTH, VIEW_HEIGHT, uploadRects);
+  TEST_CHECK(uploadRects == dirtyRects);
+}
+
+TEST_CASE(SeparateAbove64Rects)
+{
+  CDirtyRectOptimizer optimizer;
+  optimizer.SetCosts(0, 1.0f);
+  CefRenderHandler::RectList uploadRects;
+
+  // Without call cost stay separated rectangles also above the pairwise
+  // limit separate, no bounding box over all
+  CefRenderHandler::RectList dirtyRects;
+  for (int i = 0; i < 65; ++i)
+    dirtyRects.emplace_back((i % 16) * 100, (i / 16) * 100, 50, 50);
+
+  TEST_CHECK(!optimizer.Optimize(dirtyRects, VIEW_WIDTH, VIEW_HEIGHT, uploadRects));
+  TEST_CHECK(uploadRects.size() == dirtyRects.size());
+  for (const auto& dirty : dirtyRects)
+    TEST_CHECK(Covered(uploadRects, dirty));
+}
+
+TEST_CASE(NeighboursMergedAbove64Rects)
+{
+  CDirtyRectOptimizer optimizer;
+  optimizer.SetCosts(CALL_OVERHEAD_PIXELS, 0.7f);
+  CefRenderHandler::RectList uploadRects;
+
+  // Glyphs of 4 text lines, neighbours in a line are merged
+  CefRenderHandler::RectList dirtyRects;
+  for (int line = 0; line < 4; ++line)
+  {
+    for (int i = 0; i < 50; ++i)
+      dirtyRects.emplace_back(100 + i * 14, 100 + line * 200, 16, 20);
+  }
+
+  TEST_CHECK(!optimizer.Optimize(dirtyRects, VIEW_WIDTH, VIEW_HEIGHT, uploadRects));
+  TEST_CHECK(uploadRects.size() == 4);
+  for (const auto& dirty : dirtyRects)
+    TEST_CHECK(Covered(uploadRects, dirty));
+}
+
+TEST_CASE(NoFullUploadForScatteredAbove64Rects)
+{
+  CDirtyRectOptimizer optimizer;
+  optimizer.SetCosts(CALL_OVERHEAD_PIXELS, 0.7f);
+  CefRenderHandler::RectList uploadRects;
+
+  // Few pixels dirty, spread over the whole view
+  CefRenderHandler::RectList dirtyRects;
+  int64_t dirtyPixels = 0;
+  for (int i = 0; i < 200; ++i)
+  {
+    dirtyRects.emplace_back((i * 397) % (VIEW_WIDTH - 30), (i * 211) % (VIEW_HEIGHT - 20), 30, 20);
+    dirtyPixels += 30 * 20;
+  }
+
+  TEST_CHECK(!optimizer.Optimize(dirtyRects, VIEW_WIDTH, VIEW_HEIGHT, uploadRects));
+  TEST_CHECK(uploadRects.size() < dirtyRects.size());
+
+  int64_t uploadPixels = 0;
+  for (const auto& rect : uploadRects)
+    uploadPixels += static_cast<int64_t>(rect.width) * rect.height;
+  TEST_CHECK(uploadPixels < 5 * dirtyPixels);
+  for (const auto& dirty : dirtyRects)
+    TEST_CHECK(Covered(uploadRects, dirty));
+}
+
+TEST_CASE(FullUploadRatio)
+{
+  CDirtyRectOptimizer optimizer;
+  CefRenderHandler::RectList uploadRects;
+
+  // Top 75 % of the view
+  const CefRenderHandler::RectList dirtyRects{CefRect(0, 0, VIEW_WIDTH, VIEW_HEIGHT * 3 / 4)};
+
+  optimizer.SetCosts(CALL_OVERHEAD_PIXELS, 0.7f);
+  TEST_CHECK(optimizer.Optimize(dirtyRects, VIEW_WIDTH, VIEW_HEIGHT, uploadRects));
+  TEST_CHECK(uploadRects.size() == 1);
+  TEST_CHECK(uploadRects[0] == CefRect(0, 0, VIEW_WIDTH, VIEW_HEIGHT));
+
+  optimizer.SetCosts(CALL_OVERHEAD_PIXELS, 0.8f);
+  TEST_CHECK(!optimizer.Optimize(dirtyRects, VIEW_WIDTH, VIEW_HEIGHT, uploadRects));
+  TEST_CHECK(uploadRects == dirtyRects);
+
+  // Exactly at the ratio is full
+  optimizer.SetCosts(CALL_OVERHEAD_PIXELS, 0.75f);
+  TEST_CHECK(optimizer.Optimize(dirtyRects, VIEW_WIDTH, VIEW_HEIGHT, uploadRects));
+
+  // Out of range values are limited to 0.0 - 1.0
+  optimizer.SetCosts(CALL_OVERHEAD_PIXELS, 2.0f);
+  TEST_CHECK(!optimizer.Optimize(dirtyRects, VIEW_WIDTH, VIEW_HEIGHT, uploadRects));
+  TEST_CHECK(optimizer.Optimize({CefRect(0, 0, VIEW_WIDTH, VIEW_HEIGHT)}, VIEW_WIDTH, VIEW_HEIGHT,
+                                uploadRects));
+}
+
+TEST_CASE(Statistics)
+{
+  CDirtyRectOptimizer optimizer;
+  optimizer.SetCosts(CALL_OVERHEAD_PIXELS, 0.7f);
+  CefRenderHandler::RectList uploadRects;
+
+  optimizer.Optimize({CefRect(0, 0, 10, 10), CefRect(10, 0, 10, 10)}, VIEW_WIDTH, VIEW_HEIGHT,
+                     uploadRects);
+  optimizer.Optimize({CefRect(0, 0, 200, 200), CefRect(1500, 800, 200, 200)}, VIEW_WIDTH,
+                     VIEW_HEIGHT, uploadRects);
+  optimizer.Optimize({CefRect(0, 0, VIEW_WIDTH, VIEW_HEIGHT)}, VIEW_WIDTH, VIEW_HEIGHT,
+                     uploadRects);
+
+  TEST_CHECK(optimizer.InputRects() == 5);
+  TEST_CHECK(optimizer.OutputRects() == 4);
+  TEST_CHECK(optimizer.FullUploads() == 1);
+}
+
+int main()
+{
+  return TestUtils::RunAll();
+}
@@ -0,0 +1,184 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "TestUtils.h"
+#include "renderer/RendererMemory.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr int WIDTH = 256;
+constexpr int HEIGHT = 128;
+
+std::vector<uint8_t> Buffer(int width, int height, uint8_t value)
+{
+  return std::vector<uint8_t>(static_cast<size_t>(width) * height * 4, value);
+}
+
+uint8_t Pixel(const std::vector<uint8_t>& buffer, int width, int x, int y, int channel)
+{
+  return buffer[(static_cast<size_t>(y) * width + x) * 4 + channel];
+}
+
+RendererConfig Config()
+{
+  RendererConfig config;
+  config.fullUploadRatio = 0.7f;
+  return config;
+}
+
+} // namespace
+
+TEST_CASE(FirstPaintIsComplete)
+{
+  CRendererClientMemory renderer(Config());
+  TEST_CHECK(renderer.Initialize());
+
+  const std::vector<uint8_t> buffer = Buffer(WIDTH, HEIGHT, 0x40);
+  renderer.OnPaint(PET_VIEW, {CefRect(0, 0, 8, 8)}, buffer.data(), WIDTH, HEIGHT);
+  renderer.Render();
+
+  TEST_CHECK(renderer.FrameWidth() == WIDTH);
+  TEST_CHECK(renderer.FrameHeight() == HEIGHT);
+  TEST_CHECK(renderer.FrameBuffer() == buffer);
+  TEST_CHECK(renderer.LastFrameStats().uploadBytes == buffer.size());
+}
+
+TEST_CASE(DirtyRectOnlyIsCopied)
+{
+  CRendererClientMemory renderer(Config());
+  renderer.Initialize();
+
+  std::vector<uint8_t> buffer = Buffer(WIDTH, HEIGHT, 0x00);
+  renderer.OnPaint(PET_VIEW, {CefRect(0, 0, WIDTH, HEIGHT)}, buffer.data(), WIDTH, HEIGHT);
+  renderer.Render();
+
+  // The whole source changes, but only the dirty part may arrive
+  buffer.assign(buffer.size(), 0xFF);
+  renderer.OnPaint(PET_VIEW, {CefRect(10, 20, 30, 40)}, buffer.data(), WIDTH, HEIGHT);
+  renderer.Render();
+
+  const std::vector<uint8_t>& frame = renderer.FrameBuffer();
+  TEST_CHECK(Pixel(frame, WIDTH, 10, 20, 0) == 0xFF);
+  TEST_CHECK(Pixel(frame, WIDTH, 39, 59, 3) == 0xFF);
+  TEST_CHECK(Pixel(frame, WIDTH, 9, 20, 0) == 0x00);
+  TEST_CHECK(Pixel(frame, WIDTH, 40, 59, 0) == 0x00);
+  TEST_CHECK(Pixel(frame, WIDTH, 10, 60, 0) == 0x00);
+  TEST_CHECK(renderer.LastFrameStats().uploadBytes == 30u * 40u * 4u);
+  TEST_CHECK(!renderer.LastFrameStats().fullUpload);
+}
+
+TEST_CASE(PopupIsComposed)
+{
+  CRendererClientMemory renderer(Config());
+  renderer.Initialize();
+
+  const std::vector<uint8_t> view = Buffer(WIDTH, HEIGHT, 0x10);
+  renderer.OnPaint(PET_VIEW, {CefRect(0, 0, WIDTH, HEIGHT)}, view.data(), WIDTH, HEIGHT);
+
+  const std::vector<uint8_t> popup = Buffer(20, 10, 0xA0);
+  renderer.OnPopupShow(nullptr, true);
+  renderer.OnPopupSize(nullptr, CefRect(50, 60, 20, 10));
+  renderer.OnPaint(PET_POPUP, {CefRect(0, 0, 20, 10)}, popup.data(), 20, 10);
+  renderer.Render();
+
+  const std::vector<uint8_t>& frame = renderer.FrameBuffer();
+  TEST_CHECK(Pixel(frame, WIDTH, 50, 60, 0) == 0xA0);
+  TEST_CHECK(Pixel(frame, WIDTH, 69, 69, 0) == 0xA0);
+  TEST_CHECK(Pixel(frame, WIDTH, 70, 60, 0) == 0x10);
+  TEST_CHECK(Pixel(frame, WIDTH, 49, 60, 0) == 0x10);
+
+  // Hidden again, the view is seen there
+  renderer.OnPopupShow(nullptr, false);
+  renderer.Render();
+  TEST_CHECK(Pixel(renderer.FrameBuffer(), WIDTH, 50, 60, 0) == 0x10);
+}
+
+TEST_CASE(ScaledPopupIsBilinear)
+{
+  CRendererClientMemory renderer(Config());
+  renderer.Initialize();
+
+  const std::vector<uint8_t> view = Buffer(WIDTH, HEIGHT, 0x10);
+  renderer.OnPaint(PET_VIEW, {CefRect(0, 0, WIDTH, HEIGHT)}, view.data(), WIDTH, HEIGHT);
+
+  // Left texel black, right one white, shown with twice the width
+  std::vector<uint8_t> popup = Buffer(2, 1, 0x00);
+  memset(popup.data() + 4, 0xFF, 4);
+  renderer.OnPopupShow(nullptr, true);
+  renderer.OnPopupSize(nullptr, CefRect(50, 60, 4, 2));
+  renderer.OnPaint(PET_POPUP, {CefRect(0, 0, 2, 1)}, popup.data(), 2, 1);
+  renderer.Render();
+
+  // Same values as GL_LINEAR with GL_CLAMP_TO_EDGE gives
+  const std::vector<uint8_t>& frame = renderer.FrameBuffer();
+  TEST_CHECK(Pixel(frame, WIDTH, 50, 60, 0) == 0x00);
+  TEST_CHECK_NEAR(Pixel(frame, WIDTH, 51, 60, 0), 64.0, 1.0);
+  TEST_CHECK_NEAR(Pixel(frame, WIDTH, 52, 61, 0), 191.0, 1.0);
+  TEST_CHECK(Pixel(frame, WIDTH, 53, 61, 0) == 0xFF);
+}
+
+TEST_CASE(DumpFrameWritesPPM)
+{
+  CRendererClientMemory renderer(Config());
+  renderer.Initialize();
+
+  const std::string path = "renderer_memory_test.ppm";
+  TEST_CHECK(!renderer.DumpFrame(path));
+
+  // BGRA of CEF, the dump has RGB
+  std::vector<uint8_t> buffer(static_cast<size_t>(2) * 1 * 4);
+  const uint8_t bgra[] = {0x01, 0x02, 0x03, 0xFF, 0x04, 0x05, 0x06, 0xFF};
+  memcpy(buffer.data(), bgra, sizeof(bgra));
+  renderer.OnPaint(PET_VIEW, {CefRect(0, 0, 2, 1)}, buffer.data(), 2, 1);
+  renderer.Render();
+  TEST_CHECK(renderer.DumpFrame(path));
+
+  FILE* file = fopen(path.c_str(), "rb");
+  TEST_CHECK(file != nullptr);
+  if (!file)
+    return;
+
+  char data[64] = {};
+  const size_t size = fread(data, 1, sizeof(data), file);
+  fclose(file);
+  remove(path.c_str());
+
+  const char expected[] = "P6\n2 1\n255\n\x03\x02\x01\x06\x05\x04";
+  TEST_CHECK(size == sizeof(expected) - 1);
+  TEST_CHECK(memcmp(data, expected, sizeof(expected) - 1) == 0);
+}
+
+TEST_CASE(SuspendFreesAndResumeUploadsComplete)
+{
+  CRendererClientMemory renderer(Config());
+  renderer.Initialize();
+
+  const std::vector<uint8_t> buffer = Buffer(WIDTH, HEIGHT, 0x20);
+  renderer.OnPaint(PET_VIEW, {CefRect(0, 0, WIDTH, HEIGHT)}, buffer.data(), WIDTH, HEIGHT);
+  renderer.Render();
+  TEST_CHECK(renderer.AllocatedBytes() > 0);
+
+  renderer.Suspend();
+  TEST_CHECK(renderer.AllocatedBytes() == 0);
+
+  TEST_CHECK(renderer.Resume());
+  renderer.OnPaint(PET_VIEW, {CefRect(0, 0, 1, 1)}, buffer.data(), WIDTH, HEIGHT);
+  renderer.Render();
+  TEST_CHECK(renderer.FrameBuffer() == buffer);
+}
+
+int main()
+{
+  return TestUtils::RunAll();
+}
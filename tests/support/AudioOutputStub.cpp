@@ -0,0 +1,94 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include "AudioOutputStub.h"
+
+#include <algorithm>
+
+class CAudioOutputStub::CSink : public IAudioSink
+{
+public:
+  CSink(CAudioOutputStub& output, const kodi::audioengine::AudioEngineFormat& format)
+    : m_output(output),
+      m_frameSize(std::max(format.GetFrameSize(), 1u)),
+      m_sampleRate(std::max(format.GetSampleRate(), 1u)),
+      m_capacity(static_cast<uint64_t>(m_sampleRate) * output.m_bufferMs / 1000)
+  {
+  }
+
+  unsigned int GetSpace() override
+  {
+    return static_cast<unsigned int>((m_capacity - std::min(Queued(), m_capacity)) * m_frameSize);
+  }
+
+  unsigned int AddData(uint8_t* const* data,
+                       unsigned int offset,
+                       unsigned int frames,
+                       double pts) override
+  {
+    const uint64_t queued = Queued();
+    if (m_started && queued == 0)
+      m_output.m_underruns++;
+
+    // Played out from now on, the time is moved on by the added frames
+    if (!m_started || queued == 0)
+    {
+      m_start = std::chrono::steady_clock::now();
+      m_added = 0;
+      m_started = true;
+    }
+
+    frames = static_cast<unsigned int>(std::min<uint64_t>(frames, m_capacity - std::min(queued, m_capacity)));
+    m_added += frames;
+    m_output.m_frames += frames;
+    return frames;
+  }
+
+  double GetDelay() override { return static_cast<double>(Queued()) / m_sampleRate; }
+  void SetVolume(float volume) override {}
+
+private:
+  uint64_t Queued() const
+  {
+    if (!m_started)
+      return 0;
+
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    const uint64_t played = static_cast<uint64_t>(seconds * m_sampleRate);
+    return m_added > played ? m_added - played : 0;
+  }
+
+  CAudioOutputStub& m_output;
+  const unsigned int m_frameSize;
+  const unsigned int m_sampleRate;
+  const uint64_t m_capacity;
+
+  bool m_started = false;
+  std::chrono::steady_clock::time_point m_start;
+  uint64_t m_added = 0;
+};
+
+CAudioOutputStub::CAudioOutputStub(const kodi::audioengine::AudioEngineFormat& sinkFormat,
+                                   unsigned int bufferMs)
+  : m_sinkFormat(sinkFormat), m_bufferMs(std::max(bufferMs, 1u))
+{
+}
+
+bool CAudioOutputStub::GetSinkFormat(kodi::audioengine::AudioEngineFormat& format)
+{
+  format = m_sinkFormat;
+  return true;
+}
+
+std::unique_ptr<IAudioSink> CAudioOutputStub::OpenStream(
+    const kodi::audioengine::AudioEngineFormat& format)
+{
+  m_opened++;
+  return std::unique_ptr<IAudioSink>(new CSink(*this, format));
+}
@@ -0,0 +1,55 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+#include "audio/AudioOutput.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdint.h>
+
+/*!
+ * @brief Audio output without a device, its streams play in real time into
+ * nothing.
+ *
+ * A stream holds up to the buffer time and plays it out by the clock from
+ * its first added frame on, like a sink of AudioEngine would.
+ */
+class CAudioOutputStub : public IAudioOutput
+{
+public:
+  /*!
+   * @param[in] sinkFormat Format given as the one of the device
+   * @param[in] bufferMs Audio a stream takes before it is full
+   */
+  CAudioOutputStub(const kodi::audioengine::AudioEngineFormat& sinkFormat, unsigned int bufferMs);
+
+  bool GetSinkFormat(kodi::audioengine::AudioEngineFormat& format) override;
+  std::unique_ptr<IAudioSink> OpenStream(
+      const kodi::audioengine::AudioEngineFormat& format) override;
+
+  uint64_t Opened() const { return m_opened; }
+  uint64_t Frames() const { return m_frames; }
+
+  /*!
+   * @brief Times a stream played out all it had.
+   */
+  uint64_t Underruns() const { return m_underruns; }
+
+private:
+  class CSink;
+
+  const kodi::audioengine::AudioEngineFormat m_sinkFormat;
+  const unsigned int m_bufferMs;
+
+  std::atomic<uint64_t> m_opened{0};
+  std::atomic<uint64_t> m_frames{0};
+  std::atomic<uint64_t> m_underruns{0};
+};
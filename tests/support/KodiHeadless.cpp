@@ -0,0 +1,181 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#include <kodi/Filesystem.h>
+#include <kodi/General.h>
+
+#include <cstdarg>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <sys/stat.h>
+
+namespace
+{
+
+std::mutex g_mutex;
+std::map<std::string, std::string> g_settings;
+std::string g_userPath = ".";
+AddonLog g_logLevel = ADDON_LOG_INFO;
+
+bool GetSetting(const std::string& settingName, std::string& value)
+{
+  std::lock_guard<std::mutex> lock(g_mutex);
+  const auto it = g_settings.find(settingName);
+  if (it == g_settings.end())
+    return false;
+
+  value = it->second;
+  return true;
+}
+
+} // namespace
+
+namespace kodi
+{
+
+void Log(const AddonLog loglevel, const char* format, ...)
+{
+  static const char* const names[] = {"DEBUG", "INFO", "NOTICE", "WARNING",
+                                      "ERROR", "SEVERE", "FATAL"};
+  if (loglevel < g_logLevel)
+    return;
+
+  char buffer[16384];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+
+  std::lock_guard<std::mutex> lock(g_mutex);
+  fprintf(stderr, "%-7s %s\n", names[loglevel], buffer);
+}
+
+bool GetSettingBoolean(const std::string& settingName, bool defaultValue)
+{
+  std::string value;
+  if (!GetSetting(settingName, value))
+    return defaultValue;
+  return value == "true" || value == "1";
+}
+
+int GetSettingInt(const std::string& settingName, int defaultValue)
+{
+  std::string value;
+  return GetSetting(settingName, value) ? atoi(value.c_str()) : defaultValue;
+}
+
+float GetSettingFloat(const std::string& settingName, float defaultValue)
+{
+  std::string value;
+  return GetSetting(settingName, value) ? static_cast<float>(atof(value.c_str())) : defaultValue;
+}
+
+std::string GetSettingString(const std::string& settingName, const std::string& defaultValue)
+{
+  std::string value;
+  return GetSetting(settingName, value) ? value : defaultValue;
+}
+
+std::string GetBaseUserPath(const std::string& append)
+{
+  std::lock_guard<std::mutex> lock(g_mutex);
+  return append.empty() ? g_userPath : g_userPath + "/" + append;
+}
+
+namespace headless
+{
+
+void SetLogLevel(AddonLog level)
+{
+  g_logLevel = level;
+}
+
+void SetSetting(const std::string& settingName, const std::string& value)
+{
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_settings[settingName] = value;
+}
+
+void SetUserPath(const std::string& path)
+{
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_userPath = path;
+}
+
+} // namespace headless
+
+namespace vfs
+{
+
+bool CreateDirectory(const std::string& path)
+{
+  return mkdir(path.c_str(), 0755) == 0 || FileExists(path);
+}
+
+bool FileExists(const std::string& filename, bool usecache)
+{
+  struct stat info;
+  return stat(filename.c_str(), &info) == 0;
+}
+
+bool CFile::OpenFile(const std::string& filename, unsigned int flags)
+{
+  Close();
+  m_file = fopen(filename.c_str(), "rb");
+  return m_file != nullptr;
+}
+
+bool CFile::OpenFileForWrite(const std::string& filename, bool overwrite)
+{
+  Close();
+  if (!overwrite && FileExists(filename))
+    return false;
+
+  m_file = fopen(filename.c_str(), "wb");
+  return m_file != nullptr;
+}
+
+void CFile::Close()
+{
+  if (m_file)
+    fclose(m_file);
+  m_file = nullptr;
+}
+
+ssize_t CFile::Read(void* ptr, size_t size)
+{
+  return m_file ? static_cast<ssize_t>(fread(ptr, 1, size, m_file)) : -1;
+}
+
+ssize_t CFile::Write(const void* ptr, size_t size)
+{
+  return m_file ? static_cast<ssize_t>(fwrite(ptr, 1, size, m_file)) : -1;
+}
+
+int64_t CFile::Seek(int64_t position, int whence)
+{
+  if (!m_file || fseek(m_file, static_cast<long>(position), whence) != 0)
+    return -1;
+  return ftell(m_file);
+}
+
+int64_t CFile::GetLength() const
+{
+  if (!m_file)
+    return 0;
+
+  const long position = ftell(m_file);
+  fseek(m_file, 0, SEEK_END);
+  const long length = ftell(m_file);
+  fseek(m_file, position, SEEK_SET);
+  return length;
+}
+
+} // namespace vfs
+} // namespace kodi
@@ -0,0 +1,96 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+/*
+ * Minimal checks for the test executables, run by ctest. A failed check
+ * prints its place and the test ends with exit code 1 after all ran.
+ *
+ *   TEST_CASE(Name) { TEST_CHECK(a == b); }
+ *   int main() { return TestUtils::RunAll(); }
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace TestUtils
+{
+
+struct TestCase
+{
+  const char* name;
+  std::function<void()> function;
+};
+
+inline std::vector<TestCase>& Cases()
+{
+  static std::vector<TestCase> cases;
+  return cases;
+}
+
+inline int& Failures()
+{
+  static int failures = 0;
+  return failures;
+}
+
+struct Register
+{
+  Register(const char* name, std::function<void()> function)
+  {
+    Cases().push_back({name, std::move(function)});
+  }
+};
+
+inline void Fail(const char* file, int line, const std::string& message)
+{
+  fprintf(stderr, "%s:%i: FAILED: %s\n", file, line, message.c_str());
+  Failures()++;
+}
+
+inline int RunAll()
+{
+  for (const auto& test : Cases())
+  {
+    const int before = Failures();
+    test.function();
+    fprintf(stderr, "%s %s\n", Failures() == before ? "[  OK  ]" : "[FAILED]", test.name);
+  }
+
+  fprintf(stderr, "%zu tests, %i failed checks\n", Cases().size(), Failures());
+  return Failures() == 0 ? 0 : 1;
+}
+
+} // namespace TestUtils
+
+#define TEST_CASE(name) \
+  static void name(); \
+  static TestUtils::Register name##Register(#name, name); \
+  static void name()
+
+#define TEST_CHECK(condition) \
+  do \
+  { \
+    if (!(condition)) \
+      TestUtils::Fail(__FILE__, __LINE__, #condition); \
+  } while (0)
+
+#define TEST_CHECK_NEAR(value, expected, tolerance) \
+  do \
+  { \
+    const double testValue = (value); \
+    const double testExpected = (expected); \
+    if (!(std::fabs(testValue - testExpected) <= (tolerance))) \
+      TestUtils::Fail(__FILE__, __LINE__, \
+                      std::string(#value) + " = " + std::to_string(testValue) + ", expected " + \
+                          std::to_string(testExpected)); \
+  } while (0)
@@ -0,0 +1,111 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+/*
+ * Headless format description of Kodi's AudioEngine. There is no stream and
+ * no sink here, the tests and tools play into an IAudioOutput of their own.
+ */
+
+#include "General.h"
+
+#include <vector>
+
+enum AudioEngineChannel
+{
+  AUDIOENGINE_CH_NULL = -1,
+  AUDIOENGINE_CH_RAW,
+  AUDIOENGINE_CH_FL,
+  AUDIOENGINE_CH_FR,
+  AUDIOENGINE_CH_FC,
+  AUDIOENGINE_CH_LFE,
+  AUDIOENGINE_CH_BL,
+  AUDIOENGINE_CH_BR,
+  AUDIOENGINE_CH_FLOC,
+  AUDIOENGINE_CH_FROC,
+  AUDIOENGINE_CH_BC,
+  AUDIOENGINE_CH_SL,
+  AUDIOENGINE_CH_SR,
+  AUDIOENGINE_CH_TFL,
+  AUDIOENGINE_CH_TFR,
+  AUDIOENGINE_CH_TFC,
+  AUDIOENGINE_CH_TC,
+  AUDIOENGINE_CH_TBL,
+  AUDIOENGINE_CH_TBR,
+  AUDIOENGINE_CH_TBC,
+  AUDIOENGINE_CH_BLOC,
+  AUDIOENGINE_CH_BROC,
+  AUDIOENGINE_CH_MAX
+};
+
+enum AudioEngineDataFormat
+{
+  AUDIOENGINE_FMT_INVALID = -1,
+  AUDIOENGINE_FMT_U8,
+  AUDIOENGINE_FMT_S16BE,
+  AUDIOENGINE_FMT_S16LE,
+  AUDIOENGINE_FMT_S16NE,
+  AUDIOENGINE_FMT_S32BE,
+  AUDIOENGINE_FMT_S32LE,
+  AUDIOENGINE_FMT_S32NE,
+  AUDIOENGINE_FMT_S24BE4,
+  AUDIOENGINE_FMT_S24LE4,
+  AUDIOENGINE_FMT_S24NE4,
+  AUDIOENGINE_FMT_S24NE4MSB,
+  AUDIOENGINE_FMT_S24BE3,
+  AUDIOENGINE_FMT_S24LE3,
+  AUDIOENGINE_FMT_S24NE3,
+  AUDIOENGINE_FMT_DOUBLE,
+  AUDIOENGINE_FMT_FLOAT,
+  AUDIOENGINE_FMT_RAW,
+  AUDIOENGINE_FMT_U8P,
+  AUDIOENGINE_FMT_S16NEP,
+  AUDIOENGINE_FMT_S32NEP,
+  AUDIOENGINE_FMT_S24NE4P,
+  AUDIOENGINE_FMT_S24NE4MSBP,
+  AUDIOENGINE_FMT_S24NE3P,
+  AUDIOENGINE_FMT_DOUBLEP,
+  AUDIOENGINE_FMT_FLOATP,
+  AUDIOENGINE_FMT_MAX
+};
+
+namespace kodi
+{
+namespace audioengine
+{
+
+class ATTRIBUTE_HIDDEN AudioEngineFormat
+{
+public:
+  void SetDataFormat(enum AudioEngineDataFormat format) { m_dataFormat = format; }
+  enum AudioEngineDataFormat GetDataFormat() const { return m_dataFormat; }
+
+  void SetSampleRate(unsigned int rate) { m_sampleRate = rate; }
+  unsigned int GetSampleRate() const { return m_sampleRate; }
+
+  void SetChannelLayout(const std::vector<enum AudioEngineChannel>& layout) { m_layout = layout; }
+  std::vector<enum AudioEngineChannel> GetChannelLayout() const { return m_layout; }
+  unsigned int GetChannelCount() const { return static_cast<unsigned int>(m_layout.size()); }
+
+  void SetFramesAmount(unsigned int frames) { m_frames = frames; }
+  unsigned int GetFramesAmount() const { return m_frames; }
+
+  void SetFrameSize(unsigned int frameSize) { m_frameSize = frameSize; }
+  unsigned int GetFrameSize() const { return m_frameSize; }
+
+private:
+  enum AudioEngineDataFormat m_dataFormat = AUDIOENGINE_FMT_INVALID;
+  unsigned int m_sampleRate = 0;
+  unsigned int m_frames = 0;
+  unsigned int m_frameSize = 0;
+  std::vector<enum AudioEngineChannel> m_layout;
+};
+
+} // namespace audioengine
+} // namespace kodi
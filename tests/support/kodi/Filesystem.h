@@ -0,0 +1,53 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+/*
+ * Headless file access of Kodi's VFS, on local paths only.
+ */
+
+#include "General.h"
+
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+
+namespace kodi
+{
+namespace vfs
+{
+
+bool CreateDirectory(const std::string& path);
+bool FileExists(const std::string& filename, bool usecache = false);
+
+class ATTRIBUTE_HIDDEN CFile
+{
+public:
+  CFile() = default;
+  ~CFile() { Close(); }
+
+  bool OpenFile(const std::string& filename, unsigned int flags = 0);
+  bool OpenFileForWrite(const std::string& filename, bool overwrite = false);
+  void Close();
+
+  ssize_t Read(void* ptr, size_t size);
+  ssize_t Write(const void* ptr, size_t size);
+  int64_t Seek(int64_t position, int whence = SEEK_SET);
+  int64_t GetLength() const;
+
+private:
+  CFile(const CFile&) = delete;
+  CFile& operator=(const CFile&) = delete;
+
+  FILE* m_file = nullptr;
+};
+
+} // namespace vfs
+} // namespace kodi
@@ -0,0 +1,66 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+#pragma once
+
+/*
+ * Headless part of Kodi's add-on API, used instead of the dev-kit by the
+ * tests and tools. Only what the tested add-on sources need is given, with
+ * the same names and signatures as the dev-kit.
+ */
+
+#include <string>
+
+#ifndef ATTRIBUTE_HIDDEN
+#define ATTRIBUTE_HIDDEN
+#endif
+
+typedef enum AddonLog
+{
+  ADDON_LOG_DEBUG = 0,
+  ADDON_LOG_INFO = 1,
+  ADDON_LOG_NOTICE = 2,
+  ADDON_LOG_WARNING = 3,
+  ADDON_LOG_ERROR = 4,
+  ADDON_LOG_SEVERE = 5,
+  ADDON_LOG_FATAL = 6
+} AddonLog;
+
+namespace kodi
+{
+
+/*!
+ * @brief Print to stderr, from the level set by headless::SetLogLevel().
+ */
+void Log(const AddonLog loglevel, const char* format, ...);
+
+/*!
+ * @brief Settings given by headless::SetSetting(), else the default.
+ */
+//@{
+bool GetSettingBoolean(const std::string& settingName, bool defaultValue = false);
+int GetSettingInt(const std::string& settingName, int defaultValue = 0);
+float GetSettingFloat(const std::string& settingName, float defaultValue = 0.0f);
+std::string GetSettingString(const std::string& settingName,
+                             const std::string& defaultValue = "");
+//@}
+
+/*!
+ * @brief Folder of headless::SetUserPath(), the current one by default.
+ */
+std::string GetBaseUserPath(const std::string& append = "");
+
+namespace headless
+{
+
+void SetLogLevel(AddonLog level);
+void SetSetting(const std::string& settingName, const std::string& value);
+void SetUserPath(const std::string& path);
+
+} // namespace headless
+} // namespace kodi
@@ -0,0 +1,132 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+/*
+ * Replay of audio traces or the synthetic source through the audio handler,
+ * into an output without a device.
+ *
+ *   audio_replay [options] [trace ...]
+ *
+ *   --setting <id>=<value>  Add-on setting, e.g. performance.audio_resampler=2
+ *   --sink-rate <Hz>        Rate of the device, default 48000
+ *   --sink-channels <n>     Channels of the device, default 2
+ *   --seconds <s>           Length of the synthetic source, default 10
+ *   --debug                 Show the debug log of the handler
+ *
+ * Without a trace the synthetic source is played. The exit code is 1 if a
+ * trace could not be read or the stream ran into underruns.
+ */
+
+#include "AudioOutputStub.h"
+#include "audio/AudioHandler.h"
+#include "audio/AudioTrace.h"
+#include "audio/ChannelLayout.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <kodi/General.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Audio the stub output buffers, about what a sink of AudioEngine holds
+constexpr unsigned int OUTPUT_BUFFER_MS = 100;
+
+void Usage(const char* name)
+{
+  fprintf(stderr, "Usage: %s [--setting <id>=<value>] [--sink-rate <Hz>] [--sink-channels <n>] "
+                  "[--seconds <s>] [--debug] [trace ...]\n", name);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  unsigned int sinkRate = 48000;
+  unsigned int sinkChannels = 2;
+  double seconds = 10.0;
+  std::vector<std::string> traces;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--setting") == 0 && hasValue)
+    {
+      const std::string setting = argv[++i];
+      const size_t split = setting.find('=');
+      if (split == std::string::npos)
+      {
+        Usage(argv[0]);
+        return 2;
+      }
+      kodi::headless::SetSetting(setting.substr(0, split), setting.substr(split + 1));
+    }
+    else if (strcmp(argv[i], "--sink-rate") == 0 && hasValue)
+      sinkRate = static_cast<unsigned int>(atoi(argv[++i]));
+    else if (strcmp(argv[i], "--sink-channels") == 0 && hasValue)
+      sinkChannels = static_cast<unsigned int>(atoi(argv[++i]));
+    else if (strcmp(argv[i], "--seconds") == 0 && hasValue)
+      seconds = atof(argv[++i]);
+    else if (strcmp(argv[i], "--debug") == 0)
+      kodi::headless::SetLogLevel(ADDON_LOG_DEBUG);
+    else if (argv[i][0] == '-')
+    {
+      Usage(argv[0]);
+      return 2;
+    }
+    else
+      traces.push_back(argv[i]);
+  }
+
+  if (sinkRate == 0 || sinkChannels == 0)
+  {
+    Usage(argv[0]);
+    return 2;
+  }
+
+  const std::vector<AudioEngineChannel> layout = ChannelMap::DefaultChannels(sinkChannels);
+  kodi::audioengine::AudioEngineFormat sinkFormat;
+  sinkFormat.SetDataFormat(AUDIOENGINE_FMT_FLOATP);
+  sinkFormat.SetChannelLayout(layout);
+  sinkFormat.SetSampleRate(sinkRate);
+  sinkFormat.SetFrameSize(static_cast<unsigned int>(sizeof(float) * layout.size()));
+  sinkFormat.SetFramesAmount(sinkRate / 100);
+
+  auto output = std::make_shared<CAudioOutputStub>(sinkFormat, OUTPUT_BUFFER_MS);
+  CefRefPtr<CAudioHandler> handler(new CAudioHandler(nullptr, false, output));
+
+  bool failed = false;
+  CAudioTraceReplay::Result result;
+  if (traces.empty())
+  {
+    CAudioTraceReplay::Synthetic synthetic;
+    synthetic.seconds = seconds;
+    CAudioTraceReplay::Run(synthetic, *handler, result);
+    CAudioTraceReplay::Log("synthetic", result);
+    failed |= result.underruns > 0;
+  }
+
+  for (const auto& trace : traces)
+  {
+    if (!CAudioTraceReplay::Run(trace, *handler, result))
+    {
+      failed = true;
+      continue;
+    }
+    CAudioTraceReplay::Log(trace, result);
+    failed |= result.underruns > 0;
+  }
+
+  kodi::Log(ADDON_LOG_INFO, "Output: %llu streams opened, %llu frames played, %llu underruns",
+            static_cast<unsigned long long>(output->Opened()),
+            static_cast<unsigned long long>(output->Frames()),
+            static_cast<unsigned long long>(output->Underruns()));
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,188 @@
+/*
+ *  Copyright (C) 2015-2020 Alwin Esch (Team Kodi)
+ *  This file is part of Kodi - https://kodi.tv
+ *
+ *  SPDX-License-Identifier: GPL-3.0-or-later
+ *  See LICENSES/README.md for more information.
+ */
+
+/*
+ * Replay of paint traces or a synthetic page workload through the memory
+ * renderer, as benchmark of the paint path without display.
+ *
+ *   paint_replay [options] [trace ...]
+ *
+ *   --setting <id>=<value>  Add-on setting, e.g. performance.tile_hash=true
+ *   --render                Compose a frame after every paint
+ *   --frames <n>            Length of the synthetic workload, default 1000
+ *   --dump <file.ppm>       Write the last frame of every replay as PPM
+ *   --debug                 Show the debug log of the renderer
+ *
+ * Without a trace the synthetic workload is replayed. The exit code is 1 if a
+ * trace could not be read or the dump could not be written.
+ */
+
+#include "renderer/PaintTrace.h"
+#include "renderer/RendererMemory.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <kodi/General.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// View size of the synthetic workload
+constexpr int VIEW_WIDTH = 1280;
+constexpr int VIEW_HEIGHT = 720;
+
+// Trace file of the synthetic workload, removed after the replay
+constexpr const char* SYNTHETIC_TRACE = "paint_replay_synthetic.trace";
+
+void Usage(const char* name)
+{
+  fprintf(stderr, "Usage: %s [--setting <id>=<value>] [--render] [--frames <n>] "
+                  "[--dump <file.ppm>] [--debug] [trace ...]\n", name);
+}
+
+/*!
+ * @brief Paints as given by CEF on a usual page: caret blink, scrolled
+ * content, animated text in many small pieces and sometimes a popup.
+ */
+bool WriteSynthetic(const std::string& path, int frames)
+{
+  CPaintTraceWriter writer;
+  if (!writer.Open(path, false))
+    return false;
+
+  CefRenderHandler::RectList rects;
+  rects.assign(1, CefRect(0, 0, VIEW_WIDTH, VIEW_HEIGHT));
+  writer.Record(PET_VIEW, rects, nullptr, VIEW_WIDTH, VIEW_HEIGHT);
+
+  for (int frame = 0; frame < frames; ++frame)
+  {
+    rects.clear();
+    switch (frame % 4)
+    {
+      case 0: // Caret
+        rects.emplace_back(200, 300, 2, 18);
+        break;
+      case 1: // Scroll of the content below the page header
+        rects.emplace_back(0, 80, VIEW_WIDTH, VIEW_HEIGHT - 80);
+        break;
+      case 2: // Text animation, above the merge limit of the optimizer
+        for (int i = 0; i < 80; ++i)
+          rects.emplace_back(100 + (i % 20) * 40, 400 + (i / 20) * 20, 30, 16);
+        break;
+      default: // Two separated widgets
+        rects.emplace_back(20, 20, 120, 40);
+        rects.emplace_back(VIEW_WIDTH - 140, VIEW_HEIGHT - 60, 120, 40);
+        break;
+    }
+    writer.Record(PET_VIEW, rects, nullptr, VIEW_WIDTH, VIEW_HEIGHT);
+
+    if (frame % 50 == 10)
+    {
+      rects.assign(1, CefRect(0, 0, 200, 300));
+      writer.Record(PET_POPUP, rects, nullptr, 200, 300);
+    }
+  }
+
+  writer.Close();
+  return true;
+}
+
+bool Replay(const std::string& path,
+            const std::string& name,
+            bool render,
+            const std::string& dump)
+{
+  // Same selection of the settings as done by CRendererClient
+  RendererConfig config;
+  config.fullUploadRatio = float(kodi::GetSettingInt("performance.full_upload_ratio", 70)) / 100.0f;
+  config.tileHash = kodi::GetSettingBoolean("performance.tile_hash");
+
+  CRendererClientMemory renderer(config);
+  renderer.Initialize();
+  renderer.OnPopupShow(nullptr, true);
+  renderer.OnPopupSize(nullptr, CefRect(100, 100, 200, 300));
+
+  CPaintTraceReplay::Result result;
+  if (!CPaintTraceReplay::Run(path, renderer, render, result))
+    return false;
+  CPaintTraceReplay::Log(name, result);
+
+  // Takes the paints after the last frame into the sums
+  renderer.Render();
+  const auto& stats = renderer.TotalStats();
+  kodi::Log(ADDON_LOG_INFO, "%s: %llu dirty rects uploaded as %llu rects%s", name.c_str(),
+            static_cast<unsigned long long>(stats.dirtyRects),
+            static_cast<unsigned long long>(stats.uploadRects),
+            stats.fullUpload ? ", with full uploads" : "");
+
+  return dump.empty() || renderer.DumpFrame(dump);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  bool render = false;
+  int frames = 1000;
+  std::string dump;
+  std::vector<std::string> traces;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--setting") == 0 && hasValue)
+    {
+      const std::string setting = argv[++i];
+      const size_t split = setting.find('=');
+      if (split == std::string::npos)
+      {
+        Usage(argv[0]);
+        return 2;
+      }
+      kodi::headless::SetSetting(setting.substr(0, split), setting.substr(split + 1));
+    }
+    else if (strcmp(argv[i], "--render") == 0)
+      render = true;
+    else if (strcmp(argv[i], "--frames") == 0 && hasValue)
+      frames = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--dump") == 0 && hasValue)
+      dump = argv[++i];
+    else if (strcmp(argv[i], "--debug") == 0)
+      kodi::headless::SetLogLevel(ADDON_LOG_DEBUG);
+    else if (argv[i][0] == '-')
+    {
+      Usage(argv[0]);
+      return 2;
+    }
+    else
+      traces.push_back(argv[i]);
+  }
+
+  if (frames <= 0)
+  {
+    Usage(argv[0]);
+    return 2;
+  }
+
+  bool failed = false;
+  if (traces.empty())
+  {
+    if (!WriteSynthetic(SYNTHETIC_TRACE, frames))
+      return 1;
+    failed |= !Replay(SYNTHETIC_TRACE, "synthetic", render, dump);
+    remove(SYNTHETIC_TRACE);
+  }
+
+  for (const auto& trace : traces)
+    failed |= !Replay(trace, trace, render, dump);
+
+  return failed ? 1 : 0;
+}
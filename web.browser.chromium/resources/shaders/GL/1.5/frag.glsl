@@ -4,16 +4,39 @@
 uniform sampler2D u_sampler;
 uniform bool u_clearColor;
 uniform vec4 u_backgroundColor;
+uniform bool u_swizzle;
+uniform float u_sharpen;
+uniform vec2 u_texelSize;
 
 // varyings
 in vec2 v_coord;
 
 out vec4 fragColor;
 
+vec4 sampleView(vec2 coord)
+{
+  // Texture holds BGRA uploaded as RGBA if swizzle is set
+  vec4 color = texture(u_sampler, coord);
+  return u_swizzle ? color.bgra : color;
+}
+
 void main()
 {
   if (u_clearColor)
     fragColor = u_backgroundColor;
   else
-    fragColor = vec4(texture(u_sampler, v_coord));
+  {
+    vec4 color = sampleView(v_coord);
+    if (u_sharpen > 0.0)
+    {
+      // Upscaled view, unsharp mask against the direct neighbours. Colors
+      // are premultiplied and stay below alpha.
+      vec4 blur = (sampleView(v_coord + vec2(u_texelSize.x, 0.0)) +
+                   sampleView(v_coord - vec2(u_texelSize.x, 0.0)) +
+                   sampleView(v_coord + vec2(0.0, u_texelSize.y)) +
+                   sampleView(v_coord - vec2(0.0, u_texelSize.y))) * 0.25;
+      color.rgb = clamp(color.rgb + (color.rgb - blur.rgb) * u_sharpen, 0.0, color.a);
+    }
+    fragColor = color;
+  }
 }